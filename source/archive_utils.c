@@ -0,0 +1,446 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "archive_utils.h"
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+
+// Size of the buffer used to read compressed data from the file
+#define ARCHIVE_CHUNK_SIZE (64 * 1024)
+
+typedef enum {
+    ARCHIVE_ZIP,
+    ARCHIVE_GZIP,
+    ARCHIVE_NONE
+} _archive_type_;
+
+struct _archive_stream_ {
+    FILE *f;
+    int stored; // 1 if the data isn't compressed
+    z_stream zs;
+    size_t in_left; // Compressed bytes left in the file
+    size_t out_left; // Uncompressed bytes left
+    u8 *in_buffer;
+};
+
+static _archive_type_ ArchiveGetType(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL)
+        return ARCHIVE_NONE;
+
+    char extension[5];
+    size_t i;
+    for (i = 0; (i < sizeof(extension) - 1) && dot[i + 1]; i++)
+        extension[i] = toupper((unsigned char)dot[i + 1]);
+    extension[i] = '\0';
+
+    if (strcmp(extension, "ZIP") == 0)
+        return ARCHIVE_ZIP;
+    if (strcmp(extension, "GZ") == 0)
+        return ARCHIVE_GZIP;
+
+    return ARCHIVE_NONE;
+}
+
+int ArchiveIsSupported(const char *path)
+{
+    return ArchiveGetType(path) != ARCHIVE_NONE;
+}
+
+//------------------------------------------------------------------------------
+
+static u32 ArchiveRead16LE(const u8 *p)
+{
+    return (u32)p[0] | ((u32)p[1] << 8);
+}
+
+static u32 ArchiveRead32LE(const u8 *p)
+{
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16)
+           | ((u32)p[3] << 24);
+}
+
+typedef struct {
+    u32 method;
+    u32 compressed_size;
+    u32 uncompressed_size;
+    u32 local_header_offset;
+} _zip_entry_;
+
+// Finds the first file (not directory) in the central directory of the zip
+// file. Zip64 archives aren't supported, but ROMs are never that big.
+static int ArchiveZipFindEntry(FILE *f, _zip_entry_ *entry,
+                               char *name, size_t name_size)
+{
+    // The End Of Central Directory record is at the end of the file, followed
+    // by a comment of up to 64 KB.
+    const long eocd_size = 22;
+    const long max_search = eocd_size + 0xFFFF;
+
+    if (fseek(f, 0, SEEK_END) != 0)
+        return 0;
+    long file_size = ftell(f);
+    if (file_size < eocd_size)
+        return 0;
+
+    long search_size = (file_size < max_search) ? file_size : max_search;
+    u8 *buffer = malloc(search_size);
+    if (buffer == NULL)
+        return 0;
+
+    int ret = 0;
+
+    if ((fseek(f, file_size - search_size, SEEK_SET) != 0)
+        || (fread(buffer, search_size, 1, f) != 1))
+        goto end;
+
+    long eocd = -1;
+    for (long i = search_size - eocd_size; i >= 0; i--)
+    {
+        if (ArchiveRead32LE(&buffer[i]) == 0x06054B50)
+        {
+            eocd = i;
+            break;
+        }
+    }
+
+    if (eocd == -1)
+        goto end;
+
+    u32 num_entries = ArchiveRead16LE(&buffer[eocd + 10]);
+    u32 cd_offset = ArchiveRead32LE(&buffer[eocd + 16]);
+
+    if (fseek(f, cd_offset, SEEK_SET) != 0)
+        goto end;
+
+    for (u32 n = 0; n < num_entries; n++)
+    {
+        u8 header[46];
+        if (fread(header, sizeof(header), 1, f) != 1)
+            goto end;
+
+        if (ArchiveRead32LE(&header[0]) != 0x02014B50)
+            goto end;
+
+        u32 name_len = ArchiveRead16LE(&header[28]);
+        u32 extra_len = ArchiveRead16LE(&header[30]);
+        u32 comment_len = ArchiveRead16LE(&header[32]);
+
+        char entry_name[MAX_PATHLEN];
+        size_t read_len = (name_len < sizeof(entry_name) - 1) ?
+                          name_len : sizeof(entry_name) - 1;
+        if (fread(entry_name, read_len, 1, f) != 1)
+            goto end;
+        entry_name[read_len] = '\0';
+
+        if (fseek(f, name_len - read_len + extra_len + comment_len,
+                  SEEK_CUR) != 0)
+            goto end;
+
+        // Skip directories
+        if ((read_len > 0) && (entry_name[read_len - 1] == '/'))
+            continue;
+
+        entry->method = ArchiveRead16LE(&header[10]);
+        entry->compressed_size = ArchiveRead32LE(&header[20]);
+        entry->uncompressed_size = ArchiveRead32LE(&header[24]);
+        entry->local_header_offset = ArchiveRead32LE(&header[42]);
+
+        if (name)
+            s_strncpy(name, entry_name, name_size);
+
+        ret = 1;
+        break;
+    }
+
+end:
+    free(buffer);
+    return ret;
+}
+
+// Reads the name of the original file from the header of a gzip file. If it
+// isn't there, the name of the archive without the extension is used.
+static int ArchiveGzipGetFileName(FILE *f, const char *path,
+                                  char *name, size_t name_size)
+{
+    u8 header[10];
+    if (fread(header, sizeof(header), 1, f) != 1)
+        return 0;
+
+    if ((header[0] != 0x1F) || (header[1] != 0x8B))
+        return 0;
+
+    const u8 FEXTRA = BIT(2);
+    const u8 FNAME = BIT(3);
+
+    if (header[3] & FNAME)
+    {
+        if (header[3] & FEXTRA)
+        {
+            u8 xlen[2];
+            if (fread(xlen, sizeof(xlen), 1, f) != 1)
+                return 0;
+            if (fseek(f, ArchiveRead16LE(xlen), SEEK_CUR) != 0)
+                return 0;
+        }
+
+        size_t i = 0;
+        while (1)
+        {
+            int c = fgetc(f);
+            if (c == EOF)
+                return 0;
+            if (i < name_size - 1)
+                name[i++] = c;
+            if (c == '\0')
+                break;
+        }
+        name[i] = '\0';
+        return 1;
+    }
+
+    s_strncpy(name, path, name_size);
+    char *dot = strrchr(name, '.');
+    if (dot)
+        *dot = '\0';
+
+    return 1;
+}
+
+int ArchiveGetFileName(const char *path, char *name, size_t name_size)
+{
+    _archive_type_ type = ArchiveGetType(path);
+    if (type == ARCHIVE_NONE)
+        return 0;
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return 0;
+
+    int ret;
+
+    if (type == ARCHIVE_ZIP)
+    {
+        _zip_entry_ entry;
+        ret = ArchiveZipFindEntry(f, &entry, name, name_size);
+    }
+    else
+    {
+        ret = ArchiveGzipGetFileName(f, path, name, name_size);
+    }
+
+    fclose(f);
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+
+static _archive_stream_ *ArchiveOpenZip(FILE *f, size_t *size_)
+{
+    _zip_entry_ entry;
+    if (ArchiveZipFindEntry(f, &entry, NULL, 0) == 0)
+    {
+        Debug_ErrorMsgArg("Couldn't find any file in the zip archive.");
+        return NULL;
+    }
+
+    if ((entry.method != 0) && (entry.method != Z_DEFLATED))
+    {
+        Debug_ErrorMsgArg("Unsupported zip compression method: %u",
+                          entry.method);
+        return NULL;
+    }
+
+    u8 header[30];
+    if ((fseek(f, entry.local_header_offset, SEEK_SET) != 0)
+        || (fread(header, sizeof(header), 1, f) != 1)
+        || (ArchiveRead32LE(&header[0]) != 0x04034B50))
+    {
+        Debug_ErrorMsgArg("Invalid zip file.");
+        return NULL;
+    }
+
+    u32 skip = ArchiveRead16LE(&header[26]) + ArchiveRead16LE(&header[28]);
+    if (fseek(f, skip, SEEK_CUR) != 0)
+    {
+        Debug_ErrorMsgArg("Invalid zip file.");
+        return NULL;
+    }
+
+    _archive_stream_ *s = calloc(1, sizeof(_archive_stream_));
+    if (s == NULL)
+        return NULL;
+
+    s->f = f;
+    s->stored = (entry.method == 0);
+    s->in_left = entry.compressed_size;
+    s->out_left = entry.uncompressed_size;
+
+    // Raw deflate data, without zlib header
+    if (!s->stored && (inflateInit2(&s->zs, -MAX_WBITS) != Z_OK))
+    {
+        free(s);
+        return NULL;
+    }
+
+    *size_ = entry.uncompressed_size;
+    return s;
+}
+
+static _archive_stream_ *ArchiveOpenGzip(FILE *f, size_t *size_)
+{
+    // The uncompressed size (modulo 2^32) is stored at the end of the file
+    u8 isize[4];
+    if ((fseek(f, -4, SEEK_END) != 0)
+        || (fread(isize, sizeof(isize), 1, f) != 1))
+    {
+        Debug_ErrorMsgArg("Invalid gzip file.");
+        return NULL;
+    }
+
+    long file_size = ftell(f);
+    rewind(f);
+
+    _archive_stream_ *s = calloc(1, sizeof(_archive_stream_));
+    if (s == NULL)
+        return NULL;
+
+    s->f = f;
+    s->stored = 0;
+    s->in_left = file_size;
+    s->out_left = ArchiveRead32LE(isize);
+
+    // Let zlib parse the gzip header
+    if (inflateInit2(&s->zs, MAX_WBITS + 16) != Z_OK)
+    {
+        free(s);
+        return NULL;
+    }
+
+    *size_ = s->out_left;
+    return s;
+}
+
+_archive_stream_ *ArchiveOpen(const char *path, size_t *size_)
+{
+    *size_ = 0;
+
+    _archive_type_ type = ArchiveGetType(path);
+    if (type == ARCHIVE_NONE)
+        return NULL;
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("%s couldn't be opened!", path);
+        return NULL;
+    }
+
+    _archive_stream_ *s;
+    if (type == ARCHIVE_ZIP)
+        s = ArchiveOpenZip(f, size_);
+    else
+        s = ArchiveOpenGzip(f, size_);
+
+    if (s == NULL)
+    {
+        fclose(f);
+        return NULL;
+    }
+
+    if (*size_ == 0)
+    {
+        Debug_ErrorMsgArg("Size of %s is 0!", path);
+        ArchiveClose(s);
+        return NULL;
+    }
+
+    if (!s->stored)
+    {
+        s->in_buffer = malloc(ARCHIVE_CHUNK_SIZE);
+        if (s->in_buffer == NULL)
+        {
+            Debug_ErrorMsgArg("Not enought memory to load %s!", path);
+            ArchiveClose(s);
+            return NULL;
+        }
+    }
+
+    return s;
+}
+
+size_t ArchiveRead(_archive_stream_ *s, void *dest, size_t size)
+{
+    if (size > s->out_left)
+        size = s->out_left;
+
+    if (size == 0)
+        return 0;
+
+    if (s->stored)
+    {
+        if (size > s->in_left)
+            size = s->in_left;
+        size_t done = fread(dest, 1, size, s->f);
+        s->in_left -= done;
+        s->out_left -= done;
+        return done;
+    }
+
+    s->zs.next_out = dest;
+    s->zs.avail_out = size;
+
+    while (s->zs.avail_out > 0)
+    {
+        if ((s->zs.avail_in == 0) && (s->in_left > 0))
+        {
+            size_t chunk = (s->in_left < ARCHIVE_CHUNK_SIZE) ?
+                           s->in_left : ARCHIVE_CHUNK_SIZE;
+            chunk = fread(s->in_buffer, 1, chunk, s->f);
+            if (chunk == 0)
+                break;
+            s->in_left -= chunk;
+            s->zs.next_in = s->in_buffer;
+            s->zs.avail_in = chunk;
+        }
+
+        int ret = inflate(&s->zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END)
+            break;
+        if (ret != Z_OK)
+        {
+            Debug_ErrorMsgArg("Error while decompressing: %s",
+                              s->zs.msg ? s->zs.msg : "Unknown error");
+            break;
+        }
+    }
+
+    size_t done = size - s->zs.avail_out;
+    s->out_left -= done;
+    return done;
+}
+
+void ArchiveClose(_archive_stream_ *s)
+{
+    if (s == NULL)
+        return;
+
+    if (!s->stored)
+        inflateEnd(&s->zs);
+
+    free(s->in_buffer);
+    fclose(s->f);
+    free(s);
+}
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef ARCHIVE_UTILS__
+#define ARCHIVE_UTILS__
+
+#include <stddef.h>
+
+// Support for ROMs inside compressed files. Supported formats are zip (stored
+// or deflate) and gzip. Only the first file inside a zip archive is used.
+
+typedef struct _archive_stream_ _archive_stream_;
+
+// Returns 1 if the extension of the path is one of a supported archive
+int ArchiveIsSupported(const char *path);
+
+// Gets the name of the file inside the archive. Returns 1 on success.
+int ArchiveGetFileName(const char *path, char *name, size_t name_size);
+
+// Opens the file inside the archive for reading. The uncompressed size is
+// returned in size_. Returns NULL on error.
+_archive_stream_ *ArchiveOpen(const char *path, size_t *size_);
+// Decompresses the next "size" bytes of the file. Returns the number of bytes
+// written to dest, which is only smaller than size on error or at the end of
+// the file.
+size_t ArchiveRead(_archive_stream_ *stream, void *dest, size_t size);
+void ArchiveClose(_archive_stream_ *stream);
+
+#endif // ARCHIVE_UTILS__
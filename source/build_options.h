@@ -41,6 +41,16 @@
 #define BIOS_FOLDER "bios"
 #define SCREENSHOT_FOLDER "screenshots"
 
+// Cartridge saves are written to disk when the game hasn't modified them for
+// AUTOSAVE_IDLE_FRAMES frames, or AUTOSAVE_MAX_FRAMES frames after the first
+// unsaved change if the game keeps modifying them. This groups bursts of
+// writes (like a Flash sector erase followed by the new data) in one write.
+#define AUTOSAVE_IDLE_FRAMES (30)
+#define AUTOSAVE_MAX_FRAMES (600)
+
+// Input movies store a hash of the screen every MOVIE_CHECKPOINT_FRAMES frames
+#define MOVIE_CHECKPOINT_FRAMES (60)
+
 //-----------------------------------------
 //----------- GAMEBOY EMULATION -----------
 //-----------------------------------------
@@ -29,6 +29,10 @@ t_config EmulatorConfig = {
     0, // oglfilter
     0, // auto_close_debugger
     0, // webcam_select
+    "", // webcam_source
+    0, // vsync
+    0, // audio_sync
+    0, // run_ahead
     //---------
     64,   // volume
     0x3F, // chn_flags
@@ -36,6 +40,7 @@ t_config EmulatorConfig = {
     //---------
     -1,               // hardware_type
     SERIAL_GBPRINTER, // serial_device
+    "/tmp/giibiiadvance_link.sock", // serial_socket
     0,                // enableblur
     0,                // realcolors
     0x0200,           // gbcam_exposure_reference
@@ -67,6 +72,20 @@ static const char *oglfiltertype[] = {
 #define CFG_WEBCAM_SELECT "webcam_select"
 // "0" - "9"
 
+#define CFG_WEBCAM_SOURCE "webcam_source"
+// Path to a video or image sequence ("frame_%03d.png"). Empty = use webcam
+
+#define CFG_VSYNC "vsync"
+static const char *vsynctype[] = {
+    "off", "on", "adaptive"
+};
+
+#define CFG_AUDIO_SYNC "audio_sync"
+// "true" - "false"
+
+#define CFG_RUN_AHEAD "run_ahead"
+// "0" - "4"
+
 #define CFG_SND_CHN_ENABLE "channels_enabled"
 // "#3F" 3F = flags
 
@@ -83,9 +102,12 @@ static const char *hwtype[] = {
 
 #define CFG_SERIAL_DEVICE "serial_device"
 static const char *serialdevice[] = {
-    "None", "GBPrinter" //, "Gameboy"
+    "None", "GBPrinter", "Gameboy", "Socket"
 };
 
+#define CFG_SERIAL_SOCKET "serial_socket"
+// Path
+
 #define CFG_ENABLE_BLUR "enable_blur"
 // "true" - "false"
 
@@ -130,6 +152,11 @@ void Config_Save(void)
     fprintf(ini_file, CFG_AUTO_CLOSE_DEBUGGER "=%s\n",
             EmulatorConfig.auto_close_debugger ? "true" : "false");
     fprintf(ini_file, CFG_WEBCAM_SELECT "=%d\n", EmulatorConfig.webcam_select);
+    fprintf(ini_file, CFG_WEBCAM_SOURCE "=%s\n", EmulatorConfig.webcam_source);
+    fprintf(ini_file, CFG_VSYNC "=%s\n", vsynctype[EmulatorConfig.vsync]);
+    fprintf(ini_file, CFG_AUDIO_SYNC "=%s\n",
+            EmulatorConfig.audio_sync ? "true" : "false");
+    fprintf(ini_file, CFG_RUN_AHEAD "=%d\n", EmulatorConfig.run_ahead);
     fprintf(ini_file, "\n");
 
     fprintf(ini_file, "[Sound]\n");
@@ -146,6 +173,7 @@ void Config_Save(void)
             hwtype[EmulatorConfig.hardware_type + 1]);
     fprintf(ini_file, CFG_SERIAL_DEVICE "=%s\n",
             serialdevice[EmulatorConfig.serial_device]);
+    fprintf(ini_file, CFG_SERIAL_SOCKET "=%s\n", EmulatorConfig.serial_socket);
     fprintf(ini_file, CFG_ENABLE_BLUR "=%s\n",
             EmulatorConfig.enableblur ? "true" : "false");
     fprintf(ini_file, CFG_REAL_GB_COLORS "=%s\n",
@@ -335,6 +363,54 @@ void Config_Load(void)
             EmulatorConfig.webcam_select = 9;
     }
 
+    tmp = strstr(ini, CFG_WEBCAM_SOURCE);
+    if (tmp)
+    {
+        tmp += strlen(CFG_WEBCAM_SOURCE) + 1;
+
+        size_t len = strcspn(tmp, "\r\n");
+        if (len >= sizeof(EmulatorConfig.webcam_source))
+            len = sizeof(EmulatorConfig.webcam_source) - 1;
+
+        memcpy(EmulatorConfig.webcam_source, tmp, len);
+        EmulatorConfig.webcam_source[len] = '\0';
+    }
+
+    tmp = strstr(ini, CFG_VSYNC);
+    if (tmp)
+    {
+        tmp += strlen(CFG_VSYNC) + 1;
+
+        int result = 0;
+        for (size_t i = 0; i < ARRAY_NUM_ELEMENTS(vsynctype); i++)
+            if (strncmp(tmp, vsynctype[i], strlen(vsynctype[i])) == 0)
+                result = i;
+
+        EmulatorConfig.vsync = result;
+    }
+
+    tmp = strstr(ini, CFG_AUDIO_SYNC);
+    if (tmp)
+    {
+        tmp += strlen(CFG_AUDIO_SYNC) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.audio_sync = 1;
+        else
+            EmulatorConfig.audio_sync = 0;
+    }
+
+    EmulatorConfig.run_ahead = 0;
+    tmp = strstr(ini, CFG_RUN_AHEAD);
+    if (tmp)
+    {
+        tmp += strlen(CFG_RUN_AHEAD) + 1;
+        if ((*tmp >= '0') && (*tmp <= '9'))
+            EmulatorConfig.run_ahead = *tmp - '0';
+
+        if (EmulatorConfig.run_ahead > 4)
+            EmulatorConfig.run_ahead = 4;
+    }
+
     // SOUND
     int vol = 64, chn_flags = 0x3F;
     tmp = strstr(ini, CFG_SND_CHN_ENABLE);
@@ -407,6 +483,19 @@ void Config_Load(void)
         EmulatorConfig.serial_device = result;
     }
 
+    tmp = strstr(ini, CFG_SERIAL_SOCKET);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SERIAL_SOCKET) + 1;
+
+        size_t len = strcspn(tmp, "\r\n");
+        if (len >= sizeof(EmulatorConfig.serial_socket))
+            len = sizeof(EmulatorConfig.serial_socket) - 1;
+
+        memcpy(EmulatorConfig.serial_socket, tmp, len);
+        EmulatorConfig.serial_socket[len] = '\0';
+    }
+
     tmp = strstr(ini, CFG_ENABLE_BLUR);
     if (tmp)
     {
@@ -7,6 +7,8 @@
 #ifndef CONFIG__
 #define CONFIG__
 
+#include "build_options.h"
+
 typedef struct
 {
     int debug_msg_enable;
@@ -17,6 +19,10 @@ typedef struct
     int oglfilter;
     int auto_close_debugger;
     unsigned int webcam_select; // 0 = CV_CAP_ANY
+    char webcam_source[MAX_PATHLEN]; // Video or image sequence used as webcam
+    int vsync; // 0 = off, 1 = on, 2 = adaptive
+    int audio_sync; // The speed of the emulation follows the audio output
+    int run_ahead; // Frames emulated ahead of the real one to reduce latency
 
     // Sound
     //-----
@@ -28,6 +34,7 @@ typedef struct
     //-------
     int hardware_type;
     int serial_device;
+    char serial_socket[MAX_PATHLEN]; // Path of the socket of the link cable
     int enableblur;
     int realcolors;
     unsigned int gbcam_exposure_reference;
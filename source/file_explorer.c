@@ -16,6 +16,7 @@
 # include <dirent.h>
 #endif
 
+#include "archive_utils.h"
 #include "build_options.h"
 #include "general_utils.h"
 #include "file_utils.h"
@@ -25,6 +26,14 @@ static int _file_explorer_is_valid_rom_type(char *name)
     char extension[4];
     size_t len = strlen(name);
 
+    // Don't open archives here to check the name of the file inside them, that
+    // would make loading big folders too slow.
+    if (ArchiveIsSupported(name))
+        return 1;
+
+    if (len < 3)
+        return 0;
+
     extension[3] = '\0';
     extension[2] = toupper(name[len - 1]);
     extension[1] = toupper(name[len - 2]);
@@ -4,6 +4,9 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+// Needed for MAP_ANONYMOUS when building in strict C11 mode
+#define _DEFAULT_SOURCE
+
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,11 +17,25 @@
 
 #if defined(_MSC_VER)
 # include <direct.h>
+# include <io.h>
+# include <windows.h>
+#elif defined(_WIN32)
+# include <io.h>
+# include <unistd.h>
 # include <windows.h>
 #else
 # include <unistd.h>
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+# include <fcntl.h>
+# include <sys/mman.h>
+# define FILE_MAP_USE_MMAP
+# ifndef MAP_ANONYMOUS
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+#endif
+
 #include "build_options.h"
 #include "debug_utils.h"
 #include "general_utils.h"
@@ -174,6 +191,161 @@ void FileLoad(const char *filename, void **buffer, size_t *size_)
     fclose(f);
 }
 
+#ifdef FILE_MAP_USE_MMAP
+
+void *FileMapReadOnly(const char *filename, size_t padded_size,
+                      size_t *size_, size_t *map_size_)
+{
+    *size_ = 0;
+    *map_size_ = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+    {
+        Debug_ErrorMsgArg("%s couldn't be opened!", filename);
+        return NULL;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0))
+    {
+        Debug_ErrorMsgArg("Size of %s is 0!", filename);
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = st.st_size;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t map_size = (size > padded_size) ? size : padded_size;
+    map_size = (map_size + page_size - 1) & ~(page_size - 1);
+
+    // Reserve the whole area with zero pages first, and then map the file over
+    // the start of it. The padding doesn't use any physical memory until it is
+    // read, and then all of it is backed by the same shared zero page.
+    void *base = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+    if (base == MAP_FAILED)
+    {
+        Debug_ErrorMsgArg("Not enought memory to load %s!", filename);
+        close(fd);
+        return NULL;
+    }
+
+    void *ptr = mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        Debug_ErrorMsgArg("Error while reading: %s", filename);
+        munmap(base, map_size);
+        return NULL;
+    }
+
+    *size_ = size;
+    *map_size_ = map_size;
+    return base;
+}
+
+void FileUnmap(void *buffer, size_t map_size)
+{
+    if (buffer)
+        munmap(buffer, map_size);
+}
+
+#else // FILE_MAP_USE_MMAP
+
+// Fallback for systems without mmap(): Load a private copy of the file.
+
+void *FileMapReadOnly(const char *filename, size_t padded_size,
+                      size_t *size_, size_t *map_size_)
+{
+    void *file;
+    size_t size;
+
+    *size_ = 0;
+    *map_size_ = 0;
+
+    FileLoad(filename, &file, &size);
+    if (file == NULL)
+        return NULL;
+
+    if (size >= padded_size)
+    {
+        *size_ = size;
+        *map_size_ = size;
+        return file;
+    }
+
+    u8 *buffer = calloc(1, padded_size);
+    if (buffer == NULL)
+    {
+        Debug_ErrorMsgArg("Not enought memory to load %s!", filename);
+        free(file);
+        return NULL;
+    }
+
+    memcpy(buffer, file, size);
+    free(file);
+
+    *size_ = size;
+    *map_size_ = padded_size;
+    return buffer;
+}
+
+void FileUnmap(void *buffer, size_t map_size)
+{
+    (void)map_size;
+    free(buffer);
+}
+
+#endif // FILE_MAP_USE_MMAP
+
+int FileWriteAtomic(const char *filename, const void *data, size_t size)
+{
+    char temp_name[MAX_PATHLEN + 4];
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", filename);
+
+    FILE *f = fopen(temp_name, "wb");
+    if (f == NULL)
+        return 0;
+
+    int ok = 1;
+
+    if ((size > 0) && (fwrite(data, size, 1, f) != 1))
+        ok = 0;
+
+    // Make sure that the data is in the disk before replacing the old file
+    if (fflush(f) != 0)
+        ok = 0;
+#if defined(_WIN32)
+    if (_commit(_fileno(f)) != 0)
+        ok = 0;
+#else
+    if (fsync(fileno(f)) != 0)
+        ok = 0;
+#endif
+
+    if (fclose(f) != 0)
+        ok = 0;
+
+    if (ok == 0)
+    {
+        remove(temp_name);
+        return 0;
+    }
+
+#if defined(_WIN32)
+    if (MoveFileEx(temp_name, filename, MOVEFILE_REPLACE_EXISTING) == 0)
+#else
+    if (rename(temp_name, filename) != 0)
+#endif
+    {
+        remove(temp_name);
+        return 0;
+    }
+
+    return 1;
+}
+
 int FileExists(const char *filename)
 {
     FILE *f = fopen(filename, "rb");
@@ -293,6 +465,11 @@ int DirCreate(char *path)
 
 static char _fu_filename[MAX_PATHLEN];
 
+// Images are saved in the background, so the file of the last name that has
+// been returned may not exist yet.
+static char _fu_last_prefix[MAX_PATHLEN];
+static long long int _fu_last_number;
+
 char *FU_GetNewTimestampFilename(const char *basename)
 {
     long long int number = 0;
@@ -307,6 +484,11 @@ char *FU_GetNewTimestampFilename(const char *basename)
              1900 + ptm->tm_year, 1 + ptm->tm_mon, ptm->tm_mday,
              1 + ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
 
+    char prefix[MAX_PATHLEN];
+    snprintf(prefix, sizeof(prefix), "%s_%s", basename, timestamp);
+    if (strcmp(prefix, _fu_last_prefix) == 0)
+        number = _fu_last_number + 1;
+
     // Append a number to the name so that we can take multiple screenshots the
     // same second.
     while (1)
@@ -322,5 +504,8 @@ char *FU_GetNewTimestampFilename(const char *basename)
         number++;
     }
 
+    s_strncpy(_fu_last_prefix, prefix, sizeof(_fu_last_prefix));
+    _fu_last_number = number;
+
     return _fu_filename;
 }
@@ -15,6 +15,19 @@ char *DirGetScreenshotFolderPath(void);
 void FileLoad_NoError(const char *filename, void **buffer, size_t *size_);
 void FileLoad(const char *filename, void **buffer, size_t *size_);
 
+// Maps a file as read-only memory. If padded_size is bigger than the size of
+// the file, the returned buffer is padded_size bytes long and the bytes after
+// the end of the file read as zero. The size of the file is returned in size_
+// and the size that has to be passed to FileUnmap() in map_size_. Returns NULL
+// on error. In systems without mmap() this loads a copy of the file.
+void *FileMapReadOnly(const char *filename, size_t padded_size,
+                      size_t *size_, size_t *map_size_);
+void FileUnmap(void *buffer, size_t map_size);
+
+// Writes the data to a temporary file and then renames it to the final name,
+// so that the old file is never left half-written. Returns 1 on success.
+int FileWriteAtomic(const char *filename, const void *data, size_t size);
+
 int FileExists(const char *filename); // Returns 1 if file exists
 
 int PathIsDir(char *path); // Returns 1 if path is a directory
@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug_utils.h"
+#include "frame_hash.h"
+#include "general_utils.h"
+
+// Log format: The first line identifies the version of the log. The hashes of
+// older versions can't be compared with the current ones, so those logs have to
+// be saved again. Lines that start with '#' are comments. The rest of the lines
+// have the frame number (in decimal) and the hashes of the screen and the sound
+// (in hexadecimal, 16 digits).
+
+#define FRAME_HASH_LOG_HEADER \
+    "# Frame hash log v2: frame, screen hash, sound hash\n"
+
+static FILE *frame_hash_log = NULL;
+static FILE *frame_hash_check = NULL;
+static int frame_hash_check_finished = 0;
+static int frame_hash_errors = 0;
+
+static int frame_hash_enabled = 0; // Waiting for a ROM, or hashing it
+static int frame_hash_interval = 1;
+static u32 frame_hash_frame = 0;
+static u64 frame_hash_sound = HASH_INIT;
+
+int FrameHash_LogSet(const char *path)
+{
+    if (frame_hash_log)
+        fclose(frame_hash_log);
+
+    frame_hash_log = fopen(path, "w");
+    if (frame_hash_log == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't open hash log:\n%s", path);
+        return 1;
+    }
+
+    fputs(FRAME_HASH_LOG_HEADER, frame_hash_log);
+
+    frame_hash_enabled = 1;
+    frame_hash_frame = 0;
+    frame_hash_sound = HASH_INIT;
+    return 0;
+}
+
+int FrameHash_CheckSet(const char *path)
+{
+    if (frame_hash_check)
+        fclose(frame_hash_check);
+
+    frame_hash_check = fopen(path, "r");
+    if (frame_hash_check == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't open reference hash log:\n%s", path);
+        return 1;
+    }
+
+    char line[128];
+    if ((fgets(line, sizeof(line), frame_hash_check) == NULL)
+        || (strcmp(line, FRAME_HASH_LOG_HEADER) != 0))
+    {
+        Debug_ErrorMsgArg("Reference hash log saved by a different version:\n"
+                          "%s", path);
+        fclose(frame_hash_check);
+        frame_hash_check = NULL;
+        return 1;
+    }
+
+    frame_hash_check_finished = 0;
+    frame_hash_errors = 0;
+
+    frame_hash_enabled = 1;
+    frame_hash_frame = 0;
+    frame_hash_sound = HASH_INIT;
+    return 0;
+}
+
+void FrameHash_IntervalSet(int frames)
+{
+    if (frames < 1)
+        frames = 1;
+
+    frame_hash_interval = frames;
+}
+
+int FrameHash_CheckFinished(void)
+{
+    return frame_hash_check_finished;
+}
+
+int FrameHash_CheckErrors(void)
+{
+    return frame_hash_errors;
+}
+
+void FrameHash_Stop(void)
+{
+    if (frame_hash_log)
+    {
+        fclose(frame_hash_log);
+        frame_hash_log = NULL;
+    }
+
+    if (frame_hash_check)
+    {
+        fclose(frame_hash_check);
+        frame_hash_check = NULL;
+    }
+
+    frame_hash_enabled = 0;
+}
+
+//----------------------------------------------------------------------------
+
+// Returns 0 on success, 1 at the end of the file.
+static int FrameHash_ReadLine(u32 *frame, u64 *screen, u64 *sound)
+{
+    char line[128];
+
+    while (fgets(line, sizeof(line), frame_hash_check))
+    {
+        if ((line[0] == '#') || (line[0] == '\n') || (line[0] == '\r'))
+            continue;
+
+        char screen_str[17], sound_str[17];
+        if (sscanf(line, "%u %16s %16s", frame, screen_str, sound_str) != 3)
+        {
+            Debug_LogMsgArg("Frame hash: Invalid line: %s", line);
+            return 1;
+        }
+
+        *screen = strtoull(screen_str, NULL, 16);
+        *sound = strtoull(sound_str, NULL, 16);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void FrameHash_Check(u32 frame, u64 screen, u64 sound)
+{
+    u32 ref_frame;
+    u64 ref_screen, ref_sound;
+
+    if (FrameHash_ReadLine(&ref_frame, &ref_screen, &ref_sound) != 0)
+    {
+        Debug_LogMsgArg("Frame hash: End of log at frame %u, %d errors", frame,
+                        frame_hash_errors);
+        frame_hash_check_finished = 1;
+        fclose(frame_hash_check);
+        frame_hash_check = NULL;
+        return;
+    }
+
+    if (ref_frame != frame)
+    {
+        // The log was saved with a different interval, nothing else can be
+        // checked.
+        Debug_LogMsgArg("Frame hash: Expected frame %u, found %u", frame,
+                        ref_frame);
+        frame_hash_errors++;
+        frame_hash_check_finished = 1;
+        fclose(frame_hash_check);
+        frame_hash_check = NULL;
+        return;
+    }
+
+    if (ref_screen != screen)
+    {
+        Debug_LogMsgArg("Frame hash: Frame %u: Screen doesn't match", frame);
+        frame_hash_errors++;
+    }
+    else if (ref_sound != sound)
+    {
+        Debug_LogMsgArg("Frame hash: Frame %u: Sound doesn't match", frame);
+        frame_hash_errors++;
+    }
+}
+
+int FrameHash_FrameStart(void)
+{
+    if (!frame_hash_enabled)
+        return 0;
+
+    u32 frame = frame_hash_frame;
+    u32 interval = frame_hash_interval;
+
+    // Draw the frame before the hashed one too, see FRAME_HASH_DRAW
+    if ((((frame + 1) % interval) == 0) || (((frame + 2) % interval) == 0))
+        return FRAME_HASH_DRAW | FRAME_HASH_END;
+
+    return FRAME_HASH_END;
+}
+
+void FrameHash_FrameEnd(u64 (*screen_hash_fn)(void),
+                        u64 (*sound_hash_fn)(void))
+{
+    if (!frame_hash_enabled)
+        return;
+
+    u32 frame = frame_hash_frame++;
+
+    u64 sound = sound_hash_fn();
+    frame_hash_sound = hash_data(&sound, sizeof(sound), frame_hash_sound);
+
+    if (((frame + 1) % frame_hash_interval) != 0)
+        return;
+
+    u64 screen = screen_hash_fn();
+    sound = frame_hash_sound;
+    frame_hash_sound = HASH_INIT;
+
+    if (frame_hash_log)
+    {
+        fprintf(frame_hash_log, "%u %08X%08X %08X%08X\n", frame,
+                (u32)(screen >> 32), (u32)screen,
+                (u32)(sound >> 32), (u32)sound);
+    }
+
+    if (frame_hash_check)
+        FrameHash_Check(frame, screen, sound);
+}
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef FRAME_HASH__
+#define FRAME_HASH__
+
+#include "general_utils.h"
+
+// Hashes of the screen and the sound of every frame, used to check that the
+// emulation doesn't change without saving screenshots. The hashes can be
+// written to a log file and compared with a log saved by a previous run. Only
+// the ROM that is loaded next is checked.
+//
+// One line is written every "interval" frames. It has the hash of the screen of
+// the last frame and the hash of the sound of all frames since the last line.
+
+// Returns 0 on success
+int FrameHash_LogSet(const char *path);
+int FrameHash_CheckSet(const char *path);
+void FrameHash_IntervalSet(int frames);
+
+// Returns 1 if all the frames in the reference log have been checked
+int FrameHash_CheckFinished(void);
+// Returns the number of frames that didn't match the reference log
+int FrameHash_CheckErrors(void);
+
+// Called when the ROM is unloaded
+void FrameHash_Stop(void);
+
+// Frames don't start at the start of the screen refresh, so the screen that is
+// hashed at the end of a frame is partly drawn during the previous frame. Frame
+// skipping has to be disabled in both of them.
+#define FRAME_HASH_DRAW BIT(0) // Don't skip drawing this frame
+#define FRAME_HASH_END  BIT(1) // Call FrameHash_FrameEnd() after the frame
+
+// Called by the cores
+int FrameHash_FrameStart(void);
+void FrameHash_FrameEnd(u64 (*screen_hash_fn)(void),
+                        u64 (*sound_hash_fn)(void));
+
+#endif // FRAME_HASH__
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <SDL2/SDL.h>
+
+#include "debug_utils.h"
+#include "frame_pacer.h"
+#include "general_utils.h"
+#include "sound_utils.h"
+
+// Sleeping is only accurate to a few milliseconds, so the last part of the wait
+// is done by spinning.
+#define PACER_SPIN_MS           (2)
+
+// Maximum change of the frame period when the audio drives the emulation
+#define PACER_AUDIO_MAX_DELTA   (0.005)
+
+// If the refresh rate of the display is this close to the emulated one, VSync
+// is used to pace the emulation.
+#define PACER_VSYNC_TOLERANCE   (0.01)
+
+static u64 pacer_frequency;     // Ticks per second
+static double pacer_rate = (double)GBA_CLOCKS_PER_SECOND / GBA_CLOCKS_PER_FRAME;
+static double pacer_period;     // Ticks per frame
+
+static u64 pacer_deadline;
+static int pacer_reset = 1;
+
+static int pacer_vsync_refresh_rate = 0;
+static int pacer_vsync_paces = 0;
+static int pacer_audio_sync = 0;
+
+// Fraction of a tick carried to the next frame so that the period doesn't
+// need to be a whole number of ticks.
+static double pacer_remainder = 0.0;
+
+static void FramePacer_Update(void)
+{
+    pacer_period = (double)pacer_frequency / pacer_rate;
+
+    pacer_vsync_paces = 0;
+    if (pacer_vsync_refresh_rate > 0)
+    {
+        double diff = (pacer_vsync_refresh_rate - pacer_rate) / pacer_rate;
+        if ((diff > -PACER_VSYNC_TOLERANCE) && (diff < PACER_VSYNC_TOLERANCE))
+            pacer_vsync_paces = 1;
+    }
+
+    // The audio has to absorb the difference between the two clocks if it
+    // doesn't drive the emulation.
+    Sound_RateControlEnable(!pacer_audio_sync || pacer_vsync_paces);
+}
+
+void FramePacer_Init(void)
+{
+    pacer_frequency = SDL_GetPerformanceFrequency();
+    pacer_reset = 1;
+    FramePacer_Update();
+}
+
+void FramePacer_SetRate(int clocks_per_second, int clocks_per_frame)
+{
+    pacer_rate = (double)clocks_per_second / (double)clocks_per_frame;
+    pacer_reset = 1;
+    FramePacer_Update();
+}
+
+void FramePacer_SetVSync(int refresh_rate)
+{
+    pacer_vsync_refresh_rate = refresh_rate;
+    FramePacer_Update();
+
+    if (pacer_vsync_paces)
+        Debug_LogMsgArg("Frame pacer: Using VSync (%d Hz)", refresh_rate);
+}
+
+void FramePacer_SetAudioSync(int enable)
+{
+    pacer_audio_sync = enable;
+    FramePacer_Update();
+}
+
+void FramePacer_Reset(void)
+{
+    pacer_reset = 1;
+}
+
+void FramePacer_Wait(void)
+{
+    u64 now = SDL_GetPerformanceCounter();
+
+    if (pacer_reset || pacer_vsync_paces)
+    {
+        pacer_reset = 0;
+        pacer_remainder = 0.0;
+        pacer_deadline = now;
+        return;
+    }
+
+    double period = pacer_period;
+
+    if (pacer_audio_sync)
+    {
+        // If the audio buffer is too full, the emulation is going faster than
+        // the audio output, so make this frame a bit longer.
+        period *= 1.0 + (PACER_AUDIO_MAX_DELTA * Sound_GetFillError());
+    }
+
+    period += pacer_remainder;
+    u64 ticks = (u64)period;
+    pacer_remainder = period - (double)ticks;
+
+    pacer_deadline += ticks;
+
+    // If the emulator has missed the deadline by more than a frame, don't try
+    // to catch up by running frames as fast as possible.
+    if (now > pacer_deadline + ticks)
+    {
+        pacer_deadline = now;
+        return;
+    }
+
+    u64 spin_ticks = (pacer_frequency * PACER_SPIN_MS) / 1000;
+
+    while (1)
+    {
+        now = SDL_GetPerformanceCounter();
+        if (now >= pacer_deadline)
+            break;
+
+        u64 remaining = pacer_deadline - now;
+        if (remaining > spin_ticks)
+        {
+            u32 ms = ((remaining - spin_ticks) * 1000) / pacer_frequency;
+            SDL_Delay(ms > 0 ? ms : 1);
+        }
+        else
+        {
+            SDL_Delay(0); // Yield, but don't sleep
+        }
+    }
+}
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef FRAME_PACER__
+#define FRAME_PACER__
+
+// Refresh rate of the emulated systems. Both of them run at ~59.73 Hz.
+#define GBA_CLOCKS_PER_SECOND   (16 * 1024 * 1024)
+#define GBA_CLOCKS_PER_FRAME    (280896)
+#define GB_CLOCKS_PER_SECOND    (4 * 1024 * 1024)
+#define GB_CLOCKS_PER_FRAME     (70224)
+
+// Waits between frames using the high resolution counter of SDL. It sleeps
+// while there is plenty of time left, and it spins for the last part of the
+// wait to avoid the inaccuracy of the OS scheduler.
+
+void FramePacer_Init(void);
+
+// Sets the refresh rate of the system that is being emulated
+void FramePacer_SetRate(int clocks_per_second, int clocks_per_frame);
+
+// Tells the pacer that presenting a frame waits for the vertical blank of a
+// display with the specified refresh rate (0 if VSync is disabled or the rate
+// isn't known). If the rate is close enough to the emulated one, VSync paces
+// the emulation and the audio rate control absorbs the difference.
+void FramePacer_SetVSync(int refresh_rate);
+
+// If enabled, the speed of the emulation is adjusted slightly to keep the
+// audio buffer at its target fill level instead of following the clock of the
+// computer. This avoids pitch changes in the audio.
+void FramePacer_SetAudioSync(int enable);
+
+// Waits until the next frame has to start
+void FramePacer_Wait(void);
+// Starts counting from now, used after the emulation hasn't been throttled
+void FramePacer_Reset(void);
+
+#endif // FRAME_PACER__
@@ -15,6 +15,7 @@
 
 #include "cpu.h"
 #include "gameboy.h"
+#include "state.h"
 
 //------------------------------------------------------------------------------
 
@@ -22,10 +23,17 @@ extern _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
+// All the images are stored row by row so that the filters read them
+// sequentially.
+
 // Webcam image (exposed in gc_core/camera.h, values in the range 0-255)
-int gb_camera_webcam_output[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
+int gb_camera_webcam_output[GBCAM_SENSOR_H][GBCAM_SENSOR_W];
 // Image processed by the retina chip
-static int gb_cam_retina_output_buf[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
+static int gb_cam_retina_output_buf[GBCAM_SENSOR_H][GBCAM_SENSOR_W];
+
+// Intermediate steps of the retina chip (signed values)
+static int gb_cam_sensor_buf[GBCAM_SENSOR_H][GBCAM_SENSOR_W];
+static int gb_cam_temp_buf[GBCAM_SENSOR_H][GBCAM_SENSOR_W];
 
 void GB_CameraEnd(void)
 {
@@ -58,6 +66,11 @@ void GB_CameraWebcamDelayDecrease(void)
 
 static int gb_camera_clock_counter = 0;
 
+void GB_CameraStateRegister(void)
+{
+    GB_StateAddBlock(&gb_camera_clock_counter, sizeof(gb_camera_clock_counter));
+}
+
 void GB_CameraClockCounterReset(void)
 {
     gb_camera_clock_counter = 0;
@@ -111,7 +124,7 @@ int GB_CameraGetClocksToNextEvent(void)
 
 //----------------------------------------------------------------------------
 
-static int gb_clamp_int(int min, int value, int max)
+static inline int gb_clamp_int(int min, int value, int max)
 {
     if (value < min)
         return min;
@@ -121,55 +134,139 @@ static int gb_clamp_int(int min, int value, int max)
     return value;
 }
 
-static int gb_min_int(int a, int b)
+// Copies a row of the image with one extra pixel at each side that repeats the
+// pixel at the border. This way the horizontal filters don't need to check the
+// limits of the row, and the compiler can vectorize them.
+static void gb_cam_row_pad(int *dst, const int *src)
 {
-    return (a < b) ? a : b;
+    dst[0] = src[0];
+    memcpy(&dst[1], src, GBCAM_SENSOR_W * sizeof(int));
+    dst[GBCAM_SENSOR_W + 1] = src[GBCAM_SENSOR_W - 1];
 }
 
-static int gb_max_int(int a, int b)
+// 1-D filtering: P * px + M * ms
+//
+// The P and M bits are converted to a weight (-1, 0 or 1) for the pixel and for
+// the one below it.
+static void gb_cam_filter_1d(int (*dst)[GBCAM_SENSOR_W],
+                             int (*src)[GBCAM_SENSOR_W], int k_px, int k_ms)
 {
-    return (a > b) ? a : b;
+    for (int j = 0; j < GBCAM_SENSOR_H; j++)
+    {
+        const int *row = src[j];
+        const int *row_s = src[gb_clamp_int(0, j + 1, GBCAM_SENSOR_H - 1)];
+        int *out = dst[j];
+
+        for (int i = 0; i < GBCAM_SENSOR_W; i++)
+        {
+            int value = k_px * row[i] + k_ms * row_s[i];
+            out[i] = gb_clamp_int(-128, value, 127) + 128;
+        }
+    }
 }
 
-static u32 gb_cam_matrix_process(u32 value, int x, int y)
+// Horizontal enhancement : P + {2P - (MW + ME)} * alpha
+//
+// alpha is in 1/4 units. The division is done at the end so that the result is
+// truncated like the original floating point version.
+static void gb_cam_filter_horizontal(int (*dst)[GBCAM_SENSOR_W],
+                                     int (*src)[GBCAM_SENSOR_W], int alpha)
 {
-    _GB_CAMERA_CART_ *cam = &GameBoy.Emulator.CAM;
+    int pad[GBCAM_SENSOR_W + 2];
+
+    for (int j = 0; j < GBCAM_SENSOR_H; j++)
+    {
+        gb_cam_row_pad(pad, src[j]);
+        int *out = dst[j];
 
-    x = x & 3;
-    y = y & 3;
+        for (int i = 0; i < GBCAM_SENSOR_W; i++)
+        {
+            int mw = pad[i];
+            int px = pad[i + 1];
+            int me = pad[i + 2];
 
-    int base = 6 + (y * 4 + x) * 3;
+            int value = (4 * px + (2 * px - mw - me) * alpha) / 4;
+            out[i] = gb_clamp_int(0, value, 255);
+        }
+    }
+}
 
-    u32 r0 = cam->reg[base + 0];
-    u32 r1 = cam->reg[base + 1];
-    u32 r2 = cam->reg[base + 2];
+// 2D enhancement : P + {4P - (MN + MS + ME + MW)} * alpha
+static void gb_cam_filter_2d(int (*dst)[GBCAM_SENSOR_W],
+                             int (*src)[GBCAM_SENSOR_W], int alpha)
+{
+    int pad[GBCAM_SENSOR_W + 2];
 
-    if (value < r0)
-        return 0x00;
-    if (value < r1)
-        return 0x40;
-    if (value < r2)
-        return 0x80;
+    for (int j = 0; j < GBCAM_SENSOR_H; j++)
+    {
+        gb_cam_row_pad(pad, src[j]);
+        const int *row_n = src[gb_clamp_int(0, j - 1, GBCAM_SENSOR_H - 1)];
+        const int *row_s = src[gb_clamp_int(0, j + 1, GBCAM_SENSOR_H - 1)];
+        int *out = dst[j];
 
-    return 0xC0;
+        for (int i = 0; i < GBCAM_SENSOR_W; i++)
+        {
+            int mw = pad[i];
+            int px = pad[i + 1];
+            int me = pad[i + 2];
+            int mn = row_n[i];
+            int ms = row_s[i];
+
+            int value = (4 * px + (4 * px - mw - me - mn - ms) * alpha) / 4;
+            out[i] = gb_clamp_int(-128, value, 127) + 128;
+        }
+    }
 }
 
-static void GB_CameraTakePicture(void)
+// Converts the image to Game Boy colors using the controller matrix, and saves
+// it as tiles in the cartridge RAM.
+static void gb_cam_matrix_to_tiles(u8 *dst)
 {
-    // Buffer for the image as seen after processed by the sensor
-    int (*temp_buf)[GBCAM_SENSOR_W];
-    temp_buf = calloc(GBCAM_SENSOR_W * GBCAM_SENSOR_H, sizeof(int));
-
-    // Buffer after controller matrix
-    int (*fourcolorsbuffer)[GBCAM_W];
-    fourcolorsbuffer = calloc(GBCAM_W * GBCAM_H, sizeof(int));
+    _GB_CAMERA_CART_ *cam = &GameBoy.Emulator.CAM;
 
-    if ((temp_buf == NULL) || (fourcolorsbuffer == NULL))
+    for (int j = 0; j < GBCAM_H; j++)
     {
-        Debug_ErrorMsgArg("%s(): Not enough memory.");
-        goto cleanup;
+        const int *row = gb_cam_retina_output_buf
+                                    [j + (GBCAM_SENSOR_EXTRA_LINES / 2)];
+
+        // 4x4 matrix, 3 thresholds per element
+        const u8 *matrix_row = &cam->reg[6 + (j & 3) * 4 * 3];
+
+        u8 *tile_row = &dst[((j >> 3) * (GBCAM_W / 8) * 16) + ((j & 7) * 2)];
+
+        for (int i = 0; i < GBCAM_W; i += 8)
+        {
+            u32 plane0 = 0;
+            u32 plane1 = 0;
+
+            for (int b = 0; b < 8; b++)
+            {
+                const u8 *r = &matrix_row[((i + b) & 3) * 3];
+                u32 value = row[i + b];
+
+                u32 color;
+                if (value < r[0])
+                    color = 3;
+                else if (value < r[1])
+                    color = 2;
+                else if (value < r[2])
+                    color = 1;
+                else
+                    color = 0;
+
+                plane0 = (plane0 << 1) | (color & 1);
+                plane1 = (plane1 << 1) | (color >> 1);
+            }
+
+            u8 *tile = &tile_row[(i >> 3) * 16];
+            tile[0] = plane0;
+            tile[1] = plane1;
+        }
     }
+}
 
+static void GB_CameraTakePicture(void)
+{
     _GB_CAMERA_CART_ *cam = &GameBoy.Emulator.CAM;
 
     //------------------------------------------------
@@ -185,8 +282,8 @@ static void GB_CameraTakePicture(void)
     // -----------------
 
     // Register 0
-    u32 P_bits = 0;
-    u32 M_bits = 0;
+    int P_bits = 0;
+    int M_bits = 0;
 
     switch ((cam->reg[0] >> 1) & 3)
     {
@@ -214,12 +311,12 @@ static void GB_CameraTakePicture(void)
     // Registers 2 and 3
     u32 EXPOSURE_bits = cam->reg[3] | (cam->reg[2] << 8);
 
-    // Register 4
-    const float edge_ratio_lut[8] = {
-        0.50, 0.75, 1.00, 1.25, 2.00, 3.00, 4.00, 5.00
+    // Register 4 (the edge ratio is in 1/4 units: 0.50, 0.75, 1.00, ...)
+    const int edge_ratio_lut[8] = {
+        2, 3, 4, 5, 8, 12, 16, 20
     };
 
-    float EDGE_alpha = edge_ratio_lut[(cam->reg[4] & 0x70) >> 4];
+    int EDGE_alpha = edge_ratio_lut[(cam->reg[4] & 0x70) >> 4];
 
     u32 E3_bit = (cam->reg[4] & BIT(7)) >> 7;
     u32 I_bit = (cam->reg[4] & BIT(3)) >> 3;
@@ -236,42 +333,38 @@ static void GB_CameraTakePicture(void)
     // Sensor handling
     // ---------------
 
-    // Copy webcam buffer to sensor buffer applying color correction and
-    // exposure time
-    for (int i = 0; i < GBCAM_SENSOR_W; i++)
+    // The exposure time, the voltage adaptation, the inversion and the
+    // conversion to signed values only depend on the value of the pixel, so
+    // they are calculated once for each possible value.
+    int sensor_lut[256];
+    for (int i = 0; i < 256; i++)
     {
-        for (int j = 0; j < GBCAM_SENSOR_H; j++)
-        {
-            int value = gb_camera_webcam_output[i][j];
-            value = (value * EXPOSURE_bits)
+        int value = (i * EXPOSURE_bits)
                     / EmulatorConfig.gbcam_exposure_reference;
 
-            value = 128 + (((value - 128) * 1) / 8); // "adapt" to "3.1"/5.0 V
-            gb_cam_retina_output_buf[i][j] = gb_clamp_int(0, value, 255);
-        }
+        value = 128 + (((value - 128) * 1) / 8); // "adapt" to "3.1"/5.0 V
+        value = gb_clamp_int(0, value, 255);
+
+        if (I_bit) // Invert image
+            value = 255 - value;
+
+        sensor_lut[i] = value - 128; // Make signed
     }
 
-    if (I_bit) // Invert image
+    for (int j = 0; j < GBCAM_SENSOR_H; j++)
     {
         for (int i = 0; i < GBCAM_SENSOR_W; i++)
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                gb_cam_retina_output_buf[i][j] =
-                        255 - gb_cam_retina_output_buf[i][j];
-            }
+            int value = gb_camera_webcam_output[j][i] & 0xFF;
+            gb_cam_sensor_buf[j][i] = sensor_lut[value];
         }
     }
 
-    // Make signed
-    for (int i = 0; i < GBCAM_SENSOR_W; i++)
-    {
-        for (int j = 0; j < GBCAM_SENSOR_H; j++)
-        {
-            gb_cam_retina_output_buf[i][j] =
-                    gb_cam_retina_output_buf[i][j] - 128;
-        }
-    }
+    // The filters write the result to gb_cam_retina_output_buf, already
+    // converted back to unsigned values.
+
+    int k_px = (P_bits & BIT(0)) - (M_bits & BIT(0));
+    int k_ms = ((P_bits & BIT(1)) - (M_bits & BIT(1))) / 2;
 
     u32 filtering_mode = (N_bit << 3) | (VH_bits << 1) | E3_bit;
     switch (filtering_mode)
@@ -279,104 +372,26 @@ static void GB_CameraTakePicture(void)
         // 1-D filtering
         case 0x0:
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    temp_buf[j][i] = gb_cam_retina_output_buf[i][j];
-                }
-            }
-
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int ms = temp_buf[gb_min_int(j + 1, GBCAM_SENSOR_H - 1)][i];
-                    int px = temp_buf[j][i];
-
-                    int value = 0;
-                    if (P_bits & BIT(0))
-                        value += px;
-                    if (P_bits & BIT(1))
-                        value += ms;
-                    if (M_bits & BIT(0))
-                        value -= px;
-                    if (M_bits & BIT(1))
-                        value -= ms;
-                    gb_cam_retina_output_buf[i][j] =
-                            gb_clamp_int(-128, value, 127);
-                }
-            }
+            gb_cam_filter_1d(gb_cam_retina_output_buf, gb_cam_sensor_buf,
+                             k_px, k_ms);
             break;
         }
 
         // 1-D filtering + Horiz. enhancement : P + {2P - (MW + ME)} * alpha
         case 0x2:
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int mw = gb_cam_retina_output_buf[gb_max_int(0, i - 1)][j];
-                    int me = gb_cam_retina_output_buf
-                            [gb_min_int(i + 1, GBCAM_SENSOR_W - 1)][j];
-                    int px = gb_cam_retina_output_buf[i][j];
-
-                    temp_buf[j][i] = gb_clamp_int(0,
-                            px + ((2 * px - mw - me) * EDGE_alpha),
-                            255);
-                }
-            }
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int ms = temp_buf[gb_min_int(j + 1, GBCAM_SENSOR_H - 1)][i];
-                    int px = temp_buf[j][i];
-
-                    int value = 0;
-                    if (P_bits & BIT(0))
-                        value += px;
-                    if (P_bits & BIT(1))
-                        value += ms;
-                    if (M_bits & BIT(0))
-                        value -= px;
-                    if (M_bits & BIT(1))
-                        value -= ms;
-                    gb_cam_retina_output_buf[i][j] =
-                            gb_clamp_int(-128, value, 127);
-                }
-            }
+            gb_cam_filter_horizontal(gb_cam_temp_buf, gb_cam_sensor_buf,
+                                     EDGE_alpha);
+            gb_cam_filter_1d(gb_cam_retina_output_buf, gb_cam_temp_buf,
+                             k_px, k_ms);
             break;
         }
 
         // 2D enhancement : P + {4P - (MN + MS + ME + MW)} * alpha
         case 0xE:
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int ms = gb_cam_retina_output_buf[i]
-                            [gb_min_int(j + 1, GBCAM_SENSOR_H - 1)];
-                    int mn = gb_cam_retina_output_buf[i][gb_max_int(0, j - 1)];
-                    int mw = gb_cam_retina_output_buf[gb_max_int(0, i - 1)][j];
-                    int me = gb_cam_retina_output_buf
-                            [gb_min_int(i + 1, GBCAM_SENSOR_W - 1)][j];
-                    int px = gb_cam_retina_output_buf[i][j];
-
-                    temp_buf[j][i] = gb_clamp_int(-128,
-                            px + ((4 * px - mw - me - mn - ms) * EDGE_alpha),
-                            127);
-                }
-            }
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    gb_cam_retina_output_buf[i][j] = temp_buf[j][i];
-                }
-            }
+            gb_cam_filter_2d(gb_cam_retina_output_buf, gb_cam_sensor_buf,
+                             EDGE_alpha);
             break;
         }
 
@@ -388,9 +403,7 @@ static void GB_CameraTakePicture(void)
             for (int j = 0; j < GBCAM_SENSOR_H; j++)
             {
                 for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    gb_cam_retina_output_buf[i][j] = 0;
-                }
+                    gb_cam_retina_output_buf[j][i] = 128;
             }
             break;
         }
@@ -403,17 +416,16 @@ static void GB_CameraTakePicture(void)
                               filtering_mode, cam->reg[0], cam->reg[1],
                               cam->reg[2], cam->reg[3], cam->reg[4],
                               cam->reg[5]);
-            break;
-        }
-    }
 
-    // Make unsigned
-    for (int j = 0; j < GBCAM_SENSOR_H; j++)
-    {
-        for (int i = 0; i < GBCAM_SENSOR_W; i++)
-        {
-            gb_cam_retina_output_buf[i][j] =
-                    gb_cam_retina_output_buf[i][j] + 128;
+            for (int j = 0; j < GBCAM_SENSOR_H; j++)
+            {
+                for (int i = 0; i < GBCAM_SENSOR_W; i++)
+                {
+                    gb_cam_retina_output_buf[j][i] =
+                            gb_cam_sensor_buf[j][i] + 128;
+                }
+            }
+            break;
         }
     }
 
@@ -422,43 +434,7 @@ static void GB_CameraTakePicture(void)
     // Controller handling
     // -------------------
 
-    // Convert to Game Boy colors using the controller matrix
-    for (int j = 0; j < GBCAM_H; j++)
-    {
-        for (int i = 0; i < GBCAM_W; i++)
-        {
-            int v;
-            v = gb_cam_retina_output_buf[i][j + (GBCAM_SENSOR_EXTRA_LINES / 2)];
-            fourcolorsbuffer[j][i] = gb_cam_matrix_process(v, i, j);
-        }
-    }
-
-    // Convert to tiles
-    u8 finalbuffer[14][16][16]; // Final buffer
-    memset(finalbuffer, 0, sizeof(finalbuffer));
-    for (int j = 0; j < GBCAM_H; j++)
-    {
-        for (int i = 0; i < GBCAM_W; i++)
-        {
-            u8 outcolor = 3 - (fourcolorsbuffer[j][i] >> 6);
-
-            u8 *tile_base = finalbuffer[j >> 3][i >> 3];
-            tile_base = &tile_base[(j & 7) * 2];
-
-            if (outcolor & 1)
-                tile_base[0] |= 1 << (7 - (7 & i));
-            if (outcolor & 2)
-                tile_base[1] |= 1 << (7 - (7 & i));
-        }
-    }
-
-    // Copy to cart ram...
-    memcpy(&(GameBoy.Memory.ExternRAM[0][0xA100 - 0xA000]), finalbuffer,
-           sizeof(finalbuffer));
-
-cleanup:
-    free(temp_buf);
-    free(fourcolorsbuffer);
+    gb_cam_matrix_to_tiles(&(GameBoy.Memory.ExternRAM[0][0xA100 - 0xA000]));
 }
 
 int GB_CameraReadRegister(int address)
@@ -512,11 +488,11 @@ int GB_MapperIsGBCamera(void)
 
 int GB_CameraWebcamImageGetPixel(int x, int y)
 {
-    return gb_camera_webcam_output[x][y + (GBCAM_SENSOR_EXTRA_LINES / 2)];
+    return gb_camera_webcam_output[y + (GBCAM_SENSOR_EXTRA_LINES / 2)][x];
 }
 
 int GB_CameraRetinaProcessedImageGetPixel(int x, int y)
 {
     // 4 extra rows, 2 on each border
-    return gb_cam_retina_output_buf[x][y + (GBCAM_SENSOR_EXTRA_LINES / 2)];
+    return gb_cam_retina_output_buf[y + (GBCAM_SENSOR_EXTRA_LINES / 2)][x];
 }
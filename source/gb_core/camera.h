@@ -19,13 +19,14 @@
 
 //----------------------------------------------------------------
 
-// Values in range 0-255
-extern int gb_camera_webcam_output[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
+// Values in range 0-255, stored row by row
+extern int gb_camera_webcam_output[GBCAM_SENSOR_H][GBCAM_SENSOR_W];
 
 //----------------------------------------------------------------
 
 int GB_CameraInit(void);
 void GB_CameraEnd(void);
+void GB_CameraStateRegister(void);
 
 int GB_CameraReadRegister(int address);
 void GB_CameraWriteRegister(int address, int value);
@@ -4,9 +4,14 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
 #include "../build_options.h"
 #include "../debug_utils.h"
 #include "../general_utils.h"
+#include "../profiler.h"
 
 #include "camera.h"
 #include "cpu.h"
@@ -15,12 +20,14 @@
 #include "gameboy.h"
 #include "gb_main.h"
 #include "general.h"
+#include "idle_loop.h"
 #include "interrupts.h"
 #include "memory.h"
 #include "ppu.h"
 #include "serial.h"
 #include "sgb.h"
 #include "sound.h"
+#include "state.h"
 
 #include "../gui/win_gb_debugger.h"
 
@@ -142,9 +149,276 @@ void GB_UpdateCounterToClocks(int reference_clocks)
 
 //----------------------------------------------------------------
 
+// Block cache
+// -----------
+//
+// Code that runs from ROM, WRAM bank 1 and HRAM is split in blocks of
+// instructions that run one after the other: a block ends at the first
+// instruction that can change the PC or needs to exit the CPU loop (jumps,
+// calls, returns, HALT, STOP and EI). The opcodes of each block are decoded
+// once and saved in a cache indexed by the host address of the first byte of
+// the block, so the same PC in different ROM or WRAM banks uses different
+// blocks.
+//
+// A block only starts if its worst case number of clocks fits before the next
+// event, so its instructions don't need to check the clock counter or to fetch
+// their opcode. The handlers still add their clocks one memory access at a
+// time, so the hardware sees the accesses at the same time as without blocks.
+// Operands are still read with GB_CPUFetch8().
+//
+// ROM can't change, so ROM blocks are valid until the next call to
+// GB_CPUInit(). Blocks in RAM end at the first instruction that can write to
+// memory, and they keep a copy of their bytes to check that they are still
+// valid before running them. Bank switches end the current block.
+//
+// The cache is only used when opcodes can be read directly from memory (see
+// GB_CPUFetch8()). It is also disabled when there are breakpoints or PC hooks,
+// because they need to see every instruction.
+
+#define GB_CPU_BLOCK_MAX_INSTRUCTIONS   16
+#define GB_CPU_BLOCK_MAX_SIZE           (GB_CPU_BLOCK_MAX_INSTRUCTIONS * 3)
+#define GB_CPU_BLOCK_CACHE_BITS         11
+#define GB_CPU_BLOCK_CACHE_SIZE         (1 << GB_CPU_BLOCK_CACHE_BITS)
+
+typedef struct
+{
+    const u8 *code;         // Host address of the first byte, NULL if unused
+    int clocks;             // Worst case number of clocks of the block
+    u8 num_instructions;    // 0 if the first instruction can't be in a block
+    u8 size;                // Size in bytes
+    u8 opcodes[GB_CPU_BLOCK_MAX_INSTRUCTIONS];
+    u8 bytes[GB_CPU_BLOCK_MAX_SIZE]; // Copy of the code of blocks in RAM
+} _gb_cpu_block_;
+
+static _gb_cpu_block_ gb_cpu_block_cache[GB_CPU_BLOCK_CACHE_SIZE];
+
+static int gb_cpu_block_cache_enabled = 0;
+
+// Instructions of the current block that haven't been started yet
+static int gb_cpu_block_left = 0;
+static const u8 *gb_cpu_block_opcode;
+
+// Size of each instruction in bytes. Undefined opcodes are 0.
+static const u8 gb_cpu_opcode_size[256] = {
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,
+    1, 1, 3, 0, 3, 1, 2, 1, 1, 1, 3, 0, 3, 0, 2, 1,
+    2, 1, 1, 0, 0, 1, 2, 1, 2, 1, 3, 0, 0, 0, 2, 1,
+    2, 1, 1, 1, 0, 1, 2, 1, 2, 1, 3, 1, 0, 0, 2, 1
+};
+
+// Worst case number of clocks of each instruction. The one of 0xCB depends on
+// the second byte, this is the worst case of all of them.
+static const u8 gb_cpu_opcode_clocks[256] = {
+     4, 12,  8,  8,  4,  4,  8,  4, 20,  8,  8,  8,  4,  4,  8,  4,
+     8, 12,  8,  8,  4,  4,  8,  4, 12,  8,  8,  8,  4,  4,  8,  4,
+    12, 12,  8,  8,  4,  4,  8,  4, 12,  8,  8,  8,  4,  4,  8,  4,
+    12, 12,  8,  8, 12, 12, 12,  4, 12,  8,  8,  8,  4,  4,  8,  4,
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+     8,  8,  8,  8,  8,  8,  4,  8,  4,  4,  4,  4,  4,  4,  8,  4,
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,
+    20, 12, 16, 16, 24, 16,  8, 16, 20, 16, 16, 16, 24, 24,  8, 16,
+    20, 12, 16,  0, 24, 16,  8, 16, 20, 16, 16,  0, 24,  0,  8, 16,
+    12, 12,  8,  0,  0, 16,  8, 16, 16,  4, 16,  0,  0,  0,  8, 16,
+    12, 12,  8,  4,  0, 16,  8, 16, 12,  8, 16,  4,  0,  0,  8, 16
+};
+
+// Returns 1 if the instruction has to be the last one of a block
+static int GB_CPUBlockOpcodeIsLast(u32 opcode)
+{
+    switch (opcode)
+    {
+        case 0x10: // STOP
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+        case 0x76: // HALT
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: // RET
+        case 0xD9: // RETI
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: // JP
+        case 0xE9: // JP HL
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC: // CALL
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: // RST
+        case 0xE7: case 0xEF: case 0xF7: case 0xFF: // RST
+        case 0xFB: // EI
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Returns 1 if the instruction can write to memory. 0xCB is handled by the
+// caller. Calls and RST instructions are always the last one of a block.
+static int GB_CPUBlockOpcodeWrites(u32 opcode)
+{
+    switch (opcode)
+    {
+        case 0x02: case 0x12: case 0x22: case 0x32: // LD [r16],A
+        case 0x08: // LD [nnnn],SP
+        case 0x34: case 0x35: case 0x36: // INC/DEC/LD [HL]
+        case 0x70: case 0x71: case 0x72: case 0x73: // LD [HL],r8
+        case 0x74: case 0x75: case 0x77:
+        case 0xC5: case 0xD5: case 0xE5: case 0xF5: // PUSH
+        case 0xE0: case 0xE2: case 0xEA: // LD [FF00+n],A; LD [C],A; LD [nnnn],A
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static u32 GB_CPUBlockCacheIndex(const u8 *code)
+{
+    u32 key = (u32)(uintptr_t)code;
+
+    return (key * 0x9E3779B1) >> (32 - GB_CPU_BLOCK_CACHE_BITS);
+}
+
+static void GB_CPUBlockCacheFlush(void)
+{
+    memset(gb_cpu_block_cache, 0, sizeof(gb_cpu_block_cache));
+    gb_cpu_block_left = 0;
+}
+
+void GB_CPUBreakBlock(void)
+{
+    gb_cpu_block_left = 0;
+}
+
+// Decodes the block that starts at the given address. max_size is the number
+// of bytes until the end of the memory area.
+static void GB_CPUBlockDecode(_gb_cpu_block_ *block, const u8 *code,
+                              u32 max_size, int is_ram)
+{
+    u32 size = 0;
+    int clocks = 0;
+    int num = 0;
+
+    while (num < GB_CPU_BLOCK_MAX_INSTRUCTIONS)
+    {
+        u32 opcode = code[size];
+        u32 opcode_size = gb_cpu_opcode_size[opcode];
+
+        if ((opcode_size == 0) || (size + opcode_size > max_size))
+            break;
+
+        int opcode_clocks = gb_cpu_opcode_clocks[opcode];
+        int writes = GB_CPUBlockOpcodeWrites(opcode);
+
+        if (opcode == 0xCB)
+        {
+            u32 opcode_cb = code[size + 1];
+
+            if ((opcode_cb & 7) != 6) // Register
+                opcode_clocks = 8;
+            else if ((opcode_cb & 0xC0) == 0x40) // BIT n,[HL]
+                opcode_clocks = 12;
+            else
+                writes = 1;
+        }
+
+        block->opcodes[num++] = opcode;
+        size += opcode_size;
+        clocks += opcode_clocks;
+
+        if (GB_CPUBlockOpcodeIsLast(opcode))
+            break;
+
+        // The write could modify the next instructions
+        if (is_ram && writes)
+            break;
+    }
+
+    // RAM can change, so don't remember that it had no valid block
+    block->code = ((num == 0) && is_ram) ? NULL : code;
+    block->clocks = clocks;
+    block->num_instructions = num;
+    block->size = size;
+
+    if (is_ram)
+        memcpy(block->bytes, code, size);
+}
+
+// Starts the block at the given address if it can run in the given number of
+// clocks. It returns the first opcode of the block, or -1 if the instruction
+// has to be fetched and run on its own.
+static int GB_CPUBlockStart(u32 address, int clocks)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    const u8 *code;
+    u32 end;
+    int is_ram = 0;
+
+    switch (address >> 12)
+    {
+        case 0x0:
+        case 0x1:
+        case 0x2:
+        case 0x3: // 16KB ROM Bank 00
+            code = &mem->ROM_Base[address];
+            end = 0x4000;
+            break;
+        case 0x4:
+        case 0x5:
+        case 0x6:
+        case 0x7: // 16KB ROM Bank 01..NN
+            code = &mem->ROM_Curr[address - 0x4000];
+            end = 0x8000;
+            break;
+        case 0xD: // 4KB Work RAM Bank 1
+            code = &mem->WorkRAM_Curr[address - 0xD000];
+            end = 0xE000;
+            is_ram = 1;
+            break;
+        case 0xF:
+            if ((address >= 0xFF80) && (address < 0xFFFF)) // High RAM
+            {
+                code = &mem->HighRAM[address - 0xFF80];
+                end = 0xFFFF; // IE isn't code
+                is_ram = 1;
+                break;
+            }
+            return -1;
+        default:
+            return -1;
+    }
+
+    _gb_cpu_block_ *block = &gb_cpu_block_cache[GB_CPUBlockCacheIndex(code)];
+
+    if ((block->code != code)
+        || (is_ram && (memcmp(block->bytes, code, block->size) != 0)))
+    {
+        GB_CPUBlockDecode(block, code, end - address, is_ram);
+    }
+
+    if ((block->num_instructions == 0) || (block->clocks > clocks))
+        return -1;
+
+    gb_cpu_block_left = block->num_instructions - 1;
+    gb_cpu_block_opcode = &block->opcodes[1];
+
+    return block->opcodes[0];
+}
+
+//----------------------------------------------------------------
+
 void GB_CPUInit(void)
 {
     GB_ClockCountersReset();
+    GB_CPUBlockCacheFlush();
 
     gb_break_cpu_loop = 0;
     gb_last_residual_clocks = 0;
@@ -258,13 +532,63 @@ void _gb_break_to_debugger(void)
 
 //----------------------------------------------------------------
 
+// Code fetch
+// ----------
+//
+// Opcodes and their operands are read from ROM or RAM almost all the time. In
+// those areas the read handlers don't have any side effects, so the fetch can
+// read the memory directly instead of going through the watchpoint check and
+// the read handler of the hardware. ROM_Curr and WorkRAM_Curr always point to
+// the banks that are currently mapped, so bank switches don't need to
+// invalidate anything. WRAM bank 0 isn't included because OAM DMA can block it
+// in GBC mode.
+//
+// The direct path is disabled while the boot ROM is mapped and when there are
+// watchpoints. Both states can only change when the CPU loop is interrupted.
+
+static int gb_cpu_fetch_direct = 0;
+
+static u32 GB_CPUFetch8(u32 address)
+{
+    if (gb_cpu_fetch_direct)
+    {
+        _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+        switch (address >> 12)
+        {
+            case 0x0:
+            case 0x1:
+            case 0x2:
+            case 0x3: // 16KB ROM Bank 00
+                return mem->ROM_Base[address];
+            case 0x4:
+            case 0x5:
+            case 0x6:
+            case 0x7: // 16KB ROM Bank 01..NN
+                return mem->ROM_Curr[address - 0x4000];
+            case 0xD: // 4KB Work RAM Bank 1
+                return mem->WorkRAM_Curr[address - 0xD000];
+            case 0xF:
+                if (address >= 0xFF80) // High RAM (and IE)
+                    return mem->HighRAM[address - 0xFF80];
+                break;
+            default:
+                break;
+        }
+    }
+
+    return GB_MemRead8(address);
+}
+
+//----------------------------------------------------------------
+
 // LD r16,nnnn - 3
 #define gb_ld_r16_nnnn(reg_hi, reg_low)                                        \
     {                                                                          \
         GB_CPUClockCounterAdd(4);                                              \
-        reg_low = GB_MemRead8(cpu->R16.PC++);                                  \
+        reg_low = GB_CPUFetch8(cpu->R16.PC++);                                 \
         GB_CPUClockCounterAdd(4);                                              \
-        reg_hi = GB_MemRead8(cpu->R16.PC++);                                   \
+        reg_hi = GB_CPUFetch8(cpu->R16.PC++);                                  \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
@@ -272,7 +596,7 @@ void _gb_break_to_debugger(void)
 #define gb_ld_r8_nn(reg8)                                                      \
     {                                                                          \
         GB_CPUClockCounterAdd(4);                                              \
-        reg8 = GB_MemRead8(cpu->R16.PC++);                                     \
+        reg8 = GB_CPUFetch8(cpu->R16.PC++);                                    \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
@@ -469,9 +793,9 @@ void _gb_break_to_debugger(void)
         if (cond)                                                              \
         {                                                                      \
             GB_CPUClockCounterAdd(4);                                          \
-            u32 temp = GB_MemRead8(cpu->R16.PC++);                             \
+            u32 temp = GB_CPUFetch8(cpu->R16.PC++);                            \
             GB_CPUClockCounterAdd(4);                                          \
-            temp |= ((u32)GB_MemRead8(cpu->R16.PC++)) << 8;                    \
+            temp |= ((u32)GB_CPUFetch8(cpu->R16.PC++)) << 8;                   \
             GB_CPUClockCounterAdd(8);                                          \
             cpu->R16.SP--;                                                     \
             cpu->R16.SP &= 0xFFFF;                                             \
@@ -518,9 +842,9 @@ void _gb_break_to_debugger(void)
         if (cond)                                                              \
         {                                                                      \
             GB_CPUClockCounterAdd(4);                                          \
-            u32 temp = GB_MemRead8(cpu->R16.PC++);                             \
+            u32 temp = GB_CPUFetch8(cpu->R16.PC++);                            \
             GB_CPUClockCounterAdd(4);                                          \
-            temp |= ((u32)GB_MemRead8(cpu->R16.PC++)) << 8;                    \
+            temp |= ((u32)GB_CPUFetch8(cpu->R16.PC++)) << 8;                   \
             GB_CPUClockCounterAdd(4);                                          \
             cpu->R16.PC = temp;                                                \
             GB_CPUClockCounterAdd(4);                                          \
@@ -539,7 +863,7 @@ void _gb_break_to_debugger(void)
         if (cond)                                                              \
         {                                                                      \
             GB_CPUClockCounterAdd(4);                                          \
-            u32 temp = GB_MemRead8(cpu->R16.PC++);                             \
+            u32 temp = GB_CPUFetch8(cpu->R16.PC++);                            \
             cpu->R16.PC = (cpu->R16.PC + (s8)temp) & 0xFFFF;                   \
             GB_CPUClockCounterAdd(8);                                          \
         }                                                                      \
@@ -699,6 +1023,260 @@ void _gb_break_to_debugger(void)
 
 //----------------------------------------------------------------
 
+// Idle loop detection
+// -------------------
+//
+// Games usually wait for VBlank by polling LY or STAT, or by polling a flag in
+// RAM that is set by an interrupt handler, instead of using HALT. If the loop
+// doesn't write to memory, only reads from memory that can't change until the
+// next event, and the CPU registers are the same at the end of two consecutive
+// iterations, the CPU can skip all the clocks until the next event. LY, STAT and
+// IF can also change at any PPU mode change, so the skip stops there too.
+
+#define IDLE_LOOP_MAX_SIZE (16) // In bytes
+
+static int idle_loop_valid;
+static u32 idle_loop_branch_pc;
+static u32 idle_loop_regs[6];
+
+void GB_CPUStateRegister(void)
+{
+    GB_StateAddBlock(&gb_last_residual_clocks,
+                     sizeof(gb_last_residual_clocks));
+    GB_StateAddBlock(&gb_cpu_clock_counter, sizeof(gb_cpu_clock_counter));
+    GB_StateAddBlock(&idle_loop_valid, sizeof(idle_loop_valid));
+    GB_StateAddBlock(&idle_loop_branch_pc, sizeof(idle_loop_branch_pc));
+    GB_StateAddBlock(idle_loop_regs, sizeof(idle_loop_regs));
+}
+
+static void GB_CPUIdleLoopReset(void)
+{
+    idle_loop_valid = 0;
+}
+
+// Call after a backwards jump. Returns 1 if the loop can't exit until the next
+// event happens.
+static int GB_CPUIdleLoopCheck(u32 branch_pc)
+{
+    _GB_CPU_ *cpu = &GameBoy.CPU;
+
+    u32 target = cpu->R16.PC;
+
+    if ((target > branch_pc) || ((branch_pc - target) > IDLE_LOOP_MAX_SIZE))
+        return 0;
+
+    // Skipping the loop would also skip the accesses that watchpoints check
+    if (gb_debug_watchpoints_armed)
+        return 0;
+
+    // OAM DMA runs in parallel with the CPU
+    if (GameBoy.Emulator.OAM_DMA_enabled)
+        return 0;
+
+    const u32 regs[6] = {
+        cpu->R16.AF, cpu->R16.BC, cpu->R16.DE,
+        cpu->R16.HL, cpu->R16.SP, cpu->R16.PC
+    };
+
+    // Only analyze the loop if nothing has changed since the last iteration
+
+    if (idle_loop_valid && (idle_loop_branch_pc == branch_pc)
+        && (memcmp(idle_loop_regs, regs, sizeof(idle_loop_regs)) == 0))
+    {
+        idle_loop_valid = 0;
+        return GB_IdleLoopBodyIsSafe(branch_pc, target);
+    }
+
+    idle_loop_valid = 1;
+    idle_loop_branch_pc = branch_pc;
+    memcpy(idle_loop_regs, regs, sizeof(idle_loop_regs));
+
+    return 0;
+}
+
+//----------------------------------------------------------------
+
+#ifdef ENABLE_PROFILER
+
+// Profiler keys are the address of the instruction, with the ROM bank in the
+// top 16 bits for code in the switchable ROM bank.
+
+static u32 GB_ProfilerKey(u32 address)
+{
+    if ((address >= 0x4000) && (address < 0x8000))
+        return address | (GameBoy.Memory.selected_rom << 16);
+    return address;
+}
+
+static void GB_ProfilerDisassemble(u32 key, char *dest, int dest_size)
+{
+    // This is called right after executing the instruction, so the mapping
+    // of the memory is still the same.
+    int step;
+    s_strncpy(dest, GB_Dissasemble(key & 0xFFFF, &step), dest_size);
+}
+
+static void GB_ProfilerFormatKey(u32 key, char *dest, int dest_size)
+{
+    if (key > 0xFFFF)
+        snprintf(dest, dest_size, "%03X:%04X", key >> 16, key & 0xFFFF);
+    else
+        snprintf(dest, dest_size, "%04X", key);
+}
+
+static const char *const gb_profiler_region_names[] = {
+    "ROM0", "ROMX", "VRAM", "SRAM", "WRAM", "Echo/OAM/IO", "HRAM"
+};
+
+static int GB_ProfilerRegion(u32 address)
+{
+    if (address < 0x4000)
+        return 0;
+    if (address < 0x8000)
+        return 1;
+    if (address < 0xA000)
+        return 2;
+    if (address < 0xC000)
+        return 3;
+    if (address < 0xE000)
+        return 4;
+    if (address < 0xFF80)
+        return 5;
+    return 6;
+}
+
+static const _profiler_cpu_info_ gb_profiler_info = {
+    "GB",
+    GB_ProfilerDisassemble,
+    GB_ProfilerFormatKey,
+    gb_profiler_region_names,
+    ARRAY_NUM_ELEMENTS(gb_profiler_region_names)
+};
+
+void GB_CPUProfilerStart(void)
+{
+    Profiler_Start(&gb_profiler_info);
+}
+
+static void GB_CPUProfilerStep(u32 pc, u8 opcode, int cycles)
+{
+    Profiler_Instruction(GB_ProfilerKey(pc), pc, cycles, GB_ProfilerRegion(pc));
+
+    // Interrupt handlers aren't tracked, they are attributed to the function
+    // that was interrupted.
+    u32 return_address;
+    switch (opcode)
+    {
+        case 0xC4: // CALL cc,nnnn
+        case 0xCC:
+        case 0xCD: // CALL nnnn
+        case 0xD4:
+        case 0xDC:
+            return_address = (pc + 3) & 0xFFFF;
+            break;
+        case 0xC7: // RST nn
+        case 0xCF:
+        case 0xD7:
+        case 0xDF:
+        case 0xE7:
+        case 0xEF:
+        case 0xF7:
+        case 0xFF:
+            return_address = (pc + 1) & 0xFFFF;
+            break;
+        default:
+            return;
+    }
+
+    u32 target = GameBoy.CPU.R16.PC;
+    if (target != return_address) // Conditional calls may not be taken
+        Profiler_Call(GB_ProfilerKey(target), return_address);
+}
+
+#endif // ENABLE_PROFILER
+
+//----------------------------------------------------------------
+
+// Opcode dispatch
+// ---------------
+//
+// With GCC and Clang the opcode handlers are threaded: the end of each handler
+// fetches the next opcode and jumps straight to its handler through a table of
+// label addresses. This gives each handler its own indirect branch, which is
+// predicted much better than the single one of a switch. Other compilers use a
+// regular switch.
+//
+// The threaded path only handles the common case. Breakpoints and PC hooks,
+// the EI delay, the HALT bug, backwards jumps (for the idle loop detection),
+// events and the end of the requested clocks go through the generic code at
+// the end of the loop, like every instruction does with the switch. EI and
+// HALT always leave the threaded path, so their flags don't need to be checked
+// for every instruction. The profiler needs to see every instruction, so it
+// always uses the switch.
+//
+// Inside a block of the block cache the next handler is known, so only the
+// flags that can end the block early need to be checked. The first instruction
+// of the next block goes through gb_instruction_next, which looks for it.
+
+#if defined(__GNUC__) && !defined(ENABLE_PROFILER)
+#define GB_CPU_THREADED_DISPATCH
+#endif
+
+#ifdef GB_CPU_THREADED_DISPATCH
+
+#define GB_OPCODE(n)            gb_op_##n
+#define GB_OPCODE_CB(n)         gb_op_cb_##n
+#define GB_DISPATCH(table, op)  goto *table[op];
+
+// Jumps to the next handler of the current block if there is one
+#define GB_NEXT()                                                              \
+    {                                                                          \
+        if (gb_cpu_block_left                                                  \
+            && ((gb_break_cpu_loop | gb_break_execution) == 0))                \
+        {                                                                      \
+            gb_cpu_block_left--;                                               \
+            instruction_pc = cpu->R16.PC++;                                    \
+            opcode = *gb_cpu_block_opcode++;                                   \
+            goto *gb_cpu_opcodes[opcode];                                      \
+        }                                                                      \
+        goto gb_instruction_next;                                              \
+    }
+
+#define GB_NEXT_SLOW()          goto gb_instruction_end
+
+// Addresses of the 16 handlers of a row of the opcode table
+#define GB_OPCODE_ROW(prefix, hi)                                              \
+    &&prefix##hi##0, &&prefix##hi##1, &&prefix##hi##2, &&prefix##hi##3,        \
+    &&prefix##hi##4, &&prefix##hi##5, &&prefix##hi##6, &&prefix##hi##7,        \
+    &&prefix##hi##8, &&prefix##hi##9, &&prefix##hi##A, &&prefix##hi##B,        \
+    &&prefix##hi##C, &&prefix##hi##D, &&prefix##hi##E, &&prefix##hi##F
+
+#define GB_OPCODE_TABLE(prefix)                                                \
+    {                                                                          \
+        GB_OPCODE_ROW(prefix, 0), GB_OPCODE_ROW(prefix, 1),                    \
+        GB_OPCODE_ROW(prefix, 2), GB_OPCODE_ROW(prefix, 3),                    \
+        GB_OPCODE_ROW(prefix, 4), GB_OPCODE_ROW(prefix, 5),                    \
+        GB_OPCODE_ROW(prefix, 6), GB_OPCODE_ROW(prefix, 7),                    \
+        GB_OPCODE_ROW(prefix, 8), GB_OPCODE_ROW(prefix, 9),                    \
+        GB_OPCODE_ROW(prefix, A), GB_OPCODE_ROW(prefix, B),                    \
+        GB_OPCODE_ROW(prefix, C), GB_OPCODE_ROW(prefix, D),                    \
+        GB_OPCODE_ROW(prefix, E), GB_OPCODE_ROW(prefix, F)                     \
+    }
+
+// Label addresses and computed gotos are GNU extensions
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+#else // GB_CPU_THREADED_DISPATCH
+
+#define GB_OPCODE(n)            case n
+#define GB_OPCODE_CB(n)         case n
+#define GB_DISPATCH(table, op)  switch (op)
+#define GB_NEXT()               break
+#define GB_NEXT_SLOW()          break
+
+#endif // GB_CPU_THREADED_DISPATCH
+
 // This function tries to run the specified number of clocks and returns the
 // actually executed number of clocks
 static int GB_CPUExecute(int clocks)
@@ -711,8 +1289,31 @@ static int GB_CPUExecute(int clocks)
     // If nothing interesting happens before, stop here
     int finish_clocks = GB_CPUClockCounterGet() + clocks;
 
+    // Interrupts and DMA can run between two calls to this function
+    GB_CPUIdleLoopReset();
+
+    gb_cpu_fetch_direct = (GameBoy.Emulator.enable_boot_rom == 0)
+                          && (gb_debug_watchpoints_armed == 0);
+
+    // Breakpoints and PC hooks added by scripts while the CPU runs are seen
+    // the next time this function is called
+    gb_cpu_block_cache_enabled = gb_cpu_fetch_direct
+            && ((gb_debug_breakpoint_count | gb_debug_pc_hook_count) == 0);
+    gb_cpu_block_left = 0;
+
+#ifdef GB_CPU_THREADED_DISPATCH
+    static const void *const gb_cpu_opcodes[256] =
+            GB_OPCODE_TABLE(gb_op_0x);
+    static const void *const gb_cpu_opcodes_cb[256] =
+            GB_OPCODE_TABLE(gb_op_cb_0x);
+
+    int fast_dispatch =
+            (gb_debug_breakpoint_count | gb_debug_pc_hook_count) == 0;
+#endif
+
     while (GB_CPUClockCounterGet() < finish_clocks)
     {
+        // PC hooks may change the PC, so read it after checking them
         if (GB_DebugCPUIsBreakpoint(cpu->R16.PC))
         {
             _gb_break_to_debugger();
@@ -720,6 +1321,11 @@ static int GB_CPUExecute(int clocks)
             break;
         }
 
+        u32 instruction_pc = cpu->R16.PC;
+#ifdef ENABLE_PROFILER
+        int profiler_clocks = GB_CPUClockCounterGet();
+#endif
+
         if (mem->interrupts_enable_count) // EI interrupt enable delay
         {
             mem->interrupts_enable_count = 0;
@@ -728,8 +1334,31 @@ static int GB_CPUExecute(int clocks)
             GB_CPUBreakLoop();
         }
 
-        u8 opcode = (u8)GB_MemRead8(cpu->R16.PC++);
-        cpu->R16.PC &= 0xFFFF;
+        u8 opcode;
+        int block_opcode = -1;
+
+        if (gb_cpu_block_left) // Next instruction of the current block
+        {
+            gb_cpu_block_left--;
+            block_opcode = *gb_cpu_block_opcode++;
+        }
+        else if (gb_cpu_block_cache_enabled && (gb_break_cpu_loop == 0)
+                 && (GameBoy.Emulator.halt_bug == 0))
+        {
+            block_opcode = GB_CPUBlockStart(cpu->R16.PC,
+                                    finish_clocks - GB_CPUClockCounterGet());
+        }
+
+        if (block_opcode >= 0)
+        {
+            opcode = block_opcode;
+            cpu->R16.PC++;
+        }
+        else
+        {
+            opcode = (u8)GB_CPUFetch8(cpu->R16.PC++);
+            cpu->R16.PC &= 0xFFFF;
+        }
 
         if (GameBoy.Emulator.halt_bug)
         {
@@ -738,75 +1367,75 @@ static int GB_CPUExecute(int clocks)
             cpu->R16.PC &= 0xFFFF;
         }
 
-        switch (opcode)
+        GB_DISPATCH(gb_cpu_opcodes, opcode)
         {
-            case 0x00: // NOP - 1
+            GB_OPCODE(0x00): // NOP - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x01: // LD BC,nnnn - 3
+                GB_NEXT();
+            GB_OPCODE(0x01): // LD BC,nnnn - 3
                 gb_ld_r16_nnnn(cpu->R8.B, cpu->R8.C);
-                break;
-            case 0x02: // LD [BC],A - 2
+                GB_NEXT();
+            GB_OPCODE(0x02): // LD [BC],A - 2
                 gb_ld_ptr_r16_r8(cpu->R16.BC, cpu->R8.A);
-                break;
-            case 0x03: // INC BC - 2
+                GB_NEXT();
+            GB_OPCODE(0x03): // INC BC - 2
                 gb_inc_r16(cpu->R16.BC);
-                break;
-            case 0x04: // INC B - 1
+                GB_NEXT();
+            GB_OPCODE(0x04): // INC B - 1
                 gb_inc_r8(cpu->R8.B);
-                break;
-            case 0x05: // DEC B - 1
+                GB_NEXT();
+            GB_OPCODE(0x05): // DEC B - 1
                 gb_dec_r8(cpu->R8.B);
-                break;
-            case 0x06: // LD B,n - 2
+                GB_NEXT();
+            GB_OPCODE(0x06): // LD B,n - 2
                 gb_ld_r8_nn(cpu->R8.B);
-                break;
-            case 0x07: // RLCA - 1
+                GB_NEXT();
+            GB_OPCODE(0x07): // RLCA - 1
                 cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
                 cpu->F.C = (cpu->R8.A & 0x80) != 0;
                 cpu->R8.A = (cpu->R8.A << 1) | cpu->F.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x08: // LD [nnnn],SP - 5
+                GB_NEXT();
+            GB_OPCODE(0x08): // LD [nnnn],SP - 5
             {
                 GB_CPUClockCounterAdd(4);
-                u16 temp = GB_MemRead8(cpu->R16.PC++);
+                u16 temp = GB_CPUFetch8(cpu->R16.PC++);
                 GB_CPUClockCounterAdd(4);
-                temp |= ((u32)GB_MemRead8(cpu->R16.PC++)) << 8;
+                temp |= ((u32)GB_CPUFetch8(cpu->R16.PC++)) << 8;
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(temp++, cpu->R8.SPL);
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(temp, cpu->R8.SPH);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x09: // ADD HL,BC - 2
+            GB_OPCODE(0x09): // ADD HL,BC - 2
                 gb_add_hl_r16(cpu->R16.BC);
-                break;
-            case 0x0A: // LD A,[BC] - 2
+                GB_NEXT();
+            GB_OPCODE(0x0A): // LD A,[BC] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.A, cpu->R16.BC);
-                break;
-            case 0x0B: // DEC BC - 2
+                GB_NEXT();
+            GB_OPCODE(0x0B): // DEC BC - 2
                 gb_dec_r16(cpu->R16.BC);
-                break;
-            case 0x0C: // INC C - 1
+                GB_NEXT();
+            GB_OPCODE(0x0C): // INC C - 1
                 gb_inc_r8(cpu->R8.C);
-                break;
-            case 0x0D: // DEC C - 1
+                GB_NEXT();
+            GB_OPCODE(0x0D): // DEC C - 1
                 gb_dec_r8(cpu->R8.C);
-                break;
-            case 0x0E: // LD C,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0x0E): // LD C,nn - 2
                 gb_ld_r8_nn(cpu->R8.C);
-                break;
-            case 0x0F: // RRCA - 1
+                GB_NEXT();
+            GB_OPCODE(0x0F): // RRCA - 1
                 cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
                 cpu->F.C = (cpu->R8.A & 0x01) != 0;
                 cpu->R8.A = (cpu->R8.A >> 1) | (cpu->F.C << 7);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x10: // STOP - 1*
+                GB_NEXT();
+            GB_OPCODE(0x10): // STOP - 1*
                 GB_CPUClockCounterAdd(4);
-                if (GB_MemRead8(cpu->R16.PC++) != 0)
+                if (GB_CPUFetch8(cpu->R16.PC++) != 0)
                 {
                     Debug_DebugMsgArg("Corrupted stop.\n"
                                       "PC: %04X\n"
@@ -840,152 +1469,152 @@ static int GB_CPUExecute(int clocks)
                     }
                 }
                 GB_CPUBreakLoop();
-                break;
-            case 0x11: // LD DE,nnnn - 3
+                GB_NEXT();
+            GB_OPCODE(0x11): // LD DE,nnnn - 3
                 gb_ld_r16_nnnn(cpu->R8.D, cpu->R8.E);
-                break;
-            case 0x12: // LD [DE],A - 2
+                GB_NEXT();
+            GB_OPCODE(0x12): // LD [DE],A - 2
                 gb_ld_ptr_r16_r8(cpu->R16.DE, cpu->R8.A);
-                break;
-            case 0x13: // INC DE - 2
+                GB_NEXT();
+            GB_OPCODE(0x13): // INC DE - 2
                 gb_inc_r16(cpu->R16.DE);
-                break;
-            case 0x14: // INC D - 1
+                GB_NEXT();
+            GB_OPCODE(0x14): // INC D - 1
                 gb_inc_r8(cpu->R8.D);
-                break;
-            case 0x15: // DEC D - 1
+                GB_NEXT();
+            GB_OPCODE(0x15): // DEC D - 1
                 gb_dec_r8(cpu->R8.D);
-                break;
-            case 0x16: // LD D,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0x16): // LD D,nn - 2
                 gb_ld_r8_nn(cpu->R8.D);
-                break;
-            case 0x17: // RLA - 1
+                GB_NEXT();
+            GB_OPCODE(0x17): // RLA - 1
             {
                 cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
                 u32 temp = cpu->F.C; // Old carry flag
                 cpu->F.C = (cpu->R8.A & 0x80) != 0;
                 cpu->R8.A = (cpu->R8.A << 1) | temp;
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x18: // JR nn - 3
+            GB_OPCODE(0x18): // JR nn - 3
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.PC = (cpu->R16.PC + (s8)temp) & 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x19: // ADD HL,DE - 2
+            GB_OPCODE(0x19): // ADD HL,DE - 2
                 gb_add_hl_r16(cpu->R16.DE);
-                break;
-            case 0x1A: // LD A,[DE] - 2
+                GB_NEXT();
+            GB_OPCODE(0x1A): // LD A,[DE] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.A, cpu->R16.DE);
-                break;
-            case 0x1B: // DEC DE - 2
+                GB_NEXT();
+            GB_OPCODE(0x1B): // DEC DE - 2
                 gb_dec_r16(cpu->R16.DE);
-                break;
-            case 0x1C: // INC E - 1
+                GB_NEXT();
+            GB_OPCODE(0x1C): // INC E - 1
                 gb_inc_r8(cpu->R8.E);
-                break;
-            case 0x1D: // DEC E - 1
+                GB_NEXT();
+            GB_OPCODE(0x1D): // DEC E - 1
                 gb_dec_r8(cpu->R8.E);
-                break;
-            case 0x1E: // LD E,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0x1E): // LD E,nn - 2
                 gb_ld_r8_nn(cpu->R8.E);
-                break;
-            case 0x1F: // RRA - 1
+                GB_NEXT();
+            GB_OPCODE(0x1F): // RRA - 1
             {
                 cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
                 u32 temp = cpu->F.C; // Old carry flag
                 cpu->F.C = cpu->R8.A & 0x01;
                 cpu->R8.A = (cpu->R8.A >> 1) | (temp << 7);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x20: // JR NZ,nn - 3/2
+            GB_OPCODE(0x20): // JR NZ,nn - 3/2
                 gb_jr_cond_nn(cpu->F.Z == 0);
-                break;
-            case 0x21: // LD HL,nnnn - 3
+                GB_NEXT();
+            GB_OPCODE(0x21): // LD HL,nnnn - 3
                 gb_ld_r16_nnnn(cpu->R8.H, cpu->R8.L);
-                break;
-            case 0x22: // LD [HL+],A - 2
+                GB_NEXT();
+            GB_OPCODE(0x22): // LD [HL+],A - 2
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(cpu->R16.HL, cpu->R8.A);
                 cpu->R16.HL = (cpu->R16.HL + 1) & 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x23: // INC HL - 2
+                GB_NEXT();
+            GB_OPCODE(0x23): // INC HL - 2
                 gb_inc_r16(cpu->R16.HL);
-                break;
-            case 0x24: // INC H - 1
+                GB_NEXT();
+            GB_OPCODE(0x24): // INC H - 1
                 gb_inc_r8(cpu->R8.H);
-                break;
-            case 0x25: // DEC H - 1
+                GB_NEXT();
+            GB_OPCODE(0x25): // DEC H - 1
                 gb_dec_r8(cpu->R8.H);
-                break;
-            case 0x26: // LD H,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0x26): // LD H,nn - 2
                 gb_ld_r8_nn(cpu->R8.H);
-                break;
-            case 0x27: // DAA - 1
+                GB_NEXT();
+            GB_OPCODE(0x27): // DAA - 1
             {
                 u32 temp = (((u32)cpu->R8.A) << (3 + 1))
                            | ((((u32)cpu->R8.F >> 4) & 7) << 1);
                 cpu->R8.A = gb_daa_table[temp];
                 cpu->R8.F = gb_daa_table[temp + 1];
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x28: // JR Z,nn - 3/2
+            GB_OPCODE(0x28): // JR Z,nn - 3/2
                 gb_jr_cond_nn(cpu->F.Z);
-                break;
-            case 0x29: // ADD HL,HL - 2
+                GB_NEXT();
+            GB_OPCODE(0x29): // ADD HL,HL - 2
                 cpu->R16.AF &= ~F_SUBTRACT;
                 cpu->F.C = (cpu->R16.HL & 0x8000) != 0;
                 cpu->F.H = (cpu->R16.HL & 0x0800) != 0;
                 cpu->R16.HL = (cpu->R16.HL << 1) & 0xFFFF;
                 GB_CPUClockCounterAdd(8);
-                break;
-            case 0x2A: // LD A,[HL+] - 2
+                GB_NEXT();
+            GB_OPCODE(0x2A): // LD A,[HL+] - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R8.A = GB_MemRead8(cpu->R16.HL);
                 cpu->R16.HL = (cpu->R16.HL + 1) & 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x2B: // DEC HL - 2
+                GB_NEXT();
+            GB_OPCODE(0x2B): // DEC HL - 2
                 gb_dec_r16(cpu->R16.HL);
-                break;
-            case 0x2C: // INC L - 1
+                GB_NEXT();
+            GB_OPCODE(0x2C): // INC L - 1
                 gb_inc_r8(cpu->R8.L);
-                break;
-            case 0x2D: // DEC L - 1
+                GB_NEXT();
+            GB_OPCODE(0x2D): // DEC L - 1
                 gb_dec_r8(cpu->R8.L);
-                break;
-            case 0x2E: // LD L,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0x2E): // LD L,nn - 2
                 gb_ld_r8_nn(cpu->R8.L);
-                break;
-            case 0x2F: // CPL - 1
+                GB_NEXT();
+            GB_OPCODE(0x2F): // CPL - 1
                 cpu->R16.AF |= (F_SUBTRACT | F_HALFCARRY);
                 cpu->R8.A = ~cpu->R8.A;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x30: // JR NC,nn - 3/2
+                GB_NEXT();
+            GB_OPCODE(0x30): // JR NC,nn - 3/2
                 gb_jr_cond_nn(cpu->F.C == 0);
-                break;
-            case 0x31: // LD SP,nnnn - 3
+                GB_NEXT();
+            GB_OPCODE(0x31): // LD SP,nnnn - 3
                 gb_ld_r16_nnnn(cpu->R8.SPH, cpu->R8.SPL);
-                break;
-            case 0x32: // LD [HL-],A - 2
+                GB_NEXT();
+            GB_OPCODE(0x32): // LD [HL-],A - 2
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(cpu->R16.HL, cpu->R8.A);
                 cpu->R16.HL = (cpu->R16.HL - 1) & 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x33: // INC SP - 2
+                GB_NEXT();
+            GB_OPCODE(0x33): // INC SP - 2
                 gb_inc_r16(cpu->R16.SP);
-                break;
-            case 0x34: // INC [HL] - 3
+                GB_NEXT();
+            GB_OPCODE(0x34): // INC [HL] - 3
             {
                 GB_CPUClockCounterAdd(4);
                 u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -996,9 +1625,9 @@ static int GB_CPUExecute(int clocks)
                 cpu->F.Z = (temp == 0);
                 GB_MemWrite8(cpu->R16.HL, temp);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x35: // DEC [HL] - 3
+            GB_OPCODE(0x35): // DEC [HL] - 3
             {
                 GB_CPUClockCounterAdd(4);
                 u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1009,250 +1638,250 @@ static int GB_CPUExecute(int clocks)
                 cpu->F.Z = (temp == 0);
                 GB_MemWrite8(cpu->R16.HL, temp);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x36: // LD [HL],n - 3
+            GB_OPCODE(0x36): // LD [HL],n - 3
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(cpu->R16.HL, temp);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x37: // SCF - 1
+            GB_OPCODE(0x37): // SCF - 1
                 cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
                 cpu->R16.AF |= F_CARRY;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x38: // JR C,nn - 3/2
+                GB_NEXT();
+            GB_OPCODE(0x38): // JR C,nn - 3/2
                 gb_jr_cond_nn(cpu->F.C);
-                break;
-            case 0x39: // ADD HL,SP - 2
+                GB_NEXT();
+            GB_OPCODE(0x39): // ADD HL,SP - 2
                 gb_add_hl_r16(cpu->R16.SP);
-                break;
-            case 0x3A: // LD A,[HL-] - 2
+                GB_NEXT();
+            GB_OPCODE(0x3A): // LD A,[HL-] - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R8.A = GB_MemRead8(cpu->R16.HL);
                 cpu->R16.HL = (cpu->R16.HL - 1) & 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x3B: // DEC SP - 2
+                GB_NEXT();
+            GB_OPCODE(0x3B): // DEC SP - 2
                 gb_dec_r16(cpu->R16.SP);
-                break;
-            case 0x3C: // INC A - 1
+                GB_NEXT();
+            GB_OPCODE(0x3C): // INC A - 1
                 gb_inc_r8(cpu->R8.A);
-                break;
-            case 0x3D: // DEC A - 1
+                GB_NEXT();
+            GB_OPCODE(0x3D): // DEC A - 1
                 gb_dec_r8(cpu->R8.A);
-                break;
-            case 0x3E: // LD A,n - 2
+                GB_NEXT();
+            GB_OPCODE(0x3E): // LD A,n - 2
                 gb_ld_r8_nn(cpu->R8.A);
-                break;
-            case 0x3F: // CCF - 1
+                GB_NEXT();
+            GB_OPCODE(0x3F): // CCF - 1
                 cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
                 cpu->F.C = !cpu->F.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x40: // LD B,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x40): // LD B,B - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x41: // LD B,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x41): // LD B,C - 1
                 cpu->R8.B = cpu->R8.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x42: // LD B,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x42): // LD B,D - 1
                 cpu->R8.B = cpu->R8.D;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x43: // LD B,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x43): // LD B,E - 1
                 cpu->R8.B = cpu->R8.E;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x44: // LD B,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x44): // LD B,H - 1
                 cpu->R8.B = cpu->R8.H;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x45: // LD B,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x45): // LD B,L - 1
                 cpu->R8.B = cpu->R8.L;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x46: // LD B,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x46): // LD B,[HL] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.B, cpu->R16.HL);
-                break;
-            case 0x47: // LD B,A - 1
+                GB_NEXT();
+            GB_OPCODE(0x47): // LD B,A - 1
                 cpu->R8.B = cpu->R8.A;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x48: // LD C,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x48): // LD C,B - 1
                 cpu->R8.C = cpu->R8.B;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x49: // LD C,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x49): // LD C,C - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x4A: // LD C,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x4A): // LD C,D - 1
                 cpu->R8.C = cpu->R8.D;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x4B: // LD C,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x4B): // LD C,E - 1
                 cpu->R8.C = cpu->R8.E;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x4C: // LD C,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x4C): // LD C,H - 1
                 cpu->R8.C = cpu->R8.H;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x4D: // LD C,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x4D): // LD C,L - 1
                 cpu->R8.C = cpu->R8.L;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x4E: // LD C,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x4E): // LD C,[HL] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.C, cpu->R16.HL);
-                break;
-            case 0x4F: // LD C,A - 1
+                GB_NEXT();
+            GB_OPCODE(0x4F): // LD C,A - 1
                 cpu->R8.C = cpu->R8.A;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x50: // LD D,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x50): // LD D,B - 1
                 cpu->R8.D = cpu->R8.B;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x51: // LD D,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x51): // LD D,C - 1
                 cpu->R8.D = cpu->R8.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x52: // LD D,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x52): // LD D,D - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x53: // LD D,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x53): // LD D,E - 1
                 cpu->R8.D = cpu->R8.E;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x54: // LD D,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x54): // LD D,H - 1
                 cpu->R8.D = cpu->R8.H;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x55: // LD D,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x55): // LD D,L - 1
                 cpu->R8.D = cpu->R8.L;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x56: // LD D,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x56): // LD D,[HL] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.D, cpu->R16.HL);
-                break;
-            case 0x57: // LD D,A - 1
+                GB_NEXT();
+            GB_OPCODE(0x57): // LD D,A - 1
                 cpu->R8.D = cpu->R8.A;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x58: // LD E,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x58): // LD E,B - 1
                 cpu->R8.E = cpu->R8.B;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x59: // LD E,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x59): // LD E,C - 1
                 cpu->R8.E = cpu->R8.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x5A: // LD E,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x5A): // LD E,D - 1
                 cpu->R8.E = cpu->R8.D;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x5B: // LD E,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x5B): // LD E,E - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x5C: // LD E,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x5C): // LD E,H - 1
                 cpu->R8.E = cpu->R8.H;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x5D: // LD E,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x5D): // LD E,L - 1
                 cpu->R8.E = cpu->R8.L;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x5E: // LD E,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x5E): // LD E,[HL] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.E, cpu->R16.HL);
-                break;
-            case 0x5F: // LD E,A - 1
+                GB_NEXT();
+            GB_OPCODE(0x5F): // LD E,A - 1
                 cpu->R8.E = cpu->R8.A;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x60: // LD H,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x60): // LD H,B - 1
                 cpu->R8.H = cpu->R8.B;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x61: // LD H,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x61): // LD H,C - 1
                 cpu->R8.H = cpu->R8.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x62: // LD H,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x62): // LD H,D - 1
                 cpu->R8.H = cpu->R8.D;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x63: // LD H,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x63): // LD H,E - 1
                 cpu->R8.H = cpu->R8.E;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x64: // LD H,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x64): // LD H,H - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x65: // LD H,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x65): // LD H,L - 1
                 cpu->R8.H = cpu->R8.L;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x66: // LD H,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x66): // LD H,[HL] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.H, cpu->R16.HL);
-                break;
-            case 0x67: // LD H,A - 1
+                GB_NEXT();
+            GB_OPCODE(0x67): // LD H,A - 1
                 cpu->R8.H = cpu->R8.A;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x68: // LD L,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x68): // LD L,B - 1
                 cpu->R8.L = cpu->R8.B;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x69: // LD L,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x69): // LD L,C - 1
                 cpu->R8.L = cpu->R8.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x6A: // LD L,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x6A): // LD L,D - 1
                 cpu->R8.L = cpu->R8.D;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x6B: // LD L,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x6B): // LD L,E - 1
                 cpu->R8.L = cpu->R8.E;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x6C: // LD L,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x6C): // LD L,H - 1
                 cpu->R8.L = cpu->R8.H;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x6D: // LD L,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x6D): // LD L,L - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x6E: // LD L,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x6E): // LD L,[HL] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.L, cpu->R16.HL);
-                break;
-            case 0x6F: // LD L,A - 1
+                GB_NEXT();
+            GB_OPCODE(0x6F): // LD L,A - 1
                 cpu->R8.L = cpu->R8.A;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x70: // LD [HL],B - 2
+                GB_NEXT();
+            GB_OPCODE(0x70): // LD [HL],B - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.B);
-                break;
-            case 0x71: // LD [HL],C - 2
+                GB_NEXT();
+            GB_OPCODE(0x71): // LD [HL],C - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.C);
-                break;
-            case 0x72: // LD [HL],D - 2
+                GB_NEXT();
+            GB_OPCODE(0x72): // LD [HL],D - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.D);
-                break;
-            case 0x73: // LD [HL],E - 2
+                GB_NEXT();
+            GB_OPCODE(0x73): // LD [HL],E - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.E);
-                break;
-            case 0x74: // LD [HL],H - 2
+                GB_NEXT();
+            GB_OPCODE(0x74): // LD [HL],H - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.H);
-                break;
-            case 0x75: // LD [HL],L - 2
+                GB_NEXT();
+            GB_OPCODE(0x75): // LD [HL],L - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.L);
-                break;
-            case 0x76: // HALT - 1*
+                GB_NEXT();
+            GB_OPCODE(0x76): // HALT - 1*
                 GB_CPUClockCounterAdd(4);
                 if (GameBoy.Memory.InterruptMasterEnable == 1)
                 {
@@ -1272,59 +1901,59 @@ static int GB_CPUExecute(int clocks)
                     }
                 }
                 GB_CPUBreakLoop();
-                break;
-            case 0x77: // LD [HL],A - 2
+                GB_NEXT();
+            GB_OPCODE(0x77): // LD [HL],A - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.A);
-                break;
-            case 0x78: // LD A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x78): // LD A,B - 1
                 cpu->R8.A = cpu->R8.B;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x79: // LD A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x79): // LD A,C - 1
                 cpu->R8.A = cpu->R8.C;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x7A: // LD A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x7A): // LD A,D - 1
                 cpu->R8.A = cpu->R8.D;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x7B: // LD A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x7B): // LD A,E - 1
                 cpu->R8.A = cpu->R8.E;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x7C: // LD A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x7C): // LD A,H - 1
                 cpu->R8.A = cpu->R8.H;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x7D: // LD A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x7D): // LD A,L - 1
                 cpu->R8.A = cpu->R8.L;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x7E: // LD A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x7E): // LD A,[HL] - 2
                 gb_ld_r8_ptr_r16(cpu->R8.A, cpu->R16.HL);
-                break;
-            case 0x7F: // LD A,A - 1
+                GB_NEXT();
+            GB_OPCODE(0x7F): // LD A,A - 1
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x80: // ADD A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x80): // ADD A,B - 1
                 gb_add_a_r8(cpu->R8.B);
-                break;
-            case 0x81: // ADD A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x81): // ADD A,C - 1
                 gb_add_a_r8(cpu->R8.C);
-                break;
-            case 0x82: // ADD A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x82): // ADD A,D - 1
                 gb_add_a_r8(cpu->R8.D);
-                break;
-            case 0x83: // ADD A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x83): // ADD A,E - 1
                 gb_add_a_r8(cpu->R8.E);
-                break;
-            case 0x84: // ADD A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x84): // ADD A,H - 1
                 gb_add_a_r8(cpu->R8.H);
-                break;
-            case 0x85: // ADD A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x85): // ADD A,L - 1
                 gb_add_a_r8(cpu->R8.L);
-                break;
-            case 0x86: // ADD A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x86): // ADD A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~F_SUBTRACT;
@@ -1335,35 +1964,35 @@ static int GB_CPUExecute(int clocks)
                 cpu->F.Z = (cpu->R8.A == 0);
                 cpu->F.C = (temp > cpu->R8.A);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x87: // ADD A,A - 1
+            GB_OPCODE(0x87): // ADD A,A - 1
                 cpu->R16.AF &= ~F_SUBTRACT;
                 cpu->F.H = (cpu->R8.A & BIT(3)) != 0;
                 cpu->F.C = (cpu->R8.A & BIT(7)) != 0;
                 cpu->R8.A += cpu->R8.A;
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x88: // ADC A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x88): // ADC A,B - 1
                 gb_adc_a_r8(cpu->R8.B);
-                break;
-            case 0x89: // ADC A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x89): // ADC A,C - 1
                 gb_adc_a_r8(cpu->R8.C);
-                break;
-            case 0x8A: // ADC A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x8A): // ADC A,D - 1
                 gb_adc_a_r8(cpu->R8.D);
-                break;
-            case 0x8B: // ADC A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x8B): // ADC A,E - 1
                 gb_adc_a_r8(cpu->R8.E);
-                break;
-            case 0x8C: // ADC A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x8C): // ADC A,H - 1
                 gb_adc_a_r8(cpu->R8.H);
-                break;
-            case 0x8D: // ADC A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x8D): // ADC A,L - 1
                 gb_adc_a_r8(cpu->R8.L);
-                break;
-            case 0x8E: // ADC A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x8E): // ADC A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~F_SUBTRACT;
@@ -1375,9 +2004,9 @@ static int GB_CPUExecute(int clocks)
                 cpu->R8.A = temp2;
                 cpu->F.Z = (temp2 == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x8F: // ADC A,A - 1
+            GB_OPCODE(0x8F): // ADC A,A - 1
             {
                 cpu->R16.AF &= ~F_SUBTRACT;
                 u32 temp = (((u32)cpu->R8.A) << 1) + cpu->F.C;
@@ -1388,27 +2017,27 @@ static int GB_CPUExecute(int clocks)
                 cpu->R8.A = temp;
                 cpu->F.Z = (temp == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x90: // SUB A,B - 1
+            GB_OPCODE(0x90): // SUB A,B - 1
                 gb_sub_a_r8(cpu->R8.B);
-                break;
-            case 0x91: // SUB A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x91): // SUB A,C - 1
                 gb_sub_a_r8(cpu->R8.C);
-                break;
-            case 0x92: // SUB A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x92): // SUB A,D - 1
                 gb_sub_a_r8(cpu->R8.D);
-                break;
-            case 0x93: // SUB A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x93): // SUB A,E - 1
                 gb_sub_a_r8(cpu->R8.E);
-                break;
-            case 0x94: // SUB A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x94): // SUB A,H - 1
                 gb_sub_a_r8(cpu->R8.H);
-                break;
-            case 0x95: // SUB A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x95): // SUB A,L - 1
                 gb_sub_a_r8(cpu->R8.L);
-                break;
-            case 0x96: // SUB A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x96): // SUB A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
                 u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1418,32 +2047,32 @@ static int GB_CPUExecute(int clocks)
                 cpu->R8.A -= temp;
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x97: // SUB A,A - 1
+            GB_OPCODE(0x97): // SUB A,A - 1
                 cpu->R8.F = F_SUBTRACT | F_ZERO;
                 cpu->R8.A = 0;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0x98: // SBC A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0x98): // SBC A,B - 1
                 gb_sbc_a_r8(cpu->R8.B);
-                break;
-            case 0x99: // SBC A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0x99): // SBC A,C - 1
                 gb_sbc_a_r8(cpu->R8.C);
-                break;
-            case 0x9A: // SBC A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0x9A): // SBC A,D - 1
                 gb_sbc_a_r8(cpu->R8.D);
-                break;
-            case 0x9B: // SBC A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0x9B): // SBC A,E - 1
                 gb_sbc_a_r8(cpu->R8.E);
-                break;
-            case 0x9C: // SBC A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0x9C): // SBC A,H - 1
                 gb_sbc_a_r8(cpu->R8.H);
-                break;
-            case 0x9D: // SBC A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0x9D): // SBC A,L - 1
                 gb_sbc_a_r8(cpu->R8.L);
-                break;
-            case 0x9E: // SBC A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0x9E): // SBC A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
                 u32 temp2 = GB_MemRead8(cpu->R16.HL);
@@ -1454,126 +2083,126 @@ static int GB_CPUExecute(int clocks)
                 cpu->F.H = ((cpu->R8.A ^ temp2 ^ temp) & 0x10) != 0;
                 cpu->R8.A = temp;
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0x9F: // SBC A,A - 1
+            GB_OPCODE(0x9F): // SBC A,A - 1
                 cpu->R16.AF = (cpu->R8.F & F_CARRY) ?
                             ((0xFF << 8) | F_CARRY | F_HALFCARRY | F_SUBTRACT)
                             : (F_ZERO | F_SUBTRACT);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xA0: // AND A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0xA0): // AND A,B - 1
                 gb_and_a_r8(cpu->R8.B);
-                break;
-            case 0xA1: // AND A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0xA1): // AND A,C - 1
                 gb_and_a_r8(cpu->R8.C);
-                break;
-            case 0xA2: // AND A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0xA2): // AND A,D - 1
                 gb_and_a_r8(cpu->R8.D);
-                break;
-            case 0xA3: // AND A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0xA3): // AND A,E - 1
                 gb_and_a_r8(cpu->R8.E);
-                break;
-            case 0xA4: // AND A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0xA4): // AND A,H - 1
                 gb_and_a_r8(cpu->R8.H);
-                break;
-            case 0xA5: // AND A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0xA5): // AND A,L - 1
                 gb_and_a_r8(cpu->R8.L);
-                break;
-            case 0xA6: // AND A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0xA6): // AND A,[HL] - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF |= F_HALFCARRY;
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY);
                 cpu->R8.A &= GB_MemRead8(cpu->R16.HL);
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xA7: // AND A,A - 1
+                GB_NEXT();
+            GB_OPCODE(0xA7): // AND A,A - 1
                 cpu->R16.AF |= F_HALFCARRY;
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY);
                 //cpu->R8.A &= cpu->R8.A;
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xA8: // XOR A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0xA8): // XOR A,B - 1
                 gb_xor_a_r8(cpu->R8.B);
-                break;
-            case 0xA9: // XOR A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0xA9): // XOR A,C - 1
                 gb_xor_a_r8(cpu->R8.C);
-                break;
-            case 0xAA: // XOR A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0xAA): // XOR A,D - 1
                 gb_xor_a_r8(cpu->R8.D);
-                break;
-            case 0xAB: // XOR A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0xAB): // XOR A,E - 1
                 gb_xor_a_r8(cpu->R8.E);
-                break;
-            case 0xAC: // XOR A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0xAC): // XOR A,H - 1
                 gb_xor_a_r8(cpu->R8.H);
-                break;
-            case 0xAD: // XOR A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0xAD): // XOR A,L - 1
                 gb_xor_a_r8(cpu->R8.L);
-                break;
-            case 0xAE: // XOR A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0xAE): // XOR A,[HL] - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
                 cpu->R8.A ^= GB_MemRead8(cpu->R16.HL);
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xAF: // XOR A,A - 1
+                GB_NEXT();
+            GB_OPCODE(0xAF): // XOR A,A - 1
                 cpu->R16.AF = F_ZERO;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xB0: // OR A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0xB0): // OR A,B - 1
                 gb_or_a_r8(cpu->R8.B);
-                break;
-            case 0xB1: // OR A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0xB1): // OR A,C - 1
                 gb_or_a_r8(cpu->R8.C);
-                break;
-            case 0xB2: // OR A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0xB2): // OR A,D - 1
                 gb_or_a_r8(cpu->R8.D);
-                break;
-            case 0xB3: // OR A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0xB3): // OR A,E - 1
                 gb_or_a_r8(cpu->R8.E);
-                break;
-            case 0xB4: // OR A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0xB4): // OR A,H - 1
                 gb_or_a_r8(cpu->R8.H);
-                break;
-            case 0xB5: // OR A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0xB5): // OR A,L - 1
                 gb_or_a_r8(cpu->R8.L);
-                break;
-            case 0xB6: // OR A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0xB6): // OR A,[HL] - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
                 cpu->R8.A |= GB_MemRead8(cpu->R16.HL);
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xB7: // OR A,A - 1
+                GB_NEXT();
+            GB_OPCODE(0xB7): // OR A,A - 1
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
                 //cpu->R8.A |= cpu->R8.A;
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xB8: // CP A,B - 1
+                GB_NEXT();
+            GB_OPCODE(0xB8): // CP A,B - 1
                 gb_cp_a_r8(cpu->R8.B);
-                break;
-            case 0xB9: // CP A,C - 1
+                GB_NEXT();
+            GB_OPCODE(0xB9): // CP A,C - 1
                 gb_cp_a_r8(cpu->R8.C);
-                break;
-            case 0xBA: // CP A,D - 1
+                GB_NEXT();
+            GB_OPCODE(0xBA): // CP A,D - 1
                 gb_cp_a_r8(cpu->R8.D);
-                break;
-            case 0xBB: // CP A,E - 1
+                GB_NEXT();
+            GB_OPCODE(0xBB): // CP A,E - 1
                 gb_cp_a_r8(cpu->R8.E);
-                break;
-            case 0xBC: // CP A,H - 1
+                GB_NEXT();
+            GB_OPCODE(0xBC): // CP A,H - 1
                 gb_cp_a_r8(cpu->R8.H);
-                break;
-            case 0xBD: // CP A,L - 1
+                GB_NEXT();
+            GB_OPCODE(0xBD): // CP A,L - 1
                 gb_cp_a_r8(cpu->R8.L);
-                break;
-            case 0xBE: // CP A,[HL] - 2
+                GB_NEXT();
+            GB_OPCODE(0xBE): // CP A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF |= F_SUBTRACT;
@@ -1582,61 +2211,61 @@ static int GB_CPUExecute(int clocks)
                 cpu->F.C = (u32)cpu->R8.A < temp;
                 cpu->F.Z = (cpu->R8.A == temp);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xBF: // CP A,A - 1
+            GB_OPCODE(0xBF): // CP A,A - 1
                 cpu->R16.AF |= (F_SUBTRACT | F_ZERO);
                 cpu->R16.AF &= ~(F_HALFCARRY | F_CARRY);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xC0: // RET NZ - 5/2
+                GB_NEXT();
+            GB_OPCODE(0xC0): // RET NZ - 5/2
                 gb_ret_cond(cpu->F.Z == 0);
-                break;
-            case 0xC1: // POP BC - 3
+                GB_NEXT();
+            GB_OPCODE(0xC1): // POP BC - 3
                 gb_pop_r16(cpu->R8.B, cpu->R8.C);
-                break;
-            case 0xC2: // JP NZ,nnnn - 4/3
+                GB_NEXT();
+            GB_OPCODE(0xC2): // JP NZ,nnnn - 4/3
                 gb_jp_cond_nnnn(cpu->F.Z == 0);
-                break;
-            case 0xC3: // JP nnnn - 4
+                GB_NEXT();
+            GB_OPCODE(0xC3): // JP nnnn - 4
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                temp |= ((u32)(u8)GB_MemRead8(cpu->R16.PC++)) << 8;
+                temp |= ((u32)(u8)GB_CPUFetch8(cpu->R16.PC++)) << 8;
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.PC = temp;
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xC4: // CALL NZ,nnnn - 6/3
+            GB_OPCODE(0xC4): // CALL NZ,nnnn - 6/3
                 gb_call_cond_nnnn(cpu->F.Z == 0);
-                break;
-            case 0xC5: // PUSH BC - 4
+                GB_NEXT();
+            GB_OPCODE(0xC5): // PUSH BC - 4
                 gb_push_r16(cpu->R8.B, cpu->R8.C);
-                break;
-            case 0xC6: // ADD A,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0xC6): // ADD A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~F_SUBTRACT;
                 u32 temp = cpu->R8.A;
-                u32 temp2 = GB_MemRead8(cpu->R16.PC++);
+                u32 temp2 = GB_CPUFetch8(cpu->R16.PC++);
                 cpu->F.H = ((temp & 0xF) + (temp2 & 0xF)) > 0xF;
                 cpu->R8.A += temp2;
                 cpu->F.Z = (cpu->R8.A == 0);
                 cpu->F.C = (temp > cpu->R8.A);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xC7: // RST 0x0000 - 4
+            GB_OPCODE(0xC7): // RST 0x0000 - 4
                 gb_rst_nnnn(0x0000);
-                break;
-            case 0xC8: // RET Z - 5/2
+                GB_NEXT();
+            GB_OPCODE(0xC8): // RET Z - 5/2
                 gb_ret_cond(cpu->F.Z);
-                break;
-            case 0xC9: // RET - 4
+                GB_NEXT();
+            GB_OPCODE(0xC9): // RET - 4
             {
                 GB_CPUClockCounterAdd(4);
                 u32 temp = GB_MemRead8(cpu->R16.SP++);
@@ -1647,37 +2276,37 @@ static int GB_CPUExecute(int clocks)
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.PC = temp;
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xCA: // JP Z,nnnn - 4/3
+            GB_OPCODE(0xCA): // JP Z,nnnn - 4/3
                 gb_jp_cond_nnnn(cpu->F.Z);
-                break;
-            case 0xCB:
+                GB_NEXT();
+            GB_OPCODE(0xCB):
                 GB_CPUClockCounterAdd(4);
-                opcode = (u32)(u8)GB_MemRead8(cpu->R16.PC++);
+                opcode = (u32)(u8)GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R16.PC &= 0xFFFF;
 
-                switch (opcode)
+                GB_DISPATCH(gb_cpu_opcodes_cb, opcode)
                 {
-                    case 0x00: // RLC B - 2
+                    GB_OPCODE_CB(0x00): // RLC B - 2
                         gb_rlc_r8(cpu->R8.B);
-                        break;
-                    case 0x01: // RLC C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x01): // RLC C - 2
                         gb_rlc_r8(cpu->R8.C);
-                        break;
-                    case 0x02: // RLC D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x02): // RLC D - 2
                         gb_rlc_r8(cpu->R8.D);
-                        break;
-                    case 0x03: // RLC E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x03): // RLC E - 2
                         gb_rlc_r8(cpu->R8.E);
-                        break;
-                    case 0x04: // RLC H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x04): // RLC H - 2
                         gb_rlc_r8(cpu->R8.H);
-                        break;
-                    case 0x05: // RLC L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x05): // RLC L - 2
                         gb_rlc_r8(cpu->R8.L);
-                        break;
-                    case 0x06: // RLC [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x06): // RLC [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1688,31 +2317,31 @@ static int GB_CPUExecute(int clocks)
                         cpu->F.Z = (temp == 0);
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x07: // RLC A - 2
+                    GB_OPCODE_CB(0x07): // RLC A - 2
                         gb_rlc_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x08: // RRC B - 2
+                    GB_OPCODE_CB(0x08): // RRC B - 2
                         gb_rrc_r8(cpu->R8.B);
-                        break;
-                    case 0x09: // RRC C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x09): // RRC C - 2
                         gb_rrc_r8(cpu->R8.C);
-                        break;
-                    case 0x0A: // RRC D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x0A): // RRC D - 2
                         gb_rrc_r8(cpu->R8.D);
-                        break;
-                    case 0x0B: // RRC E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x0B): // RRC E - 2
                         gb_rrc_r8(cpu->R8.E);
-                        break;
-                    case 0x0C: // RRC H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x0C): // RRC H - 2
                         gb_rrc_r8(cpu->R8.H);
-                        break;
-                    case 0x0D: // RRC L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x0D): // RRC L - 2
                         gb_rrc_r8(cpu->R8.L);
-                        break;
-                    case 0x0E: // RRC [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x0E): // RRC [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1723,31 +2352,31 @@ static int GB_CPUExecute(int clocks)
                         cpu->F.Z = (temp == 0);
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x0F: // RRC A - 2
+                    GB_OPCODE_CB(0x0F): // RRC A - 2
                         gb_rrc_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x10: // RL B - 2
+                    GB_OPCODE_CB(0x10): // RL B - 2
                         gb_rl_r8(cpu->R8.B);
-                        break;
-                    case 0x11: // RL C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x11): // RL C - 2
                         gb_rl_r8(cpu->R8.C);
-                        break;
-                    case 0x12: // RL D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x12): // RL D - 2
                         gb_rl_r8(cpu->R8.D);
-                        break;
-                    case 0x13: // RL E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x13): // RL E - 2
                         gb_rl_r8(cpu->R8.E);
-                        break;
-                    case 0x14: // RL H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x14): // RL H - 2
                         gb_rl_r8(cpu->R8.H);
-                        break;
-                    case 0x15: // RL L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x15): // RL L - 2
                         gb_rl_r8(cpu->R8.L);
-                        break;
-                    case 0x16: // RL [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x16): // RL [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp2 = GB_MemRead8(cpu->R16.HL);
@@ -1759,31 +2388,31 @@ static int GB_CPUExecute(int clocks)
                         cpu->F.Z = (temp2 == 0);
                         GB_MemWrite8(cpu->R16.HL, temp2);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x17: // RL A - 2
+                    GB_OPCODE_CB(0x17): // RL A - 2
                         gb_rl_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x18: // RR B - 2
+                    GB_OPCODE_CB(0x18): // RR B - 2
                         gb_rr_r8(cpu->R8.B);
-                        break;
-                    case 0x19: // RR C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x19): // RR C - 2
                         gb_rr_r8(cpu->R8.C);
-                        break;
-                    case 0x1A: // RR D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x1A): // RR D - 2
                         gb_rr_r8(cpu->R8.D);
-                        break;
-                    case 0x1B: // RR E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x1B): // RR E - 2
                         gb_rr_r8(cpu->R8.E);
-                        break;
-                    case 0x1C: // RR H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x1C): // RR H - 2
                         gb_rr_r8(cpu->R8.H);
-                        break;
-                    case 0x1D: // RR L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x1D): // RR L - 2
                         gb_rr_r8(cpu->R8.L);
-                        break;
-                    case 0x1E: // RR [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x1E): // RR [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp2 = GB_MemRead8(cpu->R16.HL);
@@ -1795,31 +2424,31 @@ static int GB_CPUExecute(int clocks)
                         cpu->F.Z = (temp2 == 0);
                         GB_MemWrite8(cpu->R16.HL, temp2);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x1F: // RR A - 2
+                    GB_OPCODE_CB(0x1F): // RR A - 2
                         gb_rr_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x20: // SLA B - 2
+                    GB_OPCODE_CB(0x20): // SLA B - 2
                         gb_sla_r8(cpu->R8.B);
-                        break;
-                    case 0x21: // SLA C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x21): // SLA C - 2
                         gb_sla_r8(cpu->R8.C);
-                        break;
-                    case 0x22: // SLA D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x22): // SLA D - 2
                         gb_sla_r8(cpu->R8.D);
-                        break;
-                    case 0x23: // SLA E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x23): // SLA E - 2
                         gb_sla_r8(cpu->R8.E);
-                        break;
-                    case 0x24: // SLA H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x24): // SLA H - 2
                         gb_sla_r8(cpu->R8.H);
-                        break;
-                    case 0x25: // SLA L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x25): // SLA L - 2
                         gb_sla_r8(cpu->R8.L);
-                        break;
-                    case 0x26: // SLA [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x26): // SLA [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1830,31 +2459,31 @@ static int GB_CPUExecute(int clocks)
                         cpu->F.Z = (temp == 0);
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x27: // SLA A - 2
+                    GB_OPCODE_CB(0x27): // SLA A - 2
                         gb_sla_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x28: // SRA B - 2
+                    GB_OPCODE_CB(0x28): // SRA B - 2
                         gb_sra_r8(cpu->R8.B);
-                        break;
-                    case 0x29: // SRA C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x29): // SRA C - 2
                         gb_sra_r8(cpu->R8.C);
-                        break;
-                    case 0x2A: // SRA D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x2A): // SRA D - 2
                         gb_sra_r8(cpu->R8.D);
-                        break;
-                    case 0x2B: // SRA E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x2B): // SRA E - 2
                         gb_sra_r8(cpu->R8.E);
-                        break;
-                    case 0x2C: // SRA H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x2C): // SRA H - 2
                         gb_sra_r8(cpu->R8.H);
-                        break;
-                    case 0x2D: // SRA L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x2D): // SRA L - 2
                         gb_sra_r8(cpu->R8.L);
-                        break;
-                    case 0x2E: // SRA [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x2E): // SRA [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1865,31 +2494,31 @@ static int GB_CPUExecute(int clocks)
                         cpu->F.Z = (temp == 0);
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x2F: // SRA A - 2
+                    GB_OPCODE_CB(0x2F): // SRA A - 2
                         gb_sra_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x30: // SWAP B - 2
+                    GB_OPCODE_CB(0x30): // SWAP B - 2
                         gb_swap_r8(cpu->R8.B);
-                        break;
-                    case 0x31: // SWAP C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x31): // SWAP C - 2
                         gb_swap_r8(cpu->R8.C);
-                        break;
-                    case 0x32: // SWAP D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x32): // SWAP D - 2
                         gb_swap_r8(cpu->R8.D);
-                        break;
-                    case 0x33: // SWAP E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x33): // SWAP E - 2
                         gb_swap_r8(cpu->R8.E);
-                        break;
-                    case 0x34: // SWAP H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x34): // SWAP H - 2
                         gb_swap_r8(cpu->R8.H);
-                        break;
-                    case 0x35: // SWAP L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x35): // SWAP L - 2
                         gb_swap_r8(cpu->R8.L);
-                        break;
-                    case 0x36: // SWAP [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x36): // SWAP [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1899,31 +2528,31 @@ static int GB_CPUExecute(int clocks)
                         GB_MemWrite8(cpu->R16.HL, temp);
                         cpu->F.Z = (temp == 0);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x37: // SWAP A - 2
+                    GB_OPCODE_CB(0x37): // SWAP A - 2
                         gb_swap_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x38: // SRL B - 2
+                    GB_OPCODE_CB(0x38): // SRL B - 2
                         gb_srl_r8(cpu->R8.B);
-                        break;
-                    case 0x39: // SRL C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x39): // SRL C - 2
                         gb_srl_r8(cpu->R8.C);
-                        break;
-                    case 0x3A: // SRL D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x3A): // SRL D - 2
                         gb_srl_r8(cpu->R8.D);
-                        break;
-                    case 0x3B: // SRL E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x3B): // SRL E - 2
                         gb_srl_r8(cpu->R8.E);
-                        break;
-                    case 0x3C: // SRL H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x3C): // SRL H - 2
                         gb_srl_r8(cpu->R8.H);
-                        break;
-                    case 0x3D: // SRL L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x3D): // SRL L - 2
                         gb_srl_r8(cpu->R8.L);
-                        break;
-                    case 0x3E: // SRL [HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x3E): // SRL [HL] - 4
                     {
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
@@ -1934,591 +2563,592 @@ static int GB_CPUExecute(int clocks)
                         cpu->F.Z = (temp == 0);
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
-                        break;
+                        GB_NEXT();
                     }
-                    case 0x3F: // SRL A - 2
+                    GB_OPCODE_CB(0x3F): // SRL A - 2
                         gb_srl_r8(cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x40: // BIT 0,B - 2
+                    GB_OPCODE_CB(0x40): // BIT 0,B - 2
                         gb_bit_n_r8(0, cpu->R8.B);
-                        break;
-                    case 0x41: // BIT 0,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x41): // BIT 0,C - 2
                         gb_bit_n_r8(0, cpu->R8.C);
-                        break;
-                    case 0x42: // BIT 0,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x42): // BIT 0,D - 2
                         gb_bit_n_r8(0, cpu->R8.D);
-                        break;
-                    case 0x43: // BIT 0,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x43): // BIT 0,E - 2
                         gb_bit_n_r8(0, cpu->R8.E);
-                        break;
-                    case 0x44: // BIT 0,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x44): // BIT 0,H - 2
                         gb_bit_n_r8(0, cpu->R8.H);
-                        break;
-                    case 0x45: // BIT 0,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x45): // BIT 0,L - 2
                         gb_bit_n_r8(0, cpu->R8.L);
-                        break;
-                    case 0x46: // BIT 0,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x46): // BIT 0,[HL] - 3
                         gb_bit_n_ptr_hl(0);
-                        break;
-                    case 0x47: // BIT 0,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x47): // BIT 0,A - 2
                         gb_bit_n_r8(0, cpu->R8.A);
-                        break;
-                    case 0x48: // BIT 1,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x48): // BIT 1,B - 2
                         gb_bit_n_r8(1, cpu->R8.B);
-                        break;
-                    case 0x49: // BIT 1,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x49): // BIT 1,C - 2
                         gb_bit_n_r8(1, cpu->R8.C);
-                        break;
-                    case 0x4A: // BIT 1,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x4A): // BIT 1,D - 2
                         gb_bit_n_r8(1, cpu->R8.D);
-                        break;
-                    case 0x4B: // BIT 1,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x4B): // BIT 1,E - 2
                         gb_bit_n_r8(1, cpu->R8.E);
-                        break;
-                    case 0x4C: // BIT 1,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x4C): // BIT 1,H - 2
                         gb_bit_n_r8(1, cpu->R8.H);
-                        break;
-                    case 0x4D: // BIT 1,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x4D): // BIT 1,L - 2
                         gb_bit_n_r8(1, cpu->R8.L);
-                        break;
-                    case 0x4E: // BIT 1,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x4E): // BIT 1,[HL] - 3
                         gb_bit_n_ptr_hl(1);
-                        break;
-                    case 0x4F: // BIT 1,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x4F): // BIT 1,A - 2
                         gb_bit_n_r8(1, cpu->R8.A);
-                        break;
-                    case 0x50: // BIT 2,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x50): // BIT 2,B - 2
                         gb_bit_n_r8(2, cpu->R8.B);
-                        break;
-                    case 0x51: // BIT 2,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x51): // BIT 2,C - 2
                         gb_bit_n_r8(2, cpu->R8.C);
-                        break;
-                    case 0x52: // BIT 2,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x52): // BIT 2,D - 2
                         gb_bit_n_r8(2, cpu->R8.D);
-                        break;
-                    case 0x53: // BIT 2,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x53): // BIT 2,E - 2
                         gb_bit_n_r8(2, cpu->R8.E);
-                        break;
-                    case 0x54: // BIT 2,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x54): // BIT 2,H - 2
                         gb_bit_n_r8(2, cpu->R8.H);
-                        break;
-                    case 0x55: // BIT 2,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x55): // BIT 2,L - 2
                         gb_bit_n_r8(2, cpu->R8.L);
-                        break;
-                    case 0x56: // BIT 2,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x56): // BIT 2,[HL] - 3
                         gb_bit_n_ptr_hl(2);
-                        break;
-                    case 0x57: // BIT 2,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x57): // BIT 2,A - 2
                         gb_bit_n_r8(2, cpu->R8.A);
-                        break;
-                    case 0x58: // BIT 3,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x58): // BIT 3,B - 2
                         gb_bit_n_r8(3, cpu->R8.B);
-                        break;
-                    case 0x59: // BIT 3,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x59): // BIT 3,C - 2
                         gb_bit_n_r8(3, cpu->R8.C);
-                        break;
-                    case 0x5A: // BIT 3,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x5A): // BIT 3,D - 2
                         gb_bit_n_r8(3, cpu->R8.D);
-                        break;
-                    case 0x5B: // BIT 3,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x5B): // BIT 3,E - 2
                         gb_bit_n_r8(3, cpu->R8.E);
-                        break;
-                    case 0x5C: // BIT 3,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x5C): // BIT 3,H - 2
                         gb_bit_n_r8(3, cpu->R8.H);
-                        break;
-                    case 0x5D: // BIT 3,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x5D): // BIT 3,L - 2
                         gb_bit_n_r8(3, cpu->R8.L);
-                        break;
-                    case 0x5E: // BIT 3,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x5E): // BIT 3,[HL] - 3
                         gb_bit_n_ptr_hl(3);
-                        break;
-                    case 0x5F: // BIT 3,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x5F): // BIT 3,A - 2
                         gb_bit_n_r8(3, cpu->R8.A);
-                        break;
-                    case 0x60: // BIT 4,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x60): // BIT 4,B - 2
                         gb_bit_n_r8(4, cpu->R8.B);
-                        break;
-                    case 0x61: // BIT 4,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x61): // BIT 4,C - 2
                         gb_bit_n_r8(4, cpu->R8.C);
-                        break;
-                    case 0x62: // BIT 4,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x62): // BIT 4,D - 2
                         gb_bit_n_r8(4, cpu->R8.D);
-                        break;
-                    case 0x63: // BIT 4,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x63): // BIT 4,E - 2
                         gb_bit_n_r8(4, cpu->R8.E);
-                        break;
-                    case 0x64: // BIT 4,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x64): // BIT 4,H - 2
                         gb_bit_n_r8(4, cpu->R8.H);
-                        break;
-                    case 0x65: // BIT 4,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x65): // BIT 4,L - 2
                         gb_bit_n_r8(4, cpu->R8.L);
-                        break;
-                    case 0x66: // BIT 4,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x66): // BIT 4,[HL] - 3
                         gb_bit_n_ptr_hl(4);
-                        break;
-                    case 0x67: // BIT 4,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x67): // BIT 4,A - 2
                         gb_bit_n_r8(4, cpu->R8.A);
-                        break;
-                    case 0x68: // BIT 5,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x68): // BIT 5,B - 2
                         gb_bit_n_r8(5, cpu->R8.B);
-                        break;
-                    case 0x69: // BIT 5,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x69): // BIT 5,C - 2
                         gb_bit_n_r8(5, cpu->R8.C);
-                        break;
-                    case 0x6A: // BIT 5,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x6A): // BIT 5,D - 2
                         gb_bit_n_r8(5, cpu->R8.D);
-                        break;
-                    case 0x6B: // BIT 5,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x6B): // BIT 5,E - 2
                         gb_bit_n_r8(5, cpu->R8.E);
-                        break;
-                    case 0x6C: // BIT 5,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x6C): // BIT 5,H - 2
                         gb_bit_n_r8(5, cpu->R8.H);
-                        break;
-                    case 0x6D: // BIT 5,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x6D): // BIT 5,L - 2
                         gb_bit_n_r8(5, cpu->R8.L);
-                        break;
-                    case 0x6E: // BIT 5,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x6E): // BIT 5,[HL] - 3
                         gb_bit_n_ptr_hl(5);
-                        break;
-                    case 0x6F: // BIT 5,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x6F): // BIT 5,A - 2
                         gb_bit_n_r8(5, cpu->R8.A);
-                        break;
-                    case 0x70: // BIT 6,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x70): // BIT 6,B - 2
                         gb_bit_n_r8(6, cpu->R8.B);
-                        break;
-                    case 0x71: // BIT 6,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x71): // BIT 6,C - 2
                         gb_bit_n_r8(6, cpu->R8.C);
-                        break;
-                    case 0x72: // BIT 6,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x72): // BIT 6,D - 2
                         gb_bit_n_r8(6, cpu->R8.D);
-                        break;
-                    case 0x73: // BIT 6,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x73): // BIT 6,E - 2
                         gb_bit_n_r8(6, cpu->R8.E);
-                        break;
-                    case 0x74: // BIT 6,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x74): // BIT 6,H - 2
                         gb_bit_n_r8(6, cpu->R8.H);
-                        break;
-                    case 0x75: // BIT 6,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x75): // BIT 6,L - 2
                         gb_bit_n_r8(6, cpu->R8.L);
-                        break;
-                    case 0x76: // BIT 6,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x76): // BIT 6,[HL] - 3
                         gb_bit_n_ptr_hl(6);
-                        break;
-                    case 0x77: // BIT 6,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x77): // BIT 6,A - 2
                         gb_bit_n_r8(6, cpu->R8.A);
-                        break;
-                    case 0x78: // BIT 7,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x78): // BIT 7,B - 2
                         gb_bit_n_r8(7, cpu->R8.B);
-                        break;
-                    case 0x79: // BIT 7,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x79): // BIT 7,C - 2
                         gb_bit_n_r8(7, cpu->R8.C);
-                        break;
-                    case 0x7A: // BIT 7,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x7A): // BIT 7,D - 2
                         gb_bit_n_r8(7, cpu->R8.D);
-                        break;
-                    case 0x7B: // BIT 7,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x7B): // BIT 7,E - 2
                         gb_bit_n_r8(7, cpu->R8.E);
-                        break;
-                    case 0x7C: // BIT 7,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x7C): // BIT 7,H - 2
                         gb_bit_n_r8(7, cpu->R8.H);
-                        break;
-                    case 0x7D: // BIT 7,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x7D): // BIT 7,L - 2
                         gb_bit_n_r8(7, cpu->R8.L);
-                        break;
-                    case 0x7E: // BIT 7,[HL] - 3
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x7E): // BIT 7,[HL] - 3
                         gb_bit_n_ptr_hl(7);
-                        break;
-                    case 0x7F: // BIT 7,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x7F): // BIT 7,A - 2
                         gb_bit_n_r8(7, cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0x80: // RES 0,B - 2
+                    GB_OPCODE_CB(0x80): // RES 0,B - 2
                         gb_res_n_r8(0, cpu->R8.B);
-                        break;
-                    case 0x81: // RES 0,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x81): // RES 0,C - 2
                         gb_res_n_r8(0, cpu->R8.C);
-                        break;
-                    case 0x82: // RES 0,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x82): // RES 0,D - 2
                         gb_res_n_r8(0, cpu->R8.D);
-                        break;
-                    case 0x83: // RES 0,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x83): // RES 0,E - 2
                         gb_res_n_r8(0, cpu->R8.E);
-                        break;
-                    case 0x84: // RES 0,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x84): // RES 0,H - 2
                         gb_res_n_r8(0, cpu->R8.H);
-                        break;
-                    case 0x85: // RES 0,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x85): // RES 0,L - 2
                         gb_res_n_r8(0, cpu->R8.L);
-                        break;
-                    case 0x86: // RES 0,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x86): // RES 0,[HL] - 4
                         gb_res_n_ptr_hl(0);
-                        break;
-                    case 0x87: // RES 0,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x87): // RES 0,A - 2
                         gb_res_n_r8(0, cpu->R8.A);
-                        break;
-                    case 0x88: // RES 1,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x88): // RES 1,B - 2
                         gb_res_n_r8(1, cpu->R8.B);
-                        break;
-                    case 0x89: // RES 1,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x89): // RES 1,C - 2
                         gb_res_n_r8(1, cpu->R8.C);
-                        break;
-                    case 0x8A: // RES 1,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x8A): // RES 1,D - 2
                         gb_res_n_r8(1, cpu->R8.D);
-                        break;
-                    case 0x8B: // RES 1,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x8B): // RES 1,E - 2
                         gb_res_n_r8(1, cpu->R8.E);
-                        break;
-                    case 0x8C: // RES 1,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x8C): // RES 1,H - 2
                         gb_res_n_r8(1, cpu->R8.H);
-                        break;
-                    case 0x8D: // RES 1,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x8D): // RES 1,L - 2
                         gb_res_n_r8(1, cpu->R8.L);
-                        break;
-                    case 0x8E: // RES 1,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x8E): // RES 1,[HL] - 4
                         gb_res_n_ptr_hl(1);
-                        break;
-                    case 0x8F: // RES 1,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x8F): // RES 1,A - 2
                         gb_res_n_r8(1, cpu->R8.A);
-                        break;
-                    case 0x90: // RES 2,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x90): // RES 2,B - 2
                         gb_res_n_r8(2, cpu->R8.B);
-                        break;
-                    case 0x91: // RES 2,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x91): // RES 2,C - 2
                         gb_res_n_r8(2, cpu->R8.C);
-                        break;
-                    case 0x92: // RES 2,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x92): // RES 2,D - 2
                         gb_res_n_r8(2, cpu->R8.D);
-                        break;
-                    case 0x93: // RES 2,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x93): // RES 2,E - 2
                         gb_res_n_r8(2, cpu->R8.E);
-                        break;
-                    case 0x94: // RES 2,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x94): // RES 2,H - 2
                         gb_res_n_r8(2, cpu->R8.H);
-                        break;
-                    case 0x95: // RES 2,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x95): // RES 2,L - 2
                         gb_res_n_r8(2, cpu->R8.L);
-                        break;
-                    case 0x96: // RES 2,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x96): // RES 2,[HL] - 4
                         gb_res_n_ptr_hl(2);
-                        break;
-                    case 0x97: // RES 2,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x97): // RES 2,A - 2
                         gb_res_n_r8(2, cpu->R8.A);
-                        break;
-                    case 0x98: // RES 3,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x98): // RES 3,B - 2
                         gb_res_n_r8(3, cpu->R8.B);
-                        break;
-                    case 0x99: // RES 3,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x99): // RES 3,C - 2
                         gb_res_n_r8(3, cpu->R8.C);
-                        break;
-                    case 0x9A: // RES 3,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x9A): // RES 3,D - 2
                         gb_res_n_r8(3, cpu->R8.D);
-                        break;
-                    case 0x9B: // RES 3,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x9B): // RES 3,E - 2
                         gb_res_n_r8(3, cpu->R8.E);
-                        break;
-                    case 0x9C: // RES 3,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x9C): // RES 3,H - 2
                         gb_res_n_r8(3, cpu->R8.H);
-                        break;
-                    case 0x9D: // RES 3,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x9D): // RES 3,L - 2
                         gb_res_n_r8(3, cpu->R8.L);
-                        break;
-                    case 0x9E: // RES 3,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x9E): // RES 3,[HL] - 4
                         gb_res_n_ptr_hl(3);
-                        break;
-                    case 0x9F: // RES 3,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0x9F): // RES 3,A - 2
                         gb_res_n_r8(3, cpu->R8.A);
-                        break;
-                    case 0xA0: // RES 4,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA0): // RES 4,B - 2
                         gb_res_n_r8(4, cpu->R8.B);
-                        break;
-                    case 0xA1: // RES 4,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA1): // RES 4,C - 2
                         gb_res_n_r8(4, cpu->R8.C);
-                        break;
-                    case 0xA2: // RES 4,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA2): // RES 4,D - 2
                         gb_res_n_r8(4, cpu->R8.D);
-                        break;
-                    case 0xA3: // RES 4,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA3): // RES 4,E - 2
                         gb_res_n_r8(4, cpu->R8.E);
-                        break;
-                    case 0xA4: // RES 4,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA4): // RES 4,H - 2
                         gb_res_n_r8(4, cpu->R8.H);
-                        break;
-                    case 0xA5: // RES 4,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA5): // RES 4,L - 2
                         gb_res_n_r8(4, cpu->R8.L);
-                        break;
-                    case 0xA6: // RES 4,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA6): // RES 4,[HL] - 4
                         gb_res_n_ptr_hl(4);
-                        break;
-                    case 0xA7: // RES 4,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA7): // RES 4,A - 2
                         gb_res_n_r8(4, cpu->R8.A);
-                        break;
-                    case 0xA8: // RES 5,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA8): // RES 5,B - 2
                         gb_res_n_r8(5, cpu->R8.B);
-                        break;
-                    case 0xA9: // RES 5,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xA9): // RES 5,C - 2
                         gb_res_n_r8(5, cpu->R8.C);
-                        break;
-                    case 0xAA: // RES 5,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xAA): // RES 5,D - 2
                         gb_res_n_r8(5, cpu->R8.D);
-                        break;
-                    case 0xAB: // RES 5,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xAB): // RES 5,E - 2
                         gb_res_n_r8(5, cpu->R8.E);
-                        break;
-                    case 0xAC: // RES 5,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xAC): // RES 5,H - 2
                         gb_res_n_r8(5, cpu->R8.H);
-                        break;
-                    case 0xAD: // RES 5,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xAD): // RES 5,L - 2
                         gb_res_n_r8(5, cpu->R8.L);
-                        break;
-                    case 0xAE: // RES 5,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xAE): // RES 5,[HL] - 4
                         gb_res_n_ptr_hl(5);
-                        break;
-                    case 0xAF: // RES 5,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xAF): // RES 5,A - 2
                         gb_res_n_r8(5, cpu->R8.A);
-                        break;
-                    case 0xB0: // RES 6,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB0): // RES 6,B - 2
                         gb_res_n_r8(6, cpu->R8.B);
-                        break;
-                    case 0xB1: // RES 6,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB1): // RES 6,C - 2
                         gb_res_n_r8(6, cpu->R8.C);
-                        break;
-                    case 0xB2: // RES 6,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB2): // RES 6,D - 2
                         gb_res_n_r8(6, cpu->R8.D);
-                        break;
-                    case 0xB3: // RES 6,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB3): // RES 6,E - 2
                         gb_res_n_r8(6, cpu->R8.E);
-                        break;
-                    case 0xB4: // RES 6,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB4): // RES 6,H - 2
                         gb_res_n_r8(6, cpu->R8.H);
-                        break;
-                    case 0xB5: // RES 6,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB5): // RES 6,L - 2
                         gb_res_n_r8(6, cpu->R8.L);
-                        break;
-                    case 0xB6: // RES 6,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB6): // RES 6,[HL] - 4
                         gb_res_n_ptr_hl(6);
-                        break;
-                    case 0xB7: // RES 6,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB7): // RES 6,A - 2
                         gb_res_n_r8(6, cpu->R8.A);
-                        break;
-                    case 0xB8: // RES 7,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB8): // RES 7,B - 2
                         gb_res_n_r8(7, cpu->R8.B);
-                        break;
-                    case 0xB9: // RES 7,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xB9): // RES 7,C - 2
                         gb_res_n_r8(7, cpu->R8.C);
-                        break;
-                    case 0xBA: // RES 7,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xBA): // RES 7,D - 2
                         gb_res_n_r8(7, cpu->R8.D);
-                        break;
-                    case 0xBB: // RES 7,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xBB): // RES 7,E - 2
                         gb_res_n_r8(7, cpu->R8.E);
-                        break;
-                    case 0xBC: // RES 7,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xBC): // RES 7,H - 2
                         gb_res_n_r8(7, cpu->R8.H);
-                        break;
-                    case 0xBD: // RES 7,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xBD): // RES 7,L - 2
                         gb_res_n_r8(7, cpu->R8.L);
-                        break;
-                    case 0xBE: // RES 7,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xBE): // RES 7,[HL] - 4
                         gb_res_n_ptr_hl(7);
-                        break;
-                    case 0xBF: // RES 7,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xBF): // RES 7,A - 2
                         gb_res_n_r8(7, cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
-                    case 0xC0: // SET 0,B - 2
+                    GB_OPCODE_CB(0xC0): // SET 0,B - 2
                         gb_set_n_r8(0, cpu->R8.B);
-                        break;
-                    case 0xC1: // SET 0,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC1): // SET 0,C - 2
                         gb_set_n_r8(0, cpu->R8.C);
-                        break;
-                    case 0xC2: // SET 0,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC2): // SET 0,D - 2
                         gb_set_n_r8(0, cpu->R8.D);
-                        break;
-                    case 0xC3: // SET 0,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC3): // SET 0,E - 2
                         gb_set_n_r8(0, cpu->R8.E);
-                        break;
-                    case 0xC4: // SET 0,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC4): // SET 0,H - 2
                         gb_set_n_r8(0, cpu->R8.H);
-                        break;
-                    case 0xC5: // SET 0,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC5): // SET 0,L - 2
                         gb_set_n_r8(0, cpu->R8.L);
-                        break;
-                    case 0xC6: // SET 0,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC6): // SET 0,[HL] - 4
                         gb_set_n_ptr_hl(0);
-                        break;
-                    case 0xC7: // SET 0,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC7): // SET 0,A - 2
                         gb_set_n_r8(0, cpu->R8.A);
-                        break;
-                    case 0xC8: // SET 1,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC8): // SET 1,B - 2
                         gb_set_n_r8(1, cpu->R8.B);
-                        break;
-                    case 0xC9: // SET 1,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xC9): // SET 1,C - 2
                         gb_set_n_r8(1, cpu->R8.C);
-                        break;
-                    case 0xCA: // SET 1,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xCA): // SET 1,D - 2
                         gb_set_n_r8(1, cpu->R8.D);
-                        break;
-                    case 0xCB: // SET 1,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xCB): // SET 1,E - 2
                         gb_set_n_r8(1, cpu->R8.E);
-                        break;
-                    case 0xCC: // SET 1,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xCC): // SET 1,H - 2
                         gb_set_n_r8(1, cpu->R8.H);
-                        break;
-                    case 0xCD: // SET 1,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xCD): // SET 1,L - 2
                         gb_set_n_r8(1, cpu->R8.L);
-                        break;
-                    case 0xCE: // SET 1,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xCE): // SET 1,[HL] - 4
                         gb_set_n_ptr_hl(1);
-                        break;
-                    case 0xCF: // SET 1,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xCF): // SET 1,A - 2
                         gb_set_n_r8(1, cpu->R8.A);
-                        break;
-                    case 0xD0: // SET 2,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD0): // SET 2,B - 2
                         gb_set_n_r8(2, cpu->R8.B);
-                        break;
-                    case 0xD1: // SET 2,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD1): // SET 2,C - 2
                         gb_set_n_r8(2, cpu->R8.C);
-                        break;
-                    case 0xD2: // SET 2,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD2): // SET 2,D - 2
                         gb_set_n_r8(2, cpu->R8.D);
-                        break;
-                    case 0xD3: // SET 2,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD3): // SET 2,E - 2
                         gb_set_n_r8(2, cpu->R8.E);
-                        break;
-                    case 0xD4: // SET 2,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD4): // SET 2,H - 2
                         gb_set_n_r8(2, cpu->R8.H);
-                        break;
-                    case 0xD5: // SET 2,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD5): // SET 2,L - 2
                         gb_set_n_r8(2, cpu->R8.L);
-                        break;
-                    case 0xD6: // SET 2,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD6): // SET 2,[HL] - 4
                         gb_set_n_ptr_hl(2);
-                        break;
-                    case 0xD7: // SET 2,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD7): // SET 2,A - 2
                         gb_set_n_r8(2, cpu->R8.A);
-                        break;
-                    case 0xD8: // SET 3,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD8): // SET 3,B - 2
                         gb_set_n_r8(3, cpu->R8.B);
-                        break;
-                    case 0xD9: // SET 3,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xD9): // SET 3,C - 2
                         gb_set_n_r8(3, cpu->R8.C);
-                        break;
-                    case 0xDA: // SET 3,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xDA): // SET 3,D - 2
                         gb_set_n_r8(3, cpu->R8.D);
-                        break;
-                    case 0xDB: // SET 3,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xDB): // SET 3,E - 2
                         gb_set_n_r8(3, cpu->R8.E);
-                        break;
-                    case 0xDC: // SET 3,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xDC): // SET 3,H - 2
                         gb_set_n_r8(3, cpu->R8.H);
-                        break;
-                    case 0xDD: // SET 3,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xDD): // SET 3,L - 2
                         gb_set_n_r8(3, cpu->R8.L);
-                        break;
-                    case 0xDE: // SET 3,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xDE): // SET 3,[HL] - 4
                         gb_set_n_ptr_hl(3);
-                        break;
-                    case 0xDF: // SET 3,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xDF): // SET 3,A - 2
                         gb_set_n_r8(3, cpu->R8.A);
-                        break;
-                    case 0xE0: // SET 4,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE0): // SET 4,B - 2
                         gb_set_n_r8(4, cpu->R8.B);
-                        break;
-                    case 0xE1: // SET 4,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE1): // SET 4,C - 2
                         gb_set_n_r8(4, cpu->R8.C);
-                        break;
-                    case 0xE2: // SET 4,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE2): // SET 4,D - 2
                         gb_set_n_r8(4, cpu->R8.D);
-                        break;
-                    case 0xE3: // SET 4,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE3): // SET 4,E - 2
                         gb_set_n_r8(4, cpu->R8.E);
-                        break;
-                    case 0xE4: // SET 4,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE4): // SET 4,H - 2
                         gb_set_n_r8(4, cpu->R8.H);
-                        break;
-                    case 0xE5: // SET 4,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE5): // SET 4,L - 2
                         gb_set_n_r8(4, cpu->R8.L);
-                        break;
-                    case 0xE6: // SET 4,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE6): // SET 4,[HL] - 4
                         gb_set_n_ptr_hl(4);
-                        break;
-                    case 0xE7: // SET 4,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE7): // SET 4,A - 2
                         gb_set_n_r8(4, cpu->R8.A);
-                        break;
-                    case 0xE8: // SET 5,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE8): // SET 5,B - 2
                         gb_set_n_r8(5, cpu->R8.B);
-                        break;
-                    case 0xE9: // SET 5,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xE9): // SET 5,C - 2
                         gb_set_n_r8(5, cpu->R8.C);
-                        break;
-                    case 0xEA: // SET 5,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xEA): // SET 5,D - 2
                         gb_set_n_r8(5, cpu->R8.D);
-                        break;
-                    case 0xEB: // SET 5,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xEB): // SET 5,E - 2
                         gb_set_n_r8(5, cpu->R8.E);
-                        break;
-                    case 0xEC: // SET 5,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xEC): // SET 5,H - 2
                         gb_set_n_r8(5, cpu->R8.H);
-                        break;
-                    case 0xED: // SET 5,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xED): // SET 5,L - 2
                         gb_set_n_r8(5, cpu->R8.L);
-                        break;
-                    case 0xEE: // SET 5,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xEE): // SET 5,[HL] - 4
                         gb_set_n_ptr_hl(5);
-                        break;
-                    case 0xEF: // SET 5,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xEF): // SET 5,A - 2
                         gb_set_n_r8(5, cpu->R8.A);
-                        break;
-                    case 0xF0: // SET 6,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF0): // SET 6,B - 2
                         gb_set_n_r8(6, cpu->R8.B);
-                        break;
-                    case 0xF1: // SET 6,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF1): // SET 6,C - 2
                         gb_set_n_r8(6, cpu->R8.C);
-                        break;
-                    case 0xF2: // SET 6,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF2): // SET 6,D - 2
                         gb_set_n_r8(6, cpu->R8.D);
-                        break;
-                    case 0xF3: // SET 6,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF3): // SET 6,E - 2
                         gb_set_n_r8(6, cpu->R8.E);
-                        break;
-                    case 0xF4: // SET 6,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF4): // SET 6,H - 2
                         gb_set_n_r8(6, cpu->R8.H);
-                        break;
-                    case 0xF5: // SET 6,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF5): // SET 6,L - 2
                         gb_set_n_r8(6, cpu->R8.L);
-                        break;
-                    case 0xF6: // SET 6,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF6): // SET 6,[HL] - 4
                         gb_set_n_ptr_hl(6);
-                        break;
-                    case 0xF7: // SET 6,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF7): // SET 6,A - 2
                         gb_set_n_r8(6, cpu->R8.A);
-                        break;
-                    case 0xF8: // SET 7,B - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF8): // SET 7,B - 2
                         gb_set_n_r8(7, cpu->R8.B);
-                        break;
-                    case 0xF9: // SET 7,C - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xF9): // SET 7,C - 2
                         gb_set_n_r8(7, cpu->R8.C);
-                        break;
-                    case 0xFA: // SET 7,D - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xFA): // SET 7,D - 2
                         gb_set_n_r8(7, cpu->R8.D);
-                        break;
-                    case 0xFB: // SET 7,E - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xFB): // SET 7,E - 2
                         gb_set_n_r8(7, cpu->R8.E);
-                        break;
-                    case 0xFC: // SET 7,H - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xFC): // SET 7,H - 2
                         gb_set_n_r8(7, cpu->R8.H);
-                        break;
-                    case 0xFD: // SET 7,L - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xFD): // SET 7,L - 2
                         gb_set_n_r8(7, cpu->R8.L);
-                        break;
-                    case 0xFE: // SET 7,[HL] - 4
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xFE): // SET 7,[HL] - 4
                         gb_set_n_ptr_hl(7);
-                        break;
-                    case 0xFF: // SET 7,A - 2
+                        GB_NEXT();
+                    GB_OPCODE_CB(0xFF): // SET 7,A - 2
                         gb_set_n_r8(7, cpu->R8.A);
-                        break;
+                        GB_NEXT();
 
+#ifndef GB_CPU_THREADED_DISPATCH
                     default:
                         // Shouldn't happen
                         GB_CPUClockCounterAdd(4);
@@ -2528,19 +3158,20 @@ static int GB_CPUExecute(int clocks)
                                           "ROM: %d",
                                           opcode, GameBoy.CPU.R16.PC,
                                           GameBoy.Memory.selected_rom);
-                        break;
-                } // End of inner 0xCB switch
-                break;
-            case 0xCC: // CALL Z,nnnn - 6/3
+                        GB_NEXT();
+#endif
+                } // End of 0xCB handlers
+                GB_NEXT();
+            GB_OPCODE(0xCC): // CALL Z,nnnn - 6/3
                 gb_call_cond_nnnn(cpu->F.Z);
-                break;
-            case 0xCD: // CALL nnnn - 6
+                GB_NEXT();
+            GB_OPCODE(0xCD): // CALL nnnn - 6
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                temp |= ((u32)GB_MemRead8(cpu->R16.PC++)) << 8;
+                temp |= ((u32)GB_CPUFetch8(cpu->R16.PC++)) << 8;
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(8);
                 cpu->R16.SP--;
@@ -2552,61 +3183,61 @@ static int GB_CPUExecute(int clocks)
                 GB_MemWrite8(cpu->R16.SP, cpu->R8.PCL);
                 cpu->R16.PC = temp;
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xCE: // ADC A,nn - 2
+            GB_OPCODE(0xCE): // ADC A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~F_SUBTRACT;
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 u32 temp2 = cpu->R8.A + temp + cpu->F.C;
                 cpu->F.H = (((cpu->R8.A & 0xF) + (temp & 0xF)) + cpu->F.C) > 0xF;
                 cpu->F.C = (temp2 > 0xFF);
                 cpu->R8.A = (temp2 & 0xFF);
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xCF: // RST 0x0008 - 4
+            GB_OPCODE(0xCF): // RST 0x0008 - 4
                 gb_rst_nnnn(0x0008);
-                break;
-            case 0xD0: // RET NC - 5/2
+                GB_NEXT();
+            GB_OPCODE(0xD0): // RET NC - 5/2
                 gb_ret_cond(cpu->F.C == 0);
-                break;
-            case 0xD1: // POP DE - 3
+                GB_NEXT();
+            GB_OPCODE(0xD1): // POP DE - 3
                 gb_pop_r16(cpu->R8.D, cpu->R8.E);
-                break;
-            case 0xD2: // JP NC,nnnn - 4/3
+                GB_NEXT();
+            GB_OPCODE(0xD2): // JP NC,nnnn - 4/3
                 gb_jp_cond_nnnn(cpu->F.C == 0);
-                break;
-            case 0xD3: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xD3): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xD4: // CALL NC,nnnn - 6/3
+                GB_NEXT();
+            GB_OPCODE(0xD4): // CALL NC,nnnn - 6/3
                 gb_call_cond_nnnn(cpu->F.C == 0);
-                break;
-            case 0xD5: // PUSH DE - 4
+                GB_NEXT();
+            GB_OPCODE(0xD5): // PUSH DE - 4
                 gb_push_r16(cpu->R8.D, cpu->R8.E);
-                break;
-            case 0xD6: // SUB A,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0xD6): // SUB A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R16.AF |= F_SUBTRACT;
                 cpu->F.H = (cpu->R8.A & 0xF) < (temp & 0xF);
                 cpu->F.C = (u32)cpu->R8.A < temp;
                 cpu->R8.A -= temp;
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xD7: // RST 0x0010 - 4
+            GB_OPCODE(0xD7): // RST 0x0010 - 4
                 gb_rst_nnnn(0x0010);
-                break;
-            case 0xD8: // RET C - 5/2
+                GB_NEXT();
+            GB_OPCODE(0xD8): // RET C - 5/2
                 gb_ret_cond(cpu->F.C);
-                break;
-            case 0xD9: // RETI - 4
+                GB_NEXT();
+            GB_OPCODE(0xD9): // RETI - 4
             {
                 GB_CPUClockCounterAdd(4);
                 u32 temp = GB_MemRead8(cpu->R16.SP++);
@@ -2619,24 +3250,24 @@ static int GB_CPUExecute(int clocks)
                 GameBoy.Memory.InterruptMasterEnable = 1;
                 GB_CPUClockCounterAdd(4);
                 GB_CPUBreakLoop();
-                break;
+                GB_NEXT();
             }
-            case 0xDA: // JP C,nnnn - 4/3
+            GB_OPCODE(0xDA): // JP C,nnnn - 4/3
                 gb_jp_cond_nnnn(cpu->F.C);
-                break;
-            case 0xDB: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xDB): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xDC: // CALL C,nnnn - 6/3
+                GB_NEXT();
+            GB_OPCODE(0xDC): // CALL C,nnnn - 6/3
                 gb_call_cond_nnnn(cpu->F.C);
-                break;
-            case 0xDD: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xDD): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xDE: // SBC A,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0xDE): // SBC A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp2 = GB_MemRead8(cpu->R16.PC++);
+                u32 temp2 = GB_CPUFetch8(cpu->R16.PC++);
                 u32 temp = cpu->R8.A - temp2 - ((cpu->R8.F & F_CARRY) ? 1 : 0);
                 cpu->R8.F = ((temp & ~0xFF) ? F_CARRY : 0)
                             | ((temp & 0xFF) ? 0 : F_ZERO)
@@ -2644,142 +3275,142 @@ static int GB_CPUExecute(int clocks)
                 cpu->F.H = ((cpu->R8.A ^ temp2 ^ temp) & 0x10) != 0;
                 cpu->R8.A = temp;
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xDF: // RST 0x0018 - 4
+            GB_OPCODE(0xDF): // RST 0x0018 - 4
                 gb_rst_nnnn(0x0018);
-                break;
-            case 0xE0: // LD [0xFF00+nn],A - 3
+                GB_NEXT();
+            GB_OPCODE(0xE0): // LD [0xFF00+nn],A - 3
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = 0xFF00 + (u32)GB_MemRead8(cpu->R16.PC++);
+                u32 temp = 0xFF00 + (u32)GB_CPUFetch8(cpu->R16.PC++);
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(temp, cpu->R8.A);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xE1: // POP HL - 3
+            GB_OPCODE(0xE1): // POP HL - 3
                 gb_pop_r16(cpu->R8.H, cpu->R8.L);
-                break;
-            case 0xE2: // LD [0xFF00+C],A - 2
+                GB_NEXT();
+            GB_OPCODE(0xE2): // LD [0xFF00+C],A - 2
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(0xFF00 + (u32)cpu->R8.C, cpu->R8.A);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xE3: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xE3): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xE4: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xE4): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xE5: // PUSH HL - 4
+                GB_NEXT();
+            GB_OPCODE(0xE5): // PUSH HL - 4
                 gb_push_r16(cpu->R8.H, cpu->R8.L);
-                break;
-            case 0xE6: // AND A,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0xE6): // AND A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY);
                 cpu->R16.AF |= F_HALFCARRY;
-                cpu->R8.A &= GB_MemRead8(cpu->R16.PC++);
+                cpu->R8.A &= GB_CPUFetch8(cpu->R16.PC++);
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xE7: // RST 0x0020 - 4
+            GB_OPCODE(0xE7): // RST 0x0020 - 4
                 gb_rst_nnnn(0x0020);
-                break;
-            case 0xE8: // ADD SP,nn - 4
+                GB_NEXT();
+            GB_OPCODE(0xE8): // ADD SP,nn - 4
             {
                 GB_CPUClockCounterAdd(4);
                 // Expand sign
-                u32 temp = (u16)(s16)(s8)GB_MemRead8(cpu->R16.PC++);
+                u32 temp = (u16)(s16)(s8)GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R8.F = 0;
                 cpu->F.C = ((cpu->R16.SP & 0x00FF) + (temp & 0x00FF)) > 0x00FF;
                 cpu->F.H = ((cpu->R16.SP & 0x000F) + (temp & 0x000F)) > 0x000F;
                 cpu->R16.SP = (cpu->R16.SP + temp) & 0xFFFF;
                 GB_CPUClockCounterAdd(12);
-                break;
+                GB_NEXT();
             }
-            case 0xE9: // JP HL - 1
+            GB_OPCODE(0xE9): // JP HL - 1
                 cpu->R16.PC = cpu->R16.HL;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xEA: // LD [nnnn],A - 4
+                GB_NEXT();
+            GB_OPCODE(0xEA): // LD [nnnn],A - 4
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                temp |= ((u32)GB_MemRead8(cpu->R16.PC++)) << 8;
+                temp |= ((u32)GB_CPUFetch8(cpu->R16.PC++)) << 8;
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(4);
                 GB_MemWrite8(temp, cpu->R8.A);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xEB: // Undefined - *
+            GB_OPCODE(0xEB): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xEC: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xEC): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xED: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xED): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xEE: // XOR A,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0xEE): // XOR A,nn - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
-                cpu->R8.A ^= GB_MemRead8(cpu->R16.PC++);
+                cpu->R8.A ^= GB_CPUFetch8(cpu->R16.PC++);
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xEF: // RST 0x0028 - 4
+                GB_NEXT();
+            GB_OPCODE(0xEF): // RST 0x0028 - 4
                 gb_rst_nnnn(0x0028);
-                break;
+                GB_NEXT();
 
-            case 0xF0: // LD A,[0xFF00+nn] - 3
+            GB_OPCODE(0xF0): // LD A,[0xFF00+nn] - 3
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = 0xFF00 + (u32)GB_MemRead8(cpu->R16.PC++);
+                u32 temp = 0xFF00 + (u32)GB_CPUFetch8(cpu->R16.PC++);
                 GB_CPUClockCounterAdd(4);
                 cpu->R8.A = GB_MemRead8(temp);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xF1: // POP AF - 3
+            GB_OPCODE(0xF1): // POP AF - 3
                 gb_pop_r16(cpu->R8.A, cpu->R8.F);
                 cpu->R8.F &= 0xF0; // Lower 4 bits are always 0
-                break;
-            case 0xF2: // LD A,[0xFF00+C] - 2
+                GB_NEXT();
+            GB_OPCODE(0xF2): // LD A,[0xFF00+C] - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R8.A = GB_MemRead8(0xFF00 + (u32)cpu->R8.C);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xF3: // DI - 1
+                GB_NEXT();
+            GB_OPCODE(0xF3): // DI - 1
                 GameBoy.Memory.InterruptMasterEnable = 0;
                 GameBoy.Memory.interrupts_enable_count = 0;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xF4: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xF4): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xF5: // PUSH AF - 4
+                GB_NEXT();
+            GB_OPCODE(0xF5): // PUSH AF - 4
                 gb_push_r16(cpu->R8.A, cpu->R8.F);
-                break;
-            case 0xF6: // OR A,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0xF6): // OR A,nn - 2
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
-                cpu->R8.A |= GB_MemRead8(cpu->R16.PC++);
+                cpu->R8.A |= GB_CPUFetch8(cpu->R16.PC++);
                 cpu->F.Z = (cpu->R8.A == 0);
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xF7: // RST 0x0030 - 4
+                GB_NEXT();
+            GB_OPCODE(0xF7): // RST 0x0030 - 4
                 gb_rst_nnnn(0x0030);
-                break;
-            case 0xF8: // LD HL,SP+nn - 3
+                GB_NEXT();
+            GB_OPCODE(0xF8): // LD HL,SP+nn - 3
             {
                 GB_CPUClockCounterAdd(4);
-                s32 temp = (s32)(s8)GB_MemRead8(cpu->R16.PC++);
+                s32 temp = (s32)(s8)GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R16.PC &= 0xFFFF;
                 s32 res = (s32)cpu->R16.SP + temp;
                 cpu->R16.HL = res & 0xFFFF;
@@ -2787,52 +3418,54 @@ static int GB_CPUExecute(int clocks)
                 cpu->F.C = ((cpu->R16.SP & 0x00FF) + (temp & 0x00FF)) > 0x00FF;
                 cpu->F.H = ((cpu->R16.SP & 0x000F) + (temp & 0x000F)) > 0x000F;
                 GB_CPUClockCounterAdd(8);
-                break;
+                GB_NEXT();
             }
-            case 0xF9: // LD SP,HL - 2
+            GB_OPCODE(0xF9): // LD SP,HL - 2
                 cpu->R16.SP = cpu->R16.HL;
                 GB_CPUClockCounterAdd(8);
-                break;
-            case 0xFA: // LD A,[nnnn] - 4
+                GB_NEXT();
+            GB_OPCODE(0xFA): // LD A,[nnnn] - 4
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(4);
-                temp |= ((u32)GB_MemRead8(cpu->R16.PC++)) << 8;
+                temp |= ((u32)GB_CPUFetch8(cpu->R16.PC++)) << 8;
                 cpu->R16.PC &= 0xFFFF;
                 GB_CPUClockCounterAdd(4);
                 cpu->R8.A = GB_MemRead8(temp);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xFB: // EI - 1
+            GB_OPCODE(0xFB): // EI - 1
                 GameBoy.Memory.interrupts_enable_count = 1;
                 //GameBoy.Memory.InterruptMasterEnable = 1;
                 GB_CPUClockCounterAdd(4);
-                break;
-            case 0xFC: // Undefined - *
+                // The delay is handled before fetching the next opcode
+                GB_NEXT_SLOW();
+            GB_OPCODE(0xFC): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xFD: // Undefined - *
+                GB_NEXT();
+            GB_OPCODE(0xFD): // Undefined - *
                 gb_undefined_opcode(opcode);
-                break;
-            case 0xFE: // CP A,nn - 2
+                GB_NEXT();
+            GB_OPCODE(0xFE): // CP A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
                 cpu->R16.AF |= F_SUBTRACT;
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
+                u32 temp = GB_CPUFetch8(cpu->R16.PC++);
                 u32 temp2 = cpu->R8.A;
                 cpu->F.H = (temp2 & 0xF) < (temp & 0xF);
                 cpu->F.C = (temp2 < temp);
                 cpu->F.Z = (temp2 == temp);
                 GB_CPUClockCounterAdd(4);
-                break;
+                GB_NEXT();
             }
-            case 0xFF: // RST 0x0038 - 4
+            GB_OPCODE(0xFF): // RST 0x0038 - 4
                 gb_rst_nnnn(0x0038);
-                break;
+                GB_NEXT();
 
+#ifndef GB_CPU_THREADED_DISPATCH
             default: // Shouldn't happen
                 GB_CPUClockCounterAdd(4);
                 _gb_break_to_debugger();
@@ -2841,8 +3474,65 @@ static int GB_CPUExecute(int clocks)
                                   "ROM: %d",
                                   opcode, GameBoy.CPU.R16.PC,
                                   GameBoy.Memory.selected_rom);
-                break;
-        } // End switch
+                GB_NEXT();
+#endif
+        } // End of opcode handlers
+
+#ifdef GB_CPU_THREADED_DISPATCH
+        // Jumps to the next handler if nothing needs to be checked before it
+gb_instruction_next:
+        if (fast_dispatch && (cpu->R16.PC >= instruction_pc)
+            && ((gb_break_cpu_loop | gb_break_execution) == 0)
+            && (GB_CPUClockCounterGet() < finish_clocks))
+        {
+            instruction_pc = cpu->R16.PC;
+
+            block_opcode = -1;
+            if (gb_cpu_block_cache_enabled)
+            {
+                block_opcode = GB_CPUBlockStart(cpu->R16.PC,
+                                    finish_clocks - GB_CPUClockCounterGet());
+            }
+
+            if (block_opcode >= 0)
+            {
+                opcode = block_opcode;
+                cpu->R16.PC++;
+            }
+            else
+            {
+                opcode = (u8)GB_CPUFetch8(cpu->R16.PC++);
+                cpu->R16.PC &= 0xFFFF;
+            }
+
+            goto *gb_cpu_opcodes[opcode];
+        }
+
+gb_instruction_end:
+#endif
+
+#ifdef ENABLE_PROFILER
+        GB_CPUProfilerStep(instruction_pc, opcode,
+                           GB_CPUClockCounterGet() - profiler_clocks);
+#endif
+
+        if (cpu->R16.PC < instruction_pc) // Backwards jump
+        {
+            if (GB_CPUIdleLoopCheck(instruction_pc))
+            {
+                // Nothing can change until the next event, skip to it. The
+                // PPU only stops the CPU at mode changes that cause events,
+                // but LY and STAT change at every mode change, so don't skip
+                // past the next one. Reading them updates the PPU, so the
+                // loop will see the new values.
+                GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+                int skipped_clocks = finish_clocks - GB_CPUClockCounterGet();
+                skipped_clocks = min(skipped_clocks,
+                                     GB_PPUClocksToNextModeChange());
+                if (skipped_clocks > 0)
+                    GB_CPUClockCounterAdd(skipped_clocks);
+            }
+        }
 
         if (gb_break_cpu_loop) // Some event happened - handle it out of loop
         {
@@ -2863,6 +3553,10 @@ static int GB_CPUExecute(int clocks)
     return GB_CPUClockCounterGet() - previous_clocks_counter;
 }
 
+#ifdef GB_CPU_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
 //----------------------------------------------------------------
 
 // Returns 1 if breakpoint executed
@@ -2870,6 +3564,8 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
 {
     gb_break_execution = 0;
 
+    GB_DebugWatchpointsArm(1);
+
     Win_GBDisassemblerStartAddressSetDefault();
 
     run_for_clocks += gb_last_residual_clocks;
@@ -2946,12 +3642,14 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
         {
             gb_last_residual_clocks = run_for_clocks;
             GameBoy.Emulator.FrameDrawn = 0;
+            GB_DebugWatchpointsArm(0);
             return 0;
         }
 
         if (gb_break_execution)
         {
             gb_last_residual_clocks = 0;
+            GB_DebugWatchpointsArm(0);
             return 1;
         }
     }
@@ -2960,6 +3658,30 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
     return 0;
 }
 
+// GB_RunFor() resets the clock counters every time it's called. This is the
+// number of clocks run by the previous calls of the current slice.
+static s32 gb_slice_clocks_base;
+
+int GB_RunForSlice(s32 clocks)
+{
+    gb_slice_clocks_base = 0;
+
+    int ret = GB_RunFor(clocks);
+
+    while ((ret == 0) && (gb_last_residual_clocks > 0))
+    {
+        gb_slice_clocks_base += GB_CPUClockCounterGet();
+        ret = GB_RunFor(0);
+    }
+
+    return ret;
+}
+
+s32 GB_SliceClockCounterGet(void)
+{
+    return gb_slice_clocks_base + GB_CPUClockCounterGet();
+}
+
 void GB_RunForInstruction(void)
 {
     gb_last_residual_clocks = 0;
@@ -11,6 +11,7 @@
 
 void GB_CPUInit(void);
 void GB_CPUEnd(void);
+void GB_CPUStateRegister(void);
 
 //----------------------------------------------------------------
 
@@ -27,12 +28,30 @@ void GB_UpdateCounterToClocks(int reference_clocks);
 // event!!!
 void GB_CPUBreakLoop(void);
 
+// Call this when the ROM or WRAM bank that the CPU may be running code from is
+// switched. The rest of the current block of predecoded instructions is
+// dropped, and the next instruction is read from the new bank.
+void GB_CPUBreakBlock(void);
+
+// Stop execution and return control to the debugger after this instruction
+void _gb_break_to_debugger(void);
+
 //----------------------------------------------------------------
 
 // Run GB emulation for the specified number of clocks (1 frame = 70224 clocks).
 // It returns 1 if a breakpoint is found.
 int GB_RunFor(s32 clocks);
+// GB_RunFor() returns early at the end of a frame. This one doesn't, it's meant
+// to be used when the emulation has to be synchronized with something else.
+int GB_RunForSlice(s32 clocks);
+// Clocks run since the start of the last call to GB_RunForSlice(), including
+// the ones run after the requested amount to finish the last instruction.
+s32 GB_SliceClockCounterGet(void);
 
 void GB_RunForInstruction(void);
 
+#ifdef ENABLE_PROFILER
+void GB_CPUProfilerStart(void);
+#endif
+
 #endif // GB_CPU__
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "../build_options.h"
+#include "../debug_utils.h"
 #include "../font_utils.h"
 #include "../general_utils.h"
 
@@ -25,54 +26,51 @@ extern _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
-#define GB_MAX_BREAKPOINTS 20
+// Breakpoints are stored in a bitmap with one bit per address, so checking an
+// address is always O(1) regardless of the number of breakpoints. PC hooks use
+// another bitmap.
 
-static u32 gb_brkpoint_addrlist[GB_MAX_BREAKPOINTS];
-static int gb_brkpoint_used[GB_MAX_BREAKPOINTS];
-static int gb_any_breakpoint_used = 0;
+static u32 gb_brkpoint_map[0x10000 / 32];
+int gb_debug_breakpoint_count = 0;
+
+static u32 gb_pc_hook_map[0x10000 / 32];
+int gb_debug_pc_hook_count = 0;
+static gb_debug_pc_hook_fn gb_pc_hook_handler = NULL;
 
 int GB_DebugIsBreakpoint(u32 addr)
 {
-    if (gb_any_breakpoint_used == 0)
+    if (gb_debug_breakpoint_count == 0)
         return 0;
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
-    {
-        if (gb_brkpoint_used[i])
-        {
-            if (gb_brkpoint_addrlist[i] == addr)
-            {
-                return 1;
-            }
-        }
-    }
-    return 0;
+    addr &= 0xFFFF;
+    return (gb_brkpoint_map[addr >> 5] & (1u << (addr & 31))) ? 1 : 0;
 }
 
 static u32 gb_last_executed_opcode = 1;
 
-int GB_DebugCPUIsBreakpoint(u32 addr)
+int GB_DebugCPUCheckBreakpoint(u32 addr)
 {
-    if (gb_any_breakpoint_used == 0)
-        return 0;
-
     if (gb_last_executed_opcode == addr)
     {
         gb_last_executed_opcode = 1;
         return 0;
     }
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
+    // The hook of an instruction that stops the emulation isn't called again
+    // when the emulation continues.
+    if (gb_debug_pc_hook_count > 0)
     {
-        if (gb_brkpoint_used[i])
-        {
-            if (gb_brkpoint_addrlist[i] == addr)
-            {
-                gb_last_executed_opcode = addr;
-                return 1;
-            }
-        }
+        u32 a = addr & 0xFFFF;
+        if (gb_pc_hook_map[a >> 5] & (1u << (a & 31)))
+            gb_pc_hook_handler(addr);
+    }
+
+    if (GB_DebugIsBreakpoint(addr))
+    {
+        gb_last_executed_opcode = addr;
+        return 1;
     }
+
     return 0;
 }
 
@@ -81,51 +79,161 @@ void GB_DebugAddBreakpoint(u32 addr)
     if (GB_DebugIsBreakpoint(addr))
         return;
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
-    {
-        if (gb_brkpoint_used[i] == 0)
-        {
-            gb_brkpoint_addrlist[i] = addr;
-            gb_brkpoint_used[i] = 1;
-            gb_any_breakpoint_used = 1;
-            return;
-        }
-    }
+    addr &= 0xFFFF;
+    gb_brkpoint_map[addr >> 5] |= 1u << (addr & 31);
+    gb_debug_breakpoint_count++;
 }
 
 void GB_DebugClearBreakpoint(u32 addr)
 {
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
+    if (GB_DebugIsBreakpoint(addr) == 0)
+        return;
+
+    addr &= 0xFFFF;
+    gb_brkpoint_map[addr >> 5] &= ~(1u << (addr & 31));
+    gb_debug_breakpoint_count--;
+}
+
+void GB_DebugClearBreakpointAll(void)
+{
+    memset(gb_brkpoint_map, 0, sizeof(gb_brkpoint_map));
+    gb_debug_breakpoint_count = 0;
+}
+
+void GB_DebugPCHookHandlerSet(gb_debug_pc_hook_fn fn)
+{
+    gb_pc_hook_handler = fn;
+}
+
+void GB_DebugAddPCHook(u32 addr)
+{
+    if (gb_pc_hook_handler == NULL)
+        return;
+
+    addr &= 0xFFFF;
+    u32 mask = 1u << (addr & 31);
+    if (gb_pc_hook_map[addr >> 5] & mask)
+        return;
+
+    gb_pc_hook_map[addr >> 5] |= mask;
+    gb_debug_pc_hook_count++;
+}
+
+void GB_DebugClearPCHook(u32 addr)
+{
+    addr &= 0xFFFF;
+    u32 mask = 1u << (addr & 31);
+    if ((gb_pc_hook_map[addr >> 5] & mask) == 0)
+        return;
+
+    gb_pc_hook_map[addr >> 5] &= ~mask;
+    gb_debug_pc_hook_count--;
+}
+
+void GB_DebugClearPCHookAll(void)
+{
+    memset(gb_pc_hook_map, 0, sizeof(gb_pc_hook_map));
+    gb_debug_pc_hook_count = 0;
+}
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+    u32 start;
+    u32 end; // Inclusive
+    int access;
+} _gb_watchpoint_;
+
+static _gb_watchpoint_ *gb_watchpoints;
+static int gb_watchpoint_num;
+static int gb_watchpoint_max;
+
+int gb_debug_watchpoints_armed = 0;
+static int gb_watchpoint_hit = 0;
+
+void GB_DebugAddWatchpoint(u32 start, u32 end, int access)
+{
+    if (gb_watchpoint_num == gb_watchpoint_max)
     {
-        if (gb_brkpoint_used[i])
+        int new_max = gb_watchpoint_max ? gb_watchpoint_max * 2 : 16;
+        _gb_watchpoint_ *list =
+                realloc(gb_watchpoints, new_max * sizeof(_gb_watchpoint_));
+        if (list == NULL)
         {
-            if (gb_brkpoint_addrlist[i] == addr)
-            {
-                gb_brkpoint_used[i] = 0;
-                break;
-            }
+            Debug_ErrorMsgArg("Couldn't allocate memory for watchpoint.");
+            return;
         }
+        gb_watchpoints = list;
+        gb_watchpoint_max = new_max;
     }
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
+    _gb_watchpoint_ *w = &gb_watchpoints[gb_watchpoint_num++];
+    w->start = start;
+    w->end = end;
+    w->access = access;
+}
+
+void GB_DebugClearWatchpoint(u32 start, u32 end)
+{
+    for (int i = 0; i < gb_watchpoint_num; i++)
     {
-        if (gb_brkpoint_used[i])
+        if ((gb_watchpoints[i].start == start)
+            && (gb_watchpoints[i].end == end))
         {
+            gb_watchpoint_num--;
+            gb_watchpoints[i] = gb_watchpoints[gb_watchpoint_num];
             return;
         }
     }
+}
+
+void GB_DebugClearWatchpointAll(void)
+{
+    free(gb_watchpoints);
+    gb_watchpoints = NULL;
+    gb_watchpoint_num = 0;
+    gb_watchpoint_max = 0;
+    gb_debug_watchpoints_armed = 0;
+}
 
-    gb_any_breakpoint_used = 0;
+int GB_DebugWatchpointsUsed(void)
+{
+    return gb_watchpoint_num > 0;
 }
 
-void GB_DebugClearBreakpointAll(void)
+void GB_DebugWatchpointsArm(int arm)
+{
+    gb_debug_watchpoints_armed = arm && (gb_watchpoint_num > 0);
+}
+
+void GB_DebugWatchpointCheck(u32 address, int access)
 {
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
+    for (int i = 0; i < gb_watchpoint_num; i++)
     {
-        gb_brkpoint_used[i] = 0;
+        _gb_watchpoint_ *w = &gb_watchpoints[i];
+
+        if ((w->access & access) == 0)
+            continue;
+
+        if ((address >= w->start) && (address <= w->end))
+        {
+            ConsolePrint("Watchpoint: %s [0x%04X] (PC = 0x%04X)\n",
+                         (access & GB_WATCH_WRITE) ? "Write" : "Read",
+                         address, GameBoy.CPU.R16.PC);
+
+            // Stop after the instruction that has done the access
+            _gb_break_to_debugger();
+            gb_watchpoint_hit = 1;
+            return;
+        }
     }
+}
 
-    gb_any_breakpoint_used = 0;
+int GB_DebugWatchpointHit(void)
+{
+    int hit = gb_watchpoint_hit;
+    gb_watchpoint_hit = 0;
+    return hit;
 }
 
 //------------------------------------------------------------------------------
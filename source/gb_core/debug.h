@@ -12,9 +12,48 @@
 void GB_DebugAddBreakpoint(u32 addr);
 void GB_DebugClearBreakpoint(u32 addr);
 int GB_DebugIsBreakpoint(u32 addr);    // Used in debugger
-int GB_DebugCPUIsBreakpoint(u32 addr); // Used in CPU loop
 void GB_DebugClearBreakpointAll(void);
 
+// PC hooks call the handler right before the instruction at that address is
+// executed. They don't stop the emulation. They are used by scripts.
+typedef void (*gb_debug_pc_hook_fn)(u32 addr);
+void GB_DebugPCHookHandlerSet(gb_debug_pc_hook_fn fn);
+void GB_DebugAddPCHook(u32 addr);
+void GB_DebugClearPCHook(u32 addr);
+void GB_DebugClearPCHookAll(void);
+
+extern int gb_debug_breakpoint_count;
+extern int gb_debug_pc_hook_count;
+// Calls the PC hook handler if needed. Returns 1 if there is a breakpoint.
+int GB_DebugCPUCheckBreakpoint(u32 addr);
+
+// Used in CPU loop
+static inline int GB_DebugCPUIsBreakpoint(u32 addr)
+{
+    if ((gb_debug_breakpoint_count | gb_debug_pc_hook_count) == 0)
+        return 0;
+    return GB_DebugCPUCheckBreakpoint(addr);
+}
+
+// Watchpoints stop the emulation after the instruction that accesses any
+// address between start and end (both included).
+
+#define GB_WATCH_READ  BIT(0)
+#define GB_WATCH_WRITE BIT(1)
+
+void GB_DebugAddWatchpoint(u32 start, u32 end, int access);
+void GB_DebugClearWatchpoint(u32 start, u32 end);
+void GB_DebugClearWatchpointAll(void);
+int GB_DebugWatchpointsUsed(void);
+
+// Watchpoints are only checked while the emulation is running, not when the
+// debugger windows read memory.
+extern int gb_debug_watchpoints_armed;
+void GB_DebugWatchpointsArm(int arm);
+void GB_DebugWatchpointCheck(u32 address, int access);
+// Returns 1 if a watchpoint has stopped the emulation since the last call
+int GB_DebugWatchpointHit(void);
+
 int gb_debug_get_address_increment(u32 address);
 int gb_debug_get_address_is_code(u32 address);
 char *GB_Dissasemble(u16 addr, int *step);
@@ -806,158 +806,159 @@ void GB_Debug_PrintSpriteAlpha(unsigned char *buf, int sprite)
 
 //------------------------------------------------------------------------------
 
-void GB_Debug_TileVRAMDraw(unsigned char *buffer0, int bufw0, unused__ int bufh0,
-                           unsigned char *buffer1, int bufw1, unused__ int bufh1)
+// The tile and map viewers are updated after every frame, so they only draw
+// the tiles that have changed since the last time they were drawn. The data
+// used to draw each tile is saved to compare it with the current one.
+
+#define GB_DEBUG_NUM_TILES  (384) // Per bank
+
+typedef struct {
+    unsigned char *buffer[2]; // NULL if everything has to be drawn again
+    u8 colors[4][3];
+    u8 vram[2][GB_DEBUG_NUM_TILES * 16];
+    u8 modified[2][GB_DEBUG_NUM_TILES]; // Drawn over by the caller
+} _gb_debug_tile_cache_;
+
+typedef struct {
+    unsigned char *buffer; // NULL if everything has to be drawn again
+    int map;
+    int tile_base;
+    int bw;
+    int cgb;
+    u8 palette[8 * 4 * 2]; // Palettes used to draw the map
+    u8 tilemap[2][32 * 32]; // Tile index and attributes
+    u8 vram[2][GB_DEBUG_NUM_TILES * 16];
+    u8 modified[32 * 32]; // Drawn over by the caller
+} _gb_debug_map_cache_;
+
+static _gb_debug_tile_cache_ gb_debug_tile_cache;
+static _gb_debug_map_cache_ gb_debug_map_cache;
+
+// Draws an 8x8 tile to a 24 bit buffer
+static void _gb_debug_tile_draw(unsigned char *buffer, int bufw, int x, int y,
+                                const u8 *data, int xflip, int yflip,
+                                u8 colors[4][3])
 {
-    _GB_MEMORY_ *mem = &GameBoy.Memory;
-
-    for (int y = 0; y < 192; y++)
+    for (int j = 0; j < 8; j++)
     {
-        for (int x = 0; x < 128; x++)
-        {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
+        const u8 *row = data + ((yflip ? (7 - j) : j) * 2);
+        unsigned char *dst = &buffer[((y + j) * bufw + x) * 3];
 
-            u8 *data = &mem->VideoRAM[tile << 4]; // Bank 0
-
-            data += ((y & 7) * 2);
+        for (int i = 0; i < 8; i++)
+        {
+            u32 x_ = xflip ? i : (7 - i);
+            u32 color = ((row[0] >> x_) & 1) | (((row[1] >> x_) << 1) & 2);
 
-            u32 x_ = 7 - (x & 7);
+            *dst++ = colors[color][0];
+            *dst++ = colors[color][1];
+            *dst++ = colors[color][2];
+        }
+    }
+}
 
-            u32 color =
-                    ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+static void _gb_debug_tile_vram_draw(unsigned char *buffer0, int bufw0,
+                                     unsigned char *buffer1, int bufw1,
+                                     u8 colors[4][3])
+{
+    _gb_debug_tile_cache_ *c = &gb_debug_tile_cache;
 
-            buffer0[(y * bufw0 + x) * 3 + 0] = gb_pal_colors[color][0];
-            buffer0[(y * bufw0 + x) * 3 + 1] = gb_pal_colors[color][1];
-            buffer0[(y * bufw0 + x) * 3 + 2] = gb_pal_colors[color][2];
-        }
+    int redraw_all = (c->buffer[0] != buffer0) || (c->buffer[1] != buffer1)
+                     || (memcmp(c->colors, colors, sizeof(c->colors)) != 0);
+    if (redraw_all)
+    {
+        c->buffer[0] = buffer0;
+        c->buffer[1] = buffer1;
+        memcpy(c->colors, colors, sizeof(c->colors));
     }
 
-    for (int y = 0; y < 192; y++)
+    unsigned char *buffer[2] = { buffer0, buffer1 };
+    int bufw[2] = { bufw0, bufw1 };
+
+    for (int bank = 0; bank < 2; bank++)
     {
-        for (int x = 0; x < 128; x++)
+        const u8 *vram = &GameBoy.Memory.VideoRAM[bank * 0x2000];
+
+        for (int tile = 0; tile < GB_DEBUG_NUM_TILES; tile++)
         {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
+            const u8 *data = &vram[tile * 16];
+            u8 *saved = &c->vram[bank][tile * 16];
 
-            u8 *data = &mem->VideoRAM[tile << 4];
-            data += 0x2000; // Bank 1;
+            if ((redraw_all == 0) && (c->modified[bank][tile] == 0)
+                && (memcmp(saved, data, 16) == 0))
+                continue;
 
-            data += (y & 7) * 2;
+            memcpy(saved, data, 16);
+            c->modified[bank][tile] = 0;
 
-            u32 x_ = 7 - (x & 7);
+            _gb_debug_tile_draw(buffer[bank], bufw[bank],
+                                (tile % 16) * 8, (tile / 16) * 8,
+                                data, 0, 0, colors);
+        }
+    }
+}
 
-            u32 color =
-                    ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+void GB_Debug_TileVRAMDraw(unsigned char *buffer0,
+                           int bufw0, unused__ int bufh0,
+                           unsigned char *buffer1,
+                           int bufw1, unused__ int bufh1)
+{
+    u8 colors[4][3];
 
-            buffer1[(y * bufw1 + x) * 3 + 0] = gb_pal_colors[color][0];
-            buffer1[(y * bufw1 + x) * 3 + 1] = gb_pal_colors[color][1];
-            buffer1[(y * bufw1 + x) * 3 + 2] = gb_pal_colors[color][2];
-        }
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            colors[i][j] = gb_pal_colors[i][j];
     }
+
+    _gb_debug_tile_vram_draw(buffer0, bufw0, buffer1, bufw1, colors);
 }
 
 void GB_Debug_TileVRAMDrawPaletted(unsigned char *buffer0,
-                                   unused__ int bufw0, unused__ int bufh0,
+                                   int bufw0, unused__ int bufh0,
                                    unsigned char *buffer1,
-                                   unused__ int bufw1, unused__ int bufh1,
+                                   int bufw1, unused__ int bufh1,
                                    int pal, int pal_is_spr)
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-    u32 bg_pal[4];
-    u32 bgp_reg = mem->IO_Ports[BGP_REG - 0xFF00];
-    bg_pal[0] = gb_pal_colors[bgp_reg & 0x3][0];
-    bg_pal[1] = gb_pal_colors[(bgp_reg >> 2) & 0x3][0];
-    bg_pal[2] = gb_pal_colors[(bgp_reg >> 4) & 0x3][0];
-    bg_pal[3] = gb_pal_colors[(bgp_reg >> 6) & 0x3][0];
+    u8 colors[4][3];
 
-    for (int y = 0; y < 192; y++)
+    if (GameBoy.Emulator.CGBEnabled)
     {
-        for (int x = 0; x < 128; x++)
-        {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
-
-            u8 *data = &mem->VideoRAM[tile << 4]; // Bank 0
-
-            data += (y & 7) * 2;
-
-            u32 x_ = 7 - (x & 7);
+        u32 *palettes = pal_is_spr ?
+                       GameBoy.Emulator.spr_pal : GameBoy.Emulator.bg_pal;
 
-            u32 color = ((*data >> x_) & 1)
-                        | ((((*(data + 1)) >> x_) << 1) & 2);
-
-            if (GameBoy.Emulator.CGBEnabled)
-            {
-                u32 pal_index = (pal * 8) + (2 * color);
-
-                if (pal_is_spr)
-                {
-                    color = GameBoy.Emulator.spr_pal[pal_index]
-                            | (GameBoy.Emulator.spr_pal[pal_index + 1] << 8);
-                }
-                else
-                {
-                    color = GameBoy.Emulator.bg_pal[pal_index]
-                            | (GameBoy.Emulator.bg_pal[pal_index + 1] << 8);
-                }
-                color = rgb16to32(color);
-            }
-            else
-            {
-                color = bg_pal[color]
-                        | (bg_pal[color] << 8)
-                        | (bg_pal[color] << 16);
-            }
+        for (int i = 0; i < 4; i++)
+        {
+            u32 pal_index = (pal * 8) + (2 * i);
+            u32 color = rgb16to32(palettes[pal_index]
+                                  | (palettes[pal_index + 1] << 8));
 
-            buffer0[(y * bufw0 + x) * 3 + 0] = color & 0xFF;
-            buffer0[(y * bufw0 + x) * 3 + 1] = (color >> 8) & 0xFF;
-            buffer0[(y * bufw0 + x) * 3 + 2] = (color >> 16) & 0xFF;
+            colors[i][0] = color & 0xFF;
+            colors[i][1] = (color >> 8) & 0xFF;
+            colors[i][2] = (color >> 16) & 0xFF;
         }
     }
-
-    for (int y = 0; y < 192; y++)
+    else
     {
-        for (int x = 0; x < 128; x++)
-        {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
-
-            u8 *data = &mem->VideoRAM[tile << 4];
-            data += 0x2000; // Bank 1
-
-            data += (y & 7) * 2;
-
-            u32 x_ = 7 - (x & 7);
-
-            u32 color = ((*data >> x_) & 1)
-                        | ((((*(data + 1)) >> x_) << 1) & 2);
-
-            if (GameBoy.Emulator.CGBEnabled)
-            {
-                u32 pal_index = (pal * 8) + (2 * color);
+        u32 bgp_reg = mem->IO_Ports[BGP_REG - 0xFF00];
 
-                if (pal_is_spr)
-                {
-                    color = GameBoy.Emulator.spr_pal[pal_index]
-                            | (GameBoy.Emulator.spr_pal[pal_index + 1] << 8);
-                }
-                else
-                {
-                    color = GameBoy.Emulator.bg_pal[pal_index]
-                            | (GameBoy.Emulator.bg_pal[pal_index + 1] << 8);
-                }
-                color = rgb16to32(color);
-            }
-            else
-            {
-                color = bg_pal[color]
-                        | (bg_pal[color] << 8)
-                        | (bg_pal[color] << 16);
-            }
+        for (int i = 0; i < 4; i++)
+        {
+            u32 gray = gb_pal_colors[(bgp_reg >> (i * 2)) & 0x3][0];
 
-            buffer1[(y * bufw0 + x) * 3 + 0] = color & 0xFF;
-            buffer1[(y * bufw0 + x) * 3 + 1] = (color >> 8) & 0xFF;
-            buffer1[(y * bufw0 + x) * 3 + 2] = (color >> 16) & 0xFF;
+            colors[i][0] = gray;
+            colors[i][1] = gray;
+            colors[i][2] = gray;
         }
     }
+
+    _gb_debug_tile_vram_draw(buffer0, bufw0, buffer1, bufw1, colors);
+}
+
+void GB_Debug_TileVRAMModified(int bank, int tile)
+{
+    gb_debug_tile_cache.modified[bank][tile] = 1;
 }
 
 void GB_Debug_TileDrawZoomed64x64(unsigned char *buffer, int tile, int bank)
@@ -1068,181 +1069,147 @@ void GB_Debug_TileDrawZoomedPaletted64x64(unsigned char *buffer, int tile,
 
 //------------------------------------------------------------------------------
 
-void GB_Debug_MapPrint(unsigned char *buffer, int bufw, unused__ int bufh,
-                       int map, int tile_base)
+static void _gb_debug_map_print(unsigned char *buffer, int bufw, int map,
+                                int tile_base, int bw)
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
+    _gb_debug_map_cache_ *c = &gb_debug_map_cache;
 
-    u8 *tiledata = tile_base ? &mem->VideoRAM[0x0800] : &mem->VideoRAM[0x0000];
-    u8 *bgtilemap = map ? &mem->VideoRAM[0x1C00] : &mem->VideoRAM[0x1800];
+    int cgb = GameBoy.Emulator.CGBEnabled;
 
-    if (GameBoy.Emulator.CGBEnabled)
+    u8 palette[sizeof(c->palette)];
+    memset(palette, 0, sizeof(palette));
+    if (bw == 0)
     {
-        for (int y = 0; y < 256; y++)
+        if (cgb)
         {
-            for (int x = 0; x < 256; x++)
-            {
-                u32 tile_location = (((y >> 3) & 31) * 32) + ((x >> 3) & 31);
-                u32 tile = bgtilemap[tile_location];
-                u32 tileinfo = bgtilemap[tile_location + 0x2000];
-
-                if (tile_base) // If tile base is 0x8800
-                {
-                    if (tile & (1 << 7))
-                        tile &= 0x7F;
-                    else
-                        tile += 128;
-                }
-
-                u8 *data = &tiledata[(tile << 4)
-                         + ((tileinfo & (1 << 3)) ? 0x2000 : 0)]; // Bank 1?
-
-                // V flip
-                if (tileinfo & (1 << 6))
-                    data += (((7 - y) & 7) * 2);
-                else
-                    data += ((y & 7) * 2);
-
-                u32 x_;
-
-                // H flip
-                if (tileinfo & (1 << 5))
-                    x_ = (x & 7);
-                else
-                    x_ = 7 - (x & 7);
+            for (size_t i = 0; i < sizeof(palette); i++)
+                palette[i] = GameBoy.Emulator.bg_pal[i];
+        }
+        else
+            palette[0] = mem->IO_Ports[BGP_REG - 0xFF00];
+    }
 
-                u32 color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
-                u32 pal_index = ((tileinfo & 7) * 8) + (2 * color);
+    int redraw_all = (c->buffer != buffer) || (c->map != map)
+                     || (c->tile_base != tile_base) || (c->bw != bw)
+                     || (c->cgb != cgb)
+                     || (memcmp(c->palette, palette, sizeof(palette)) != 0);
+    if (redraw_all)
+    {
+        c->buffer = buffer;
+        c->map = map;
+        c->tile_base = tile_base;
+        c->bw = bw;
+        c->cgb = cgb;
+        memcpy(c->palette, palette, sizeof(palette));
+    }
 
-                color = GameBoy.Emulator.bg_pal[pal_index]
-                        | (GameBoy.Emulator.bg_pal[pal_index + 1] << 8);
+    // Check which tiles have changed
+    u8 tile_changed[2][GB_DEBUG_NUM_TILES];
 
-                buffer[(y * bufw + x) * 3 + 0] = (color & 0x1F) << 3;
-                buffer[(y * bufw + x) * 3 + 1] = ((color >> 5) & 0x1F) << 3;
-                buffer[(y * bufw + x) * 3 + 2] = ((color >> 10) & 0x1F) << 3;
-            }
-        }
-    }
-    else
+    for (int bank = 0; bank < 2; bank++)
     {
-        u32 bg_pal[4];
-        u32 bgp_reg = mem->IO_Ports[BGP_REG - 0xFF00];
-        bg_pal[0] = gb_pal_colors[bgp_reg & 0x3][0];
-        bg_pal[1] = gb_pal_colors[(bgp_reg >> 2) & 0x3][0];
-        bg_pal[2] = gb_pal_colors[(bgp_reg >> 4) & 0x3][0];
-        bg_pal[3] = gb_pal_colors[(bgp_reg >> 6) & 0x3][0];
+        const u8 *vram = &mem->VideoRAM[bank * 0x2000];
 
-        for (int y = 0; y < 256; y++)
+        for (int tile = 0; tile < GB_DEBUG_NUM_TILES; tile++)
         {
-            for (int x = 0; x < 256; x++)
-            {
-                u32 tile = bgtilemap[(((y >> 3) & 31) * 32) + ((x >> 3) & 31)];
+            const u8 *data = &vram[tile * 16];
+            u8 *saved = &c->vram[bank][tile * 16];
 
-                if (tile_base) // If tile base is 0x8800
-                {
-                    if (tile & (1 << 7))
-                        tile &= 0x7F;
-                    else
-                        tile += 128;
-                }
-
-                u8 *data = (&tiledata[tile << 4]) + ((y & 7) << 1);
+            tile_changed[bank][tile] = (memcmp(saved, data, 16) != 0);
+            if (tile_changed[bank][tile])
+                memcpy(saved, data, 16);
+        }
+    }
 
-                u32 x_ = 7 - (x & 7);
+    u8 colors[4][3];
 
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+    for (int i = 0; i < 4; i++)
+    {
+        if (bw || cgb)
+        {
+            for (int j = 0; j < 3; j++)
+                colors[i][j] = gb_pal_colors[i][j];
+        }
+        else
+        {
+            u32 gray = gb_pal_colors[(palette[0] >> (i * 2)) & 0x3][0];
 
-                buffer[(y * bufw + x) * 3 + 0] = bg_pal[color];
-                buffer[(y * bufw + x) * 3 + 1] = bg_pal[color];
-                buffer[(y * bufw + x) * 3 + 2] = bg_pal[color];
-            }
+            colors[i][0] = gray;
+            colors[i][1] = gray;
+            colors[i][2] = gray;
         }
     }
-}
-
-void GB_Debug_MapPrintBW(unsigned char *buffer, int bufw, unused__ int bufh,
-                         int map, int tile_base)
-{
-    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-    u8 *tiledata = tile_base ? &mem->VideoRAM[0x0800] : &mem->VideoRAM[0x0000];
-    u8 *bgtilemap = map ? &mem->VideoRAM[0x1C00] : &mem->VideoRAM[0x1800];
+    const u8 *tilemap = map ? &mem->VideoRAM[0x1C00] : &mem->VideoRAM[0x1800];
 
-    if (GameBoy.Emulator.CGBEnabled)
+    for (int y = 0; y < 32; y++)
     {
-        for (int y = 0; y < 256; y++)
+        for (int x = 0; x < 32; x++)
         {
-            for (int x = 0; x < 256; x++)
-            {
-                u32 tile_location = (((y >> 3) & 31) * 32) + ((x >> 3) & 31);
-                u32 tile = bgtilemap[tile_location];
-                u32 tileinfo = bgtilemap[tile_location + 0x2000];
+            u32 tile_location = (y * 32) + x;
+            u32 tile = tilemap[tile_location];
+            u32 tileinfo = cgb ? tilemap[tile_location + 0x2000] : 0;
 
-                if (tile_base) // If tile base is 0x8800
-                {
-                    if (tile & (1 << 7))
-                        tile &= 0x7F;
-                    else
-                        tile += 128;
-                }
-
-                u8 *data = &tiledata[(tile << 4)
-                         + ((tileinfo & (1 << 3)) ? 0x2000 : 0)]; // Bank 1?
-
-                // V flip
-                if (tileinfo & (1 << 6))
-                    data += (((7 - y) & 7) * 2);
+            if (tile_base) // If tile base is 0x8800
+            {
+                if (tile & (1 << 7))
+                    tile &= 0x7F;
                 else
-                    data += ((y & 7) * 2);
+                    tile += 128;
 
-                u32 x_;
+                tile += 128;
+            }
 
-                // H flip
-                if (tileinfo & (1 << 5))
-                    x_ = x & 7;
-                else
-                    x_ = 7 - (x & 7);
+            u32 bank = (tileinfo & (1 << 3)) ? 1 : 0;
 
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+            if ((redraw_all == 0) && (c->modified[tile_location] == 0)
+                && (c->tilemap[0][tile_location] == tilemap[tile_location])
+                && (c->tilemap[1][tile_location] == tileinfo)
+                && (tile_changed[bank][tile] == 0))
+                continue;
 
-                buffer[(y * bufw + x) * 3 + 0] = gb_pal_colors[color][0];
-                buffer[(y * bufw + x) * 3 + 1] = gb_pal_colors[color][1];
-                buffer[(y * bufw + x) * 3 + 2] = gb_pal_colors[color][2];
-            }
-        }
-    }
-    else
-    {
-        for (int y = 0; y < 256; y++)
-        {
-            for (int x = 0; x < 256; x++)
-            {
-                u32 tile = bgtilemap[(((y >> 3) & 31) * 32) + ((x >> 3) & 31)];
+            c->tilemap[0][tile_location] = tilemap[tile_location];
+            c->tilemap[1][tile_location] = tileinfo;
+            c->modified[tile_location] = 0;
 
-                if (tile_base) // If tile base is 0x8800
+            if (cgb && (bw == 0))
+            {
+                for (int i = 0; i < 4; i++)
                 {
-                    if (tile & (1 << 7))
-                        tile &= 0x7F;
-                    else
-                        tile += 128;
+                    u32 pal_index = ((tileinfo & 7) * 8) + (2 * i);
+                    u32 color = palette[pal_index]
+                                | (palette[pal_index + 1] << 8);
+
+                    colors[i][0] = (color & 0x1F) << 3;
+                    colors[i][1] = ((color >> 5) & 0x1F) << 3;
+                    colors[i][2] = ((color >> 10) & 0x1F) << 3;
                 }
+            }
 
-                u8 *data = (&tiledata[tile << 4]) + ((y & 7) << 1);
+            _gb_debug_tile_draw(buffer, bufw, x * 8, y * 8,
+                                &mem->VideoRAM[(bank * 0x2000) + (tile << 4)],
+                                tileinfo & (1 << 5), tileinfo & (1 << 6),
+                                colors);
+        }
+    }
+}
 
-                u32 x_ = 7 - (x & 7);
+void GB_Debug_MapPrint(unsigned char *buffer, int bufw, unused__ int bufh,
+                       int map, int tile_base)
+{
+    _gb_debug_map_print(buffer, bufw, map, tile_base, 0);
+}
 
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+void GB_Debug_MapPrintBW(unsigned char *buffer, int bufw, unused__ int bufh,
+                         int map, int tile_base)
+{
+    _gb_debug_map_print(buffer, bufw, map, tile_base, 1);
+}
 
-                buffer[(y * bufw + x) * 3 + 0] = gb_pal_colors[color][0];
-                buffer[(y * bufw + x) * 3 + 1] = gb_pal_colors[color][1];
-                buffer[(y * bufw + x) * 3 + 2] = gb_pal_colors[color][2];
-            }
-        }
-    }
+void GB_Debug_MapModified(int x, int y)
+{
+    gb_debug_map_cache.modified[(y * 32) + x] = 1;
 }
 
 //------------------------------------------------------------------------------
@@ -28,6 +28,9 @@ void GB_Debug_TileVRAMDraw(unsigned char *buffer0, int bufw0, int bufh0,
 void GB_Debug_TileVRAMDrawPaletted(unsigned char *buffer0, int bufw0, int bufh0,
                                    unsigned char *buffer1, int bufw1, int bufh1,
                                    int pal, int pal_is_spr);
+// Only the tiles that have changed since the last call are drawn. If the caller
+// draws over a tile of the buffers, it has to be marked as modified.
+void GB_Debug_TileVRAMModified(int bank, int tile);
 void GB_Debug_TileDrawZoomed64x64(unsigned char *buffer, int tile, int bank);
 void GB_Debug_TileDrawZoomedPaletted64x64(unsigned char *buffer, int tile,
                                           int bank, int palette,
@@ -39,6 +42,9 @@ void GB_Debug_MapPrint(unsigned char *buffer, int bufw, int bufh, int map,
                        int tile_base);
 void GB_Debug_MapPrintBW(unsigned char *buffer, int bufw, int bufh, int map,
                          int tile_base); // Black and white
+// Only the tiles that have changed since the last call are drawn. If the caller
+// draws over a tile of the buffer, it has to be marked as modified.
+void GB_Debug_MapModified(int x, int y);
 
 //------------------------------------------------------------------------------
 
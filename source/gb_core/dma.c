@@ -8,6 +8,7 @@
 
 #include "cpu.h"
 #include "memory.h"
+#include "state.h"
 
 //----------------------------------------------------------------
 
@@ -133,6 +134,11 @@ static void GB_DMAStopGBCCopy(void)
 
 static int gb_dma_clock_counter = 0;
 
+void GB_DMAStateRegister(void)
+{
+    GB_StateAddBlock(&gb_dma_clock_counter, sizeof(gb_dma_clock_counter));
+}
+
 void GB_DMAClockCounterReset(void)
 {
     gb_dma_clock_counter = 0;
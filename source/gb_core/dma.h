@@ -11,6 +11,7 @@
 
 void GB_DMAInit(void);
 void GB_DMAEnd(void);
+void GB_DMAStateRegister(void);
 
 void GB_DMAWriteDMA(int reference_clocks, int value);
 
@@ -254,6 +254,7 @@ typedef struct
 #define SERIAL_NONE      (0)
 #define SERIAL_GBPRINTER (1)
 #define SERIAL_GAMEBOY   (2)
+#define SERIAL_SOCKET    (3)
 
 typedef void (*gb_ppu_update_fn_ptr)(int); // increment clocks
 typedef int (*gb_ppu_clocks_to_event_fn_ptr)(void);
@@ -319,6 +320,7 @@ typedef struct
     _GB_MMM01_CART_ MMM01;
     _GB_CAMERA_CART_ CAM;
     u32 rumble; // Rumble enabled
+    u32 sram_dirty; // Set when the mapper writes to cartridge RAM, for autosave
     u32 *Rom_Pointer;
     char save_filename[MAX_PATHLEN];
     u32 game_supports_gbc;
@@ -11,16 +11,26 @@
 #include "../build_options.h"
 #include "../debug_utils.h"
 #include "../file_utils.h"
+#include "../frame_hash.h"
 #include "../general_utils.h"
+#include "../image_writer.h"
+#include "../movie.h"
+#include "../profiler.h"
+#include "../rom_cache.h"
 
 #include "cpu.h"
+#include "debug.h"
 #include "gameboy.h"
 #include "gb_main.h"
 #include "general.h"
 #include "interrupts.h"
+#include "link.h"
+#include "link_socket.h"
 #include "rom.h"
+#include "serial.h"
 #include "sgb.h"
 #include "sound.h"
+#include "state.h"
 #include "video.h"
 
 extern _GB_CONTEXT_ GameBoy;
@@ -30,12 +40,29 @@ void GB_Input_Update(void);
 
 //---------------------------------
 
+static const void *gb_rom_buffer = NULL;
+static size_t gb_rom_available = 0;
+
+static u32 GB_ROMFill(u32 size)
+{
+    gb_rom_available = RomCacheFill(gb_rom_buffer, size);
+    return gb_rom_available;
+}
+
+const void *GB_ROMBufferGet(size_t *available)
+{
+    *available = gb_rom_available;
+    return gb_rom_buffer;
+}
+
 int GB_ROMLoad(const char *rom_path)
 {
-    void *ptr;
-    size_t size;
+    size_t size, available;
 
-    FileLoad(rom_path, &ptr, &size);
+    // ROMs inside compressed files are decompressed when the banks are used.
+    // Load the first two banks, which are used when the GB is powered on.
+    const void *ptr = RomCacheAcquirePartial(rom_path, 0, 2 * 16 * 1024,
+                                             &size, &available);
 
     if (ptr == NULL)
     {
@@ -43,11 +70,20 @@ int GB_ROMLoad(const char *rom_path)
         return 0;
     }
 
+    gb_rom_buffer = ptr;
+    gb_rom_available = available;
+
+    if (available < size)
+        GB_CartridgeSetLazyLoad(available, GB_ROMFill);
+
     if (GB_CartridgeLoad(ptr, size) == 0)
     {
         Debug_ErrorMsgArg("Error while loading cartridge.\n"
                           "Read the console output for details.");
-        free(ptr);
+        GB_CartridgeSetLazyLoad(0, NULL);
+        RomCacheRelease(ptr);
+        gb_rom_buffer = NULL;
+        gb_rom_available = 0;
         return 0;
     }
 
@@ -61,6 +97,10 @@ int GB_ROMLoad(const char *rom_path)
     GB_PowerOn();
     GB_SkipFrame(0);
 
+#ifdef ENABLE_PROFILER
+    GB_CPUProfilerStart();
+#endif
+
     return 1;
 }
 
@@ -69,8 +109,16 @@ void GB_End(int save)
     if (save)
         GB_SRAM_Save();
 
+#ifdef ENABLE_PROFILER
+    Profiler_End();
+#endif
+
     GB_PowerOff();
     GB_Cartridge_Unload();
+
+    RomCacheRelease(gb_rom_buffer);
+    gb_rom_buffer = NULL;
+    gb_rom_available = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -82,15 +130,93 @@ int GB_IsEnabledSGB(void)
 
 //---------------------------------------------------------------------------
 
+static int Keys[4];
+
 void GB_RunForOneFrame(void)
 {
+    u16 input[6];
+
+    for (int i = 0; i < 4; i++)
+        input[i] = Keys[i];
+    input[4] = GameBoy.Emulator.MBC7.sensorX;
+    input[5] = GameBoy.Emulator.MBC7.sensorY;
+
+    int movie = Movie_FrameStart(input, 6);
+
+    for (int i = 0; i < 4; i++)
+        Keys[i] = input[i];
+    GameBoy.Emulator.MBC7.sensorX = input[4];
+    GameBoy.Emulator.MBC7.sensorY = input[5];
+
+    int hash = FrameHash_FrameStart();
+    int dump = ImageWriter_VideoIsRecording();
+
+    if ((movie & MOVIE_FRAME_DRAW) || (hash & FRAME_HASH_DRAW) || dump)
+        GB_SkipFrame(0);
+
     GB_CheckJoypadInterrupt();
-    GB_RunFor(70224 << GameBoy.Emulator.DoubleSpeed);
+    if (GB_LinkIsEnabled())
+        GB_LinkRunForOneFrame();
+    else if (GB_LinkSocketIsEnabled())
+        GB_LinkSocketRunForOneFrame();
+    else
+        GB_RunFor(70224 << GameBoy.Emulator.DoubleSpeed);
+    GB_SRAM_AutosaveUpdate();
+
+    if (movie & MOVIE_FRAME_CHECKPOINT)
+        Movie_FrameCheckpoint(GB_ScreenHash());
+    if (hash & FRAME_HASH_END)
+        FrameHash_FrameEnd(GB_ScreenHash, GB_SoundHash);
+    if (dump)
+        GB_VideoFrameDump();
 }
 
-//---------------------------------------------------------------------------
+// Run-ahead: See the explanation in GBA_RunForOneFrameAhead()
 
-static int Keys[4];
+static int GB_RunAheadAvailable(void)
+{
+    if (gb_debug_breakpoint_count | gb_debug_pc_hook_count)
+        return 0;
+
+    if (GB_DebugWatchpointsUsed())
+        return 0;
+
+    return 1;
+}
+
+void GB_RunForOneFrameAhead(int frames)
+{
+    if ((frames <= 0) || !GB_RunAheadAvailable())
+    {
+        GB_RunForOneFrame();
+        return;
+    }
+
+    int skip = GB_HasToSkipFrame();
+
+    GB_SkipFrame(1);
+    GB_RunForOneFrame();
+
+    if (GB_StateSave() != 0)
+        return;
+
+    // Devices connected to the serial port can't see the discarded frames
+    GB_SerialDetach();
+
+    for (int i = 0; i < frames; i++)
+    {
+        // Only the last frame is displayed
+        GB_SkipFrame(skip || (i < (frames - 1)));
+        GB_CheckJoypadInterrupt();
+        GB_RunFor(70224 << GameBoy.Emulator.DoubleSpeed);
+    }
+
+    GB_StateLoad();
+
+    GB_SkipFrame(skip);
+}
+
+//---------------------------------------------------------------------------
 
 void GB_InputSet(int player, int a, int b, int st, int se,
                  int r, int l, int u, int d)
@@ -170,3 +296,8 @@ int GB_Input_Get(int player)
 {
     return Keys[player];
 }
+
+void GB_Input_Set(int player, int keys)
+{
+    Keys[player] = keys;
+}
@@ -9,12 +9,20 @@
 
 void GB_Input_Update(void);
 
+#include <stddef.h>
+
 int GB_ROMLoad(const char *rom_path);
+// Returns the ROM that is loaded. Only the first 'available' bytes have been
+// read from the file.
+const void *GB_ROMBufferGet(size_t *available);
 void GB_End(int save);
 
 int GB_Screen_Init(void);
 
 void GB_RunForOneFrame(void);
+// Runs one frame and then the specified number of frames ahead of it, which
+// are discarded afterwards, leaving the last one in the framebuffer.
+void GB_RunForOneFrameAhead(int frames);
 
 int GB_IsEnabledSGB(void);
 
@@ -24,5 +32,6 @@ void GB_InputSetMBC7(int x, int y); // -200 to 200
 void GB_InputSetMBC7Buttons(int up, int down, int right, int left);
 
 int GB_Input_Get(int player);
+void GB_Input_Set(int player, int keys);
 
 #endif // GB_GB_MAIN__
@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include "gameboy.h"
+
+#include "idle_loop.h"
+#include "memory.h"
+
+//----------------------------------------------------------------
+
+extern _GB_CONTEXT_ GameBoy;
+
+//----------------------------------------------------------------
+
+int GB_IdleLoopReadIsSafe(u32 address)
+{
+    if (address < 0xA000) // ROM, VRAM
+        return 1;
+    if (address < 0xC000) // Cartridge RAM, RTC, sensors...
+        return 0;
+    if (address < 0xE000) // WRAM
+        return 1;
+    if (address < 0xFE00) // Echo RAM reads cartridge RAM too
+        return 0;
+    if (address < 0xFEA0) // OAM
+        return 1;
+    if (address < 0xFF00)
+        return 0;
+    if (address < 0xFF80)
+    {
+        switch (address)
+        {
+            case IF_REG:
+            case LCDC_REG:
+            case STAT_REG:
+            case SCY_REG:
+            case SCX_REG:
+            case LY_REG:
+            case LYC_REG:
+            case WY_REG:
+            case WX_REG:
+                return 1;
+            default: // DIV, TIMA, serial, sound, joypad...
+                return 0;
+        }
+    }
+    return 1; // HRAM, IE
+}
+
+static int GB_IdleLoopCodeIsSafe(u32 address)
+{
+    return (address < 0x8000) || ((address >= 0xC000) && (address < 0xE000))
+           || ((address >= 0xFF80) && (address < 0xFFFF));
+}
+
+int GB_IdleLoopBodyIsSafe(u32 branch_pc, u32 target)
+{
+    _GB_CPU_ *cpu = &GameBoy.CPU;
+
+    if (!GB_IdleLoopCodeIsSafe(target) || !GB_IdleLoopCodeIsSafe(branch_pc))
+        return 0;
+
+    // Only JR, JR cc, JP and JP cc
+    u32 opcode = GB_MemRead8(branch_pc);
+    if ((opcode != 0x18) && (opcode != 0xC3) && ((opcode & 0xE7) != 0x20)
+        && ((opcode & 0xE7) != 0xC2))
+        return 0;
+
+    // B, C, D, E, H, L, -, A (same order as in the opcodes)
+    u32 value[8] = {
+        cpu->R8.B, cpu->R8.C, cpu->R8.D, cpu->R8.E,
+        cpu->R8.H, cpu->R8.L, 0, cpu->R8.A
+    };
+    int known[8] = { 1, 1, 1, 1, 1, 1, 0, 1 };
+
+#define KNOWN_PAIR(hi, lo) (known[hi] && known[lo])
+#define VALUE_PAIR(hi, lo) ((value[hi] << 8) | value[lo])
+#define CHECK_READ_PAIR(hi, lo)                                                    {                                                                                  if (!KNOWN_PAIR(hi, lo)                                                            || !GB_IdleLoopReadIsSafe(VALUE_PAIR(hi, lo)))                                 return 0;                                                              }
+
+    u32 pc = target;
+
+    while (pc < branch_pc)
+    {
+        opcode = GB_MemRead8(pc++);
+
+        if ((opcode >= 0x40) && (opcode < 0x80)) // LD r,r
+        {
+            u32 dst = (opcode >> 3) & 7;
+            u32 src = opcode & 7;
+
+            if (dst == 6) // LD [HL],r and HALT
+                return 0;
+
+            if (src == 6)
+            {
+                CHECK_READ_PAIR(4, 5);
+                known[dst] = 0;
+            }
+            else
+            {
+                known[dst] = known[src];
+                value[dst] = value[src];
+            }
+            continue;
+        }
+
+        if ((opcode >= 0x80) && (opcode < 0xC0)) // ALU A,r
+        {
+            if ((opcode & 7) == 6)
+                CHECK_READ_PAIR(4, 5);
+            if ((opcode & 0xF8) != 0xB8) // Everything but CP modifies A
+                known[7] = 0;
+            continue;
+        }
+
+        switch (opcode)
+        {
+            case 0x00: // NOP
+            case 0x37: // SCF
+            case 0x3F: // CCF
+            case 0xF9: // LD SP,HL
+                break;
+
+            case 0x07: // RLCA
+            case 0x0F: // RRCA
+            case 0x17: // RLA
+            case 0x1F: // RRA
+            case 0x27: // DAA
+            case 0x2F: // CPL
+                known[7] = 0;
+                break;
+
+            case 0x04: case 0x05: // INC/DEC B
+            case 0x0C: case 0x0D: // INC/DEC C
+            case 0x14: case 0x15: // INC/DEC D
+            case 0x1C: case 0x1D: // INC/DEC E
+            case 0x24: case 0x25: // INC/DEC H
+            case 0x2C: case 0x2D: // INC/DEC L
+            case 0x3C: case 0x3D: // INC/DEC A
+                known[(opcode >> 3) & 7] = 0;
+                break;
+
+            case 0x06: case 0x0E: case 0x16: case 0x1E: // LD r,nn
+            case 0x26: case 0x2E: case 0x3E:
+                known[(opcode >> 3) & 7] = 1;
+                value[(opcode >> 3) & 7] = GB_MemRead8(pc++);
+                break;
+
+            case 0x01: case 0x11: case 0x21: // LD rr,nnnn
+            {
+                u32 hi = ((opcode >> 4) & 3) * 2;
+                known[hi + 1] = 1;
+                value[hi + 1] = GB_MemRead8(pc++);
+                known[hi] = 1;
+                value[hi] = GB_MemRead8(pc++);
+                break;
+            }
+            case 0x31: // LD SP,nnnn
+                pc += 2;
+                break;
+
+            case 0x03: case 0x0B: // INC/DEC BC
+            case 0x13: case 0x1B: // INC/DEC DE
+            case 0x23: case 0x2B: // INC/DEC HL
+            {
+                u32 hi = ((opcode >> 4) & 3) * 2;
+                known[hi] = 0;
+                known[hi + 1] = 0;
+                break;
+            }
+            case 0x33: case 0x3B: // INC/DEC SP
+                break;
+
+            case 0x09: case 0x19: case 0x29: case 0x39: // ADD HL,rr
+                known[4] = 0;
+                known[5] = 0;
+                break;
+
+            case 0x0A: // LD A,[BC]
+                CHECK_READ_PAIR(0, 1);
+                known[7] = 0;
+                break;
+            case 0x1A: // LD A,[DE]
+                CHECK_READ_PAIR(2, 3);
+                known[7] = 0;
+                break;
+            case 0x2A: // LD A,[HL+]
+            case 0x3A: // LD A,[HL-]
+                CHECK_READ_PAIR(4, 5);
+                known[4] = 0;
+                known[5] = 0;
+                known[7] = 0;
+                break;
+
+            case 0xC6: case 0xCE: case 0xD6: case 0xDE: // ALU A,nn
+            case 0xE6: case 0xEE: case 0xF6:
+                pc++;
+                known[7] = 0;
+                break;
+            case 0xFE: // CP A,nn
+                pc++;
+                break;
+
+            case 0xF0: // LD A,[0xFF00+nn]
+                if (!GB_IdleLoopReadIsSafe(0xFF00 + GB_MemRead8(pc++)))
+                    return 0;
+                known[7] = 0;
+                break;
+            case 0xF2: // LD A,[0xFF00+C]
+                if (!known[1] || !GB_IdleLoopReadIsSafe(0xFF00 + value[1]))
+                    return 0;
+                known[7] = 0;
+                break;
+            case 0xFA: // LD A,[nnnn]
+            {
+                u32 address = GB_MemRead8(pc++);
+                address |= GB_MemRead8(pc++) << 8;
+                if (!GB_IdleLoopReadIsSafe(address))
+                    return 0;
+                known[7] = 0;
+                break;
+            }
+            case 0xF8: // LD HL,SP+nn
+                pc++;
+                known[4] = 0;
+                known[5] = 0;
+                break;
+
+            case 0xCB:
+            {
+                u32 cb_opcode = GB_MemRead8(pc++);
+                u32 reg = cb_opcode & 7;
+                if ((cb_opcode >= 0x40) && (cb_opcode < 0x80)) // BIT n,r
+                {
+                    if (reg == 6)
+                        CHECK_READ_PAIR(4, 5);
+                }
+                else // Shifts, rotations, SWAP, RES and SET
+                {
+                    if (reg == 6)
+                        return 0;
+                    known[reg] = 0;
+                }
+                break;
+            }
+
+            default: // Writes, jumps, calls, stack, EI, DI, HALT, STOP...
+                return 0;
+        }
+    }
+
+#undef KNOWN_PAIR
+#undef VALUE_PAIR
+#undef CHECK_READ_PAIR
+
+    // The last instruction must end right before the branch
+    return pc == branch_pc;
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GB_IDLE_LOOP__
+#define GB_IDLE_LOOP__
+
+#include "gameboy.h"
+
+// Returns 1 if the address is in memory that can only change because of writes
+// of the CPU, during events or at PPU mode changes.
+int GB_IdleLoopReadIsSafe(u32 address);
+
+// Returns 1 if the body of the loop doesn't write to memory or jump, and if all
+// memory reads are done from safe addresses. The values of the registers are
+// tracked so that reads from [HL], [BC], [DE] and [0xFF00+C] can be checked.
+int GB_IdleLoopBodyIsSafe(u32 branch_pc, u32 target);
+
+#endif // GB_IDLE_LOOP__
@@ -18,6 +18,7 @@
 #include "memory.h"
 #include "ppu.h"
 #include "serial.h"
+#include "state.h"
 #include "video.h"
 
 //----------------------------------------------------------------
@@ -401,6 +402,11 @@ void GB_InterruptsWriteIF(int reference_clocks, int value)
 
 static int gb_timer_clock_counter = 0;
 
+void GB_TimersStateRegister(void)
+{
+    GB_StateAddBlock(&gb_timer_clock_counter, sizeof(gb_timer_clock_counter));
+}
+
 void GB_TimersClockCounterReset(void)
 {
     gb_timer_clock_counter = 0;
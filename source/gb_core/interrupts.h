@@ -28,6 +28,7 @@ void GB_HandleRTC(void);
 
 void GB_InterruptsInit(void);
 void GB_InterruptsEnd(void);
+void GB_TimersStateRegister(void);
 
 int GB_InterruptsExecute(void);
 
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+
+#include "../debug_utils.h"
+#include "../general_utils.h"
+
+#include "cpu.h"
+#include "gameboy.h"
+#include "gb_main.h"
+#include "link.h"
+#include "serial.h"
+#include "sound.h"
+#include "state.h"
+#include "video.h"
+
+extern _GB_CONTEXT_ GameBoy;
+
+// The state of the emulator is global, so only one GB can be loaded at a time.
+// The other one is kept in a snapshot, and they are swapped when the other one
+// has to run. Swapping them is expensive, so they run in slices that are as
+// long as possible. The length of a slice is limited by the end of the next
+// serial transfer (which is when both GB need to be at the same point) and by
+// GB_LINK_SLICE_CLOCKS (because a transfer that starts in the middle of a slice
+// can't be seen by the other GB until the end of the slice).
+//
+// All lengths are measured in single speed clocks so that a GBC in double
+// speed mode can be linked to another one in single speed mode.
+
+#define GB_LINK_FRAME_CLOCKS    (70224)
+#define GB_LINK_SLICE_CLOCKS    (GB_LINK_FRAME_CLOCKS / 8)
+
+static int gb_link_enabled = 0;
+static int gb_link_started = 0; // 1 after the second GB has been created
+
+static u8 *gb_link_state[2];
+static int gb_link_current = 0; // GB loaded in the emulator
+
+// State of each GB at the end of its last slice
+static u32 gb_link_sb[2];
+static int gb_link_ready[2]; // 1 if it's waiting for an external clock
+static int gb_link_transfer_clocks[2];
+
+static int gb_link_pending[2]; // Byte received by the GB, or -1
+static u32 gb_link_received; // Byte received by the GB that drives the clock
+
+void GB_LinkStart(void)
+{
+    gb_link_enabled = 1;
+    gb_link_started = 0;
+    gb_link_current = 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+        gb_link_ready[i] = 0;
+        gb_link_transfer_clocks[i] = 0x7FFFFFFF;
+        gb_link_pending[i] = -1;
+    }
+}
+
+void GB_LinkEnd(void)
+{
+    gb_link_enabled = 0;
+    gb_link_started = 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+        free(gb_link_state[i]);
+        gb_link_state[i] = NULL;
+    }
+}
+
+int GB_LinkIsEnabled(void)
+{
+    return gb_link_enabled;
+}
+
+// The second GB is a copy of the first one when the first frame is emulated,
+// so both of them start at the same point right after loading the ROM.
+static int GB_LinkCreateSecondGB(void)
+{
+    size_t size = GB_StateSize();
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (gb_link_state[i] == NULL)
+            gb_link_state[i] = malloc(size);
+
+        if (gb_link_state[i] == NULL)
+        {
+            Debug_ErrorMsgArg("%s: Not enough memory", __func__);
+            GB_LinkEnd();
+            return 1;
+        }
+    }
+
+    GB_StateSaveTo(gb_link_state[1]);
+
+    gb_link_started = 1;
+
+    return 0;
+}
+
+static void GB_LinkSwitchTo(int gb)
+{
+    if (gb_link_current == gb)
+        return;
+
+    GB_StateSaveTo(gb_link_state[gb_link_current]);
+    GB_StateLoadFrom(gb_link_state[gb]);
+
+    // The second GB uses the input of player 2
+    int keys = GB_Input_Get(0);
+    GB_Input_Set(0, GB_Input_Get(1));
+    GB_Input_Set(1, keys);
+
+    gb_link_current = gb;
+}
+
+// Returns 1 if a breakpoint has been found
+static int GB_LinkRunFor(int gb, int clocks)
+{
+    GB_LinkSwitchTo(gb);
+
+    if (gb_link_pending[gb] >= 0)
+    {
+        GB_SerialExternalByteReceived(gb_link_pending[gb]);
+        gb_link_pending[gb] = -1;
+    }
+
+    int skip = GB_HasToSkipFrame();
+    if (gb != 0)
+        GB_SkipFrame(1);
+
+    int ret = GB_RunForSlice(clocks << GameBoy.Emulator.DoubleSpeed);
+
+    GB_SkipFrame(skip);
+
+    if (gb != 0)
+        GB_SoundResetBufferPointers();
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    gb_link_sb[gb] = mem->IO_Ports[SB_REG - 0xFF00];
+    gb_link_ready[gb] = (mem->IO_Ports[SC_REG - 0xFF00] & 0x81) == 0x80;
+
+    int transfer_clocks = GB_SerialGetClocksToTransferEnd();
+    if (transfer_clocks != 0x7FFFFFFF)
+        transfer_clocks >>= GameBoy.Emulator.DoubleSpeed;
+    gb_link_transfer_clocks[gb] = transfer_clocks;
+
+    return ret;
+}
+
+void GB_LinkRunForOneFrame(void)
+{
+    if (!gb_link_started)
+    {
+        if (GB_LinkCreateSecondGB() != 0)
+        {
+            GB_RunFor(GB_LINK_FRAME_CLOCKS << GameBoy.Emulator.DoubleSpeed);
+            return;
+        }
+    }
+
+    int clocks_left = GB_LINK_FRAME_CLOCKS;
+
+    while (clocks_left > 0)
+    {
+        int clocks = GB_LINK_SLICE_CLOCKS;
+        if (clocks > clocks_left)
+            clocks = clocks_left;
+
+        // The GB that drives the clock runs last. When the transfer ends, the
+        // other one has already reached that point, so it knows the byte that
+        // it has to send.
+        int last = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            if (clocks > gb_link_transfer_clocks[i])
+            {
+                clocks = gb_link_transfer_clocks[i];
+                last = i;
+            }
+        }
+
+        if (clocks <= 0)
+            clocks = 1;
+
+        if (GB_LinkRunFor(last ^ 1, clocks) || GB_LinkRunFor(last, clocks))
+            break; // Breakpoint
+
+        clocks_left -= clocks;
+    }
+
+    GB_LinkSwitchTo(0);
+}
+
+void GB_LinkSend(u32 data)
+{
+    int other = gb_link_current ^ 1;
+
+    // The other GB only receives the byte if it has started a transfer that
+    // uses the external clock. If not, this one receives 0xFF, like when there
+    // is nothing connected.
+    if (gb_link_ready[other])
+    {
+        gb_link_received = gb_link_sb[other];
+        gb_link_pending[other] = data;
+        gb_link_ready[other] = 0;
+    }
+    else
+    {
+        gb_link_received = 0xFF;
+    }
+}
+
+u32 GB_LinkRecv(void)
+{
+    return gb_link_received;
+}
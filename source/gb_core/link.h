@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GB_LINK__
+#define GB_LINK__
+
+#include "gameboy.h"
+
+// Link cable between two GB that run the same ROM in this process. The first
+// one is the one that is displayed and receives the input of player 1. The
+// second one receives the input of player 2, and its video and audio output
+// are discarded. Its save data isn't written to any file.
+
+void GB_LinkStart(void);
+void GB_LinkEnd(void);
+int GB_LinkIsEnabled(void);
+
+// Runs both GB for one frame, synchronized at the end of each serial transfer
+void GB_LinkRunForOneFrame(void);
+
+// Serial port callbacks
+void GB_LinkSend(u32 data);
+u32 GB_LinkRecv(void);
+
+#endif // GB_LINK__
@@ -0,0 +1,521 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+// Needed for the socket functions when building in strict C11 mode
+#define _DEFAULT_SOURCE
+
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <unistd.h>
+# define LINK_SOCKET_SUPPORTED
+# ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+# endif
+#endif
+
+#include "../debug_utils.h"
+#include "../general_utils.h"
+
+#include "cpu.h"
+#include "gameboy.h"
+#include "link_socket.h"
+#include "serial.h"
+
+extern _GB_CONTEXT_ GameBoy;
+
+// Protocol
+// --------
+//
+// All messages have the same size. Times are measured in single speed clocks
+// since the start of the emulation of each process. Both processes run in the
+// same computer, so the native byte order is used.
+//
+// - HELLO: Sent by both processes when the connection is established. The time
+//   is used to convert the times of the other process to local times.
+//
+// - BYTE: Sent by the GB that drives the clock when it finishes sending a byte.
+//   It waits until it receives a REPLY.
+//
+// - REPLY: Sent when a BYTE is received and the local time reaches the time of
+//   the BYTE. If the GB has started a transfer with the external clock, it
+//   contains the value of SB and the transfer ends. If not, it contains 0xFF.
+//
+// Messages are queued and sent together when the emulation stops to check the
+// socket, or right away when a process has to wait for a reply.
+
+#define LINK_MSG_HELLO  (0)
+#define LINK_MSG_BYTE   (1)
+#define LINK_MSG_REPLY  (2)
+
+typedef struct {
+    u8 type;
+    u8 data;
+    u8 padding[6];
+    u64 time;
+} _gb_link_msg_;
+
+#define LINK_FRAME_CLOCKS   (70224)
+#define LINK_SLICE_CLOCKS   (LINK_FRAME_CLOCKS / 8)
+
+// If the other process doesn't reply in this time, the byte received is 0xFF
+#define LINK_REPLY_TIMEOUT_MS   (1000)
+
+#define LINK_QUEUE_SIZE     (64) // In messages
+
+static int link_enabled = 0;
+
+#ifdef LINK_SOCKET_SUPPORTED
+
+static char link_path[MAX_PATHLEN];
+static int link_listen_fd = -1; // Only used if this process waits for the other
+static int link_fd = -1;
+
+static u64 link_time; // Time at the start of the current slice
+static s64 link_time_offset; // Local time minus remote time
+static int link_time_offset_valid;
+
+// BYTE received that hasn't been replied to yet
+static int link_pending;
+static u8 link_pending_data;
+static u64 link_pending_time;
+
+static u8 link_received; // Byte received by the GB that drives the clock
+
+static _gb_link_msg_ link_out[LINK_QUEUE_SIZE];
+static int link_out_num;
+
+static u8 link_in[sizeof(_gb_link_msg_)];
+static size_t link_in_size;
+
+static void GB_LinkSocketDisconnect(void)
+{
+    if (link_fd >= 0)
+    {
+        close(link_fd);
+        link_fd = -1;
+
+        Debug_LogMsgArg("Link: Disconnected");
+    }
+
+    link_time_offset_valid = 0;
+    link_pending = 0;
+    link_out_num = 0;
+    link_in_size = 0;
+}
+
+static int GB_LinkSocketSetNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1)
+        return -1;
+
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// EAGAIN and EWOULDBLOCK have the same value in most systems
+static int GB_LinkSocketWouldBlock(int error)
+{
+#if EAGAIN != EWOULDBLOCK
+    if (error == EWOULDBLOCK)
+        return 1;
+#endif
+    return error == EAGAIN;
+}
+
+static u64 GB_LinkSocketTimeNow(void)
+{
+    int clocks = GB_SliceClockCounterGet() >> GameBoy.Emulator.DoubleSpeed;
+
+    return link_time + clocks;
+}
+
+static void GB_LinkSocketQueue(int type, int data, u64 time)
+{
+    if (link_fd < 0)
+        return;
+
+    if (link_out_num == LINK_QUEUE_SIZE)
+    {
+        Debug_ErrorMsgArg("Link: Message queue full");
+        GB_LinkSocketDisconnect();
+        return;
+    }
+
+    _gb_link_msg_ *msg = &link_out[link_out_num++];
+
+    memset(msg, 0, sizeof(_gb_link_msg_));
+    msg->type = type;
+    msg->data = data;
+    msg->time = time;
+}
+
+static void GB_LinkSocketFlush(void)
+{
+    const u8 *data = (const u8 *)link_out;
+    size_t size = link_out_num * sizeof(_gb_link_msg_);
+
+    while ((size > 0) && (link_fd >= 0))
+    {
+        ssize_t written = send(link_fd, data, size, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (GB_LinkSocketWouldBlock(errno))
+            {
+                // The other process isn't reading, wait a bit for it
+                struct pollfd pfd = { link_fd, POLLOUT, 0 };
+                if (poll(&pfd, 1, LINK_REPLY_TIMEOUT_MS) > 0)
+                    continue;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+
+            GB_LinkSocketDisconnect();
+            break;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    link_out_num = 0;
+}
+
+static void GB_LinkSocketConnected(void)
+{
+    Debug_LogMsgArg("Link: Connected");
+
+    link_time_offset_valid = 0;
+    link_pending = 0;
+    link_out_num = 0;
+    link_in_size = 0;
+
+    GB_LinkSocketQueue(LINK_MSG_HELLO, 0, link_time);
+    GB_LinkSocketFlush();
+}
+
+// If the BYTE that has been received is due, reply to it
+static void GB_LinkSocketReplyPending(u64 now)
+{
+    if (!link_pending || (now < link_pending_time))
+        return;
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    int ready = (mem->IO_Ports[SC_REG - 0xFF00] & 0x81) == 0x80;
+
+    GB_LinkSocketQueue(LINK_MSG_REPLY,
+                       ready ? mem->IO_Ports[SB_REG - 0xFF00] : 0xFF, now);
+
+    if (ready)
+        GB_SerialExternalByteReceived(link_pending_data);
+
+    link_pending = 0;
+}
+
+static void GB_LinkSocketHandleMessage(const _gb_link_msg_ *msg, u64 now,
+                                       int *reply)
+{
+    switch (msg->type)
+    {
+        case LINK_MSG_HELLO:
+            link_time_offset = (s64)now - (s64)msg->time;
+            link_time_offset_valid = 1;
+            break;
+
+        case LINK_MSG_BYTE:
+        {
+            s64 time = (s64)msg->time + link_time_offset;
+
+            // The clocks of both processes drift apart because they don't run
+            // at exactly the same speed, and because they stop while waiting
+            // for replies. If the byte has been sent in the past, or too far
+            // in the future, consider that it has been sent now.
+            if (!link_time_offset_valid || (time < (s64)now)
+                || (time > (s64)now + LINK_FRAME_CLOCKS))
+            {
+                link_time_offset += (s64)now - time;
+                link_time_offset_valid = 1;
+                time = now;
+            }
+
+            link_pending = 1;
+            link_pending_data = msg->data;
+            link_pending_time = time;
+            break;
+        }
+
+        case LINK_MSG_REPLY:
+            if (reply)
+                *reply = msg->data;
+            break;
+
+        default:
+            Debug_ErrorMsgArg("Link: Unknown message: %d", msg->type);
+            GB_LinkSocketDisconnect();
+            break;
+    }
+}
+
+// Reads all messages available. If 'reply' isn't NULL, it waits until a REPLY
+// is received, and its value is saved there. Returns 0 on success.
+static int GB_LinkSocketRead(u64 now, int *reply)
+{
+    while (link_fd >= 0)
+    {
+        ssize_t size = recv(link_fd, link_in + link_in_size,
+                            sizeof(link_in) - link_in_size, 0);
+        if (size == 0)
+        {
+            GB_LinkSocketDisconnect(); // Closed by the other process
+            return 1;
+        }
+
+        if (size < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (!GB_LinkSocketWouldBlock(errno))
+            {
+                GB_LinkSocketDisconnect();
+                return 1;
+            }
+
+            if ((reply == NULL) || (*reply >= 0))
+                return 0;
+
+            // Keep the connection in case the other process is paused, a
+            // late reply will be ignored.
+            struct pollfd pfd = { link_fd, POLLIN, 0 };
+            if (poll(&pfd, 1, LINK_REPLY_TIMEOUT_MS) <= 0)
+            {
+                Debug_LogMsgArg("Link: No reply received");
+                return 1;
+            }
+
+            continue;
+        }
+
+        link_in_size += size;
+        if (link_in_size < sizeof(link_in))
+            continue;
+
+        link_in_size = 0;
+
+        _gb_link_msg_ msg;
+        memcpy(&msg, link_in, sizeof(msg));
+        GB_LinkSocketHandleMessage(&msg, now, reply);
+
+        // If both GB drive the clock at the same time they can't wait for each
+        // other. This GB isn't waiting for an external clock, so the reply is
+        // just 0xFF.
+        if (reply != NULL)
+        {
+            GB_LinkSocketReplyPending(~(u64)0);
+            GB_LinkSocketFlush();
+        }
+    }
+
+    return 1;
+}
+
+static void GB_LinkSocketPoll(void)
+{
+    if ((link_fd < 0) && (link_listen_fd >= 0))
+    {
+        int fd = accept(link_listen_fd, NULL, NULL);
+        if (fd >= 0)
+        {
+            if (GB_LinkSocketSetNonBlocking(fd) == 0)
+            {
+                link_fd = fd;
+                GB_LinkSocketConnected();
+            }
+            else
+            {
+                close(fd);
+            }
+        }
+    }
+
+    if (link_fd < 0)
+        return;
+
+    GB_LinkSocketRead(link_time, NULL);
+    GB_LinkSocketReplyPending(link_time);
+    GB_LinkSocketFlush();
+}
+
+void GB_LinkSocketStart(const char *path)
+{
+    GB_LinkSocketEnd();
+
+    s_strncpy(link_path, path, sizeof(link_path));
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        Debug_ErrorMsgArg("Link: Socket path too long: %s", path);
+        return;
+    }
+
+    s_strncpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+    link_time = 0;
+    link_enabled = 1;
+
+    // Try to connect to a process that is already waiting
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        Debug_ErrorMsgArg("Link: socket(): %s", strerror(errno));
+        return;
+    }
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        if (GB_LinkSocketSetNonBlocking(fd) == 0)
+        {
+            link_fd = fd;
+            GB_LinkSocketConnected();
+            return;
+        }
+
+        close(fd);
+        return;
+    }
+
+    // Nobody is waiting, so wait for the other process. If the path exists,
+    // it has been left behind by a process that hasn't been closed correctly.
+    unlink(path);
+
+    if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        || (listen(fd, 1) != 0) || (GB_LinkSocketSetNonBlocking(fd) != 0))
+    {
+        Debug_ErrorMsgArg("Link: Can't listen on %s: %s", path,
+                          strerror(errno));
+        close(fd);
+        return;
+    }
+
+    link_listen_fd = fd;
+
+    Debug_LogMsgArg("Link: Waiting for connection on %s", path);
+}
+
+void GB_LinkSocketEnd(void)
+{
+    GB_LinkSocketDisconnect();
+
+    if (link_listen_fd >= 0)
+    {
+        close(link_listen_fd);
+        link_listen_fd = -1;
+        unlink(link_path);
+    }
+
+    link_enabled = 0;
+}
+
+void GB_LinkSocketRunForOneFrame(void)
+{
+    GB_LinkSocketPoll();
+
+    int clocks_left = LINK_FRAME_CLOCKS;
+
+    while (clocks_left > 0)
+    {
+        int clocks = LINK_SLICE_CLOCKS;
+        if (clocks > clocks_left)
+            clocks = clocks_left;
+
+        // Stop at the point where the other GB has sent a byte to this one
+        if (link_pending && (link_pending_time > link_time)
+            && (link_pending_time - link_time < (u64)clocks))
+        {
+            clocks = link_pending_time - link_time;
+        }
+
+        int ret = GB_RunForSlice(clocks << GameBoy.Emulator.DoubleSpeed);
+
+        // The CPU may have run a few more clocks than requested
+        clocks = GB_SliceClockCounterGet() >> GameBoy.Emulator.DoubleSpeed;
+
+        link_time += clocks;
+        clocks_left -= clocks;
+
+        GB_LinkSocketPoll();
+
+        if (ret)
+            break; // Breakpoint
+    }
+}
+
+void GB_LinkSocketSend(u32 data)
+{
+    link_received = 0xFF;
+
+    if (link_fd < 0)
+        return;
+
+    u64 now = GB_LinkSocketTimeNow();
+
+    GB_LinkSocketQueue(LINK_MSG_BYTE, data, now);
+    GB_LinkSocketFlush();
+
+    int reply = -1;
+    if (GB_LinkSocketRead(now, &reply) == 0)
+        link_received = reply;
+}
+
+u32 GB_LinkSocketRecv(void)
+{
+    return link_received;
+}
+
+#else // LINK_SOCKET_SUPPORTED
+
+void GB_LinkSocketStart(unused__ const char *path)
+{
+    Debug_ErrorMsgArg("Link: Sockets aren't supported in this platform");
+}
+
+void GB_LinkSocketEnd(void)
+{
+    link_enabled = 0;
+}
+
+void GB_LinkSocketRunForOneFrame(void)
+{
+    GB_RunFor(70224 << GameBoy.Emulator.DoubleSpeed);
+}
+
+void GB_LinkSocketSend(unused__ u32 data)
+{
+    return;
+}
+
+u32 GB_LinkSocketRecv(void)
+{
+    return 0xFF;
+}
+
+#endif // LINK_SOCKET_SUPPORTED
+
+int GB_LinkSocketIsEnabled(void)
+{
+    return link_enabled;
+}
@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GB_LINK_SOCKET__
+#define GB_LINK_SOCKET__
+
+#include "gameboy.h"
+
+// Link cable to another process of the emulator (or any other program that
+// follows the same protocol) running in the same computer, using a Unix domain
+// socket. The first process that uses the socket path waits for a connection,
+// the second one connects to it.
+//
+// Both processes run at their own speed. They only wait for each other when
+// the GB that drives the clock finishes sending a byte and needs the one of the
+// other GB.
+
+void GB_LinkSocketStart(const char *path);
+void GB_LinkSocketEnd(void);
+int GB_LinkSocketIsEnabled(void);
+
+void GB_LinkSocketRunForOneFrame(void);
+
+// Serial port callbacks
+void GB_LinkSocketSend(u32 data);
+u32 GB_LinkSocketRecv(void);
+
+#endif // GB_LINK_SOCKET__
@@ -85,7 +85,7 @@ static void GB_MBC1Write(u32 address, u32 value)
 
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
 
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             break;
         case 0x4:
         case 0x5: // RAM Bank Number - or - Upper Bits of ROM Bank Number
@@ -97,7 +97,7 @@ static void GB_MBC1Write(u32 address, u32 value)
 
                 mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
 
-                mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             }
             else // RAM mode
             {
@@ -114,8 +114,8 @@ static void GB_MBC1Write(u32 address, u32 value)
         case 0xB:
             if (mem->RAMEnabled == 0)
                 return;
-            else
-                mem->RAM_Curr[address - 0xA000] = value;
+            mem->RAM_Curr[address - 0xA000] = value;
+            GameBoy.Emulator.sram_dirty = 1;
             break;
         default:
             //Debug_DebugMsgArg("MBC1 WROTE - %02x to %04x", value, address);
@@ -147,7 +147,7 @@ static void GB_MBC2Write(u32 address, u32 value)
                 mem->selected_rom = value & (GameBoy.Emulator.ROM_Banks - 1);
                 if (mem->selected_rom == 0)
                     mem->selected_rom++;
-                mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             }
             break;
         case 0x4:
@@ -159,8 +159,8 @@ static void GB_MBC2Write(u32 address, u32 value)
         case 0xB:
             if (mem->RAMEnabled == 0)
                 return;
-            else
-                mem->RAM_Curr[address - 0xA000] = value & 0x0F;
+            mem->RAM_Curr[address - 0xA000] = value & 0x0F;
+            GameBoy.Emulator.sram_dirty = 1;
             break;
         default:
             //Debug_DebugMsgArg("MBC2 WROTE - %02x to %04x", value, address);
@@ -186,7 +186,7 @@ static void GB_MBC3Write(u32 address, u32 value)
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
             if (mem->selected_rom == 0)
                 mem->selected_rom = 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             break;
         case 0x4:
         case 0x5: // RAM Bank Number - or - RTC Register Select
@@ -223,6 +223,9 @@ static void GB_MBC3Write(u32 address, u32 value)
             if (mem->RAMEnabled == 0)
                 return;
 
+            // The RTC registers are saved with the RAM
+            GameBoy.Emulator.sram_dirty = 1;
+
             if (mem->mbc_mode == 1) // RAM mode
             {
                 mem->RAM_Curr[address - 0xA000] = value;
@@ -283,13 +286,13 @@ static void GB_MBC5Write(u32 address, u32 value)
             mem->selected_rom &= 0xFF00;
             mem->selected_rom |= (value & 0xFF);
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             break;
         case 0x3:
             mem->selected_rom &= 0xFF;
             mem->selected_rom |= value << 8;
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             break;
         case 0x4:
         case 0x5:
@@ -311,8 +314,8 @@ static void GB_MBC5Write(u32 address, u32 value)
         case 0xB:
             if (mem->RAMEnabled == 0)
                 return;
-            else
-                mem->RAM_Curr[address - 0xA000] = value;
+            mem->RAM_Curr[address - 0xA000] = value;
+            GameBoy.Emulator.sram_dirty = 1;
             break;
         default:
             //Debug_DebugMsgArg("MBC5 WROTE - %02x to %04x", value, address);
@@ -350,7 +353,7 @@ static void GB_MBC6Write(u32 address, u32 value)
             {
                 if (value == 0)
                 {
-                    mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                    mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
                 }
                 //else
                 //{
@@ -395,8 +398,8 @@ static void GB_MBC6Write(u32 address, u32 value)
             //Debug_DebugMsgArg("MBC6 WROTE - %02x to %04x", value, address);
             if (mem->RAMEnabled == 0)
                 return;
-            else
-                mem->RAM_Curr[address - 0xA000] = value;
+            mem->RAM_Curr[address - 0xA000] = value;
+            GameBoy.Emulator.sram_dirty = 1;
             break;
         default:
             //Debug_DebugMsgArg("MBC6 WROTE - %02x to %04x", value, address);
@@ -420,7 +423,7 @@ static void GB_MBC7Write(u32 address, u32 value)
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
             if (mem->selected_rom == 0)
                 mem->selected_rom = 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             break;
         case 0x4:
         case 0x5:
@@ -457,6 +460,7 @@ static void GB_MBC7Write(u32 address, u32 value)
                                     mbc7->buffer >> 8;
                             mem->RAM_Curr[mbc7->address * 2 + 1] =
                                     mbc7->buffer & 0xFF;
+                            GameBoy.Emulator.sram_dirty = 1;
                         }
                         mbc7->state = 0;
                         mbc7->value = 1;
@@ -643,11 +647,11 @@ static void GB_MMM01Write(u32 address, u32 value)
                 if (value & 0x40) // Taito Pack
                 {
                     mem->ROM_Base =
-                            mem->ROM_Switch[GameBoy.Emulator.MMM01.offset
-                            & (GameBoy.Emulator.ROM_Banks - 1)];
+                            GB_MemROMBankGet(GameBoy.Emulator.MMM01.offset
+                            & (GameBoy.Emulator.ROM_Banks - 1));
                     mem->selected_rom = (GameBoy.Emulator.MMM01.offset + 1)
                                         & (GameBoy.Emulator.ROM_Banks - 1);
-                    mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                    mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
                     GameBoy.Emulator.EnableBank0Switch = 0;
                 }
             }
@@ -665,7 +669,7 @@ static void GB_MMM01Write(u32 address, u32 value)
                 // Taito Pack
                 mem->selected_rom = (value & GameBoy.Emulator.MMM01.mask)
                                     + GameBoy.Emulator.MMM01.offset;
-                mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             }
             //Debug_DebugMsgArg("MMM01 WROTE - %02x to %04x", value, address);
             break;
@@ -713,6 +717,7 @@ static void GB_MMM01Write(u32 address, u32 value)
                 return;
 
             mem->RAM_Curr[address - 0xA000] = value;
+            GameBoy.Emulator.sram_dirty = 1;
             break;
         default:
             //Debug_DebugMsgArg("MMM01 WROTE - %02x to %04x", value, address);
@@ -736,7 +741,7 @@ static void GB_CameraWrite(u32 address, u32 value)
             mem->selected_rom &= 0xFF00;
             mem->selected_rom |= (value & 0xFF);
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
             break;
         case 0x3:
             break;
@@ -770,6 +775,7 @@ static void GB_CameraWrite(u32 address, u32 value)
                 return;
 
             mem->RAM_Curr[address - 0xA000] = value;
+            GameBoy.Emulator.sram_dirty = 1;
             break;
         default:
             //Debug_DebugMsgArg("CAMERA WROTE - %02x to %04x", value, address);
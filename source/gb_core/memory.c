@@ -23,6 +23,7 @@
 #include "memory_dmg.h"
 #include "memory_gbc.h"
 #include "ppu.h"
+#include "rom.h"
 #include "serial.h"
 #include "sgb.h"
 #include "sound.h"
@@ -94,6 +95,12 @@ void GB_MemUpdateReadWriteFunctionPointers(void)
     }
 }
 
+u8 *GB_MemROMBankGet(u32 bank)
+{
+    GB_CartridgeRequestROM((bank + 1) * 16 * 1024);
+    return GameBoy.Memory.ROM_Switch[bank];
+}
+
 void GB_MemInit(void)
 {
     GB_MemUpdateReadWriteFunctionPointers();
@@ -103,8 +110,6 @@ void GB_MemInit(void)
 
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-    mem->ROM_Base = (void *)GameBoy.Emulator.Rom_Pointer;
-
     for (u32 i = 0; i < 512; i++)
         mem->ROM_Switch[i] = NULL;
 
@@ -112,6 +117,8 @@ void GB_MemInit(void)
         mem->ROM_Switch[i] = (u8 *)GameBoy.Emulator.Rom_Pointer
                              + (16 * 1024 * i);
 
+    mem->ROM_Base = GB_MemROMBankGet(0);
+
     memset(mem->VideoRAM, 0, 0x4000);
 
     // Don't clear cartridge RAM here. Do it when loading the sav file if not
@@ -157,7 +164,7 @@ void GB_MemInit(void)
     mem->mbc_mode = 0;
 
     mem->VideoRAM_Curr = mem->VideoRAM;
-    mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+    mem->ROM_Curr = GB_MemROMBankGet(mem->selected_rom);
     mem->RAM_Curr = mem->ExternRAM[0];
     mem->WorkRAM_Curr = mem->WorkRAM_Switch[0];
 
@@ -211,6 +218,9 @@ void GB_MemWrite16(u32 address, u32 value)
 
 void GB_MemWrite8(u32 address, u32 value)
 {
+    if (gb_debug_watchpoints_armed)
+        GB_DebugWatchpointCheck(address, GB_WATCH_WRITE);
+
     GameBoy.Memory.MemWrite(address, value);
 }
 
@@ -228,6 +238,9 @@ u32 GB_MemRead16(u32 address)
 
 u32 GB_MemRead8(u32 address)
 {
+    if (gb_debug_watchpoints_armed)
+        GB_DebugWatchpointCheck(address, GB_WATCH_READ);
+
     return GameBoy.Memory.MemRead(address);
 }
 
@@ -297,6 +310,9 @@ u32 GB_MemReadDMA8(u32 address) // Not verified yet - different for GBC and DMG
 
 void GB_MemWriteHDMA8(u32 address, u32 value)
 {
+    // The CPU clock counter advances during the copy
+    GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+
     if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
         return;
 
@@ -382,6 +398,8 @@ void GB_MemoryWriteSVBK(int value) // reference_clocks not needed
 
     mem->selected_wram = value - 1;
     mem->WorkRAM_Curr = mem->WorkRAM_Switch[mem->selected_wram];
+
+    GB_CPUBreakBlock();
 }
 
 void GB_MemoryWriteVBK(int value) // reference_clocks not needed
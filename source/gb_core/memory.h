@@ -12,6 +12,10 @@ void GB_MemEnd(void);
 
 void GB_MemUpdateReadWriteFunctionPointers(void);
 
+// Returns a pointer to a ROM bank. Use it instead of reading ROM_Switch[]
+// directly so that banks of ROMs loaded on demand are loaded before using them.
+u8 *GB_MemROMBankGet(u32 bank);
+
 void GB_MemWrite16(u32 address, u32 value); // Only used by debugger
 void GB_MemWrite8(u32 address, u32 value);
 void GB_MemWriteReg8(u32 address, u32 value);
@@ -192,9 +192,11 @@ void GB_MemWrite8_DMG(u32 address, u32 value)
         case 0x6:
         case 0x7: // 16KB ROM Bank 01..NN
             GameBoy.Memory.MapperWrite(address, value);
+            GB_CPUBreakBlock();
             return;
         case 0x8:
         case 0x9: // 8KB Video RAM (VRAM)
+            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
             if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
                 return;
@@ -226,6 +228,7 @@ void GB_MemWrite8_DMG(u32 address, u32 value)
             }
             else if (address < 0xFEA0) // Sprite Attribute Table
             {
+                GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
                 if (GameBoy.Emulator.lcd_on
                     && (GameBoy.Emulator.ScreenMode & 0x02))
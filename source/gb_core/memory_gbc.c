@@ -230,9 +230,11 @@ void GB_MemWrite8_GBC(u32 address, u32 value)
         case 0x6:
         case 0x7: // 16KB ROM Bank 01..NN
             GameBoy.Memory.MapperWrite(address, value);
+            GB_CPUBreakBlock();
             return;
         case 0x8:
         case 0x9: // 8KB Video RAM (VRAM)
+            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
             if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
                 return;
@@ -264,6 +266,7 @@ void GB_MemWrite8_GBC(u32 address, u32 value)
             }
             else if (address < 0xFEA0) // Sprite Attribute Table
             {
+                GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
                 if (GameBoy.Emulator.lcd_on
                     && (GameBoy.Emulator.ScreenMode & 0x02))
@@ -774,6 +777,7 @@ void GB_MemWriteReg8_GBC(u32 address, u32 value)
         {
             if (GameBoy.Emulator.CGBEnabled == 0)
                 return;
+            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
             if (GameBoy.Emulator.ScreenMode == 3 && GameBoy.Emulator.lcd_on)
                 return;
@@ -803,6 +807,7 @@ void GB_MemWriteReg8_GBC(u32 address, u32 value)
         {
             if (GameBoy.Emulator.CGBEnabled == 0)
                 return;
+            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
             if (GameBoy.Emulator.ScreenMode == 3 && GameBoy.Emulator.lcd_on)
                 return;
@@ -17,6 +17,7 @@
 #include "ppu.h"
 #include "ppu_dmg.h"
 #include "ppu_gbc.h"
+#include "state.h"
 #include "video.h"
 
 //----------------------------------------------------------------
@@ -25,6 +26,15 @@ extern _GB_CONTEXT_ GameBoy;
 
 //----------------------------------------------------------------
 
+gb_scanline_hook_fn gb_ppu_scanline_hook = NULL;
+
+void GB_PPUScanlineHookSet(gb_scanline_hook_fn fn)
+{
+    gb_ppu_scanline_hook = fn;
+}
+
+//----------------------------------------------------------------
+
 void GB_PPUInit(void)
 {
     GameBoy.Emulator.FrameDrawn = 0;
@@ -194,6 +204,11 @@ void GB_PPUEnd(void)
 
 static int gb_ppu_clock_counter = 0;
 
+void GB_PPUStateRegister(void)
+{
+    GB_StateAddBlock(&gb_ppu_clock_counter, sizeof(gb_ppu_clock_counter));
+}
+
 void GB_PPUClockCounterReset(void)
 {
     gb_ppu_clock_counter = 0;
@@ -226,6 +241,112 @@ int GB_PPUGetClocksToNextEvent(void)
     return GameBoy.Emulator.PPUClocksToNextEvent();
 }
 
+// The PPU is updated lazily. Reading LY, STAT or IF, and writing to VRAM, OAM
+// or any video register, updates it to the current clock first (drawing any
+// pending scanline with the old state). Because of that, the CPU loop only has
+// to stop at the mode changes that can be seen in some other way:
+//
+// - The start of the VBlank period and the end of the frame.
+// - All of them if the STAT interrupt is enabled in IE and STAT, because the
+//   interrupt has to be requested at the right time.
+// - The start of the HBlank period if there is a HBlank DMA copy running (it
+//   starts as soon as the mode changes) or if there is a scanline hook.
+//
+// Writes to IE, STAT, LYC, LCDC and HDMA5 break the CPU loop, so the next event
+// is calculated again whenever any of the conditions changes.
+//
+// If all_changes is 1, all mode and line changes are considered events.
+static int GB_PPUClocksToNextChange(int speed_shift, int all_changes)
+{
+    if (GameBoy.Emulator.lcd_on == 0)
+        return 0x7FFFFFFF;
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    int stat_events = all_changes
+                      || ((mem->HighRAM[IE_REG - 0xFF80] & I_STAT)
+                          && (mem->IO_Ports[STAT_REG - 0xFF00]
+                              & (IENABLE_LY_COMPARE | IENABLE_OAM
+                                 | IENABLE_VBL | IENABLE_HBL)));
+    int hblank_events = stat_events || (gb_ppu_scanline_hook != NULL)
+                        || (GameBoy.Emulator.GBC_DMA_enabled == GBC_DMA_HBLANK);
+
+    int mode = GameBoy.Emulator.ScreenMode;
+    int drawn = GameBoy.Emulator.ly_drawn;
+    int line = GameBoy.Emulator.CurrentScanLine;
+    int ly_clocks = GameBoy.Emulator.ly_clocks;
+
+    // Follow the same steps as GB_PPUUpdateClocks_DMG() and
+    // GB_PPUUpdateClocks_GBC() until a mode change that needs an event is
+    // found. The end of the frame always needs one, so this can't loop forever.
+    int clocks = 0;
+    int found = 0;
+    while (found == 0)
+    {
+        switch (mode)
+        {
+            case 2:
+                clocks += (82 << speed_shift) - ly_clocks;
+                ly_clocks = 82 << speed_shift;
+                mode = 3;
+                found = stat_events;
+                break;
+            case 3:
+                clocks += (252 << speed_shift) - ly_clocks;
+                ly_clocks = 252 << speed_shift;
+                mode = 0;
+                drawn = 1;
+                found = hblank_events;
+                break;
+            case 0:
+                if (drawn == 0)
+                {
+                    clocks += 4 - ly_clocks;
+                    ly_clocks = 4;
+                    mode = 2;
+                    found = stat_events || (line == 144); // VBlank
+                }
+                else
+                {
+                    clocks += (456 << speed_shift) - ly_clocks;
+                    ly_clocks = 0;
+                    line++;
+                    drawn = 0;
+                    found = stat_events;
+                }
+                break;
+            case 1:
+                clocks += (456 << speed_shift) - ly_clocks;
+                ly_clocks = 0;
+                if (line == 0)
+                {
+                    mode = 2;
+                    found = stat_events;
+                    break;
+                }
+                line++;
+                if (line == 153) // 8 clocks this scanline
+                    ly_clocks = (456 - 8) << speed_shift;
+                found = stat_events || (line == 154); // End of frame
+                break;
+            default:
+                return 0x7FFFFFFF;
+        }
+    }
+
+    return (clocks > 0) ? clocks : 1;
+}
+
+int GB_PPUClocksToNextEvent(int speed_shift)
+{
+    return GB_PPUClocksToNextChange(speed_shift, 0);
+}
+
+int GB_PPUClocksToNextModeChange(void)
+{
+    return GB_PPUClocksToNextChange(GameBoy.Emulator.DoubleSpeed, 1);
+}
+
 //----------------------------------------------------------------
 
 void GB_PPUCheckStatSignal(void)
@@ -7,14 +7,27 @@
 #ifndef GB_PPU__
 #define GB_PPU__
 
+#include "gameboy.h"
+
 void GB_PPUInit(void);
 void GB_PPUEnd(void);
+void GB_PPUStateRegister(void);
 
 void GB_PPUClockCounterReset(void);
 void GB_PPUUpdateClocksCounterReference(int reference_clocks);
 int GB_PPUGetClocksToNextEvent(void);
+// Used by the DMG and GBC implementations of GB_PPUGetClocksToNextEvent()
+int GB_PPUClocksToNextEvent(int speed_shift);
+// Clocks until LY or the mode in STAT change. The PPU must be up to date.
+int GB_PPUClocksToNextModeChange(void);
 
 void GB_PPUCheckStatSignal(void);
 void GB_PPUCheckLYC(void);
 
+// Called after drawing each visible scanline, when its H-Blank period starts.
+// Used by scripts. NULL disables it.
+typedef void (*gb_scanline_hook_fn)(u32 ly);
+void GB_PPUScanlineHookSet(gb_scanline_hook_fn fn);
+extern gb_scanline_hook_fn gb_ppu_scanline_hook;
+
 #endif // GB_PPU__
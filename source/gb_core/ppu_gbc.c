@@ -120,6 +120,9 @@ void GB_PPUUpdateClocks_GBC(int increment_clocks)
                 {
                     GameBoy.Emulator.DrawScanlineFn(GameBoy.Emulator.CurrentScanLine);
 
+                    if (gb_ppu_scanline_hook)
+                        gb_ppu_scanline_hook(GameBoy.Emulator.CurrentScanLine);
+
                     GameBoy.Emulator.ScreenMode = 0;
                     mem->IO_Ports[STAT_REG - 0xFF00] &= 0xFC;
 
@@ -236,32 +239,5 @@ void GB_PPUUpdateClocks_GBC(int increment_clocks)
 
 int GB_PPUGetClocksToNextEvent_GBC(void)
 {
-    int clocks_to_next_event = 0x7FFFFFFF;
-
-    if (GameBoy.Emulator.lcd_on)
-    {
-        switch (GameBoy.Emulator.ScreenMode)
-        {
-            case 2:
-                clocks_to_next_event = (82 << GameBoy.Emulator.DoubleSpeed)
-                                       - GameBoy.Emulator.ly_clocks;
-                break;
-            case 3:
-                clocks_to_next_event = 4;
-                break;
-            case 0:
-                clocks_to_next_event = 4;
-                //clocks_to_next_event = (456 << GameBoy.Emulator.DoubleSpeed)
-                //                     - GameBoy.Emulator.ly_clocks;
-                break;
-            case 1:
-                clocks_to_next_event = (456 << GameBoy.Emulator.DoubleSpeed)
-                                       - GameBoy.Emulator.ly_clocks;
-                break;
-            default:
-                break;
-        }
-    }
-
-    return clocks_to_next_event;
+    return GB_PPUClocksToNextEvent(GameBoy.Emulator.DoubleSpeed);
 }
@@ -15,6 +15,8 @@
 #include "../debug_utils.h"
 #include "../file_utils.h"
 #include "../general_utils.h"
+#include "../movie.h"
+#include "../save_writer.h"
 
 #include "debug.h"
 #include "gameboy.h"
@@ -126,8 +128,33 @@ int GB_ShowConsoleRequested(void)
     return ret;
 }
 
+// ROMs loaded from compressed files can be decompressed on demand. In that
+// case, only the first gb_rom_available bytes can be used.
+static gb_rom_fill_fn gb_rom_fill = NULL;
+static u32 gb_rom_available = 0;
+
+void GB_CartridgeSetLazyLoad(u32 available, gb_rom_fill_fn fill_fn)
+{
+    gb_rom_available = available;
+    gb_rom_fill = fill_fn;
+}
+
+void GB_CartridgeRequestROM(u32 size)
+{
+    if (size <= gb_rom_available)
+        return;
+
+    if (gb_rom_fill == NULL)
+        return;
+
+    gb_rom_available = gb_rom_fill(size);
+}
+
 int GB_CartridgeLoad(const u8 *pointer, const u32 rom_size)
 {
+    if (gb_rom_fill == NULL)
+        gb_rom_available = rom_size;
+
     showconsole = 0; // If at the end this is 1, show console window
 
     ConsoleReset();
@@ -633,24 +660,33 @@ int GB_CartridgeLoad(const u8 *pointer, const u32 rom_size)
 
     // Global checksum
     u32 size = GameBoy.Emulator.ROM_Banks * 16 * 1024;
-    sum = 0;
-    for (count = 0; count < size; count++)
-        sum += (u32)pointer[count];
+    if (size > gb_rom_available)
+    {
+        // Checking it would force the whole ROM to be decompressed
+        ConsolePrint("Global checksum: %04X - Not checked (ROM is loaded on "
+                     "demand)\n", GB_Header->global_checksum);
+    }
+    else
+    {
+        sum = 0;
+        for (count = 0; count < size; count++)
+            sum += (u32)pointer[count];
 
-    sum -= GB_Header->global_checksum & 0xFF; // Checksum bytes not included
-    sum -= (GB_Header->global_checksum >> 8) & 0xFF;
+        sum -= GB_Header->global_checksum & 0xFF; // Checksum bytes not included
+        sum -= (GB_Header->global_checksum >> 8) & 0xFF;
 
-    sum &= 0xFFFF;
-    sum = ((sum >> 8) & 0x00FF) | ((sum << 8) & 0xFF00);
+        sum &= 0xFFFF;
+        sum = ((sum >> 8) & 0x00FF) | ((sum << 8) & 0xFF00);
 
-    ConsolePrint("Global checksum: %04X - Obtained: %04X\n",
-                 GB_Header->global_checksum, sum);
+        ConsolePrint("Global checksum: %04X - Obtained: %04X\n",
+                     GB_Header->global_checksum, sum);
 
-    if (GB_Header->global_checksum != sum)
-    {
-        ConsolePrint("[!]INCORRECT! - Maybe a bad dump?\n");
-        if (EmulatorConfig.debug_msg_enable)
-            showconsole = 1;
+        if (GB_Header->global_checksum != sum)
+        {
+            ConsolePrint("[!]INCORRECT! - Maybe a bad dump?\n");
+            if (EmulatorConfig.debug_msg_enable)
+                showconsole = 1;
+        }
     }
 
     ConsolePrint("Checking Nintendo logo... ");
@@ -694,7 +730,11 @@ void GB_Cartridge_Unload(void)
         GameBoy.Emulator.enable_boot_rom = 0;
     }
 
-    free(GameBoy.Emulator.Rom_Pointer);
+    // The ROM buffer is owned by the caller of GB_CartridgeLoad()
+    GameBoy.Emulator.Rom_Pointer = NULL;
+
+    gb_rom_fill = NULL;
+    gb_rom_available = 0;
 }
 
 void GB_Cardridge_Set_Filename(const char *filename)
@@ -726,82 +766,41 @@ void GB_Cardridge_Set_Filename(const char *filename)
 
 //--------------------------------------------------------------------------
 
-void GB_RTC_Save(FILE *savefile)
-{
-    if (GameBoy.Emulator.HasTimer == 0)
-        return;
-
-    time_t current_time = time(NULL);
+// The RTC state is stored after the RAM banks in the save file as 12 words
+#define GB_RTC_SAVE_SIZE (12 * sizeof(u32))
 
-    int error = 0;
+static void GB_RTC_Save(u8 *dest)
+{
+    u32 data[12];
 
     // Time
 
-    if (fwrite(&GameBoy.Emulator.Timer.sec, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.Timer.min, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.Timer.hour, 1, 4, savefile) != 4)
-        error = 1;
-
-    u32 days_low = GameBoy.Emulator.Timer.days & 0xFF;
-    u32 days_hi = (GameBoy.Emulator.Timer.days >> 8)
-                  | (GameBoy.Emulator.Timer.halt << 6)
-                  | (GameBoy.Emulator.Timer.carry << 7);
-
-    if (fwrite(&days_low, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&days_hi, 1, 4, savefile) != 4)
-        error = 1;
+    data[0] = GameBoy.Emulator.Timer.sec;
+    data[1] = GameBoy.Emulator.Timer.min;
+    data[2] = GameBoy.Emulator.Timer.hour;
+    data[3] = GameBoy.Emulator.Timer.days & 0xFF;
+    data[4] = (GameBoy.Emulator.Timer.days >> 8)
+              | (GameBoy.Emulator.Timer.halt << 6)
+              | (GameBoy.Emulator.Timer.carry << 7);
 
     // Latched time
 
-    if (fwrite(&GameBoy.Emulator.LatchedTime.sec, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.LatchedTime.min, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.LatchedTime.hour, 1, 4, savefile) != 4)
-        error = 1;
-
-    days_low = GameBoy.Emulator.LatchedTime.days & 0xFF;
-    days_hi = (GameBoy.Emulator.LatchedTime.days >> 8)
+    data[5] = GameBoy.Emulator.LatchedTime.sec;
+    data[6] = GameBoy.Emulator.LatchedTime.min;
+    data[7] = GameBoy.Emulator.LatchedTime.hour;
+    data[8] = GameBoy.Emulator.LatchedTime.days & 0xFF;
+    data[9] = (GameBoy.Emulator.LatchedTime.days >> 8)
               | (GameBoy.Emulator.LatchedTime.halt << 6)
               | (GameBoy.Emulator.LatchedTime.carry << 7);
 
-    if (fwrite(&days_low, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&days_hi, 1, 4, savefile) != 4)
-        error = 1;
-
     // Timestamp
 
-    u32 timestamp_low, timestamp_hi;
-
-    if (sizeof(time_t) == 4)
-    {
-        timestamp_low = current_time;
-        timestamp_hi = 0;
-    }
-    else if (sizeof(time_t) == 8)
-    {
-        timestamp_low = current_time;
-        timestamp_hi = (current_time >> 32);
-    }
-    else // ????
-    {
-        // TODO: Add assert
-        //Debug_ErrorMsg("Invalid size of time_t.");
-        timestamp_low = current_time;
-        timestamp_hi = (current_time >> 32);
-    }
+    u64 current_time = (u64)time(NULL);
 
-    if (fwrite(&timestamp_low, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&timestamp_hi, 1, 4, savefile) != 4)
-        error = 1;
+    data[10] = (u32)current_time;
+    data[11] = (u32)(current_time >> 32);
 
-    if (error)
-        Debug_ErrorMsgArg("Error while saving RTC data!");
+    memcpy(dest, data, sizeof(data));
 }
 
 void GB_RTC_Load(FILE *savefile)
@@ -809,7 +808,7 @@ void GB_RTC_Load(FILE *savefile)
     if (GameBoy.Emulator.HasTimer == 0)
         return;
 
-    u64 current_time = (u64)time(NULL);
+    u64 current_time = Movie_GetTime();
     u64 old_time;
 
     ConsolePrint("Loading RTC data... ");
@@ -909,52 +908,118 @@ void GB_RTC_Load(FILE *savefile)
 
 //--------------------------------------------------------------------------
 
-void GB_SRAM_Save(void)
+// Returns a buffer with the contents of the save file. It has to be freed by
+// the caller.
+static u8 *GB_SRAM_GetData(size_t *size_)
 {
-    if ((GameBoy.Emulator.RAM_Banks == 0) || (GameBoy.Emulator.HasBattery == 0))
-        return;
+    size_t ram_size;
 
-    size_t size = strlen(GameBoy.Emulator.save_filename) + 5;
-    char *name = malloc(size);
-    snprintf(name, size, "%s.sav", GameBoy.Emulator.save_filename);
+    if (GameBoy.Emulator.MemoryController == MEM_MBC2)
+        ram_size = 512; // 512 * 4 bits
+    else
+        ram_size = GameBoy.Emulator.RAM_Banks * 8 * 1024; // Complete banks
 
-    FILE *savefile = fopen(name, "wb+");
+    size_t size = ram_size;
+    if (GameBoy.Emulator.HasTimer)
+        size += GB_RTC_SAVE_SIZE;
 
-    if (!savefile)
-    {
-        Debug_ErrorMsgArg("Couldn't save SRAM.");
-        free(name);
-        return;
-    }
+    u8 *data = malloc(size);
+    if (data == NULL)
+        return NULL;
 
     if (GameBoy.Emulator.MemoryController == MEM_MBC2)
     {
-        // 512 * 4 bits
-        size_t n = fwrite(GameBoy.Memory.ExternRAM[0], 1, 512, savefile);
-        if (n != 512)
-            Debug_ErrorMsgArg("Error while writing SRAM: %zu bytes written.", n);
+        memcpy(data, GameBoy.Memory.ExternRAM[0], 512);
     }
     //else if (((_GB_ROM_HEADER_ *)GameBoy.Emulator.Rom_Pointer)->ram_size == 1)
     //{
     //    // 2 KB
-    //    fwrite(GameBoy.Memory.ExternRAM[0], 1, 2 * 1024, savefile);
+    //    memcpy(data, GameBoy.Memory.ExternRAM[0], 2 * 1024);
     //}
     else
     {
-        // Complete banks
         for (u32 a = 0; a < GameBoy.Emulator.RAM_Banks; a++)
+            memcpy(&data[a * 8 * 1024], GameBoy.Memory.ExternRAM[a], 8 * 1024);
+    }
+
+    if (GameBoy.Emulator.HasTimer)
+        GB_RTC_Save(&data[ram_size]);
+
+    *size_ = size;
+    return data;
+}
+
+static void GB_SRAM_Write(int wait)
+{
+    if (!Movie_SaveWriteAllowed())
+        return;
+
+    size_t size;
+    u8 *data = GB_SRAM_GetData(&size);
+    if (data == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't save SRAM.");
+        return;
+    }
+
+    char name[MAX_PATHLEN + 4];
+    snprintf(name, sizeof(name), "%s.sav", GameBoy.Emulator.save_filename);
+
+    SaveWriter_Write(name, data, size);
+    if (wait)
+        SaveWriter_Flush();
+
+    free(data);
+}
+
+// See GB_SRAM_AutosaveUpdate()
+static int gb_sram_pending = 0; // There are changes that haven't been saved
+static int gb_sram_pending_frames = 0;
+static int gb_sram_idle_frames = 0;
+
+void GB_SRAM_Save(void)
+{
+    if ((GameBoy.Emulator.RAM_Banks == 0) || (GameBoy.Emulator.HasBattery == 0))
+        return;
+
+    // Wait for the write so that the file is complete when this returns
+    GB_SRAM_Write(1);
+
+    GameBoy.Emulator.sram_dirty = 0;
+    gb_sram_pending = 0;
+}
+
+void GB_SRAM_AutosaveUpdate(void)
+{
+    if ((GameBoy.Emulator.RAM_Banks == 0) || (GameBoy.Emulator.HasBattery == 0))
+        return;
+
+    if (GameBoy.Emulator.sram_dirty)
+    {
+        GameBoy.Emulator.sram_dirty = 0;
+        if (gb_sram_pending == 0)
         {
-            size_t n = fwrite(GameBoy.Memory.ExternRAM[a], 1, 8 * 1024, savefile);
-            if (n != (8 * 1024))
-                Debug_ErrorMsgArg("Error while writing SRAM bank %u: %zu bytes written",
-                                  a, n);
+            gb_sram_pending = 1;
+            gb_sram_pending_frames = 0;
         }
+        gb_sram_idle_frames = 0;
+    }
+    else
+    {
+        if (gb_sram_pending == 0)
+            return;
+        gb_sram_idle_frames++;
     }
 
-    GB_RTC_Save(savefile);
+    gb_sram_pending_frames++;
 
-    fclose(savefile);
-    free(name);
+    if ((gb_sram_idle_frames < AUTOSAVE_IDLE_FRAMES)
+        && (gb_sram_pending_frames < AUTOSAVE_MAX_FRAMES))
+        return;
+
+    GB_SRAM_Write(0);
+
+    gb_sram_pending = 0;
 }
 
 void GB_SRAM_Load(void)
@@ -972,7 +1037,7 @@ void GB_SRAM_Load(void)
     char *name = malloc(size);
     snprintf(name, size, "%s.sav", GameBoy.Emulator.save_filename);
 
-    FILE *savefile = fopen(name, "rb");
+    FILE *savefile = Movie_SaveFileOpen(name);
 
     if (!savefile) // No save file...
     {
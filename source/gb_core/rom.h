@@ -62,12 +62,24 @@ typedef struct
 #pragma pack(pop)
 
 int GB_ShowConsoleRequested(void);
+// The ROM isn't copied, so it must remain valid until GB_Cartridge_Unload()
 int GB_CartridgeLoad(const u8 *pointer, const u32 rom_size);
+
+// Called before GB_CartridgeLoad() if only the first "available" bytes of the
+// ROM have been loaded. fill_fn is called to load the rest of the ROM when it
+// is needed, and it returns the number of bytes that can be used after that.
+typedef u32 (*gb_rom_fill_fn)(u32 size);
+void GB_CartridgeSetLazyLoad(u32 available, gb_rom_fill_fn fill_fn);
+// Makes sure that the first "size" bytes of the ROM can be used
+void GB_CartridgeRequestROM(u32 size);
 void GB_Cartridge_Unload(void);
 
 void GB_Cardridge_Set_Filename(const char *filename);
 
 void GB_SRAM_Save(void);
 void GB_SRAM_Load(void);
+// Call once per frame. It writes the save file in the background when the game
+// has modified the cartridge RAM and has stopped writing to it for a while.
+void GB_SRAM_AutosaveUpdate(void);
 
 #endif // GB_ROM__
@@ -21,7 +21,10 @@
 #include "gameboy.h"
 #include "general.h"
 #include "interrupts.h"
+#include "link.h"
+#include "link_socket.h"
 #include "serial.h"
+#include "state.h"
 
 extern _GB_CONTEXT_ GameBoy;
 
@@ -52,6 +55,12 @@ static void GB_SerialSendBit(void)
 
 static int gb_serial_clock_counter = 0;
 
+void GB_SerialStateRegister(void)
+{
+    GB_StateAddBlock(&gb_serial_clock_counter,
+                     sizeof(gb_serial_clock_counter));
+}
+
 void GB_SerialClockCounterReset(void)
 {
     gb_serial_clock_counter = 0;
@@ -119,6 +128,48 @@ int GB_SerialGetClocksToNextEvent(void)
     return 0x7FFFFFFF;
 }
 
+// Returns the number of clocks left until the current transfer ends, if this GB
+// is the one that drives the clock.
+int GB_SerialGetClocksToTransferEnd(void)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    if (GameBoy.Emulator.serial_enabled == 0)
+        return 0x7FFFFFFF;
+
+    if ((mem->IO_Ports[SC_REG - 0xFF00] & 0x01) == 0) // External clock
+        return 0x7FFFFFFF;
+
+    // Each bit is sent after a rising and a falling edge of the clock
+    int bits_left = 7 - (GameBoy.Emulator.serial_transfered_bits & 7);
+    int flips_left = (bits_left * 2)
+                   + ((GameBoy.Emulator.serial_clock_signal == 0) ? 2 : 1);
+
+    return GB_SerialGetClocksToNextEvent()
+           + (flips_left - 1)
+             * GameBoy.Emulator.serial_clocks_to_flip_clock_signal;
+}
+
+// Called when the other end of the cable drives the clock and finishes sending
+// a byte. It only has an effect if a transfer that uses the external clock has
+// been started.
+void GB_SerialExternalByteReceived(int value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    if ((mem->IO_Ports[SC_REG - 0xFF00] & 0x81) != 0x80)
+        return;
+
+    GameBoy.Emulator.serial_enabled = 0;
+
+    mem->IO_Ports[SC_REG - 0xFF00] &= ~0x80;
+    mem->IO_Ports[SB_REG - 0xFF00] = value;
+
+    GB_InterruptsSetFlag(I_SERIAL);
+
+    GB_CPUBreakLoop();
+}
+
 //------------------------------------------------------------------------------
 
 void GB_SerialWriteSB(int reference_clocks, int value)
@@ -514,8 +565,16 @@ void GB_SerialPlug(int device)
             GameBoy.Emulator.SerialRecv_Fn = &GB_RecvPrinter;
             GB_PrinterReset();
             break;
-        case SERIAL_GAMEBOY: // TODO
-            //break;
+        case SERIAL_GAMEBOY:
+            GameBoy.Emulator.SerialSend_Fn = &GB_LinkSend;
+            GameBoy.Emulator.SerialRecv_Fn = &GB_LinkRecv;
+            GB_LinkStart();
+            break;
+        case SERIAL_SOCKET:
+            GameBoy.Emulator.SerialSend_Fn = &GB_LinkSocketSend;
+            GameBoy.Emulator.SerialRecv_Fn = &GB_LinkSocketRecv;
+            GB_LinkSocketStart(EmulatorConfig.serial_socket);
+            break;
         default:
             GameBoy.Emulator.SerialSend_Fn = &GB_SendNone;
             GameBoy.Emulator.SerialRecv_Fn = &GB_RecvNone;
@@ -523,6 +582,15 @@ void GB_SerialPlug(int device)
     }
 }
 
+// The state of the devices isn't part of the snapshots, so they are detached
+// while emulating frames that are going to be discarded. The transfer functions
+// are restored when the snapshot is loaded.
+void GB_SerialDetach(void)
+{
+    GameBoy.Emulator.SerialSend_Fn = &GB_SendNone;
+    GameBoy.Emulator.SerialRecv_Fn = &GB_RecvNone;
+}
+
 //------------------------------------------------------------------------------
 
 void GB_SerialInit(void)
@@ -613,7 +681,8 @@ void GB_SerialEnd(void)
         GB_PrinterReset();
 
     if (GameBoy.Emulator.serial_device == SERIAL_GAMEBOY)
-    {
-        // TODO
-    }
+        GB_LinkEnd();
+
+    if (GameBoy.Emulator.serial_device == SERIAL_SOCKET)
+        GB_LinkSocketEnd();
 }
@@ -10,6 +10,9 @@
 void GB_SerialClockCounterReset(void);
 void GB_SerialUpdateClocksCounterReference(int reference_clocks);
 int GB_SerialGetClocksToNextEvent(void);
+int GB_SerialGetClocksToTransferEnd(void);
+
+void GB_SerialExternalByteReceived(int value);
 
 void GB_SerialWriteSB(int reference_clocks, int value);
 void GB_SerialWriteSC(int reference_clocks, int value);
@@ -18,5 +21,8 @@ void GB_SerialInit(void);
 void GB_SerialEnd(void);
 
 void GB_SerialPlug(int device);
+void GB_SerialDetach(void);
+
+void GB_SerialStateRegister(void);
 
 #endif // GB_SERIAL__
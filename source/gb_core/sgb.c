@@ -191,6 +191,8 @@ void SGB_Init(void)
     memset(SGBInfo.tile_map, 0, 32 * 32 * 4);
 
     memset(SGBInfo.data, 0, sizeof(SGBInfo.data));
+
+    SGB_ScreenDrawBorder();
 }
 
 // For delay between frames (not used for now)
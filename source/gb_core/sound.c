@@ -18,6 +18,7 @@
 #include "gameboy.h"
 #include "general.h"
 #include "memory.h"
+#include "state.h"
 
 // Quite a big buffer, but it works fine this way.  The bigger, the less
 // possibilities to underflow, but the more delay between actions and sound
@@ -194,6 +195,7 @@ typedef struct
 
     s16 buffer[GB_SAMPLE_RATE];
     u32 buffer_write_ptr;
+    u32 buffer_hash_ptr; // Samples before this one have been hashed
 
     // Some temporary variables to avoid doing the same calculations every time
     // a sample is going to be generated:
@@ -209,6 +211,12 @@ static _GB_SOUND_HARDWARE_ Sound;
 
 static int output_enabled;
 
+void GB_SoundStateRegister(void)
+{
+    GB_StateAddBlock(GB_WavePattern, sizeof(GB_WavePattern));
+    GB_StateAddBlock(&Sound, sizeof(Sound));
+}
+
 int GB_SoundHardwareIsOn(void)
 {
     return Sound.master_enable;
@@ -263,6 +271,7 @@ size_t GB_SoundGetSamplesFrame(void *buffer, size_t buffer_size)
 
     // Reset pointer
     Sound.buffer_write_ptr = 0;
+    Sound.buffer_hash_ptr = 0;
 
     return copy_size;
 }
@@ -270,6 +279,17 @@ size_t GB_SoundGetSamplesFrame(void *buffer, size_t buffer_size)
 void GB_SoundResetBufferPointers(void)
 {
     Sound.buffer_write_ptr = 0;
+    Sound.buffer_hash_ptr = 0;
+}
+
+u64 GB_SoundHash(void)
+{
+    u32 start = Sound.buffer_hash_ptr;
+    u32 size = (Sound.buffer_write_ptr - start) * sizeof(s16);
+
+    Sound.buffer_hash_ptr = Sound.buffer_write_ptr;
+
+    return hash_data(&Sound.buffer[start], size, HASH_INIT);
 }
 
 void GB_SoundInit(void)
@@ -16,9 +16,13 @@ void GB_SoundUpdate(u32 clocks);
 void GB_SoundRegWrite(u32 address, u32 value);
 void GB_SoundResetBufferPointers(void);
 void GB_SoundEnd(void);
+void GB_SoundStateRegister(void);
 void GB_SoundSaveToWAV(void);
 size_t GB_SoundGetSamplesFrame(void *buffer, size_t buffer_size);
 void GB_SoundResetBufferPointers(void);
+// Hash of the samples generated since the last call (or since the buffer was
+// emptied). It doesn't remove them from the buffer.
+u64 GB_SoundHash(void);
 
 void GB_SoundClockCounterReset(void);
 void GB_SoundUpdateClocksCounterReference(int reference_clocks);
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../debug_utils.h"
+
+#include "camera.h"
+#include "cpu.h"
+#include "dma.h"
+#include "gameboy.h"
+#include "interrupts.h"
+#include "ppu.h"
+#include "serial.h"
+#include "sgb.h"
+#include "sound.h"
+#include "state.h"
+#include "video.h"
+
+extern _GB_CONTEXT_ GameBoy;
+
+typedef struct {
+    void *ptr;
+    size_t size;
+} _gb_state_block_;
+
+#define GB_STATE_MAX_BLOCKS (64)
+
+static _gb_state_block_ gb_state_blocks[GB_STATE_MAX_BLOCKS];
+static int gb_state_num_blocks = 0;
+static size_t gb_state_size = 0;
+
+static u8 *gb_state_buffer = NULL;
+static int gb_state_saved = 0;
+
+void GB_StateAddBlock(void *ptr, size_t size)
+{
+    if (gb_state_num_blocks == GB_STATE_MAX_BLOCKS)
+    {
+        Debug_ErrorMsgArg("%s: Too many blocks", __func__);
+        return;
+    }
+
+    gb_state_blocks[gb_state_num_blocks].ptr = ptr;
+    gb_state_blocks[gb_state_num_blocks].size = size;
+    gb_state_num_blocks++;
+
+    gb_state_size += size;
+}
+
+static void GB_StateInit(void)
+{
+    if (gb_state_num_blocks > 0)
+        return;
+
+    GB_StateAddBlock(&GameBoy, sizeof(GameBoy));
+    GB_StateAddBlock(&SGBInfo, sizeof(SGBInfo));
+
+    GB_CameraStateRegister();
+    GB_CPUStateRegister();
+    GB_DMAStateRegister();
+    GB_PPUStateRegister();
+    GB_SerialStateRegister();
+    GB_SoundStateRegister();
+    GB_TimersStateRegister();
+    GB_VideoStateRegister();
+}
+
+size_t GB_StateSize(void)
+{
+    GB_StateInit();
+
+    return gb_state_size;
+}
+
+void GB_StateSaveTo(void *buffer)
+{
+    GB_StateInit();
+
+    u8 *dst = buffer;
+    for (int i = 0; i < gb_state_num_blocks; i++)
+    {
+        memcpy(dst, gb_state_blocks[i].ptr, gb_state_blocks[i].size);
+        dst += gb_state_blocks[i].size;
+    }
+}
+
+void GB_StateLoadFrom(const void *buffer)
+{
+    GB_StateInit();
+
+    const u8 *src = buffer;
+    for (int i = 0; i < gb_state_num_blocks; i++)
+    {
+        memcpy(gb_state_blocks[i].ptr, src, gb_state_blocks[i].size);
+        src += gb_state_blocks[i].size;
+    }
+}
+
+int GB_StateSave(void)
+{
+    if (gb_state_buffer == NULL)
+    {
+        gb_state_buffer = malloc(GB_StateSize());
+        if (gb_state_buffer == NULL)
+        {
+            Debug_ErrorMsgArg("%s: Not enough memory", __func__);
+            return 1;
+        }
+    }
+
+    GB_StateSaveTo(gb_state_buffer);
+
+    gb_state_saved = 1;
+
+    return 0;
+}
+
+int GB_StateLoad(void)
+{
+    if (!gb_state_saved)
+        return 1;
+
+    GB_StateLoadFrom(gb_state_buffer);
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GB_STATE__
+#define GB_STATE__
+
+#include <stddef.h>
+
+// In-memory snapshot of the emulated system. It contains pointers to buffers of
+// the emulator (like the ROM), so it is only valid while the same ROM is
+// loaded. The screen buffers and the configuration aren't part of it.
+
+// Used by the modules of the core to add their internal state to the snapshot
+void GB_StateAddBlock(void *ptr, size_t size);
+
+// Size of the buffers used by GB_StateSaveTo() and GB_StateLoadFrom()
+size_t GB_StateSize(void);
+void GB_StateSaveTo(void *buffer);
+void GB_StateLoadFrom(const void *buffer);
+
+// Same as the functions above, using a buffer owned by this module.
+// Returns 0 on success
+int GB_StateSave(void);
+// Returns 0 on success, or 1 if there isn't any saved snapshot
+int GB_StateLoad(void);
+
+#endif // GB_STATE__
@@ -11,7 +11,8 @@
 
 #include "../build_options.h"
 #include "../file_utils.h"
-#include "../png_utils.h"
+#include "../general_utils.h"
+#include "../image_writer.h"
 
 #include "debug.h"
 #include "gameboy.h"
@@ -19,6 +20,7 @@
 #include "memory.h"
 #include "sgb.h"
 #include "sound.h"
+#include "state.h"
 #include "video.h"
 
 extern _GB_CONTEXT_ GameBoy;
@@ -88,6 +90,13 @@ static u32 gb_framebuffer_bgpriority[256]; // For GBC
 
 static int window_current_line;
 
+// The framebuffers aren't part of the state. After loading a snapshot they
+// still hold the last frame that has been drawn.
+void GB_VideoStateRegister(void)
+{
+    GB_StateAddBlock(&window_current_line, sizeof(window_current_line));
+}
+
 static u32 gbpalettes[4] = {
     GB_RGB(31, 31, 31), GB_RGB(21, 21, 21), GB_RGB(10, 10, 10), GB_RGB(0, 0, 0)
 };
@@ -1002,13 +1011,16 @@ void GBC_GB_ScreenDrawScanline(u32 y)
 
 //******************************************************************************
 
-u32 SGB_GetPixelColor(u32 x, u32 y, u32 palindex)
-{
-    int pal = SGBInfo.ATF_list[SGBInfo.curr_ATF][(20 * (y >> 3)) + (x >> 3)];
-    return SGBInfo.palette[pal][palindex];
-}
+// The border is only drawn when it changes. SGB_ScreenDrawBorder() marks it as
+// dirty, and it is drawn again at the end of the frame. The opaque pixels of
+// the border that are on top of the GB screen are saved as a list so that they
+// can be drawn every frame without having to decode the tiles again.
+static int sgb_border_dirty = 0;
+static u32 sgb_border_inside_count = 0;
+static u16 sgb_border_inside_offset[20 * 19 * 8 * 8];
+static u16 sgb_border_inside_color[20 * 19 * 8 * 8];
 
-void SGB_ScreenDrawBorder(void)
+static void SGB_ScreenRenderBorder(void)
 {
     for (int i = 0; i < 32; i++)
     {
@@ -1070,10 +1082,10 @@ void SGB_ScreenDrawBorder(void)
             }
         }
     }
-}
 
-void SGB_ScreenDrawBorderInside(void)
-{
+    // Opaque pixels of the part of the border that is over the GB screen
+    sgb_border_inside_count = 0;
+
     for (int i = 6; i < 26; i++)
     {
         for (int j = 4; j < 23; j++)
@@ -1125,11 +1137,11 @@ void SGB_ScreenDrawBorderInside(void)
 
                         if (color != 0)
                         {
-                            color = SGBInfo.palette[pal][color];
-
-                            int temp = ((y + (j << 3)) * 256) + (x + (i << 3));
-                            gb_framebuffer[0][temp] = color;
-                            gb_framebuffer[1][temp] = color;
+                            u32 n = sgb_border_inside_count++;
+                            sgb_border_inside_offset[n] =
+                                    ((y + (j << 3)) * 256) + (x + (i << 3));
+                            sgb_border_inside_color[n] =
+                                    SGBInfo.palette[pal][color];
                         }
                     }
                 //}
@@ -1138,6 +1150,28 @@ void SGB_ScreenDrawBorderInside(void)
     }
 }
 
+void SGB_ScreenDrawBorder(void)
+{
+    sgb_border_dirty = 1;
+}
+
+static void SGB_ScreenDrawBorderInside(void)
+{
+    if (sgb_border_dirty)
+    {
+        sgb_border_dirty = 0;
+        SGB_ScreenRenderBorder();
+    }
+
+    for (u32 n = 0; n < sgb_border_inside_count; n++)
+    {
+        u32 offset = sgb_border_inside_offset[n];
+        u32 color = sgb_border_inside_color[n];
+        gb_framebuffer[0][offset] = color;
+        gb_framebuffer[1][offset] = color;
+    }
+}
+
 void SGB_ScreenDrawScanline(u32 y)
 {
     if (GB_HasToSkipFrame())
@@ -1254,12 +1288,24 @@ void SGB_ScreenDrawScanline(u32 y)
         u8 *wintilemap = (lcd_reg & (1 << 6)) ?
                                 &mem->VideoRAM[0x1C00] : &mem->VideoRAM[0x1800];
 
+        // Palette of each tile of this line in the current attribute file
+        const u32 *attr = &SGBInfo.ATF_list[SGBInfo.curr_ATF][20 * (y >> 3)];
+
+        // Final colors of each tile of this line after applying BGP
+        u32 bg_colors[20][4];
+        for (int t = 0; t < 20; t++)
+        {
+            const u32 *pal = SGBInfo.palette[attr[t]];
+            for (int c = 0; c < 4; c++)
+                bg_colors[t][c] = pal[bg_pal[c]];
+        }
+
         bool increase_win = false;
 
         // Draw BG + window
         for (u32 x = 0; x < 160; x++)
         {
-            u32 color = SGB_GetPixelColor(x, y, bg_pal[0]);
+            u32 color = bg_colors[x >> 3][0];
             bool window_draw = 0;
             bool bg_color0 = false;
 
@@ -1297,7 +1343,7 @@ void SGB_ScreenDrawScanline(u32 y)
 
                             bg_color0 = (color == 0);
 
-                            color = SGB_GetPixelColor(x, y, bg_pal[color]);
+                            color = bg_colors[x >> 3][color];
                             window_draw = true;
                         }
                     }
@@ -1331,7 +1377,7 @@ void SGB_ScreenDrawScanline(u32 y)
 
                 bg_color0 = (color == 0);
 
-                color = SGB_GetPixelColor(x, y, bg_pal[color]);
+                color = bg_colors[x >> 3][color];
             }
 
             gb_framebuffer[gb_cur_fb][base_index + x + 48] = color;
@@ -1422,14 +1468,11 @@ void SGB_ScreenDrawScanline(u32 y)
 
                             if ((x_ >= 0) && (x_ < 160))
                             {
+                                const u32 *pal = SGBInfo.palette[attr[x_ >> 3]];
                                 if (GB_Sprite->Info & (1 << 4))
-                                {
-                                    color = SGB_GetPixelColor(x_, y, spr_pal1[color]);
-                                }
+                                    color = pal[spr_pal1[color]];
                                 else
-                                {
-                                    color = SGB_GetPixelColor(x_, y, spr_pal0[color]);
-                                }
+                                    color = pal[spr_pal0[color]];
 
                                 // If BG has priority and it is enabled...
                                 if ((GB_Sprite->Info & (1 << 7))
@@ -1480,36 +1523,42 @@ int GB_Screen_Init(void)
     return 0;
 }
 
+// Format of the buffer that is being written by the functions below
+static int gb_scr_bytes_per_pixel; // 3 = 24 bit RGB, 4 = 32 bit XRGB
+static int gb_scr_pitch; // Bytes per row
+
+// Frame drawn before shaking it when the rumble is active
+static unsigned char gb_scr_rumble_buffer[256 * 224 * 4];
+
 static void GB_Screen_WritePixel(unsigned char *buffer, int x, int y,
                                  int r, int g, int b)
 {
-    u8 *p = (u8 *)buffer + (y * 160 + x) * 3;
-    *p++ = r;
-    *p++ = g;
-    *p = b;
-}
+    u8 *p = buffer + (y * gb_scr_pitch) + (x * gb_scr_bytes_per_pixel);
 
-static void GB_Screen_WritePixelSGB(unsigned char *buffer, int x, int y,
-                                    int r, int g, int b)
-{
-    u8 *p = (u8 *)buffer + (y * (160 + 96) + x) * 3;
-    *p++ = r;
-    *p++ = g;
-    *p = b;
+    if (gb_scr_bytes_per_pixel == 4)
+    {
+        *(u32 *)p = (r << 16) | (g << 8) | b;
+    }
+    else
+    {
+        *p++ = r;
+        *p++ = g;
+        *p = b;
+    }
 }
 
 static void gb_scr_writebuffer_sgb(unsigned char *buffer)
 {
     int last_fb = gb_cur_fb ^ 1;
-    for (int i = 0; i < 256; i++)
+    for (int j = 0; j < 224; j++)
     {
-        for (int j = 0; j < 224; j++)
+        for (int i = 0; i < 256; i++)
         {
             int data = gb_framebuffer[last_fb][j * 256 + i];
             int r = data & 0x1F;
             int g = (data >> 5) & 0x1F;
             int b = (data >> 10) & 0x1F;
-            GB_Screen_WritePixelSGB(buffer, i, j, r << 3, g << 3, b << 3);
+            GB_Screen_WritePixel(buffer, i, j, r << 3, g << 3, b << 3);
         }
     }
 }
@@ -1517,9 +1566,9 @@ static void gb_scr_writebuffer_sgb(unsigned char *buffer)
 static void gb_scr_writebuffer_dmg_cgb(unsigned char *buffer)
 {
     int last_fb = gb_cur_fb ^ 1;
-    for (int i = 0; i < 160; i++)
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
+        for (int i = 0; i < 160; i++)
         {
             int data = gb_framebuffer[last_fb][j * 256 + i];
             int r = data & 0x1F;
@@ -1532,9 +1581,9 @@ static void gb_scr_writebuffer_dmg_cgb(unsigned char *buffer)
 
 static void gb_scr_writebuffer_dmg_cgb_blur(unsigned char *buffer)
 {
-    for (int i = 0; i < 160; i++)
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
+        for (int i = 0; i < 160; i++)
         {
             int data1 = gb_framebuffer[0][j * 256 + i];
             int r1 = data1 & 0x1F;
@@ -1561,9 +1610,9 @@ static void gb_scr_writebuffer_dmg_cgb_blur(unsigned char *buffer)
 static void gb_scr_writebuffer_dmg_cgb_realcolors(unsigned char *buffer)
 {
     int last_fb = gb_cur_fb ^ 1;
-    for (int i = 0; i < 160; i++)
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
+        for (int i = 0; i < 160; i++)
         {
             int data = gb_framebuffer[last_fb][j * 256 + i];
             int r = data & 0x1F;
@@ -1580,9 +1629,9 @@ static void gb_scr_writebuffer_dmg_cgb_realcolors(unsigned char *buffer)
 
 static void gb_scr_writebuffer_dmg_cgb_blur_realcolors(unsigned char *buffer)
 {
-    for (int i = 0; i < 160; i++)
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
+        for (int i = 0; i < 160; i++)
         {
             int data1 = gb_framebuffer[0][j * 256 + i];
             int r1 = data1 & 0x1F;
@@ -1605,7 +1654,9 @@ static void gb_scr_writebuffer_dmg_cgb_blur_realcolors(unsigned char *buffer)
 
 typedef void (*draw_to_buf_fn)(unsigned char *);
 
-void GB_Screen_WriteBuffer_24RGB(unsigned char *buffer)
+// If pitch is 0 the rows of the buffer are packed
+static void GB_Screen_WriteBuffer(unsigned char *buffer, int bytes_per_pixel,
+                                  int pitch)
 {
     draw_to_buf_fn draw_fn = NULL;
 
@@ -1640,83 +1691,105 @@ void GB_Screen_WriteBuffer_24RGB(unsigned char *buffer)
         }
     }
 
+    int w, h;
+
+    if ((GameBoy.Emulator.HardwareType == HW_SGB)
+        || (GameBoy.Emulator.HardwareType == HW_SGB2))
+    {
+        w = 256;
+        h = 224;
+    }
+    else
+    {
+        w = 160;
+        h = 144;
+    }
+
+    int bpp = bytes_per_pixel;
+    if (pitch == 0)
+        pitch = w * bpp;
+
+    gb_scr_bytes_per_pixel = bpp;
+
     if (GameBoy.Emulator.rumble)
     {
         int rand_ = rand();
         int mov_x = (rand_ % 3) - 1;
         int mov_y = ((rand_ >> 8) % 3) - 1;
 
-        int w, h;
-
-        if ((GameBoy.Emulator.HardwareType == HW_SGB)
-            || (GameBoy.Emulator.HardwareType == HW_SGB2))
-        {
-            w = 256;
-            h = 224;
-        }
-        else
-        {
-            w = 160;
-            h = 144;
-        }
+        // The destination may be locked texture memory, which is write-only
+        // and doesn't keep the previous frame, so every pixel has to be
+        // written. The pixels at the edges are repeated to fill the gap.
+        unsigned char *buf = gb_scr_rumble_buffer;
 
-        unsigned char *buf = malloc(w * h * 3);
-        if (buf == NULL)
-            return;
+        gb_scr_pitch = w * bpp;
         draw_fn(buf);
 
         for (int j = 0; j < h; j++)
         {
+            int y_src = j - mov_y;
+            if (y_src < 0)
+                y_src = 0;
+            else if (y_src >= h)
+                y_src = h - 1;
+
             for (int i = 0; i < w; i++)
             {
-                int y_dst = j + mov_y;
-                if ((y_dst >= 0) && (y_dst < h))
-                {
-                    int x_dst = i + mov_x;
-
-                    if ((x_dst >= 0) && (x_dst < w))
-                    {
-                        int dst = (y_dst * w + x_dst) * 3;
-                        buffer[dst + 0] = buf[(j * w + i) * 3 + 0];
-                        buffer[dst + 1] = buf[(j * w + i) * 3 + 1];
-                        buffer[dst + 2] = buf[(j * w + i) * 3 + 2];
-                    }
-                }
+                int x_src = i - mov_x;
+                if (x_src < 0)
+                    x_src = 0;
+                else if (x_src >= w)
+                    x_src = w - 1;
+
+                memcpy(&buffer[(j * pitch) + (i * bpp)],
+                       &buf[((y_src * w) + x_src) * bpp], bpp);
             }
         }
-
-        free(buf);
     }
     else
     {
+        gb_scr_pitch = pitch;
         draw_fn(buffer);
     }
 }
 
+void GB_Screen_WriteBuffer_24RGB(unsigned char *buffer)
+{
+    GB_Screen_WriteBuffer(buffer, 3, 0);
+}
+
+void GB_Screen_WriteBuffer_32XRGB(void *buffer, int pitch)
+{
+    GB_Screen_WriteBuffer(buffer, 4, pitch);
+}
+
 // -------------------------------------------------------------
 // -------------------------------------------------------------
 //                      SCREENSHOTS
 // -------------------------------------------------------------
 // -------------------------------------------------------------
 
-void GB_Screenshot(void)
+static void GB_ScreenGetSize(int *width, int *height)
 {
-    char *name = FU_GetNewTimestampFilename("gb_screenshot");
-
-    int width, height;
-
     if (GameBoy.Emulator.SGBEnabled)
     {
-        width = 256;
-        height = 224;
+        *width = 256;
+        *height = 224;
     }
     else
     {
-        width = 160;
-        height = 144;
+        *width = 160;
+        *height = 144;
     }
+}
+
+// Returns a buffer from the image writer with the last frame in 24-bit RGB
+static unsigned char *GB_ScreenGetImage(int width, int height)
+{
+    unsigned char *buf_temp = ImageWriter_BufferGet(width * height * 3);
+    if (buf_temp == NULL)
+        return NULL;
 
-    unsigned char *buf_temp = calloc(width * height * 3, 1);
     int last_fb = gb_cur_fb ^ 1;
 
     for (int y = 0; y < height; y++)
@@ -1731,6 +1804,51 @@ void GB_Screenshot(void)
             buf_temp[index + 2] = ((data >> 10) & 0x1F) << 3;
         }
     }
-    Save_PNG(name, buf_temp, width, height, 0);
-    free(buf_temp);
+
+    return buf_temp;
+}
+
+void GB_Screenshot(const char *path)
+{
+    int width, height;
+    GB_ScreenGetSize(&width, &height);
+
+    // The PNG is encoded in the background
+    unsigned char *buf_temp = GB_ScreenGetImage(width, height);
+    if (buf_temp == NULL)
+        return;
+
+    if (path == NULL)
+        path = FU_GetNewTimestampFilename("gb_screenshot");
+
+    ImageWriter_SavePNG(path, buf_temp, width, height, 0);
+}
+
+u64 GB_ScreenHash(void)
+{
+    int width, height;
+    GB_ScreenGetSize(&width, &height);
+
+    int last_fb = gb_cur_fb ^ 1;
+    u64 hash = HASH_INIT;
+
+    for (int y = 0; y < height; y++)
+    {
+        hash = hash_data(&gb_framebuffer[last_fb][y * 256],
+                         width * sizeof(u16), hash);
+    }
+
+    return hash;
+}
+
+void GB_VideoFrameDump(void)
+{
+    int width, height;
+    GB_ScreenGetSize(&width, &height);
+
+    unsigned char *buf_temp = GB_ScreenGetImage(width, height);
+    if (buf_temp == NULL)
+        return;
+
+    ImageWriter_VideoFrame(buf_temp, width, height);
 }
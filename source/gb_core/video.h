@@ -12,6 +12,8 @@
 void GB_SkipFrame(int skip);
 int GB_HasToSkipFrame(void);
 
+void GB_VideoStateRegister(void);
+
 void GB_EnableBlur(int enable);
 void GB_EnableRealColors(int enable);
 
@@ -39,6 +41,12 @@ void SGB_ScreenDrawScanline(u32 y);
 
 // Write to buffer in 24 bit format
 void GB_Screen_WriteBuffer_24RGB(unsigned char *buffer);
-void GB_Screenshot(void);
+// Write to buffer in 32 bit format (0x00RRGGBB). Pitch is in bytes.
+void GB_Screen_WriteBuffer_32XRGB(void *buffer, int pitch);
+// Hash of the last frame that has been drawn
+u64 GB_ScreenHash(void);
+void GB_Screenshot(const char *path); // NULL = Use a timestamp as name
+// Adds the last frame to the video stream of the image writer
+void GB_VideoFrameDump(void);
 
 #endif // GB_VIDEO__
@@ -138,6 +138,10 @@ s32 GBA_ExecuteARM(s32 clocks)
             return clocks;
         }
 
+#ifdef ENABLE_PROFILER
+        s32 profiler_clocks = clocks;
+#endif
+
         //CPU.R[R_PC] &= ~3;
 
         u32 PCseq = ((CPU.OldPC + 4) == CPU.R[R_PC]);
@@ -4954,6 +4958,19 @@ s32 GBA_ExecuteARM(s32 clocks)
             clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
         }
 
+#ifdef ENABLE_PROFILER
+        GBA_CPUProfilerStep(profiler_clocks - clocks, CPU.R[R_PC] + 4, 0);
+#endif
+
+        if (CPU.R[R_PC] < CPU.OldPC) // Backwards jump
+        {
+            if (GBA_CPUIdleLoopCheck(CPU.OldPC, CPU.R[R_PC] + 4))
+            {
+                if (clocks > 0)
+                    clocks = 0;
+            }
+        }
+
         CPU.R[R_PC] += 4;
     }
 
@@ -5,6 +5,7 @@
 // GiiBiiAdvance - GBA/GB emulator
 
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -200,21 +201,72 @@ static void GBA_SWI_RegisterRamReset(void)
     GBA_MemoryWrite16(DISPCNT, 0x0080);
 }
 
+// Returns 1 if the transfer has been done using host pointers, 0 if it has to
+// be done one unit at a time. The source address is only needed for copies.
+static int GBA_SWI_SetFast(u32 src, u32 dst, u32 bytes, int fill, u32 unit)
+{
+    u32 dst_size;
+    u8 *dst_ptr = GBA_MemoryGetHostPointer(dst, &dst_size, 1);
+    if ((dst_ptr == NULL) || (dst_size < bytes))
+        return 0;
+
+    if (fill)
+    {
+        if (unit == 4)
+        {
+            u32 value = GBA_MemoryRead32(src);
+            u32 *ptr = (u32 *)dst_ptr;
+            for (u32 i = 0; i < bytes / 4; i++)
+                ptr[i] = value;
+        }
+        else
+        {
+            u16 value = GBA_MemoryRead16(src);
+            u16 *ptr = (u16 *)dst_ptr;
+            for (u32 i = 0; i < bytes / 2; i++)
+                ptr[i] = value;
+        }
+        return 1;
+    }
+
+    u32 src_size;
+    u8 *src_ptr = GBA_MemoryGetHostPointer(src, &src_size, 0);
+    if ((src_ptr == NULL) || (src_size < bytes))
+        return 0;
+
+    // A forward copy to a destination that overlaps the end of the source
+    // repeats the start of the source. memmove() can't do that.
+    uintptr_t src_start = (uintptr_t)src_ptr;
+    uintptr_t dst_start = (uintptr_t)dst_ptr;
+    if ((dst_start > src_start) && (dst_start < src_start + bytes))
+        return 0;
+
+    memmove(dst_ptr, src_ptr, bytes);
+    return 1;
+}
+
 static void GBA_SWI_CpuSet(void)
 {
     int count = CPU.R[2] & 0x001FFFFF;
+    int fill = CPU.R[2] & BIT(24);
 
     if (CPU.R[2] & BIT(26)) // 32 bit
     {
         CPU.R[0] &= ~3;
         CPU.R[1] &= ~3;
 
-        if (CPU.R[2] & BIT(24)) // Fill
+        if (GBA_SWI_SetFast(CPU.R[0], CPU.R[1], count * 4, fill, 4))
+        {
+            CPU.R[1] += count * 4;
+            if (!fill)
+                CPU.R[0] += count * 4;
+        }
+        else if (fill)
         {
-            u32 fill = GBA_MemoryRead32(CPU.R[0]);
+            u32 value = GBA_MemoryRead32(CPU.R[0]);
             while (count--)
             {
-                GBA_MemoryWrite32(CPU.R[1], fill);
+                GBA_MemoryWrite32(CPU.R[1], value);
                 CPU.R[1] += 4;
             }
         }
@@ -233,12 +285,18 @@ static void GBA_SWI_CpuSet(void)
         CPU.R[0] &= ~1;
         CPU.R[1] &= ~1;
 
-        if (CPU.R[2] & BIT(24)) // Fill
+        if (GBA_SWI_SetFast(CPU.R[0], CPU.R[1], count * 2, fill, 2))
         {
-            u16 fill = GBA_MemoryRead16(CPU.R[0]);
+            CPU.R[1] += count * 2;
+            if (!fill)
+                CPU.R[0] += count * 2;
+        }
+        else if (fill)
+        {
+            u16 value = GBA_MemoryRead16(CPU.R[0]);
             while (count--)
             {
-                GBA_MemoryWrite16(CPU.R[1], fill);
+                GBA_MemoryWrite16(CPU.R[1], value);
                 CPU.R[1] += 2;
             }
         }
@@ -258,15 +316,30 @@ static void GBA_SWI_CpuFastSet(void)
 {
     uint32_t size = (CPU.R[2] & 0x001FFFFF) * sizeof(uint32_t);
     uint32_t end_address = CPU.R[1] + size;
+    int fill = CPU.R[2] & BIT(24);
+
+    // The BIOS always copies blocks of 8 words. Unaligned sources are rotated
+    // when read, so they are left to the slow path.
+    uint32_t total = (size + 31) & ~31;
+    if ((end_address >= CPU.R[1]) && (fill || ((CPU.R[0] & 3) == 0)))
+    {
+        if (GBA_SWI_SetFast(CPU.R[0], CPU.R[1] & ~3, total, fill, 4))
+        {
+            CPU.R[1] += total;
+            if (!fill)
+                CPU.R[0] += total;
+            return;
+        }
+    }
 
-    if (CPU.R[2] & BIT(24)) // Fill
+    if (fill)
     {
-        u32 fill = GBA_MemoryRead32(CPU.R[0]);
+        u32 value = GBA_MemoryRead32(CPU.R[0]);
         while (CPU.R[1] < end_address)
         {
             for (int i = 0; i < 8; i++)
             {
-                GBA_MemoryWrite32(CPU.R[1], fill);
+                GBA_MemoryWrite32(CPU.R[1], value);
                 CPU.R[1] += 4;
             }
         }
@@ -464,159 +537,215 @@ static void GBA_SWI_BitUnPack(void)
     }
 }
 
-static void GBA_SWI_LZ77UnCompWram(void)
+// Helpers for the decompression functions. The source data is read through a
+// host pointer while it stays inside plain memory, and through the normal
+// memory handlers otherwise. The output is decoded to a scratch buffer that is
+// copied to the destination at the end, with the access size of the BIOS
+// function being emulated.
+
+typedef struct
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if (((header >> 4) & 7) != 1)
-    //{
-    //    Debug_DebugMsgArg("SWI 11 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    u32 size = (header >> 8) & 0x00FFFFFF;
-    u8 *buffer = malloc(size + 2);
-    if (buffer == NULL)
+    u32 address;
+    const u8 *ptr;
+    u32 left; // Bytes that can be read from ptr
+} _bios_src_;
+
+static void GBA_BiosSrcInit(_bios_src_ *src, u32 address)
+{
+    src->address = address;
+    src->ptr = GBA_MemoryGetHostPointer(address, &src->left, 0);
+    if (src->ptr == NULL)
+        src->left = 0;
+}
+
+static inline u8 GBA_BiosSrcRead8(_bios_src_ *src)
+{
+    src->address++;
+    if (src->left)
     {
-        Debug_ErrorMsgArg("SWI 11 - Couldn't allocate memory");
-        GBA_ExecutionBreak();
-        return;
+        src->left--;
+        return *src->ptr++;
     }
-    u8 *buffertmp = buffer;
+    return GBA_MemoryRead8(src->address - 1);
+}
+
+static inline void GBA_BiosSrcSkip(_bios_src_ *src, u32 bytes)
+{
+    src->address += bytes;
+    if (src->left >= bytes)
+    {
+        src->ptr += bytes;
+        src->left -= bytes;
+    }
+    else
+    {
+        src->left = 0;
+    }
+}
+
+static inline u16 GBA_BiosSrcRead16(_bios_src_ *src)
+{
+    u16 value;
+    if ((src->left >= 2) && ((src->address & 1) == 0))
+        value = *(const u16 *)src->ptr;
+    else
+        value = GBA_MemoryRead16(src->address);
+    GBA_BiosSrcSkip(src, 2);
+    return value;
+}
+
+static inline u32 GBA_BiosSrcRead32(_bios_src_ *src)
+{
+    u32 value;
+    if ((src->left >= 4) && ((src->address & 3) == 0))
+        value = *(const u32 *)src->ptr;
+    else
+        value = GBA_MemoryRead32(src->address);
+    GBA_BiosSrcSkip(src, 4);
+    return value;
+}
+
+static u8 *gba_bios_scratch;
+static size_t gba_bios_scratch_size;
+
+// The buffer is kept between calls, and cleared so that padding bytes written
+// to the destination are deterministic.
+static u8 *GBA_BiosScratchGet(size_t size)
+{
+    if (size > gba_bios_scratch_size)
+    {
+        u8 *buffer = realloc(gba_bios_scratch, size);
+        if (buffer == NULL)
+            return NULL;
+        gba_bios_scratch = buffer;
+        gba_bios_scratch_size = size;
+    }
+    memset(gba_bios_scratch, 0, size);
+    return gba_bios_scratch;
+}
+
+// Writes "size" bytes (a multiple of "unit") to the destination using accesses
+// of "unit" bytes.
+static void GBA_BiosDstWrite(u32 dst, const u8 *buffer, u32 size, u32 unit)
+{
+    dst &= ~(unit - 1);
+
+    // 8-bit writes only behave like plain memory in EWRAM and IWRAM
+    u32 region = dst >> 24;
+    if ((unit > 1) || (region == 2) || (region == 3))
+    {
+        u32 dst_size;
+        u8 *ptr = GBA_MemoryGetHostPointer(dst, &dst_size, 1);
+        if ((ptr != NULL) && (dst_size >= size))
+        {
+            memcpy(ptr, buffer, size);
+            return;
+        }
+    }
+
+    if (unit == 4)
+    {
+        for (u32 i = 0; i < size; i += 4)
+            GBA_MemoryWrite32(dst + i, *(const u32 *)&buffer[i]);
+    }
+    else if (unit == 2)
+    {
+        for (u32 i = 0; i < size; i += 2)
+            GBA_MemoryWrite16(dst + i, *(const u16 *)&buffer[i]);
+    }
+    else
+    {
+        for (u32 i = 0; i < size; i++)
+            GBA_MemoryWrite8(dst + i, buffer[i]);
+    }
+}
+
+// Returns the number of bytes decoded, or -1 on error
+static s32 GBA_BiosLZ77Decode(_bios_src_ *src, u8 *buffer, u32 size)
+{
     u32 total = 0;
-    while (size > total)
+
+    while (total < size)
     {
-        u8 flag = GBA_MemoryRead8(src++);
-        for (int i = 0; i < 8; i++)
+        u8 flag = GBA_BiosSrcRead8(src);
+        for (int i = 0; (i < 8) && (total < size); i++)
         {
             if (flag & 0x80)
             {
                 // Compressed - Copy N+3 Bytes from Dest-Disp-1 to Dest
-                u16 info = ((u16)GBA_MemoryRead8(src++)) << 8;
-                info |= (u16)GBA_MemoryRead8(src++);
-                u32 displacement = (info & 0x0FFF);
-                int num = 3 + ((info >> 12) & 0xF);
-                u32 offset = total - displacement - 1;
-                if (offset > total) // This also checks for negative values
-                {
-                    Debug_ErrorMsgArg("SWI 11 - Error while decoding");
-                    GBA_ExecutionBreak();
-                    free(buffer);
-                    return;
-                }
-                while (num--)
-                {
-                    *buffertmp++ = ((u8 *)buffer)[offset++];
-                    total++;
-                    if (size <= total)
-                        break;
-                }
+                u32 info = ((u32)GBA_BiosSrcRead8(src)) << 8;
+                info |= (u32)GBA_BiosSrcRead8(src);
+                u32 displacement = info & 0x0FFF;
+                u32 num = 3 + ((info >> 12) & 0xF);
+
+                if (displacement + 1 > total)
+                    return -1;
+
+                if (num > size - total)
+                    num = size - total;
+
+                // Byte by byte, the regions overlap if displacement < num
+                const u8 *from = &buffer[total - displacement - 1];
+                u8 *to = &buffer[total];
+                for (u32 j = 0; j < num; j++)
+                    to[j] = from[j];
+                total += num;
             }
             else
             {
                 // Uncompressed - Copy 1 Byte from Source to Dest
-                *buffertmp++ = GBA_MemoryRead8(src++);
-                total++;
-                if (size <= total)
-                    break;
+                buffer[total++] = GBA_BiosSrcRead8(src);
             }
             flag <<= 1;
         }
     }
-    // Copy to destination in 8 bit blocks
-    u8 *dstbuf = buffer;
-    while (size--)
-        GBA_MemoryWrite8(dst++, *dstbuf++);
-    free(buffer);
+
+    return total;
 }
 
-static void GBA_SWI_LZ77UnCompVram(void)
+static void GBA_SWI_LZ77UnComp(u32 unit, int swi)
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
+    _bios_src_ src;
+    GBA_BiosSrcInit(&src, CPU.R[0]);
 
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if (((header >> 4) & 7) != 1)
-    //{
-    //    Debug_DebugMsgArg("SWI 12 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
+    u32 header = GBA_BiosSrcRead32(&src);
     u32 size = (header >> 8) & 0x00FFFFFF;
-    u16 *buffer = malloc(size + 2);
+    u32 padded_size = (size + unit - 1) & ~(unit - 1);
+
+    u8 *buffer = GBA_BiosScratchGet(padded_size);
     if (buffer == NULL)
     {
-        Debug_ErrorMsgArg("SWI 12 - Couldn't allocate memory");
+        Debug_ErrorMsgArg("SWI %02X - Couldn't allocate memory", swi);
         GBA_ExecutionBreak();
         return;
     }
-    u8 *buffertmp = (u8 *)buffer;
-    u32 total = 0;
-    while (size > total)
-    {
-        u8 flag = GBA_MemoryRead8(src++);
-        for (int i = 0; i < 8; i++)
-        {
-            if (flag & 0x80)
-            {
-                // Compressed - Copy N+3 Bytes from Dest-Disp-1 to Dest
-                u16 info = ((u16)GBA_MemoryRead8(src++)) << 8;
-                info |= (u16)GBA_MemoryRead8(src++);
-                u32 displacement = (info & 0x0FFF);
-                int num = 3 + ((info >> 12) & 0xF);
-                u32 offset = total - displacement - 1;
-                if (offset > total) // This also checks for negative values
-                {
-                    Debug_ErrorMsgArg("SWI 12 - Error while decoding");
-                    GBA_ExecutionBreak();
-                    free(buffer);
-                    return;
-                }
-                while (num--)
-                {
-                    *buffertmp++ = ((u8 *)buffer)[offset++];
-                    total++;
-                    if (size <= total)
-                        break;
-                }
-            }
-            else
-            {
-                // Uncompressed - Copy 1 Byte from Source to Dest
-                *buffertmp++ = GBA_MemoryRead8(src++);
-                total++;
-                if (size <= total)
-                    break;
-            }
-            flag <<= 1;
-        }
-    }
-    // Copy to destination in 16 bit blocks
-    u16 *dstbuf = buffer;
-    while (size > 0)
+
+    if (GBA_BiosLZ77Decode(&src, buffer, size) < 0)
     {
-        GBA_MemoryWrite16(dst, *dstbuf++);
-        dst += 2;
-        size -= 2;
+        Debug_ErrorMsgArg("SWI %02X - Error while decoding", swi);
+        GBA_ExecutionBreak();
+        return;
     }
-    free(buffer);
+
+    GBA_BiosDstWrite(CPU.R[1], buffer, padded_size, unit);
+}
+
+static void GBA_SWI_LZ77UnCompWram(void)
+{
+    GBA_SWI_LZ77UnComp(1, 0x11); // Copy to destination in 8 bit blocks
+}
+
+static void GBA_SWI_LZ77UnCompVram(void)
+{
+    GBA_SWI_LZ77UnComp(2, 0x12); // Copy to destination in 16 bit blocks
 }
 
 static void GBA_SWI_HuffUnComp(void)
 {
-    int src = CPU.R[0] & ~3;
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if (((header >> 4) & 7) != 2)
-    //{
-    //    Debug_DebugMsgArg("SWI 13 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
+    _bios_src_ src;
+    GBA_BiosSrcInit(&src, CPU.R[0] & ~3);
+
+    u32 header = GBA_BiosSrcRead32(&src);
     int chunk_size = header & 0xF; // In bits
     if ((chunk_size != 4) && (chunk_size != 8))
     {
@@ -624,308 +753,228 @@ static void GBA_SWI_HuffUnComp(void)
         GBA_ExecutionBreak();
         return;
     }
-    int size = (header >> 8) & 0x00FFFFFF;
-    u32 *buffer = malloc(size + 2);
+    u32 size = (header >> 8) & 0x00FFFFFF;
+    u32 padded_size = (size + 3) & ~3;
+
+    u8 *buffer = GBA_BiosScratchGet(padded_size);
     if (buffer == NULL)
     {
         Debug_ErrorMsgArg("SWI 13 - Couldn't allocate memory");
         GBA_ExecutionBreak();
         return;
     }
-    u8 *buffertmp = (u8 *)buffer;
 
-    u32 treesize = (((u32)GBA_MemoryRead8(src++)) * 2) + 1;
-    u32 treetable = src;
-    src += treesize; // Bitstream
-    int total = 0;
+    u32 treesize = (((u32)GBA_BiosSrcRead8(&src)) * 2) + 1;
+    u32 treetable = src.address;
+
+    // Keep a local copy of the tree. Node offsets can point up to 0x3F * 2 + 3
+    // bytes after the end of the tree, so copy a bit more than its size.
+    u8 tree[512 + 0x80];
+    u32 tree_start = treetable & ~1;
+    {
+        _bios_src_ tree_src;
+        GBA_BiosSrcInit(&tree_src, tree_start);
+        for (u32 i = 0; i < sizeof(tree); i++)
+            tree[i] = GBA_BiosSrcRead8(&tree_src);
+    }
+
+    GBA_BiosSrcSkip(&src, treesize); // Bitstream
+
+    u32 total = 0;
     int bit4index = 0;
     int bitsleft = 0;
     u32 bitstream = 0;
+    u8 *buffertmp = buffer;
 
-    while (1)
+    while (total < size)
     {
-        int searching = 1;
         u32 nodeaddr = treetable;
-        while (searching)
+        u8 nodeinfo;
+        while (1)
         {
             if (bitsleft == 0)
             {
-                bitstream = GBA_MemoryRead32(src);
-                src += 4;
+                bitstream = GBA_BiosSrcRead32(&src);
                 bitsleft = 32;
             }
-            int node = bitstream >> 31; // Get bit 31
-            //Debug_DebugMsgArg("Node %d", node);
+            u32 node = bitstream >> 31; // Get bit 31
             bitstream <<= 1;
             bitsleft--;
-            u8 nodeinfo = GBA_MemoryRead8(nodeaddr);
-            if (node && (nodeinfo & BIT(6)))
-                searching = 0;
-            if ((node == 0) && (nodeinfo & BIT(7)))
-                searching = 0;
-            nodeaddr = (nodeaddr & ~1)
-                       + ((int)(nodeinfo & 0x3F)) * 2 + 2 + node;
+
+            u32 index = nodeaddr - tree_start;
+            if (index < sizeof(tree))
+                nodeinfo = tree[index];
+            else
+                nodeinfo = GBA_MemoryRead8(nodeaddr);
+
+            int leaf = node ? (nodeinfo & BIT(6)) : (nodeinfo & BIT(7));
+            nodeaddr = (nodeaddr & ~1) + ((u32)(nodeinfo & 0x3F)) * 2 + 2 + node;
+            if (leaf)
+                break;
         }
-        //Debug_DebugMsgArg("Data: %02X", GBA_MemoryRead8(nodeaddr));
+
+        u32 index = nodeaddr - tree_start;
+        u8 data = (index < sizeof(tree)) ? tree[index]
+                                         : GBA_MemoryRead8(nodeaddr);
+
         if (chunk_size == 8)
         {
-            *buffertmp++ = GBA_MemoryRead8(nodeaddr);
+            *buffertmp++ = data;
             total++;
         }
         else //if (chunk_size == 4)
         {
             if (bit4index & 1)
             {
-                *buffertmp |= GBA_MemoryRead8(nodeaddr) << 4;
+                *buffertmp |= data << 4;
                 buffertmp++;
                 total++;
             }
             else
             {
-                *buffertmp = GBA_MemoryRead8(nodeaddr);
+                *buffertmp = data;
             }
             bit4index ^= 1;
         }
-        if (size <= total)
-            break;
     }
+
     // Copy in 32 bit blocks
-    u32 *dstbuf = buffer;
-    while (size > 0)
-    {
-        GBA_MemoryWrite32(dst, *dstbuf++);
-        dst += 4;
-        size -= 4;
-    }
-    free(buffer);
+    GBA_BiosDstWrite(CPU.R[1], buffer, padded_size, 4);
 }
 
-static void GBA_SWI_RLUnCompWram(void)
+static void GBA_SWI_RLUnComp(u32 unit)
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if (((header >> 4) & 7) != 3)
-    //{
-    //    Debug_DebugMsgArg("SWI 14 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    int size = (header >> 8) & 0x00FFFFFF;
-    while (size > 0)
+    _bios_src_ src;
+    GBA_BiosSrcInit(&src, CPU.R[0]);
+
+    u32 header = GBA_BiosSrcRead32(&src);
+    u32 size = (header >> 8) & 0x00FFFFFF;
+
+    // The last run isn't clipped to the size in the header, so it may write up
+    // to 0x82 bytes past the end.
+    u8 *buffer = GBA_BiosScratchGet(size + 0x82 + 1);
+    if (buffer == NULL)
+    {
+        Debug_ErrorMsgArg("SWI %02X - Couldn't allocate memory",
+                          (unit == 1) ? 0x14 : 0x15);
+        GBA_ExecutionBreak();
+        return;
+    }
+
+    u32 total = 0;
+    while (total < size)
     {
-        u8 flg = GBA_MemoryRead8(src);
-        src++;
+        u8 flg = GBA_BiosSrcRead8(&src);
         if (flg & BIT(7)) // Compressed - 1 byte repeated N times
         {
-            int len = (flg & 0x7F) + 3;
-            u8 data = GBA_MemoryRead8(src);
-            src++;
-            while (len)
-            {
-                GBA_MemoryWrite8(dst, data);
-                dst++;
-                size--;
-                len--;
-            }
+            u32 len = (flg & 0x7F) + 3;
+            u8 data = GBA_BiosSrcRead8(&src);
+            memset(&buffer[total], data, len);
+            total += len;
         }
         else // N uncompressed bytes
         {
-            int len = (flg & 0x7F) + 1;
-            while (len)
-            {
-                GBA_MemoryWrite8(dst, GBA_MemoryRead8(src));
-                src++;
-                dst++;
-                size--;
-                len--;
-            }
+            u32 len = (flg & 0x7F) + 1;
+            for (u32 i = 0; i < len; i++)
+                buffer[total++] = GBA_BiosSrcRead8(&src);
         }
     }
+
+    // Halfwords are only written once both bytes are available
+    GBA_BiosDstWrite(CPU.R[1], buffer, total & ~(unit - 1), unit);
+}
+
+static void GBA_SWI_RLUnCompWram(void)
+{
+    GBA_SWI_RLUnComp(1);
 }
 
 static void GBA_SWI_RLUnCompVram(void)
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if (((header >> 4) & 7) != 3)
-    //{
-    //    Debug_DebugMsgArg("SWI 15 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    int size = (header >> 8) & 0x00FFFFFF;
-
-    u16 writedata = 0;
-    int curbyte = 0;
-
-    while (size > 0)
+    GBA_SWI_RLUnComp(2);
+}
+
+static void GBA_SWI_Diff8bitUnFilter(u32 unit)
+{
+    _bios_src_ src;
+    GBA_BiosSrcInit(&src, CPU.R[0]);
+
+    u32 header = GBA_BiosSrcRead32(&src);
+    u32 size = (header >> 8) & 0x00FFFFFF;
+
+    // At least one unit is always written. In 8-bit mode, the first byte is
+    // written before checking the size, so it's at least two bytes.
+    if (unit == 1)
     {
-        u8 flg = GBA_MemoryRead8(src);
-        src++;
-        if (flg & BIT(7)) // Compressed - 1 byte repeated N times
-        {
-            int len = (flg & 0x7F) + 3;
-            u8 data = GBA_MemoryRead8(src);
-            src++;
-            while (len)
-            {
-                if (curbyte & 1)
-                {
-                    writedata |= ((u16)data) << 8;
-                    GBA_MemoryWrite16(dst, writedata);
-                    dst += 2;
-                    writedata = 0;
-                }
-                else
-                {
-                    writedata = (u16)data;
-                }
-                curbyte ^= 1;
-                size--;
-                len--;
-            }
-        }
-        else // N uncompressed bytes
-        {
-            int len = (flg & 0x7F) + 1;
-            while (len)
-            {
-                if (curbyte & 1)
-                {
-                    writedata |= ((u16)GBA_MemoryRead8(src)) << 8;
-                    src++;
-                    GBA_MemoryWrite16(dst, writedata);
-                    dst += 2;
-                    writedata = 0;
-                }
-                else
-                {
-                    writedata = (u16)GBA_MemoryRead8(src);
-                    src++;
-                }
-                curbyte ^= 1;
-                size--;
-                len--;
-            }
-        }
+        if (size < 2)
+            size = 2;
     }
+    else
+    {
+        size = (size + 1) & ~1;
+        if (size < 2)
+            size = 2;
+    }
+
+    u8 *buffer = GBA_BiosScratchGet(size);
+    if (buffer == NULL)
+    {
+        Debug_ErrorMsgArg("SWI %02X - Couldn't allocate memory",
+                          (unit == 1) ? 0x16 : 0x17);
+        GBA_ExecutionBreak();
+        return;
+    }
+
+    u8 value = 0;
+    for (u32 i = 0; i < size; i++)
+    {
+        value += GBA_BiosSrcRead8(&src);
+        buffer[i] = value;
+    }
+
+    GBA_BiosDstWrite(CPU.R[1], buffer, size, unit);
 }
 
 static void GBA_SWI_Diff8bitUnFilterWram(void)
 {
-    u32 src = CPU.R[0];
-    u32 dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if ((header & 3) != 1)
-    //{
-    //    Debug_DebugMsgArg("SWI 16 -- Compression type != 8 bit -- ABORTED");
-    //    return;
-    //}
-    //if (((header >> 4) & 7) != 8)
-    //{
-    //    Debug_DebugMsgArg("SWI 16 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    int size = (header >> 8) & 0x00FFFFFF;
-    u8 value = GBA_MemoryRead8(src);
-    src++;
-    GBA_MemoryWrite8(dst, value);
-    dst++;
-    size--;
-    while (1)
-    {
-        value += GBA_MemoryRead8(src);
-        src++;
-        GBA_MemoryWrite8(dst, value);
-        dst++;
-        size--;
-        if (size <= 0)
-            break;
-    }
+    GBA_SWI_Diff8bitUnFilter(1);
 }
 
 static void GBA_SWI_Diff8bitUnFilterVram(void)
 {
-    u32 src = CPU.R[0];
-    u32 dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if ((header & 3) != 1)
-    //{
-    //    Debug_DebugMsgArg("SWI 17 -- Compression type != 8 bit -- ABORTED");
-    //    return;
-    //}
-    //if (((header >> 4) & 7) != 8)
-    //{
-    //    Debug_DebugMsgArg("SWI 17 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    int size = (header >> 8) & 0x00FFFFFF;
-    u8 value = 0;
-    u16 writeval = 0;
-    int bytewrite = 0;
-    while (1)
-    {
-        value += GBA_MemoryRead8(src);
-        src++;
-
-        if ((bytewrite & 1) == 0)
-        {
-            writeval = (u16)value;
-        }
-        else
-        {
-            writeval |= ((u16)value) << 8;
-            GBA_MemoryWrite16(dst, writeval);
-            dst += 2;
-            size -= 2;
-            if (size <= 0)
-                break;
-        }
-        bytewrite ^= 1;
-    }
+    GBA_SWI_Diff8bitUnFilter(2);
 }
 
 static void GBA_SWI_Diff16bitUnFilter(void)
 {
-    u32 src = CPU.R[0];
-    u32 dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if ((header & 3) != 2)
-    //{
-    //    Debug_DebugMsgArg("SWI 18 -- Compression type != 16 bit -- ABORTED");
-    //    return;
-    //}
-    //if (((header >> 4) & 7) != 8)
-    //{
-    //    Debug_DebugMsgArg("SWI 18 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    int size = (header >> 8) & 0x00FFFFFF;
-    u16 value = GBA_MemoryRead16(src);
-    src += 2;
-    GBA_MemoryWrite16(dst, value);
-    dst += 2;
-    size -= 2;
-    while (1)
+    _bios_src_ src;
+    GBA_BiosSrcInit(&src, CPU.R[0]);
+
+    u32 header = GBA_BiosSrcRead32(&src);
+    u32 size = (header >> 8) & 0x00FFFFFF;
+
+    // The first halfword is written before checking the size
+    size = (size + 1) & ~1;
+    if (size < 4)
+        size = 4;
+
+    u8 *buffer = GBA_BiosScratchGet(size);
+    if (buffer == NULL)
     {
-        value += GBA_MemoryRead16(src);
-        src += 2;
-        GBA_MemoryWrite16(dst, value);
-        dst += 2;
-        size -= 2;
-        if (size <= 0)
-            break;
+        Debug_ErrorMsgArg("SWI 18 - Couldn't allocate memory");
+        GBA_ExecutionBreak();
+        return;
     }
+
+    u16 *buffer16 = (u16 *)buffer;
+    u16 value = 0;
+    for (u32 i = 0; i < size / 2; i++)
+    {
+        value += GBA_BiosSrcRead16(&src);
+        buffer16[i] = value;
+    }
+
+    GBA_BiosDstWrite(CPU.R[1], buffer, size, 2);
 }
 
 static u32 GBA_SWI_ArcTan(u32 r0)
@@ -4,15 +4,19 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stdio.h>
 #include <string.h>
 
 #include "../build_options.h"
 #include "../config.h"
 #include "../debug_utils.h"
+#include "../profiler.h"
 
 #include "cpu.h"
+#include "disassembler.h"
 #include "gba.h"
 #include "memory.h"
+#include "state.h"
 
 //------------------------------------------------------------------------------
 
@@ -257,11 +261,210 @@ void GBA_CPUClearHalted(void)
     gba_halt = 0;
 }
 
+//------------------------------------------------------------------------------
+
+// Idle loop detection
+// -------------------
+//
+// A lot of games wait for VBlank, for a timer or for an interrupt handler to
+// set a flag by polling memory in a tight loop instead of using SWI Halt. If
+// the body of the loop doesn't have side effects and the CPU registers are the
+// same when reaching the branch at the end of the loop in two consecutive
+// iterations, the loop can't exit until something outside of the CPU changes.
+// That can only happen in the next event, so all the clocks up to it can be
+// skipped like in halt mode.
+
+#define IDLE_LOOP_MAX_SIZE (32) // In bytes
+
+static u32 idle_loop_valid;
+static u32 idle_loop_branch_pc;
+static u32 idle_loop_regs[16];
+static u32 idle_loop_cpsr;
+
+void GBA_CPUStateRegister(void)
+{
+    GBA_StateAddBlock(&gba_halt, sizeof(gba_halt));
+    GBA_StateAddBlock(&idle_loop_valid, sizeof(idle_loop_valid));
+    GBA_StateAddBlock(&idle_loop_branch_pc, sizeof(idle_loop_branch_pc));
+    GBA_StateAddBlock(idle_loop_regs, sizeof(idle_loop_regs));
+    GBA_StateAddBlock(&idle_loop_cpsr, sizeof(idle_loop_cpsr));
+}
+
+static void GBA_CPUIdleLoopReset(void)
+{
+    idle_loop_valid = 0;
+}
+
+// Returns 1 if the instruction can't modify memory, the PC or the CPU mode
+static int GBA_IdleLoopIsSafeARM(u32 opcode)
+{
+    if ((opcode >> 28) == 0xF)
+        return 0;
+
+    u32 ident = (opcode >> 25) & 7;
+
+    if (ident == 0 || ident == 1)
+    {
+        if ((ident == 0) && ((opcode & 0x90) == 0x90))
+        {
+            if (((opcode >> 5) & 3) == 0)
+            {
+                if (opcode & BIT(24)) // SWP/SWPB
+                    return 0;
+
+                // MUL, MLA, UMULL, UMLAL, SMULL, SMLAL
+                if ((((opcode >> 16) & 0xF) == R_PC)
+                    || (((opcode >> 12) & 0xF) == R_PC))
+                    return 0;
+
+                return 1;
+            }
+
+            // LDRH, LDRSB, LDRSH. Only pre-indexed loads without writeback.
+            if (!(opcode & BIT(20)) || !(opcode & BIT(24)) || (opcode & BIT(21)))
+                return 0;
+
+            return ((opcode >> 12) & 0xF) != R_PC;
+        }
+
+        if ((opcode & 0x0FFFFFF0) == 0x012FFF10) // BX
+            return 0;
+
+        u32 op = (opcode >> 21) & 0xF;
+        if ((op >= 8) && (op <= 11))
+        {
+            // TST, TEQ, CMP, CMN. Without the S bit, this is MRS or MSR.
+            return (opcode & BIT(20)) != 0;
+        }
+
+        return ((opcode >> 12) & 0xF) != R_PC;
+    }
+    else if (ident == 2 || ident == 3)
+    {
+        if ((ident == 3) && (opcode & BIT(4))) // Undefined
+            return 0;
+
+        // LDR, LDRB. Only pre-indexed loads without writeback.
+        if (!(opcode & BIT(20)) || !(opcode & BIT(24)) || (opcode & BIT(21)))
+            return 0;
+
+        return ((opcode >> 12) & 0xF) != R_PC;
+    }
+
+    // LDM, STM, branches, coprocessor instructions and SWI
+    return 0;
+}
+
+// Returns 1 if the instruction can't modify memory, the PC or the CPU mode
+static int GBA_IdleLoopIsSafeTHUMB(u16 opcode)
+{
+    u16 ident = opcode >> 8;
+
+    if (ident <= 0x43) // Shifts, ADD/SUB/MOV/CMP, ALU operations
+        return 1;
+
+    if (ident <= 0x46) // Hi register ADD, CMP, MOV
+    {
+        u16 Rd = (opcode & 7) | ((opcode >> 4) & 8);
+        return (ident == 0x45) || (Rd != R_PC);
+    }
+
+    if (ident == 0x47) // BX
+        return 0;
+
+    if (ident <= 0x4F) // LDR PC-relative
+        return 1;
+
+    if (ident <= 0x5F) // Load/store with register offset
+        return ((ident >> 1) & 7) >= 3; // Only LDSB, LDR, LDRH, LDRB, LDSH
+
+    if (ident <= 0x8F) // Load/store with immediate offset
+        return (ident & 0x08) != 0; // Only LDR, LDRB, LDRH
+
+    if (ident <= 0x9F) // Load/store SP-relative
+        return (ident & 0x08) != 0; // Only LDR
+
+    if (ident <= 0xB0) // ADD Rd,PC/SP,#nn and ADD SP,#nn
+        return 1;
+
+    // PUSH, POP, LDMIA, STMIA, branches and SWI
+    return 0;
+}
+
+static int GBA_IdleLoopBodyIsSafe(u32 branch_pc, u32 target)
+{
+    if (CPU.EXECUTION_MODE == EXEC_ARM)
+    {
+        u32 opcode = GBA_MemoryReadFast32(branch_pc);
+
+        // Only B, not BL
+        if ((((opcode >> 25) & 7) != 5) || (opcode & BIT(24)))
+            return 0;
+
+        for (u32 address = target; address < branch_pc; address += 4)
+        {
+            if (!GBA_IdleLoopIsSafeARM(GBA_MemoryReadFast32(address)))
+                return 0;
+        }
+    }
+    else
+    {
+        u16 opcode = GBA_MemoryReadFast16(branch_pc);
+
+        // Only conditional and unconditional B, not BL
+        if ((opcode < 0xD000) || (opcode >= 0xE800)
+            || ((opcode >> 9) == (0xDE00 >> 9)))
+            return 0;
+
+        for (u32 address = target; address < branch_pc; address += 2)
+        {
+            if (!GBA_IdleLoopIsSafeTHUMB(GBA_MemoryReadFast16(address)))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+int GBA_CPUIdleLoopCheck(u32 branch_pc, u32 target)
+{
+    if ((target > branch_pc) || ((branch_pc - target) > IDLE_LOOP_MAX_SIZE))
+        return 0;
+
+    // Skipping the loop would also skip the accesses that watchpoints check
+    if (gba_debug_watchpoints_armed)
+        return 0;
+
+    // Only run the analysis of the loop when the state of the CPU hasn't
+    // changed since the last iteration. Loops that do useful work change the
+    // registers, so they are discarded here quickly.
+
+    if (idle_loop_valid && (idle_loop_branch_pc == branch_pc)
+        && (idle_loop_cpsr == CPU.CPSR)
+        && (memcmp(idle_loop_regs, CPU.R, sizeof(idle_loop_regs)) == 0))
+    {
+        idle_loop_valid = 0;
+        return GBA_IdleLoopBodyIsSafe(branch_pc, target);
+    }
+
+    idle_loop_valid = 1;
+    idle_loop_branch_pc = branch_pc;
+    idle_loop_cpsr = CPU.CPSR;
+    memcpy(idle_loop_regs, CPU.R, sizeof(idle_loop_regs));
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
 s32 GBA_Execute(s32 clocks) // Returns total clocks not executed
 {
     if (GBA_CPUGetHalted()) // Execute all clocks
         return 0;
 
+    // Interrupts and DMA can run between two calls to this function
+    GBA_CPUIdleLoopReset();
+
     if (CPU.EXECUTION_MODE == EXEC_ARM)
         return GBA_ExecuteARM(clocks);
     else
@@ -272,3 +475,64 @@ void GBA_ExecutionBreak(void)
 {
     cpu_loop_break = 1;
 }
+
+//------------------------------------------------------------------------------
+
+#ifdef ENABLE_PROFILER
+
+// Profiler keys are the address of the instruction with bit 0 set for THUMB
+
+static void GBA_ProfilerDisassemble(u32 key, char *dest, int dest_size)
+{
+    u32 address = key & ~1;
+
+    if (key & 1)
+        GBA_DisassembleTHUMB(GBA_MemoryReadFast16(address), address,
+                             dest, dest_size);
+    else
+        GBA_DisassembleARM(GBA_MemoryReadFast32(address), address,
+                           dest, dest_size);
+}
+
+static void GBA_ProfilerFormatKey(u32 key, char *dest, int dest_size)
+{
+    snprintf(dest, dest_size, "%08X", key & ~1);
+}
+
+static const char *const gba_profiler_region_names[16] = {
+    "BIOS", "Unused", "EWRAM", "IWRAM", "I/O", "Palette", "VRAM", "OAM",
+    "ROM (WS0)", "ROM (WS0)", "ROM (WS1)", "ROM (WS1)",
+    "ROM (WS2)", "ROM (WS2)", "SRAM", "Unused"
+};
+
+static const _profiler_cpu_info_ gba_profiler_info = {
+    "GBA",
+    GBA_ProfilerDisassemble,
+    GBA_ProfilerFormatKey,
+    gba_profiler_region_names,
+    16
+};
+
+void GBA_CPUProfilerStart(void)
+{
+    Profiler_Start(&gba_profiler_info);
+}
+
+void GBA_CPUProfilerStep(u32 cycles, u32 next_pc, u32 thumb)
+{
+    u32 pc = CPU.OldPC;
+    u32 return_address = pc + (thumb ? 2 : 4);
+
+    Profiler_Instruction(pc | thumb, pc, cycles, (pc >> 24) & 0xF);
+
+    // A call is any jump that leaves the return address in LR. This detects BL
+    // as well as "mov lr, pc" followed by "bx rn".
+    if ((next_pc != return_address)
+        && ((CPU.R[R_LR] & ~1) == return_address))
+    {
+        u32 target_thumb = (CPU.EXECUTION_MODE == EXEC_THUMB) ? 1 : 0;
+        Profiler_Call(next_pc | target_thumb, return_address);
+    }
+}
+
+#endif // ENABLE_PROFILER
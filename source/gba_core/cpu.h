@@ -12,6 +12,7 @@
 extern _cpu_t CPU;
 
 void GBA_CPUInit(void);
+void GBA_CPUStateRegister(void);
 
 void GBA_CPUChangeMode(u32 value);
 
@@ -26,4 +27,14 @@ void GBA_CPUSetHalted(s32 value);
 s32 GBA_CPUGetHalted(void); // 0 = no, 1 = halt, 2 = stop
 void GBA_CPUClearHalted(void);
 
+// Call after a backwards branch is taken. It returns 1 if the loop can't exit
+// until the next event, so the remaining clocks can be skipped.
+int GBA_CPUIdleLoopCheck(u32 branch_pc, u32 target);
+
+#ifdef ENABLE_PROFILER
+void GBA_CPUProfilerStart(void);
+// Call after executing an instruction
+void GBA_CPUProfilerStep(u32 cycles, u32 next_pc, u32 thumb);
+#endif
+
 #endif // GBA_CPU__
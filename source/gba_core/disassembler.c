@@ -5,115 +5,305 @@
 // GiiBiiAdvance - GBA/GB emulator
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../build_options.h"
+#include "../debug_utils.h"
 #include "../font_utils.h"
 
 #include "cpu.h"
+#include "disassembler.h"
 #include "gba.h"
 #include "memory.h"
 #include "shifts.h"
 
+
 //------------------------------------------------------------------------------
 
-#define GBA_MAX_BREAKPOINTS 20
+// Breakpoints are stored in a bitmap with one bit per halfword. It is split in
+// blocks of 1 MB of address space that are only allocated when a breakpoint is
+// added to them, so checking an address is always O(1). PC hooks use another
+// bitmap with the same layout.
 
-static u32 gba_brkpoint_addrlist[GBA_MAX_BREAKPOINTS];
-static int gba_brkpoint_used[GBA_MAX_BREAKPOINTS];
-static int gba_any_breakpoint_used = 0;
+#define GBA_BRKPOINT_BLOCK_SHIFT    (20)
+#define GBA_BRKPOINT_BLOCK_NUM      (1 << (32 - GBA_BRKPOINT_BLOCK_SHIFT))
+#define GBA_BRKPOINT_BLOCK_WORDS    ((1 << GBA_BRKPOINT_BLOCK_SHIFT) / (2 * 32))
 
-int GBA_DebugIsBreakpoint(u32 addr)
+typedef struct {
+    u32 *map[GBA_BRKPOINT_BLOCK_NUM];
+    u32 count[GBA_BRKPOINT_BLOCK_NUM];
+} _gba_addr_bitmap_;
+
+static _gba_addr_bitmap_ gba_brkpoints;
+int gba_debug_breakpoint_count = 0;
+
+static _gba_addr_bitmap_ gba_pc_hooks;
+int gba_debug_pc_hook_count = 0;
+static gba_debug_pc_hook_fn gba_pc_hook_handler = NULL;
+
+static inline u32 *GBA_DebugBitmapWord(_gba_addr_bitmap_ *bitmap, u32 addr,
+                                       u32 *mask)
+{
+    u32 *block = bitmap->map[addr >> GBA_BRKPOINT_BLOCK_SHIFT];
+    if (block == NULL)
+        return NULL;
+
+    u32 index = (addr & ((1 << GBA_BRKPOINT_BLOCK_SHIFT) - 1)) >> 1;
+    *mask = 1u << (index & 31);
+    return &block[index >> 5];
+}
+
+static int GBA_DebugBitmapTest(_gba_addr_bitmap_ *bitmap, u32 addr)
+{
+    u32 mask;
+    u32 *word = GBA_DebugBitmapWord(bitmap, addr, &mask);
+    if (word == NULL)
+        return 0;
+
+    return (*word & mask) ? 1 : 0;
+}
+
+// Returns 1 if the address has been added, 0 if it was already in the bitmap
+// or if there isn't enough memory.
+static int GBA_DebugBitmapAdd(_gba_addr_bitmap_ *bitmap, u32 addr)
 {
-    if (gba_any_breakpoint_used == 0)
+    if (GBA_DebugBitmapTest(bitmap, addr))
         return 0;
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+    u32 block_index = addr >> GBA_BRKPOINT_BLOCK_SHIFT;
+
+    if (bitmap->map[block_index] == NULL)
     {
-        if (gba_brkpoint_used[i])
+        u32 *block = calloc(GBA_BRKPOINT_BLOCK_WORDS, sizeof(u32));
+        if (block == NULL)
         {
-            if (gba_brkpoint_addrlist[i] == addr)
-            {
-                return 1;
-            }
+            Debug_ErrorMsgArg("Couldn't allocate memory for breakpoint.");
+            return 0;
         }
+        bitmap->map[block_index] = block;
     }
-    return 0;
+
+    u32 mask;
+    u32 *word = GBA_DebugBitmapWord(bitmap, addr, &mask);
+    *word |= mask;
+
+    bitmap->count[block_index]++;
+    return 1;
 }
 
-static u32 gba_last_executed_opcode = 1;
+// Returns 1 if the address has been removed, 0 if it wasn't in the bitmap
+static int GBA_DebugBitmapClear(_gba_addr_bitmap_ *bitmap, u32 addr)
+{
+    if (GBA_DebugBitmapTest(bitmap, addr) == 0)
+        return 0;
 
-int GBA_DebugCPUIsBreakpoint(u32 addr)
+    u32 block_index = addr >> GBA_BRKPOINT_BLOCK_SHIFT;
+
+    u32 mask;
+    u32 *word = GBA_DebugBitmapWord(bitmap, addr, &mask);
+    *word &= ~mask;
+
+    bitmap->count[block_index]--;
+    if (bitmap->count[block_index] == 0)
+    {
+        free(bitmap->map[block_index]);
+        bitmap->map[block_index] = NULL;
+    }
+
+    return 1;
+}
+
+static void GBA_DebugBitmapClearAll(_gba_addr_bitmap_ *bitmap)
 {
-    if (gba_any_breakpoint_used == 0)
+    for (int i = 0; i < GBA_BRKPOINT_BLOCK_NUM; i++)
+    {
+        free(bitmap->map[i]);
+        bitmap->map[i] = NULL;
+        bitmap->count[i] = 0;
+    }
+}
+
+int GBA_DebugIsBreakpoint(u32 addr)
+{
+    if (gba_debug_breakpoint_count == 0)
         return 0;
 
+    return GBA_DebugBitmapTest(&gba_brkpoints, addr);
+}
+
+static u32 gba_last_executed_opcode = 1;
+
+int GBA_DebugCPUCheckBreakpoint(u32 addr)
+{
     if (gba_last_executed_opcode == addr)
     {
         gba_last_executed_opcode = 1;
         return 0;
     }
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+    // The hook of an instruction that stops the emulation isn't called again
+    // when the emulation continues.
+    if (gba_debug_pc_hook_count > 0)
     {
-        if (gba_brkpoint_used[i])
-        {
-            if (gba_brkpoint_addrlist[i] == addr)
-            {
-                gba_last_executed_opcode = addr;
-                return 1;
-            }
-        }
+        if (GBA_DebugBitmapTest(&gba_pc_hooks, addr))
+            gba_pc_hook_handler(addr);
     }
+
+    if (GBA_DebugIsBreakpoint(addr))
+    {
+        gba_last_executed_opcode = addr;
+        return 1;
+    }
+
     return 0;
 }
 
 void GBA_DebugAddBreakpoint(u32 addr)
 {
-    if (GBA_DebugIsBreakpoint(addr))
+    if (GBA_DebugBitmapAdd(&gba_brkpoints, addr))
+        gba_debug_breakpoint_count++;
+}
+
+void GBA_DebugClearBreakpoint(u32 addr)
+{
+    if (GBA_DebugBitmapClear(&gba_brkpoints, addr))
+        gba_debug_breakpoint_count--;
+}
+
+void GBA_DebugClearBreakpointAll(void)
+{
+    GBA_DebugBitmapClearAll(&gba_brkpoints);
+    gba_debug_breakpoint_count = 0;
+}
+
+void GBA_DebugPCHookHandlerSet(gba_debug_pc_hook_fn fn)
+{
+    gba_pc_hook_handler = fn;
+}
+
+void GBA_DebugAddPCHook(u32 addr)
+{
+    if (gba_pc_hook_handler == NULL)
         return;
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+    if (GBA_DebugBitmapAdd(&gba_pc_hooks, addr))
+        gba_debug_pc_hook_count++;
+}
+
+void GBA_DebugClearPCHook(u32 addr)
+{
+    if (GBA_DebugBitmapClear(&gba_pc_hooks, addr))
+        gba_debug_pc_hook_count--;
+}
+
+void GBA_DebugClearPCHookAll(void)
+{
+    GBA_DebugBitmapClearAll(&gba_pc_hooks);
+    gba_debug_pc_hook_count = 0;
+}
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+    u32 start;
+    u32 end; // Inclusive
+    int access;
+} _gba_watchpoint_;
+
+static _gba_watchpoint_ *gba_watchpoints;
+static int gba_watchpoint_num;
+static int gba_watchpoint_max;
+
+int gba_debug_watchpoints_armed = 0;
+static int gba_watchpoint_hit = 0;
+
+void GBA_DebugAddWatchpoint(u32 start, u32 end, int access)
+{
+    if (gba_watchpoint_num == gba_watchpoint_max)
     {
-        if (gba_brkpoint_used[i] == 0)
+        int new_max = gba_watchpoint_max ? gba_watchpoint_max * 2 : 16;
+        _gba_watchpoint_ *list =
+                realloc(gba_watchpoints, new_max * sizeof(_gba_watchpoint_));
+        if (list == NULL)
         {
-            gba_brkpoint_addrlist[i] = addr;
-            gba_brkpoint_used[i] = 1;
-            gba_any_breakpoint_used = 1;
+            Debug_ErrorMsgArg("Couldn't allocate memory for watchpoint.");
             return;
         }
+        gba_watchpoints = list;
+        gba_watchpoint_max = new_max;
     }
+
+    _gba_watchpoint_ *w = &gba_watchpoints[gba_watchpoint_num++];
+    w->start = start;
+    w->end = end;
+    w->access = access;
 }
 
-void GBA_DebugClearBreakpoint(u32 addr)
+void GBA_DebugClearWatchpoint(u32 start, u32 end)
 {
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+    for (int i = 0; i < gba_watchpoint_num; i++)
     {
-        if (gba_brkpoint_used[i])
+        if ((gba_watchpoints[i].start == start)
+            && (gba_watchpoints[i].end == end))
         {
-            if (gba_brkpoint_addrlist[i] == addr)
-            {
-                gba_brkpoint_used[i] = 0;
-                break;
-            }
+            gba_watchpoint_num--;
+            gba_watchpoints[i] = gba_watchpoints[gba_watchpoint_num];
+            return;
         }
     }
+}
+
+void GBA_DebugClearWatchpointAll(void)
+{
+    free(gba_watchpoints);
+    gba_watchpoints = NULL;
+    gba_watchpoint_num = 0;
+    gba_watchpoint_max = 0;
+    gba_debug_watchpoints_armed = 0;
+}
+
+int GBA_DebugWatchpointsUsed(void)
+{
+    return gba_watchpoint_num > 0;
+}
+
+void GBA_DebugWatchpointsArm(int arm)
+{
+    gba_debug_watchpoints_armed = arm && (gba_watchpoint_num > 0);
+}
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+void GBA_DebugWatchpointCheck(u32 address, u32 size, int access)
+{
+    u32 last = address + size - 1;
+
+    for (int i = 0; i < gba_watchpoint_num; i++)
     {
-        if (gba_brkpoint_used[i])
+        _gba_watchpoint_ *w = &gba_watchpoints[i];
+
+        if ((w->access & access) == 0)
+            continue;
+
+        if ((address <= w->end) && (last >= w->start))
+        {
+            ConsolePrint("Watchpoint: %s%d [0x%08X] (PC = 0x%08X)\n",
+                         (access & GBA_WATCH_WRITE) ? "Write" : "Read",
+                         size * 8, address, CPU.OldPC);
+
+            // Stop after the instruction that has done the access
+            GBA_ExecutionBreak();
+            GBA_RunFor_ExecutionBreak();
+            gba_watchpoint_hit = 1;
             return;
+        }
     }
-
-    gba_any_breakpoint_used = 0;
 }
 
-void GBA_DebugClearBreakpointAll(void)
+int GBA_DebugWatchpointHit(void)
 {
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
-        gba_brkpoint_used[i] = 0;
-
-    gba_any_breakpoint_used = 0;
+    int hit = gba_watchpoint_hit;
+    gba_watchpoint_hit = 0;
+    return hit;
 }
 
 //------------------------------------------------------------------------------
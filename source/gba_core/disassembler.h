@@ -12,9 +12,48 @@
 void GBA_DebugAddBreakpoint(u32 addr);
 void GBA_DebugClearBreakpoint(u32 addr);
 int GBA_DebugIsBreakpoint(u32 addr);    // Used in debugger
-int GBA_DebugCPUIsBreakpoint(u32 addr); // Used in CPU loop
 void GBA_DebugClearBreakpointAll(void);
 
+// PC hooks call the handler right before the instruction at that address is
+// executed. They don't stop the emulation. They are used by scripts.
+typedef void (*gba_debug_pc_hook_fn)(u32 addr);
+void GBA_DebugPCHookHandlerSet(gba_debug_pc_hook_fn fn);
+void GBA_DebugAddPCHook(u32 addr);
+void GBA_DebugClearPCHook(u32 addr);
+void GBA_DebugClearPCHookAll(void);
+
+extern int gba_debug_breakpoint_count;
+extern int gba_debug_pc_hook_count;
+// Calls the PC hook handler if needed. Returns 1 if there is a breakpoint.
+int GBA_DebugCPUCheckBreakpoint(u32 addr);
+
+// Used in CPU loop
+static inline int GBA_DebugCPUIsBreakpoint(u32 addr)
+{
+    if ((gba_debug_breakpoint_count | gba_debug_pc_hook_count) == 0)
+        return 0;
+    return GBA_DebugCPUCheckBreakpoint(addr);
+}
+
+// Watchpoints stop the emulation after the instruction that accesses any
+// address between start and end (both included).
+
+#define GBA_WATCH_READ  BIT(0)
+#define GBA_WATCH_WRITE BIT(1)
+
+void GBA_DebugAddWatchpoint(u32 start, u32 end, int access);
+void GBA_DebugClearWatchpoint(u32 start, u32 end);
+void GBA_DebugClearWatchpointAll(void);
+int GBA_DebugWatchpointsUsed(void);
+
+// Watchpoints are only checked while the emulation is running, not when the
+// debugger windows read memory.
+extern int gba_debug_watchpoints_armed;
+void GBA_DebugWatchpointsArm(int arm);
+void GBA_DebugWatchpointCheck(u32 address, u32 size, int access);
+// Returns 1 if a watchpoint has stopped the emulation since the last call
+int GBA_DebugWatchpointHit(void);
+
 void GBA_DisassembleARM(u32 opcode, u32 address, char *dest, int dest_size);
 
 void GBA_DisassembleTHUMB(u16 opcode, u32 address, char *dest, int dest_size);
@@ -4,6 +4,9 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stdint.h>
+#include <string.h>
+
 #include "../build_options.h"
 #include "../debug_utils.h"
 
@@ -12,6 +15,7 @@
 #include "gba.h"
 #include "interrupts.h"
 #include "memory.h"
+#include "state.h"
 #include "video.h"
 
 typedef struct
@@ -46,6 +50,40 @@ typedef struct
 
 static _dma_channel_ DMA[4];
 
+// Per-channel differences. Everything else is shared by all channels.
+typedef struct
+{
+    u32 sad;
+    u32 dad;
+    u32 cnt_l;
+    u32 cnt_h;
+
+    u32 count_mask; // 0 chunks means count_mask + 1 chunks
+    u32 src_mask;
+    u32 dst_mask;
+
+    u16 irq_flag;
+} _dma_channel_info_;
+
+static const _dma_channel_info_ DMA_INFO[4] = {
+    {
+        DMA0SAD, DMA0DAD, DMA0CNT_L, DMA0CNT_H,
+        0x3FFF, 0x07FFFFFF, 0x07FFFFFF, BIT(8)
+    },
+    {
+        DMA1SAD, DMA1DAD, DMA1CNT_L, DMA1CNT_H,
+        0x3FFF, 0x0FFFFFFF, 0x07FFFFFF, BIT(9)
+    },
+    {
+        DMA2SAD, DMA2DAD, DMA2CNT_L, DMA2CNT_H,
+        0x3FFF, 0x0FFFFFFF, 0x07FFFFFF, BIT(10)
+    },
+    {
+        DMA3SAD, DMA3DAD, DMA3CNT_L, DMA3CNT_H,
+        0xFFFF, 0x0FFFFFFF, 0x0FFFFFFF, BIT(11)
+    },
+};
+
 //--------------------------------------------------------------------------
 
 static s32 gba_dma_src_add[4] = { // gba_dma_src_add[3] = prohibited
@@ -58,798 +96,271 @@ static s32 gba_dma_dst_add[4] = {
 static int gba_dmaworking = 0;
 static s32 gba_dma_extra_clocks_elapsed = 0;
 
-void GBA_DMA0Setup(void)
+void GBA_DMAStateRegister(void)
+{
+    GBA_StateAddBlock(DMA, sizeof(DMA));
+    GBA_StateAddBlock(&gba_dmaworking, sizeof(gba_dmaworking));
+    GBA_StateAddBlock(&gba_dma_extra_clocks_elapsed,
+                      sizeof(gba_dma_extra_clocks_elapsed));
+}
+
+void GBA_DMASetup(int channel)
 {
-    DMA[0].enabled = 0;
-    DMA[0].starttime = 0;
+    _dma_channel_ *dma = &DMA[channel];
+    const _dma_channel_info_ *info = &DMA_INFO[channel];
 
-    if ((REG_DMA0CNT_H & BIT(15)) == 0)
+    u16 cnt_h = REG_16(info->cnt_h);
+
+    dma->enabled = 0;
+    dma->starttime = 0;
+
+    if ((cnt_h & BIT(15)) == 0)
         return;
 
-    DMA[0].enabled = 1;
+    dma->enabled = 1;
+
+    dma->num_chunks = ((u32)REG_16(info->cnt_l)) & info->count_mask;
+    if (dma->num_chunks == 0)
+        dma->num_chunks = info->count_mask + 1;
+    dma->copywords = cnt_h & BIT(10);
 
-    DMA[0].num_chunks = ((u32)REG_DMA0CNT_L) & 0x3FFF;
-    if (DMA[0].num_chunks == 0)
-        DMA[0].num_chunks = 0x4000;
-    DMA[0].copywords = REG_DMA0CNT_H & BIT(10);
+    u32 align_mask = dma->copywords ? ~3 : ~1;
 
-    DMA[0].srcaddr = REG_DMA0SAD & (DMA[0].copywords ? 0x07FFFFFC : 0x07FFFFFE);
-    DMA[0].dstaddr = REG_DMA0DAD & (DMA[0].copywords ? 0x07FFFFFC : 0x07FFFFFE);
+    dma->srcaddr = REG_32(info->sad) & info->src_mask & align_mask;
+    dma->dstaddr = REG_32(info->dad) & info->dst_mask & align_mask;
 
-    if (DMA[0].copywords)
+    if (dma->copywords)
     {
-        DMA[0].clockstotal =
+        dma->clockstotal =
                 // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq32(DMA[0].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[0].srcaddr)
-                   * (DMA[0].num_chunks - 1))
+                GBA_MemoryGetAccessCyclesNoSeq32(dma->srcaddr) // 1N+(n-1)S
+                + (GBA_MemoryGetAccessCyclesSeq32(dma->srcaddr)
+                   * (dma->num_chunks - 1))
                 // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq32(DMA[0].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[0].dstaddr)
-                   * (DMA[0].num_chunks - 1))
+                + GBA_MemoryGetAccessCyclesNoSeq32(dma->dstaddr) // 1N+(n-1)S
+                + (GBA_MemoryGetAccessCyclesSeq32(dma->dstaddr)
+                   * (dma->num_chunks - 1))
                 // Processing
                 + 2; // 2I
     }
     else
     {
-        DMA[0].clockstotal =
+        dma->clockstotal =
                 // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq16(DMA[0].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[0].srcaddr)
-                   * (DMA[0].num_chunks - 1))
+                GBA_MemoryGetAccessCyclesNoSeq16(dma->srcaddr) // 1N+(n-1)S
+                + (GBA_MemoryGetAccessCyclesSeq16(dma->srcaddr)
+                   * (dma->num_chunks - 1))
                 // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq16(DMA[0].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[0].dstaddr)
-                   * (DMA[0].num_chunks - 1))
+                + GBA_MemoryGetAccessCyclesNoSeq16(dma->dstaddr) // 1N+(n-1)S
+                + (GBA_MemoryGetAccessCyclesSeq16(dma->dstaddr)
+                   * (dma->num_chunks - 1))
                 // Processing
                 + 2; // 2I
     }
-    DMA[0].clocksremaining = DMA[0].clockstotal;
-    DMA[0].srcadd = gba_dma_src_add[(REG_DMA0CNT_H >> 7) & 3];
-    DMA[0].dstadd = gba_dma_dst_add[(REG_DMA0CNT_H >> 5) & 3];
-    if (DMA[0].copywords)
+    if ((dma->srcaddr & 0x08000000) && (dma->dstaddr & 0x08000000))
+        dma->clockstotal += 2; // Processing 4I (only possible in DMA3)
+
+    dma->clocksremaining = dma->clockstotal;
+    dma->srcadd = gba_dma_src_add[(cnt_h >> 7) & 3];
+    dma->dstadd = gba_dma_dst_add[(cnt_h >> 5) & 3];
+    if (dma->copywords)
+    {
+        dma->srcadd <<= 1;
+        dma->dstadd <<= 1;
+    }
+    dma->dst_reload = (((cnt_h >> 5) & 3) == 3);
+    dma->starttime = (cnt_h >> 12) & 3;
+    dma->repeat = cnt_h & BIT(9);
+
+    if (channel == 3)
     {
-        DMA[0].srcadd <<= 1;
-        DMA[0].dstadd <<= 1;
+        if (cnt_h & BIT(11))
+        {
+            Debug_DebugMsgArg("Game Pak DRQ  - DMA3 (not emulated)");
+            GBA_ExecutionBreak();
+        }
+        // Not emulated -- It depends on a pin in the GBA Game Pak
+        // BIT 11: Game Pak DRQ - DMA3 only - (0=Normal, 1=DRQ <from> Game Pak)
+        // BIT 9:  DMA Repeat (0=Off, 1=On) (Must be zero if Bit 11 set)]
     }
-    DMA[0].dst_reload = (((REG_DMA0CNT_H >> 5) & 3) == 3);
-    DMA[0].starttime = (REG_DMA0CNT_H >> 12) & 3;
-    DMA[0].repeat = REG_DMA0CNT_H & BIT(9);
 
-    if (DMA[0].starttime == START_NOW)
+    if (dma->starttime == START_NOW)
     {
         gba_dmaworking = 1;
         GBA_ExecutionBreak();
     }
-    else if (DMA[0].starttime == START_SPECIAL) // Prohibited
+    else if ((dma->starttime == START_SPECIAL) && (channel == 0))
     {
         Debug_DebugMsgArg("DMA 0 in mode 3 - prohibited");
         GBA_ExecutionBreak();
-        DMA[0].enabled = 0;
+        dma->enabled = 0;
     }
+}
 
-#if 0
-    char text[64];
-    snprintf(text,sizeof(text), "DMA0 SETUP\n"
-                                "MODE: %d\n"
-                                "SRC: %08X (%d)\n"
-                                "DST: %08X (%d)\n"
-                                "CHUNK: %08X", DMA[0].starttime,
-                                DMA[0].srcaddr, DMA[0].srcadd, DMA[0].dstaddr,
-                                DMA[0].dstadd, DMA[0].num_chunks);
-    MessageBox(NULL, text, "EMULATION", MB_OK);
-    GBA_ExecutionBreak();
-#endif
+void GBA_DMA0Setup(void)
+{
+    GBA_DMASetup(0);
 }
 
 void GBA_DMA1Setup(void)
 {
-    DMA[1].enabled = 0;
-    DMA[1].starttime = 0;
-
-    if ((REG_DMA1CNT_H & BIT(15)) == 0)
-        return;
-
-    DMA[1].enabled = 1;
-
-    DMA[1].num_chunks = ((u32)REG_DMA1CNT_L) & 0x3FFF;
-    if (DMA[1].num_chunks == 0)
-        DMA[1].num_chunks = 0x4000;
-    DMA[1].copywords = REG_DMA1CNT_H & BIT(10);
-
-    DMA[1].srcaddr = REG_DMA1SAD & (DMA[1].copywords ? 0x0FFFFFFC : 0x0FFFFFFE);
-    DMA[1].dstaddr = REG_DMA1DAD & (DMA[1].copywords ? 0x07FFFFFC : 0x07FFFFFE);
-
-    if (DMA[1].copywords)
-    {
-        DMA[1].clockstotal =
-                // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq32(DMA[1].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[1].srcaddr)
-                   * (DMA[1].num_chunks - 1))
-                // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq32(DMA[1].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[1].dstaddr)
-                   * (DMA[1].num_chunks - 1))
-                // Processing
-                + 2; // 2I
-    }
-    else
-    {
-        DMA[1].clockstotal =
-                // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq16(DMA[1].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[1].srcaddr)
-                   * (DMA[1].num_chunks - 1))
-                // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq16(DMA[1].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[1].dstaddr)
-                   * (DMA[1].num_chunks - 1))
-                // Processing
-                + 2; // 2I
-    }
-    DMA[1].clocksremaining = DMA[1].clockstotal;
-    DMA[1].srcadd = gba_dma_src_add[(REG_DMA1CNT_H >> 7) & 3];
-    DMA[1].dstadd = gba_dma_dst_add[(REG_DMA1CNT_H >> 5) & 3];
-    if (DMA[1].copywords || (DMA[1].starttime == START_SPECIAL))
-    {
-        DMA[1].srcadd <<= 1;
-        DMA[1].dstadd <<= 1;
-    }
-    DMA[1].dst_reload = (((REG_DMA1CNT_H >> 5) & 3) == 3);
-    DMA[1].starttime = (REG_DMA1CNT_H >> 12) & 3;
-    DMA[1].repeat = REG_DMA1CNT_H & BIT(9);
-
-    if (DMA[1].starttime == START_NOW)
-        GBA_ExecutionBreak();
+    GBA_DMASetup(1);
 }
 
 void GBA_DMA2Setup(void)
 {
-    DMA[2].enabled = 0;
-    DMA[2].starttime = 0;
-
-    if ((REG_DMA2CNT_H & BIT(15)) == 0)
-        return;
-
-    DMA[2].enabled = 1;
-
-    DMA[2].num_chunks = ((u32)REG_DMA2CNT_L) & 0x3FFF;
-    if (DMA[2].num_chunks == 0)
-        DMA[2].num_chunks = 0x4000;
-    DMA[2].copywords = REG_DMA2CNT_H & BIT(10);
-
-    DMA[2].srcaddr = REG_DMA2SAD & (DMA[2].copywords ? 0x0FFFFFFC : 0x0FFFFFFE);
-    DMA[2].dstaddr = REG_DMA2DAD & (DMA[2].copywords ? 0x07FFFFFC : 0x07FFFFFE);
-
-    if (DMA[2].copywords)
-    {
-        DMA[2].clockstotal =
-                // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq32(DMA[2].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[2].srcaddr)
-                   * (DMA[2].num_chunks - 1))
-                // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq32(DMA[2].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[2].dstaddr)
-                   * (DMA[2].num_chunks - 1))
-                // Processing
-                + 2; // 2I
-    }
-    else
-    {
-        DMA[2].clockstotal =
-                // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq16(DMA[2].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[2].srcaddr)
-                   * (DMA[2].num_chunks - 1))
-                // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq16(DMA[2].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[2].dstaddr)
-                   * (DMA[2].num_chunks - 1))
-                // Processing
-                + 2; //2I
-    }
-    DMA[2].clocksremaining = DMA[2].clockstotal;
-    DMA[2].srcadd = gba_dma_src_add[(REG_DMA2CNT_H >> 7) & 3];
-    DMA[2].dstadd = gba_dma_dst_add[(REG_DMA2CNT_H >> 5) & 3];
-    if (DMA[2].copywords || (DMA[2].starttime == START_SPECIAL))
-    {
-        DMA[2].srcadd <<= 1;
-        DMA[2].dstadd <<= 1;
-    }
-    DMA[2].dst_reload = (((REG_DMA2CNT_H >> 5) & 3) == 3);
-    DMA[2].starttime = (REG_DMA2CNT_H >> 12) & 3;
-    DMA[2].repeat = REG_DMA2CNT_H & BIT(9);
-
-    if (DMA[2].starttime == START_NOW)
-        GBA_ExecutionBreak();
+    GBA_DMASetup(2);
 }
 
 void GBA_DMA3Setup(void)
 {
-    DMA[3].enabled = 0;
-    DMA[3].starttime = 0;
-
-    if ((REG_DMA3CNT_H & BIT(15)) == 0)
-        return;
-
-    DMA[3].enabled = 1;
-
-    DMA[3].num_chunks = (u32)REG_DMA3CNT_L;
-    if (DMA[3].num_chunks == 0)
-        DMA[3].num_chunks = 0x10000;
-    DMA[3].copywords = REG_DMA3CNT_H & BIT(10);
-
-    DMA[3].srcaddr = REG_DMA3SAD & (DMA[3].copywords ? 0x0FFFFFFC : 0x0FFFFFFE);
-    DMA[3].dstaddr = REG_DMA3DAD & (DMA[3].copywords ? 0x0FFFFFFC : 0x0FFFFFFE);
-
-    if (DMA[3].copywords)
-    {
-        DMA[3].clockstotal =
-                // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq32(DMA[3].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[3].srcaddr)
-                   * (DMA[3].num_chunks - 1))
-                // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq32(DMA[3].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq32(DMA[3].dstaddr)
-                   * (DMA[3].num_chunks - 1))
-                // Processing
-                + 2; // 2I
-    }
-    else
-    {
-        DMA[3].clockstotal =
-                // Read clocks
-                GBA_MemoryGetAccessCyclesNoSeq16(DMA[3].srcaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[3].srcaddr)
-                   * (DMA[3].num_chunks - 1))
-                // Write clocks
-                + GBA_MemoryGetAccessCyclesNoSeq16(DMA[3].dstaddr) // 1N+(n-1)S
-                + (GBA_MemoryGetAccessCyclesSeq16(DMA[3].dstaddr)
-                   * (DMA[3].num_chunks - 1))
-                // Processing
-                + 2; // 2I
-    }
-    if ((DMA[3].srcaddr & 0x08000000) && (DMA[3].dstaddr & 0x08000000))
-        DMA[3].clockstotal += 2; // Processing 4I
-
-    DMA[3].clocksremaining = DMA[3].clockstotal;
-    DMA[3].srcadd = gba_dma_src_add[(REG_DMA3CNT_H >> 7) & 3];
-    DMA[3].dstadd = gba_dma_dst_add[(REG_DMA3CNT_H >> 5) & 3];
-    if (DMA[3].copywords)
-    {
-        DMA[3].srcadd <<= 1;
-        DMA[3].dstadd <<= 1;
-    }
-    DMA[3].dst_reload = (((REG_DMA3CNT_H >> 5) & 3) == 3);
-    DMA[3].starttime = (REG_DMA3CNT_H >> 12) & 3;
-    DMA[3].repeat = REG_DMA3CNT_H & BIT(9);
-
-    if (REG_DMA3CNT_H & BIT(11))
-    {
-        Debug_DebugMsgArg("Game Pak DRQ  - DMA3 (not emulated)");
-        GBA_ExecutionBreak();
-    }
-    // Not emulated -- It depends on a pin in the GBA Game Pak
-    // BIT 11: Game Pak DRQ - DMA3 only - (0=Normal, 1=DRQ <from> Game Pak, DMA3)
-    // BIT 9:  DMA Repeat (0=Off, 1=On) (Must be zero if Bit 11 set)]
-
-    if (DMA[3].starttime == START_NOW)
-    {
-        gba_dmaworking = 1;
-        GBA_ExecutionBreak();
-    }
-#if 0
-    char text[64];
-    snprintf(text, sizeof(text), "DMA3 SETUP\n"
-                                 "MODE: %d\n"
-                                 "SRC: %08X (%d)\n"
-                                 "DST: %08X (%d)\n"
-                                 "CHUNK: %08X" ,DMA[3].starttime,
-                                 DMA[3].srcaddr, DMA[3].srcadd, DMA[3].dstaddr,
-                                 DMA[3].dstadd, DMA[3].num_chunks);
-    MessageBox(NULL, text, "EMULATION", MB_OK);
-    GBA_ExecutionBreak();
-#endif
+    GBA_DMASetup(3);
 }
 
 //--------------------------------------------------------------------------
 
-// Return clocks to finish transfer
-static s32 GBA_DMA0Update(s32 clocks)
+// Copies the whole transfer with a single memcpy() if both source and
+// destination are incrementing and inside plain memory. Returns 1 if the copy
+// has been done, 0 if the caller has to do the transfer one chunk at a time.
+static int GBA_DMACopyFast(_dma_channel_ *dma)
 {
-    if (DMA[0].enabled == 0)
-        return 0x7FFFFFFF;
+    s32 chunk_size = dma->copywords ? 4 : 2;
 
-    if (DMA[0].starttime == START_SPECIAL)
-    {
-        Debug_DebugMsgArg("DMA0, MODE: START_SPECIAL (?)");
-        GBA_ExecutionBreak();
-        DMA[0].enabled = 0;
-        return 0x7FFFFFFF;
-    }
+    if ((dma->srcadd != chunk_size) || (dma->dstadd != chunk_size))
+        return 0;
 
-    if (DMA[0].clocksremaining == DMA[0].clockstotal)
-    {
-        u32 copy = 0;
+    u32 bytes = dma->num_chunks * chunk_size;
+    u32 src_size, dst_size;
 
-        switch (DMA[0].starttime)
-        {
-            case START_NOW:
-            {
-                copy = 1;
-                break;
-            }
-            case START_VBL:
-            {
-                if (screenmode != SCR_VBL)
-                    return 0x7FFFFFFF;
-                if (GBA_ScreenJustChangedMode() == 0)
-                    return 0x7FFFFFFF;
-                copy = 1;
-                break;
-            }
-            case START_HBL:
-            {
-                if (screenmode != SCR_HBL)
-                    return 0x7FFFFFFF;
-                if (GBA_ScreenJustChangedMode() == 0)
-                    return 0x7FFFFFFF;
-                copy = 1;
-                break;
-            }
-            case START_SPECIAL:
-                return 0x7FFFFFFF; // TODO: Not emulated
-            default:
-                break;
-        }
+    u8 *src = GBA_MemoryGetHostPointer(dma->srcaddr, &src_size, 0);
+    if ((src == NULL) || (src_size < bytes))
+        return 0;
 
-        if (copy)
-        {
-            if (DMA[0].copywords) // Copy words
-            {
-                for (u32 i = 0; i < DMA[0].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[0].dstaddr,
-                                      GBA_MemoryRead32(DMA[0].srcaddr));
-                    DMA[0].srcaddr += DMA[0].srcadd;
-                    DMA[0].dstaddr += DMA[0].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (u32 i = 0; i < DMA[0].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[0].dstaddr,
-                                      GBA_MemoryRead16(DMA[0].srcaddr));
-                    DMA[0].srcaddr += DMA[0].srcadd;
-                    DMA[0].dstaddr += DMA[0].dstadd;
-                }
-            }
-        }
-    }
+    u8 *dst = GBA_MemoryGetHostPointer(dma->dstaddr, &dst_size, 1);
+    if ((dst == NULL) || (dst_size < bytes))
+        return 0;
 
-    DMA[0].clocksremaining -= clocks;
+    // A forward copy between overlapping buffers repeats the data of the
+    // start of the source, memcpy() and memmove() don't behave like that.
+    uintptr_t src_start = (uintptr_t)src;
+    uintptr_t dst_start = (uintptr_t)dst;
+    if ((src_start < dst_start + bytes) && (dst_start < src_start + bytes))
+        return 0;
 
-    if (DMA[0].clocksremaining <= 0)
-    {
-        gba_dma_extra_clocks_elapsed = -DMA[0].clocksremaining;
-
-        if (DMA[0].dst_reload)
-            DMA[0].dstaddr = REG_DMA0DAD & (DMA[0].copywords ? ~3 : ~1);
+    memcpy(dst, src, bytes);
 
-        if (REG_DMA0CNT_H & BIT(14))
-            GBA_CallInterrupt(BIT(8)); // Interrupt
+    dma->srcaddr += bytes;
+    dma->dstaddr += bytes;
 
-        if (DMA[0].repeat == 0)
-        {
-            REG_DMA0CNT_H &= ~BIT(15);
-            DMA[0].enabled = 0;
-        }
-        else
-        {
-            DMA[0].clocksremaining = DMA[0].clockstotal;
-
-            if (DMA[0].starttime == START_NOW)
-            {
-                //Debug_DebugMsgArg("DMA 0 immediate mode with repeat bit set.");
-                //GBA_ExecutionBreak();
-                REG_DMA0CNT_H &= ~BIT(15);
-                DMA[0].enabled = 0;
-                return 0x7FFFFFFF;
-            }
-        }
-
-        return 0x7FFFFFFF;
-    }
-
-    gba_dmaworking = 1;
-    return DMA[0].clocksremaining;
+    return 1;
 }
 
-// Return clocks to finish transfer
-static s32 GBA_DMA1Update(s32 clocks)
+static void GBA_DMACopy(_dma_channel_ *dma)
 {
-    if (DMA[1].enabled == 0)
-        return 0x7FFFFFFF;
-
-    if (DMA[1].starttime == START_SPECIAL)
-    {
-        //char text[64];
-        //snprintf(text, sizeof(text), "DMA1, MODE: %d", DMA[1].starttime);
-        //MessageBox(NULL, text, "EMULATION", MB_OK);
-        //GBA_ExecutionBreak();
-        DMA[1].enabled = 0;
-        return 0x7FFFFFFF;
-    }
+    if (GBA_DMACopyFast(dma))
+        return;
 
-    if (DMA[1].clocksremaining == DMA[1].clockstotal)
+    if (dma->copywords) // Copy words
     {
-        u32 copy = 0;
-
-        switch (DMA[1].starttime)
+        for (u32 i = 0; i < dma->num_chunks; i++)
         {
-            case START_NOW:
-            {
-                copy = 1;
-                break;
-            }
-            case START_VBL:
-            {
-                if (screenmode != SCR_VBL)
-                    return 0x7FFFFFFF;
-                if (GBA_ScreenJustChangedMode() == 0)
-                    return 0x7FFFFFFF;
-                copy = 1;
-                break;
-            }
-            case START_HBL:
-            {
-                if (screenmode != SCR_HBL)
-                    return 0x7FFFFFFF;
-                if (GBA_ScreenJustChangedMode() == 0)
-                    return 0x7FFFFFFF;
-                copy = 1;
-                break;
-            }
-            case START_SPECIAL: // TODO: Not emulated
-                return 0x7FFFFFFF;
-            default:
-                break;
-        }
-
-        if (copy)
-        {
-            if (DMA[1].copywords) // Copy words
-            {
-                for (u32 i = 0; i < DMA[1].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[1].dstaddr,
-                                      GBA_MemoryRead32(DMA[1].srcaddr));
-                    DMA[1].srcaddr += DMA[1].srcadd;
-                    DMA[1].dstaddr += DMA[1].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (u32 i = 0; i < DMA[1].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[1].dstaddr,
-                                      GBA_MemoryRead16(DMA[1].srcaddr));
-                    DMA[1].srcaddr += DMA[1].srcadd;
-                    DMA[1].dstaddr += DMA[1].dstadd;
-                }
-            }
+            GBA_MemoryWrite32(dma->dstaddr, GBA_MemoryRead32(dma->srcaddr));
+            dma->srcaddr += dma->srcadd;
+            dma->dstaddr += dma->dstadd;
         }
     }
-
-    DMA[1].clocksremaining -= clocks;
-
-    if (DMA[1].clocksremaining <= 0)
+    else // Copy halfwords
     {
-        gba_dma_extra_clocks_elapsed = -DMA[1].clocksremaining;
-
-        if (DMA[1].dst_reload)
-            DMA[1].dstaddr = REG_DMA0DAD & (DMA[1].copywords ? ~3 : ~1);
-
-        if (REG_DMA1CNT_H & BIT(14)) // Interrupt
-            GBA_CallInterrupt(BIT(9));
-
-        if (DMA[1].repeat == 0)
-        {
-            REG_DMA1CNT_H &= ~BIT(15);
-            DMA[1].enabled = 0;
-        }
-        else
+        for (u32 i = 0; i < dma->num_chunks; i++)
         {
-            DMA[1].clocksremaining = DMA[1].clockstotal;
-
-            if (DMA[1].starttime == START_NOW)
-            {
-                //Debug_DebugMsgArg("DMA 1 immediate mode with repeat bit set.");
-                //GBA_ExecutionBreak();
-                REG_DMA1CNT_H &= ~BIT(15);
-                DMA[1].enabled = 0;
-                return 0x7FFFFFFF;
-            }
+            GBA_MemoryWrite16(dma->dstaddr, GBA_MemoryRead16(dma->srcaddr));
+            dma->srcaddr += dma->srcadd;
+            dma->dstaddr += dma->dstadd;
         }
-
-        return 0x7FFFFFFF;
     }
-
-    gba_dmaworking = 1;
-    return DMA[1].clocksremaining;
-
-#if 0
-    if (DMA[1].enabled == 0)
-        return 0x7FFFFFFF;
-
-    if (DMA[1].starttime != 3)
-    {
-        MessageBox(NULL, "DMA 1 enabled.", "EMULATION", MB_OK);
-        GBA_ExecutionBreak();
-    }
-    REG_DMA1CNT_H &= ~BIT(15);
-    DMA[1].enabled = 0;
-
-    return 0x7FFFFFFF;
-#endif
 }
 
 // Return clocks to finish transfer
-static s32 GBA_DMA2Update(s32 clocks)
+static s32 GBA_DMAChannelUpdate(int channel, s32 clocks)
 {
-    if (DMA[2].enabled == 0)
-        return 0x7FFFFFFF;
+    _dma_channel_ *dma = &DMA[channel];
+    const _dma_channel_info_ *info = &DMA_INFO[channel];
 
-    if (DMA[2].starttime == START_SPECIAL)
-    {
-        //char text[64];
-        //snprintf(text, sizeof(text), "DMA1, MODE: %d", DMA[1].starttime);
-        //MessageBox(NULL, text, "EMULATION", MB_OK);
-        //GBA_ExecutionBreak();
-        DMA[2].enabled = 0;
+    if (dma->enabled == 0)
         return 0x7FFFFFFF;
-    }
-
-    if (DMA[2].clocksremaining == DMA[2].clockstotal)
-    {
-        u32 copy = 0;
-
-        switch (DMA[2].starttime)
-        {
-            case START_NOW:
-            {
-                copy = 1;
-                break;
-            }
-            case START_VBL:
-            {
-                if (screenmode != SCR_VBL)
-                    return 0x7FFFFFFF;
-                if (GBA_ScreenJustChangedMode() == 0)
-                    return 0x7FFFFFFF;
-                copy = 1;
-                break;
-            }
-            case START_HBL:
-            {
-                if (screenmode != SCR_HBL)
-                    return 0x7FFFFFFF;
-                if (GBA_ScreenJustChangedMode() == 0)
-                    return 0x7FFFFFFF;
-                copy = 1;
-                break;
-            }
-            case START_SPECIAL: // TODO: NOt emulated
-                return 0x7FFFFFFF;
-            default:
-                break;
-        }
 
-        if (copy)
-        {
-            if (DMA[2].copywords) // Copy words
-            {
-                for (u32 i = 0; i < DMA[2].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[2].dstaddr,
-                                      GBA_MemoryRead32(DMA[2].srcaddr));
-                    DMA[2].srcaddr += DMA[2].srcadd;
-                    DMA[2].dstaddr += DMA[2].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (u32 i = 0; i < DMA[2].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[2].dstaddr,
-                                      GBA_MemoryRead16(DMA[2].srcaddr));
-                    DMA[2].srcaddr += DMA[2].srcadd;
-                    DMA[2].dstaddr += DMA[2].dstadd;
-                }
-            }
-        }
-    }
-
-    DMA[2].clocksremaining -= clocks;
-
-    if (DMA[2].clocksremaining <= 0)
+    if (dma->starttime == START_SPECIAL)
     {
-        gba_dma_extra_clocks_elapsed = -DMA[2].clocksremaining;
-
-        if (DMA[2].dst_reload)
-            DMA[2].dstaddr = REG_DMA0DAD & (DMA[2].copywords ? ~3 : ~1);
-
-        if (REG_DMA2CNT_H & BIT(14)) // Interrupt
-            GBA_CallInterrupt(BIT(10));
-
-        if (DMA[2].repeat == 0)
+        // DMA1/DMA2 are handled by GBA_DMASoundRequestData()
+        if (channel == 0)
         {
-            REG_DMA2CNT_H &= ~BIT(15);
-            DMA[2].enabled = 0;
+            Debug_DebugMsgArg("DMA0, MODE: START_SPECIAL (?)");
+            GBA_ExecutionBreak();
         }
-        else
+        else if (channel == 3)
         {
-            DMA[2].clocksremaining = DMA[2].clockstotal;
-
-            if (DMA[2].starttime == START_NOW)
-            {
-                //Debug_DebugMsgArg("DMA 2 immediate mode with repeat bit set.");
-                //GBA_ExecutionBreak();
-                REG_DMA2CNT_H &= ~BIT(15);
-                DMA[2].enabled = 0;
-                return 0x7FFFFFFF;
-            }
+            Debug_DebugMsgArg("DMA3, MODE: START_SPECIAL -- NOT EMULATED");
+            GBA_ExecutionBreak();
         }
-
-        return 0x7FFFFFFF;
-    }
-
-    gba_dmaworking = 1;
-    return DMA[2].clocksremaining;
-#if 0
-    if (DMA[2].enabled == 0)
+        dma->enabled = 0;
         return 0x7FFFFFFF;
-
-    if (DMA[2].starttime != 3)
-    {
-        MessageBox(NULL, "DMA 2 enabled.", "EMULATION", MB_OK);
-        GBA_ExecutionBreak();
     }
-    REG_DMA2CNT_H &= ~BIT(15);
-    DMA[2].enabled = 0;
 
-    return 0x7FFFFFFF;
-#endif
-}
-
-// Return clocks to finish transfer
-static s32 GBA_DMA3Update(s32 clocks)
-{
-    if (DMA[3].enabled == 0)
-        return 0x7FFFFFFF;
-
-    if (DMA[3].starttime == START_SPECIAL)
-    {
-        Debug_DebugMsgArg("DMA3, MODE: START_SPECIAL -- NOT EMULATED");
-        GBA_ExecutionBreak();
-        DMA[3].enabled = 0;
-        return 0x7FFFFFFF;
-    }
-
-    if (DMA[3].clocksremaining == DMA[3].clockstotal)
+    if (dma->clocksremaining == dma->clockstotal)
     {
-        u32 copy = 0;
-
-        switch (DMA[3].starttime)
+        switch (dma->starttime)
         {
             case START_NOW:
-            {
-                copy = 1;
                 break;
-            }
             case START_VBL:
-            {
                 if (screenmode != SCR_VBL)
                     return 0x7FFFFFFF;
                 if (GBA_ScreenJustChangedMode() == 0)
                     return 0x7FFFFFFF;
-                copy = 1;
                 break;
-            }
             case START_HBL:
-            {
                 if (screenmode != SCR_HBL)
                     return 0x7FFFFFFF;
                 if (GBA_ScreenJustChangedMode() == 0)
                     return 0x7FFFFFFF;
-                copy = 1;
                 break;
-            }
-            case START_SPECIAL:
-                return 0x7FFFFFFF; // TODO: Not emulated
             default:
-                break;
+                return 0x7FFFFFFF;
         }
 
-        if (copy)
-        {
-            //MessageBox(NULL, "DMA 3 copy", "EMULATION", MB_OK);
-            //GBA_ExecutionBreak();
-
-            //char text[64];
-            //snprintf(text, sizeof(text), "DMA3\n"
-            //                             "SRC: %08X\n"
-            //                             "DST: %08X\n"
-            //                             "CHUNCKS: %08X", DMA[3].srcaddr,
-            //                             DMA[3].dstaddr, DMA[3].num_chunks);
-            //MessageBox(NULL, text, "EMULATION", MB_OK);
-            //GBA_ExecutionBreak();
-
-            if (DMA[3].copywords) // Copy words
-            {
-                for (u32 i = 0; i < DMA[3].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[3].dstaddr,
-                                      GBA_MemoryRead32(DMA[3].srcaddr));
-                    DMA[3].srcaddr += DMA[3].srcadd;
-                    DMA[3].dstaddr += DMA[3].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (u32 i = 0; i < DMA[3].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[3].dstaddr,
-                                      GBA_MemoryRead16(DMA[3].srcaddr));
-                    DMA[3].srcaddr += DMA[3].srcadd;
-                    DMA[3].dstaddr += DMA[3].dstadd;
-                }
-            }
-        }
+        GBA_DMACopy(dma);
     }
 
-    DMA[3].clocksremaining -= clocks;
+    dma->clocksremaining -= clocks;
 
-    if (DMA[3].clocksremaining <= 0)
+    if (dma->clocksremaining <= 0)
     {
-        gba_dma_extra_clocks_elapsed = -DMA[3].clocksremaining;
+        gba_dma_extra_clocks_elapsed = -dma->clocksremaining;
 
-        if (DMA[3].dst_reload)
-            DMA[3].dstaddr = REG_DMA3DAD & (DMA[3].copywords ? ~3 : ~1);
+        if (dma->dst_reload)
+        {
+            dma->dstaddr = REG_32(info->dad) & info->dst_mask
+                           & (dma->copywords ? ~3 : ~1);
+        }
 
-        if (REG_DMA3CNT_H & BIT(14)) // Interrupt
-            GBA_CallInterrupt(BIT(11));
+        if (REG_16(info->cnt_h) & BIT(14)) // Interrupt
+            GBA_CallInterrupt(info->irq_flag);
 
-        if (DMA[3].repeat == 0)
+        if ((dma->repeat == 0) || (dma->starttime == START_NOW))
         {
-            REG_DMA3CNT_H &= ~BIT(15);
-            DMA[3].enabled = 0;
-            //MessageBox(NULL, "DMA 3 clear", "EMULATION", MB_OK);
-            //GBA_ExecutionBreak();
+            REG_16(info->cnt_h) &= ~BIT(15);
+            dma->enabled = 0;
         }
         else
         {
-            DMA[3].clocksremaining = DMA[3].clockstotal;
-
-            if (DMA[3].starttime == START_NOW)
-            {
-                //Debug_DebugMsgArg("WARNING: DMA 3, immediate mode with repeat bit set.");
-                //GBA_ExecutionBreak();
-                REG_DMA3CNT_H &= ~BIT(15);
-                DMA[3].enabled = 0;
-                return 0x7FFFFFFF;
-            }
+            dma->clocksremaining = dma->clockstotal;
         }
 
         return 0x7FFFFFFF;
     }
 
     gba_dmaworking = 1;
-    return DMA[3].clocksremaining;
+    return dma->clocksremaining;
 }
 
 //--------------------------------------------------------------------------
@@ -859,36 +370,13 @@ s32 GBA_DMAUpdate(s32 clocks)
     gba_dma_extra_clocks_elapsed = 0;
     gba_dmaworking = 0;
 
-    s32 tempclocks;
-
-    if (DMA[0].enabled)
+    // Only the channel with the highest priority can run at any given time
+    for (int i = 0; i < 4; i++)
     {
-        tempclocks = GBA_DMA0Update(clocks);
-        if (gba_dmaworking)
-            return tempclocks;
-    }
+        if (DMA[i].enabled == 0)
+            continue;
 
-    if (DMA[1].enabled)
-    {
-        tempclocks = GBA_DMA1Update(clocks);
-        if (gba_dmaworking)
-            return tempclocks;
-    }
-
-    if (DMA[2].enabled)
-    {
-        tempclocks = GBA_DMA2Update(clocks);
-        if (gba_dmaworking)
-            return tempclocks;
-    }
-
-    //if (DMA[3].enabled)
-    //    tempclocks = GBA_DMA3Update(clocks);
-    //if (gba_dmaworking)
-    //    return tempclocks;
-    if (DMA[3].enabled)
-    {
-        tempclocks = GBA_DMA3Update(clocks);
+        s32 tempclocks = GBA_DMAChannelUpdate(i, clocks);
         if (gba_dmaworking)
             return tempclocks;
     }
@@ -922,42 +410,23 @@ void GBA_DMASoundRequestData(int A, int B)
 {
     // This should check if another dma is running and return without copying
 
-    if (DMA[1].starttime == START_SPECIAL)
+    for (int channel = 1; channel <= 2; channel++)
     {
-        if ((A && (DMA[1].dstaddr == FIFO_A))
-            || (B && (DMA[1].dstaddr == FIFO_B)))
-        {
-            // Copy words
-            for (int i = 0; i < 4; i++)
-            {
-                //if (GBA_MemoryRead32(DMA[1].srcaddr) != 0)
-                //    Debug_DebugMsgArg("%08X",DMA[1].srcaddr);
-                //Debug_DebugMsgArg("[%08x]= %08X", DMA[1].srcaddr,
-                //                  GBA_MemoryRead32(DMA[1].srcaddr));
-                //Debug_DebugMsgArg("%08X", GBA_MemoryRead32(DMA[1].srcaddr));
-                GBA_MemoryWrite32(DMA[1].dstaddr,
-                                  GBA_MemoryRead32(DMA[1].srcaddr));
-                DMA[1].srcaddr += DMA[1].srcadd;
-            }
-            if (REG_DMA2CNT_H & BIT(14))
-                GBA_CallInterrupt(BIT(9));
-        }
-    }
+        _dma_channel_ *dma = &DMA[channel];
 
-    if (DMA[2].starttime == START_SPECIAL)
-    {
-        if ((A && (DMA[2].dstaddr == FIFO_A))
-            || (B && (DMA[2].dstaddr == FIFO_B)))
+        if (dma->starttime != START_SPECIAL)
+            continue;
+
+        if ((A && (dma->dstaddr == FIFO_A)) || (B && (dma->dstaddr == FIFO_B)))
         {
             // Copy words
             for (int i = 0; i < 4; i++)
             {
-                GBA_MemoryWrite32(DMA[2].dstaddr,
-                                  GBA_MemoryRead32(DMA[2].srcaddr));
-                DMA[2].srcaddr += DMA[2].srcadd;
+                GBA_MemoryWrite32(dma->dstaddr, GBA_MemoryRead32(dma->srcaddr));
+                dma->srcaddr += dma->srcadd;
             }
-            if (REG_DMA2CNT_H & BIT(14))
-                GBA_CallInterrupt(BIT(10));
+            if (REG_16(DMA_INFO[channel].cnt_h) & BIT(14))
+                GBA_CallInterrupt(DMA_INFO[channel].irq_flag);
         }
     }
 }
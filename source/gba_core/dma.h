@@ -9,6 +9,8 @@
 
 #include "gba.h"
 
+void GBA_DMASetup(int channel); // Reload channel state from its registers
+
 void GBA_DMA0Setup(void);
 void GBA_DMA1Setup(void);
 void GBA_DMA2Setup(void);
@@ -16,6 +18,8 @@ void GBA_DMA3Setup(void);
 
 s32 GBA_DMAUpdate(s32 clocks);
 
+void GBA_DMAStateRegister(void);
+
 int GBA_DMAisWorking(void);
 
 s32 GBA_DMAGetExtraClocksElapsed(void);
@@ -10,10 +10,14 @@
 #include "../build_options.h"
 #include "../debug_utils.h"
 #include "../file_utils.h"
-#include "../png_utils.h"
+#include "../frame_hash.h"
+#include "../image_writer.h"
+#include "../movie.h"
+#include "../profiler.h"
 
 #include "bios.h"
 #include "cpu.h"
+#include "disassembler.h"
 #include "dma.h"
 #include "gba.h"
 #include "interrupts.h"
@@ -21,12 +25,19 @@
 #include "rom.h"
 #include "save.h"
 #include "sound.h"
+#include "state.h"
 #include "timers.h"
 #include "video.h"
 
 static s32 clocks_to_next_event;
 static s32 lastresidualclocks = 0;
 
+void GBA_RunForStateRegister(void)
+{
+    GBA_StateAddBlock(&clocks_to_next_event, sizeof(clocks_to_next_event));
+    GBA_StateAddBlock(&lastresidualclocks, sizeof(lastresidualclocks));
+}
+
 static int inited = 0;
 
 int GBA_ROM_SIZE;
@@ -40,7 +51,7 @@ _cpu_t *GBA_CPUGet(void)
     return &CPU;
 }
 
-int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize)
+int GBA_InitRom(void *bios_ptr, const void *rom_ptr, u32 romsize)
 {
     if (inited)
         GBA_EndRom(1); // Shouldn't be needed here
@@ -83,6 +94,10 @@ int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize)
 
     inited = 1;
 
+#ifdef ENABLE_PROFILER
+    GBA_CPUProfilerStart();
+#endif
+
     if (GBA_BiosIsLoaded() == 0)
         ConsolePrint("Using emulated BIOS...\n");
     else
@@ -102,6 +117,10 @@ int GBA_EndRom(int save)
     if (save)
         GBA_SaveWriteFile();
 
+#ifdef ENABLE_PROFILER
+    Profiler_End();
+#endif
+
     GBA_MemoryEnd();
 
     inited = 0;
@@ -152,26 +171,27 @@ void GBA_HandleInputFlags(u16 flags)
 
 void GBA_Screenshot(const char *path)
 {
-    unsigned char *buffer = malloc(240 * 160 * 3);
+    // The PNG is encoded in the background
+    unsigned char *buffer = ImageWriter_BufferGet(240 * 160 * 3);
     if (buffer == NULL)
-    {
-        Debug_ErrorMsgArg("%s(): Not enough memory.");
         return;
-    }
 
     GBA_ConvertScreenBufferTo24RGB(buffer);
 
-    if (path)
-    {
-        Save_PNG(path, buffer, 240, 160, 0);
-    }
-    else
-    {
-        char *name = FU_GetNewTimestampFilename("gba_screenshot");
-        Save_PNG(name, buffer, 240, 160, 0);
-    }
+    if (path == NULL)
+        path = FU_GetNewTimestampFilename("gba_screenshot");
 
-    free(buffer);
+    ImageWriter_SavePNG(path, buffer, 240, 160, 0);
+}
+
+static void GBA_VideoFrameDump(void)
+{
+    unsigned char *buffer = ImageWriter_BufferGet(240 * 160 * 3);
+    if (buffer == NULL)
+        return;
+
+    GBA_ConvertScreenBufferTo24RGB(buffer);
+    ImageWriter_VideoFrame(buffer, 240, 160);
 }
 
 static s32 min_(s32 a, s32 b)
@@ -188,8 +208,80 @@ void GBA_RunFor_ExecutionBreak(void)
 
 void GBA_RunForOneFrame(void)
 {
+    u16 keys = ~REG_KEYINPUT & 0x3FF;
+    int movie = Movie_FrameStart(&keys, 1);
+    REG_KEYINPUT = ~keys & 0x3FF;
+
+    int hash = FrameHash_FrameStart();
+    int dump = ImageWriter_VideoIsRecording();
+
+    if ((movie & MOVIE_FRAME_DRAW) || (hash & FRAME_HASH_DRAW) || dump)
+        GBA_SkipFrame(0);
+
     GBA_CheckKeypadInterrupt();
     GBA_RunFor(280896); // Clocksperframe = 280896
+    GBA_SaveAutosaveUpdate();
+
+    if (movie & MOVIE_FRAME_CHECKPOINT)
+        Movie_FrameCheckpoint(GBA_ScreenHash());
+    if (hash & FRAME_HASH_END)
+        FrameHash_FrameEnd(GBA_ScreenHash, GBA_SoundHash);
+    if (dump)
+        GBA_VideoFrameDump();
+}
+
+// Run-ahead
+// ---------
+//
+// Most games read the input during one frame and don't show its effects until
+// one or two frames later. To hide that latency, the real frame is emulated,
+// a snapshot is taken, the following frames are emulated with the same input,
+// and the last one is displayed. Then the snapshot is loaded, so the frames
+// that have been emulated ahead don't affect the state of the emulation. Their
+// audio samples are discarded with the rest of the state.
+//
+// The hooks of movies, hashes and video recordings are only called for the real
+// frame. Run-ahead is disabled while the debugger is stopping the emulation at
+// some point, as it wouldn't know which of the two timelines it is looking at.
+
+static int GBA_RunAheadAvailable(void)
+{
+    if (gba_debug_breakpoint_count | gba_debug_pc_hook_count)
+        return 0;
+
+    if (GBA_DebugWatchpointsUsed())
+        return 0;
+
+    return 1;
+}
+
+void GBA_RunForOneFrameAhead(int frames)
+{
+    if ((frames <= 0) || !GBA_RunAheadAvailable())
+    {
+        GBA_RunForOneFrame();
+        return;
+    }
+
+    int skip = GBA_HasToSkipFrame();
+
+    GBA_SkipFrame(1);
+    GBA_RunForOneFrame();
+
+    if (GBA_StateSave() != 0)
+        return;
+
+    for (int i = 0; i < frames; i++)
+    {
+        // Only the last frame is displayed
+        GBA_SkipFrame(skip || (i < (frames - 1)));
+        GBA_CheckKeypadInterrupt();
+        GBA_RunFor(280896);
+    }
+
+    GBA_StateLoad();
+
+    GBA_SkipFrame(skip);
 }
 
 u32 GBA_RunFor(s32 totalclocks)
@@ -198,6 +290,8 @@ u32 GBA_RunFor(s32 totalclocks)
     totalclocks += lastresidualclocks;
     u32 has_executed = 0;
 
+    GBA_DebugWatchpointsArm(1);
+
     while (totalclocks >= clocks_to_next_event)
     {
         if (GBA_DMAisWorking())
@@ -238,6 +332,7 @@ u32 GBA_RunFor(s32 totalclocks)
         {
             lastresidualclocks = totalclocks;
             gba_execution_break = 0;
+            GBA_DebugWatchpointsArm(0);
             return has_executed;
         }
     }
@@ -282,12 +377,15 @@ u32 GBA_RunFor(s32 totalclocks)
         {
             lastresidualclocks = totalclocks;
             gba_execution_break = 0;
+            GBA_DebugWatchpointsArm(0);
             return has_executed;
         }
     }
 
     lastresidualclocks = totalclocks;
 
+    GBA_DebugWatchpointsArm(0);
+
     return has_executed;
 }
 
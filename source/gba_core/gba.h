@@ -155,7 +155,10 @@ typedef struct
 
 int GBA_GetRomSize(void);
 
-int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize);
+// rom_ptr must point to a buffer of at least 32 MB (the size of the ROM address
+// space) padded with zeroes after the end of the ROM. It isn't copied, so it
+// must remain valid until GBA_EndRom() is called.
+int GBA_InitRom(void *bios_ptr, const void *rom_ptr, u32 romsize);
 int GBA_EndRom(int save);
 void GBA_Reset(void);
 
@@ -164,6 +167,10 @@ _cpu_t *GBA_CPUGet(void); // For the disassembler
 void GBA_Screenshot(const char *path);
 
 void GBA_RunForOneFrame(void);
+// Runs one frame and then the specified number of frames ahead of it, which
+// are discarded afterwards, leaving the last one in the screen buffer.
+void GBA_RunForOneFrameAhead(int frames);
+void GBA_RunForStateRegister(void);
 void GBA_RunFor_ExecutionBreak(void);
 
 void GBA_HandleInput(int a, int b, int l, int r, int st, int se,
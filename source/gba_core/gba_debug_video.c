@@ -257,106 +257,181 @@ void GBA_Debug_PrintSpritesPage(int page, int buf_has_alpha_channel,
 
 //----------------------------------------------------------------
 
-void GBA_Debug_PrintTiles(unsigned char *buffer,
-                          int bufw, unused__ int bufh, int cbb,
-                          int colors, int palette)
+// The tile and map viewers are updated after every frame, so they only draw the
+// tiles that have changed since the last time they were drawn. The data used
+// to draw them is saved to compare it with the current one.
+
+typedef struct {
+    unsigned char *buffer; // NULL if everything has to be drawn again
+    int bufw;
+    int cbb;
+    int colors;
+    int palette;
+    u16 pal[256]; // Colors used to draw the tiles
+    u8 vram[32 * 1024]; // Tile data, starting at the character base block
+    u8 modified[32 * 32]; // Drawn over by the caller
+} _gba_debug_tiles_cache_;
+
+static _gba_debug_tiles_cache_ gba_debug_tiles_cache;
+
+// Draws the 8x8 tile at (tx, ty) of GBA_Debug_PrintTiles(). Rows past jmax are
+// filled with a pattern.
+static void _gba_debug_tiles_cell_draw(unsigned char *buffer, int bufw,
+                                       int tx, int ty, int jmax,
+                                       const u8 *charbaseblockptr,
+                                       int colors, const u16 *palptr)
 {
-    u8 *charbaseblockptr = (u8 *)&Mem.vram[cbb - 0x06000000];
+    u32 Index = tx + (ty * 32);
 
-    for (int i = 0; i < 256; i++)
+    for (int y = 0; y < 8; y++)
     {
-        for (int j = 0; j < 256; j++)
+        int j = (ty * 8) + y;
+
+        for (int x = 0; x < 8; x++)
         {
+            int i = (tx * 8) + x;
             int index = (j * bufw + i) * 3;
-            buffer[index + 0] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
-            buffer[index + 1] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
-            buffer[index + 2] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
-        }
-    }
-
-    if (colors == 256) // 256 Colors
-    {
-        int jmax = (cbb == 0x06014000) ? 64 : 128; // Half size
-
-        // If cbb >= 0x06010000 --> sprite
-        u32 pal = (cbb >= 0x06010000) ? 256 : 0;
 
-        for (int i = 0; i < 256; i++)
-        {
-            for (int j = 0; j < jmax; j++)
+            if (j >= jmax)
             {
-                u32 Index = (i / 8) + (j / 8) * 32;
-                u8 *dataptr = (u8 *)&(charbaseblockptr[(Index & 0x3FF) * 64]);
+                u8 v = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
 
-                int data = dataptr[(i & 7) + ((j & 7) * 8)];
-
-                u32 color = rgb16to32(((u16 *)Mem.pal_ram)[data + pal]);
-
-                int index = (j * bufw + i) * 3;
-                buffer[index + 0] = color & 0xFF;
-                buffer[index + 1] = (color >> 8) & 0xFF;
-                buffer[index + 2] = (color >> 16) & 0xFF;
-            }
-        }
-        for (int i = 0; i < 256; i++)
-        {
-            for (int j = jmax; j < 256; j++)
-            {
                 if (((i ^ j) & 7) == 0)
                 {
-                    int index = (j * bufw + i) * 3;
                     buffer[index + 0] = 255;
                     buffer[index + 1] = 0;
                     buffer[index + 2] = 0;
                 }
+                else
+                {
+                    buffer[index + 0] = v;
+                    buffer[index + 1] = v;
+                    buffer[index + 2] = v;
+                }
+                continue;
+            }
+
+            int data;
+            if (colors == 256)
+            {
+                data = charbaseblockptr[((Index & 0x3FF) * 64) + x + (y * 8)];
             }
+            else
+            {
+                data = charbaseblockptr[((Index & 0x3FF) * 32)
+                                        + ((x + (y * 8)) / 2)];
+                if (x & 1)
+                    data = data >> 4;
+                else
+                    data = data & 0xF;
+            }
+
+            u32 color = rgb16to32(palptr[data]);
+
+            buffer[index + 0] = color & 0xFF;
+            buffer[index + 1] = (color >> 8) & 0xFF;
+            buffer[index + 2] = (color >> 16) & 0xFF;
         }
     }
-    else if (colors == 16) // 16 colors
-    {
-        int jmax = (cbb == 0x06014000) ? 128 : 256; // Half size
+}
 
-        // If cbb >= 0x06010000 --> sprite
-        u32 pal = (cbb >= 0x06010000) ? (palette + 16) : palette;
-        u16 *palptr = (u16 *)&Mem.pal_ram[pal * 2 * 16];
+void GBA_Debug_PrintTiles(unsigned char *buffer,
+                          int bufw, unused__ int bufh, int cbb,
+                          int colors, int palette)
+{
+    _gba_debug_tiles_cache_ *c = &gba_debug_tiles_cache;
 
+    if ((colors != 256) && (colors != 16))
+    {
         for (int i = 0; i < 256; i++)
         {
-            for (int j = 0; j < jmax; j++)
+            for (int j = 0; j < 256; j++)
             {
-                u32 Index = (i / 8) + (j / 8) * 32;
-                u8 *dataptr = (u8 *)&(charbaseblockptr[(Index & 0x3FF) * 32]);
+                int index = (j * bufw + i) * 3;
+                buffer[index + 0] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
+                buffer[index + 1] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
+                buffer[index + 2] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
+            }
+        }
 
-                int data = dataptr[((i & 7) + ((j & 7) * 8)) / 2];
+        c->buffer = NULL;
+        return;
+    }
 
-                if (i & 1)
-                    data = data >> 4;
-                else
-                    data = data & 0xF;
+    u8 *charbaseblockptr = (u8 *)&Mem.vram[cbb - 0x06000000];
 
-                u32 color = rgb16to32(palptr[data]);
+    int jmax;
+    int tile_size;
+    int num_colors;
+    u16 *palptr;
 
-                int index = (j * bufw + i) * 3;
-                buffer[index + 0] = color & 0xFF;
-                buffer[index + 1] = (color >> 8) & 0xFF;
-                buffer[index + 2] = (color >> 16) & 0xFF;
-            }
-        }
+    if (colors == 256) // 256 Colors
+    {
+        jmax = (cbb == 0x06014000) ? 64 : 128; // Half size
+        tile_size = 64;
+        num_colors = 256;
 
-        for (int i = 0; i < 256; i++)
+        // If cbb >= 0x06010000 --> sprite
+        u32 pal = (cbb >= 0x06010000) ? 256 : 0;
+        palptr = &((u16 *)Mem.pal_ram)[pal];
+    }
+    else // 16 colors
+    {
+        jmax = (cbb == 0x06014000) ? 128 : 256; // Half size
+        tile_size = 32;
+        num_colors = 16;
+
+        // If cbb >= 0x06010000 --> sprite
+        u32 pal = (cbb >= 0x06010000) ? (palette + 16) : palette;
+        palptr = (u16 *)&Mem.pal_ram[pal * 2 * 16];
+    }
+
+    int redraw_all = (c->buffer != buffer) || (c->bufw != bufw)
+                     || (c->cbb != cbb) || (c->colors != colors)
+                     || (c->palette != palette)
+                     || (memcmp(c->pal, palptr, num_colors * 2) != 0);
+    if (redraw_all)
+    {
+        c->buffer = buffer;
+        c->bufw = bufw;
+        c->cbb = cbb;
+        c->colors = colors;
+        c->palette = palette;
+        memcpy(c->pal, palptr, num_colors * 2);
+    }
+
+    int tiles_y = jmax / 8;
+
+    for (int ty = 0; ty < 32; ty++)
+    {
+        for (int tx = 0; tx < 32; tx++)
         {
-            for (int j = jmax; j < 256; j++)
+            u32 Index = tx + (ty * 32);
+
+            if ((redraw_all == 0) && (c->modified[Index] == 0))
             {
-                if (((i ^ j) & 7) == 0)
-                {
-                    int index = (j * bufw + i) * 3;
-                    buffer[index + 0] = 255;
-                    buffer[index + 1] = 0;
-                    buffer[index + 2] = 0;
-                }
+                if (ty >= tiles_y)
+                    continue;
+
+                u32 offset = (Index & 0x3FF) * tile_size;
+                if (memcmp(&c->vram[offset], &charbaseblockptr[offset],
+                           tile_size) == 0)
+                    continue;
             }
+
+            c->modified[Index] = 0;
+
+            _gba_debug_tiles_cell_draw(buffer, bufw, tx, ty, jmax,
+                                       charbaseblockptr, colors, palptr);
         }
     }
+
+    memcpy(c->vram, charbaseblockptr, tiles_y * 32 * tile_size);
+}
+
+void GBA_Debug_PrintTilesModified(int tile)
+{
+    gba_debug_tiles_cache.modified[tile & 0x3FF] = 1;
 }
 
 void GBA_Debug_PrintTilesAlpha(unsigned char *buffer,
@@ -551,14 +626,155 @@ static u32 se_index_affine(u32 tx, u32 ty, u32 tpitch)
     return (ty * tpitch) + tx;
 }
 
+typedef struct {
+    unsigned char *buffer; // NULL if everything has to be drawn again
+    int bufw;
+    int bufh;
+    u16 control;
+    int bgmode;
+    int page;
+    u8 pal_ram[sizeof(Mem.pal_ram)];
+    u8 vram[sizeof(Mem.vram)];
+    u8 tile_changed[1024];
+} _gba_debug_bg_cache_;
+
+static _gba_debug_bg_cache_ gba_debug_bg_cache;
+
+// Fills tile_changed[] with the tiles of the character base block that are
+// different from the ones used in the last call.
+static void _gba_debug_bg_tiles_changed(u32 charbase, int tile_size, int count)
+{
+    _gba_debug_bg_cache_ *c = &gba_debug_bg_cache;
+
+    for (int t = 0; t < count; t++)
+    {
+        u32 offset = charbase + (t * tile_size);
+        c->tile_changed[t] = memcmp(&c->vram[offset], &Mem.vram[offset],
+                                    tile_size) != 0;
+    }
+}
+
+static void _gba_debug_bg_text_tile_draw(unsigned char *buffer, int bufw,
+                                         u32 tx, u32 ty, u16 SE, u16 control,
+                                         const u8 *charbaseblockptr)
+{
+    if (control & BIT(7)) // 256 colors
+    {
+        for (u32 i = tx * 8; i < (tx * 8) + 8; i++)
+        {
+            for (u32 j = ty * 8; j < (ty * 8) + 8; j++)
+            {
+                // Screen entry data:
+                // 0-9 tile id
+                // 10-hflip
+                // 11-vflip
+                int _x = i & 7;
+                if (SE & BIT(10))
+                    _x = 7 - _x; // H flip
+
+                int _y = j & 7;
+                if (SE & BIT(11))
+                    _y = 7 - _y; // V flip
+
+                int data = charbaseblockptr[((SE & 0x3FF) * 64)
+                                            + (_x + (_y * 8))];
+
+                u32 color = rgb16to32(((u16 *)Mem.pal_ram)[data]);
+                buffer[(j * bufw + i) * 4 + 0] = color & 0xFF;
+                buffer[(j * bufw + i) * 4 + 1] = (color >> 8) & 0xFF;
+                buffer[(j * bufw + i) * 4 + 2] = (color >> 16) & 0xFF;
+                buffer[(j * bufw + i) * 4 + 3] = data ? 0xFF : 0;
+            }
+        }
+    }
+    else // 16 colors
+    {
+        // Screen entry data
+        // 0-9 tile id
+        // 10-hflip
+        // 11-vflip
+        // 12-15-pal
+        u16 *palptr = (u16 *)&Mem.pal_ram[(SE >> 12) * (2 * 16)];
+
+        for (u32 i = tx * 8; i < (tx * 8) + 8; i++)
+        {
+            for (u32 j = ty * 8; j < (ty * 8) + 8; j++)
+            {
+                int _x = i & 7;
+                if (SE & BIT(10))
+                    _x = 7 - _x; // H flip
+
+                int _y = j & 7;
+                if (SE & BIT(11))
+                    _y = 7 - _y; // V flip
+
+                u32 data = charbaseblockptr[((SE & 0x3FF) * 32)
+                                            + ((_x / 2) + (_y * 4))];
+
+                if (_x & 1)
+                    data = data >> 4;
+                else
+                    data = data & 0xF;
+
+                u32 color = rgb16to32(palptr[data]);
+                buffer[(j * bufw + i) * 4 + 0] = color & 0xFF;
+                buffer[(j * bufw + i) * 4 + 1] = (color >> 8) & 0xFF;
+                buffer[(j * bufw + i) * 4 + 2] = (color >> 16) & 0xFF;
+                buffer[(j * bufw + i) * 4 + 3] = data ? 0xFF : 0;
+            }
+        }
+    }
+}
+
+static void _gba_debug_bg_affine_tile_draw(unsigned char *buffer, int bufw,
+                                           u32 tx, u32 ty, u8 SE,
+                                           const u8 *charbaseblockptr)
+{
+    for (u32 i = tx * 8; i < (tx * 8) + 8; i++)
+    {
+        for (u32 j = ty * 8; j < (ty * 8) + 8; j++)
+        {
+            int _x = i & 7;
+            int _y = j & 7;
+
+            u16 data = charbaseblockptr[(SE * 64) + (_x + (_y * 8))];
+
+            u32 color = rgb16to32(((u16 *)Mem.pal_ram)[data]);
+            buffer[(j * bufw + i) * 4 + 0] = color & 0xFF;
+            buffer[(j * bufw + i) * 4 + 1] = (color >> 8) & 0xFF;
+            buffer[(j * bufw + i) * 4 + 2] = (color >> 16) & 0xFF;
+            buffer[(j * bufw + i) * 4 + 3] = data ? 0xFF : 0;
+        }
+    }
+}
+
 // bgmode => 1 = text, 2 = affine, 3,4,5 = bmp mode 3,4,5
 void GBA_Debug_PrintBackgroundAlpha(unsigned char *buffer, int bufw, int bufh,
                                     u16 control, int bgmode, int page)
 {
+    _gba_debug_bg_cache_ *c = &gba_debug_bg_cache;
+
     if (bgmode == 0) // Shouldn't happen
         return;
 
-    memset(buffer, 0, bufw * bufh * 4);
+    // Palette changes affect almost every tile, so everything is drawn again
+    int redraw_all = (c->buffer != buffer) || (c->bufw != bufw)
+                     || (c->bufh != bufh) || (c->control != control)
+                     || (c->bgmode != bgmode) || (c->page != page)
+                     || (memcmp(c->pal_ram, Mem.pal_ram,
+                                sizeof(Mem.pal_ram)) != 0);
+    if (redraw_all)
+    {
+        c->buffer = buffer;
+        c->bufw = bufw;
+        c->bufh = bufh;
+        c->control = control;
+        c->bgmode = bgmode;
+        c->page = page;
+        memcpy(c->pal_ram, Mem.pal_ram, sizeof(Mem.pal_ram));
+
+        memset(buffer, 0, bufw * bufh * 4);
+    }
 
     if (bgmode == 1) // Text
     {
@@ -566,82 +782,38 @@ void GBA_Debug_PrintBackgroundAlpha(unsigned char *buffer, int bufw, int bufh,
             { 256, 256 }, { 512, 256 }, { 256, 512 }, { 512, 512 }
         };
 
-        u8 *charbaseblockptr =
-                (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
-        u16 *scrbaseblockptr =
-                (u16 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
+        u32 charbase = ((control >> 2) & 3) * (16 * 1024);
+        u32 scrbase = ((control >> 8) & 0x1F) * (2 * 1024);
+
+        u8 *charbaseblockptr = (u8 *)&Mem.vram[charbase];
+        u16 *scrbaseblockptr = (u16 *)&Mem.vram[scrbase];
 
         u32 sizex = text_bg_size[control >> 14][0];
         u32 sizey = text_bg_size[control >> 14][1];
 
-        if (control & BIT(7)) // 256 colors
+        if (redraw_all == 0)
         {
-            for (u32 i = 0; i < sizex; i++)
-            {
-                for (u32 j = 0; j < sizey; j++)
-                {
-                    u32 index = se_index(i / 8, j / 8, sizex / 8);
-                    u16 SE = scrbaseblockptr[index];
-                    // Screen entry data:
-                    // 0-9 tile id
-                    // 10-hflip
-                    // 11-vflip
-                    int _x = i & 7;
-                    if (SE & BIT(10))
-                        _x = 7 - _x; // H flip
-
-                    int _y = j & 7;
-                    if (SE & BIT(11))
-                        _y = 7 - _y; // V flip
-
-                    int data = charbaseblockptr[((SE & 0x3FF) * 64)
-                                                + (_x + (_y * 8))];
-
-                    u32 color = rgb16to32(((u16 *)Mem.pal_ram)[data]);
-                    buffer[(j * bufw + i) * 4 + 0] = color & 0xFF;
-                    buffer[(j * bufw + i) * 4 + 1] = (color >> 8) & 0xFF;
-                    buffer[(j * bufw + i) * 4 + 2] = (color >> 16) & 0xFF;
-                    buffer[(j * bufw + i) * 4 + 3] = data ? 0xFF : 0;
-                }
-            }
+            int tile_size = (control & BIT(7)) ? 64 : 32;
+            _gba_debug_bg_tiles_changed(charbase, tile_size, 1024);
         }
-        else // 16 colors
+
+        for (u32 tx = 0; tx < sizex / 8; tx++)
         {
-            for (u32 i = 0; i < sizex; i++)
+            for (u32 ty = 0; ty < sizey / 8; ty++)
             {
-                for (u32 j = 0; j < sizey; j++)
+                u32 index = se_index(tx, ty, sizex / 8);
+                u16 SE = scrbaseblockptr[index];
+
+                if (redraw_all == 0)
                 {
-                    u32 index = se_index(i / 8, j / 8, sizex / 8);
-                    u16 SE = scrbaseblockptr[index];
-                    // Screen entry data
-                    // 0-9 tile id
-                    // 10-hflip
-                    // 11-vflip
-                    // 12-15-pal
-                    u16 *palptr = (u16 *)&Mem.pal_ram[(SE >> 12) * (2 * 16)];
-
-                    int _x = i & 7;
-                    if (SE & BIT(10))
-                        _x = 7 - _x; // H flip
-
-                    int _y = j & 7;
-                    if (SE & BIT(11))
-                        _y = 7 - _y; // V flip
-
-                    u32 data = charbaseblockptr[((SE & 0x3FF) * 32)
-                                                + ((_x / 2) + (_y * 4))];
-
-                    if (_x & 1)
-                        data = data >> 4;
-                    else
-                        data = data & 0xF;
-
-                    u32 color = rgb16to32(palptr[data]);
-                    buffer[(j * bufw + i) * 4 + 0] = color & 0xFF;
-                    buffer[(j * bufw + i) * 4 + 1] = (color >> 8) & 0xFF;
-                    buffer[(j * bufw + i) * 4 + 2] = (color >> 16) & 0xFF;
-                    buffer[(j * bufw + i) * 4 + 3] = data ? 0xFF : 0;
+                    u32 offset = scrbase + (index * 2);
+                    if ((memcmp(&c->vram[offset], &Mem.vram[offset], 2) == 0)
+                        && (c->tile_changed[SE & 0x3FF] == 0))
+                        continue;
                 }
+
+                _gba_debug_bg_text_tile_draw(buffer, bufw, tx, ty, SE, control,
+                                             charbaseblockptr);
             }
         }
     }
@@ -649,37 +821,45 @@ void GBA_Debug_PrintBackgroundAlpha(unsigned char *buffer, int bufw, int bufh,
     {
         static const u32 affine_bg_size[4] = { 128, 256, 512, 1024 };
 
-        u8 *charbaseblockptr =
-                (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
-        u8 *scrbaseblockptr =
-                (u8 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
+        u32 charbase = ((control >> 2) & 3) * (16 * 1024);
+        u32 scrbase = ((control >> 8) & 0x1F) * (2 * 1024);
+
+        u8 *charbaseblockptr = (u8 *)&Mem.vram[charbase];
+        u8 *scrbaseblockptr = (u8 *)&Mem.vram[scrbase];
 
         u32 size = affine_bg_size[control >> 14];
         u32 tilesize = size / 8;
 
         // Always 256 color
 
-        for (u32 i = 0; i < size; i++)
+        if (redraw_all == 0)
+            _gba_debug_bg_tiles_changed(charbase, 64, 256);
+
+        for (u32 tx = 0; tx < tilesize; tx++)
         {
-            for (u32 j = 0; j < size; j++)
+            for (u32 ty = 0; ty < tilesize; ty++)
             {
-                int _x = i & 7;
-                int _y = j & 7;
-
-                u32 index = se_index_affine(i / 8, j / 8, tilesize);
+                u32 index = se_index_affine(tx, ty, tilesize);
                 u8 SE = scrbaseblockptr[index];
-                u16 data = charbaseblockptr[(SE * 64) + (_x + (_y * 8))];
 
-                u32 color = rgb16to32(((u16 *)Mem.pal_ram)[data]);
-                buffer[(j * bufw + i) * 4 + 0] = color & 0xFF;
-                buffer[(j * bufw + i) * 4 + 1] = (color >> 8) & 0xFF;
-                buffer[(j * bufw + i) * 4 + 2] = (color >> 16) & 0xFF;
-                buffer[(j * bufw + i) * 4 + 3] = data ? 0xFF : 0;
+                if (redraw_all == 0)
+                {
+                    if ((c->vram[scrbase + index] == SE)
+                        && (c->tile_changed[SE] == 0))
+                        continue;
+                }
+
+                _gba_debug_bg_affine_tile_draw(buffer, bufw, tx, ty, SE,
+                                               charbaseblockptr);
             }
         }
     }
     else if (bgmode == 3) // BG2 mode 3
     {
+        if ((redraw_all == 0)
+            && (memcmp(c->vram, Mem.vram, 240 * 160 * 2) == 0))
+            return;
+
         u16 *srcptr = (u16 *)&Mem.vram;
 
         for (int i = 0; i < 240; i++)
@@ -697,7 +877,13 @@ void GBA_Debug_PrintBackgroundAlpha(unsigned char *buffer, int bufw, int bufh,
     }
     else if (bgmode == 4) // BG2 mode 4
     {
-        u8 *srcptr = (u8 *)&Mem.vram[page ? 0xA000 : 0];
+        u32 offset = page ? 0xA000 : 0;
+
+        if ((redraw_all == 0)
+            && (memcmp(&c->vram[offset], &Mem.vram[offset], 240 * 160) == 0))
+            return;
+
+        u8 *srcptr = (u8 *)&Mem.vram[offset];
 
         for (int i = 0; i < 240; i++)
         {
@@ -714,7 +900,14 @@ void GBA_Debug_PrintBackgroundAlpha(unsigned char *buffer, int bufw, int bufh,
     }
     else if (bgmode == 5) // BG2 mode 5
     {
-        u16 *srcptr = (u16 *)&Mem.vram[page ? 0xA000 : 0];
+        u32 offset = page ? 0xA000 : 0;
+
+        if ((redraw_all == 0)
+            && (memcmp(&c->vram[offset], &Mem.vram[offset],
+                       160 * 128 * 2) == 0))
+            return;
+
+        u16 *srcptr = (u16 *)&Mem.vram[offset];
 
         for (int i = 0; i < 160; i++)
         {
@@ -729,4 +922,6 @@ void GBA_Debug_PrintBackgroundAlpha(unsigned char *buffer, int bufw, int bufh,
             }
         }
     }
+
+    memcpy(c->vram, Mem.vram, sizeof(Mem.vram));
 }
@@ -19,6 +19,9 @@ void GBA_Debug_PrintSpritesPage(int page, int buf_has_alpha_channel,
 
 void GBA_Debug_PrintTiles(unsigned char *buffer, int bufw, int bufh, int cbb,
                           int colors, int palette);
+// Only the tiles that have changed since the last call are drawn. If the caller
+// draws over a tile of the buffer, it has to be marked as modified.
+void GBA_Debug_PrintTilesModified(int tile);
 void GBA_Debug_PrintTilesAlpha(unsigned char *buffer,
                                int bufw, int bufh, int cbb,
                                int colors, int palette);
@@ -27,6 +30,8 @@ void GBA_Debug_TilePrint64x64(unsigned char *buffer,
                               int bufw, int bufh, int cbb,
                               int tile, int palcolors, int selected_pal);
 
+// Only the tiles that have changed since the last call are drawn, so the buffer
+// must not be modified by the caller.
 void GBA_Debug_PrintBackgroundAlpha(unsigned char *buffer, int bufw, int bufh,
                                     u16 control, int bgmode, int page);
 
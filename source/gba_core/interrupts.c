@@ -9,7 +9,9 @@
 #include "bios.h"
 #include "cpu.h"
 #include "gba.h"
+#include "interrupts.h"
 #include "memory.h"
+#include "state.h"
 #include "video.h"
 
 #define SCR_DRAW      (0)
@@ -97,6 +99,23 @@ void GBA_InterruptLCD(u32 flag)
 }
 
 static int justchangedscreenmode = 0;
+static int hblinterruptexecuted = 0;
+
+static gba_scanline_hook_fn gba_scanline_hook = NULL;
+
+void GBA_ScanlineHookSet(gba_scanline_hook_fn fn)
+{
+    gba_scanline_hook = fn;
+}
+
+void GBA_InterruptStateRegister(void)
+{
+    GBA_StateAddBlock(&screenmode, sizeof(screenmode));
+    GBA_StateAddBlock(&scrclocks, sizeof(scrclocks));
+    GBA_StateAddBlock(&ly, sizeof(ly));
+    GBA_StateAddBlock(&justchangedscreenmode, sizeof(justchangedscreenmode));
+    GBA_StateAddBlock(&hblinterruptexecuted, sizeof(hblinterruptexecuted));
+}
 
 int GBA_ScreenJustChangedMode(void)
 {
@@ -105,8 +124,6 @@ int GBA_ScreenJustChangedMode(void)
 
 s32 GBA_UpdateScreenTimings(s32 clocks)
 {
-    static int hblinterruptexecuted = 0;
-
     scrclocks -= clocks;
     justchangedscreenmode = 0;
     switch (screenmode)
@@ -121,6 +138,9 @@ s32 GBA_UpdateScreenTimings(s32 clocks)
                 else
                     GBA_DrawScanline(ly);
 
+                if (gba_scanline_hook)
+                    gba_scanline_hook(ly);
+
                 GBA_InterruptLCD(BIT(4)); // Does this go here?
                 // Although the drawing time is only 960 cycles (240 * 4), the
                 // H-Blank flag is "0" for a total of 1006 cycles.
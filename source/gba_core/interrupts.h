@@ -27,9 +27,15 @@ int GBA_ScreenJustChangedMode(void);
 
 s32 GBA_UpdateScreenTimings(s32 clocks);
 
+// Called after drawing each visible scanline, when its H-Blank period starts.
+// Used by scripts. NULL disables it.
+typedef void (*gba_scanline_hook_fn)(u32 ly);
+void GBA_ScanlineHookSet(gba_scanline_hook_fn fn);
+
 int GBA_InterruptCheck(void);
 void GBA_CheckKeypadInterrupt(void);
 
 void GBA_InterruptInit(void);
+void GBA_InterruptStateRegister(void);
 
 #endif // GBA_INTERRUPTS__
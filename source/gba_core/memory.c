@@ -13,6 +13,7 @@
 
 #include "bios.h"
 #include "cpu.h"
+#include "disassembler.h"
 #include "dma.h"
 #include "gba.h"
 #include "interrupts.h"
@@ -132,7 +133,67 @@ static void GBA_MemoryReadFastFillArray(void)
 
 //------------------------------------------------------------------------------
 
-void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize)
+// Returns a pointer to the host buffer that backs the specified address if it
+// can be read (or written, if "write" is not 0) directly without side effects,
+// or NULL if it can't. The number of bytes available until the end of the
+// region (or mirror) is returned in "size". Note that 8-bit writes to VRAM,
+// palette and OAM don't behave like plain memory.
+u8 *GBA_MemoryGetHostPointer(u32 address, u32 *size, int write)
+{
+    u32 offset;
+
+    // Accesses have to go through the normal handlers to check watchpoints
+    if (gba_debug_watchpoints_armed)
+        return NULL;
+
+    switch (address >> 24)
+    {
+        case 2:
+            offset = address & 0x3FFFF;
+            *size = 0x40000 - offset;
+            return &Mem.ewram[offset];
+        case 3:
+            offset = address & 0x7FFF;
+            *size = 0x8000 - offset;
+            return &Mem.iwram[offset];
+        case 5:
+            offset = address & 0x3FF;
+            *size = 0x400 - offset;
+            return &Mem.pal_ram[offset];
+        case 6:
+            if (address >= 0x06018000)
+                return NULL;
+            offset = address - 0x06000000;
+            *size = 0x18000 - offset;
+            return &Mem.vram[offset];
+        case 7:
+            offset = address & 0x3FF;
+            *size = 0x400 - offset;
+            return &Mem.oam[offset];
+        case 8:
+        case 9:
+        case 0xA:
+        case 0xB:
+        case 0xC:
+            // Writes to ROM are ignored. Stop before 0x0D000000, where the
+            // EEPROM may be mapped.
+            if (write)
+                return NULL;
+            offset = address & 0x01FFFFFF;
+            *size = 0x02000000 - offset;
+            if (*size > 0x0D000000 - address)
+                *size = 0x0D000000 - address;
+            return &Mem.rom_wait2[offset];
+        default:
+            // BIOS (only readable from BIOS code), I/O registers, SRAM and
+            // unused areas have to go through the normal memory handlers.
+            return NULL;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void GBA_MemoryInit(u32 *bios_ptr, const u32 *rom_ptr, u32 romsize)
 {
     Mem.rom_bios = (u8 *)calloc(1, 16 * 1024);
     if (bios_ptr)
@@ -148,8 +209,11 @@ void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize)
     memset(Mem.vram, 0, sizeof(Mem.vram));
     memset(Mem.oam, 0, sizeof(Mem.oam));
 
-    u8 *rom_buffer = calloc(1, 0x02000000); // 32 * 1024 * 1024);
-    memcpy(rom_buffer, rom_ptr, romsize);
+    // The ROM buffer is owned by the caller and it is already padded to 32 MB,
+    // so it can be used directly. It may be a read-only mapping of the ROM
+    // file, but writes to the ROM area never reach it.
+    (void)romsize;
+    u8 *rom_buffer = (u8 *)rom_ptr;
     Mem.rom_wait0 = rom_buffer;
     Mem.rom_wait1 = rom_buffer;
     Mem.rom_wait2 = rom_buffer;
@@ -266,13 +330,20 @@ void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize)
 void GBA_MemoryEnd(void)
 {
     free(Mem.rom_bios);
-    free(Mem.rom_wait0); // Only free one of the pointers to ROM
+
+    // The ROM buffer is owned by the caller of GBA_InitRom()
+    Mem.rom_wait0 = NULL;
+    Mem.rom_wait1 = NULL;
+    Mem.rom_wait2 = NULL;
 }
 
 //------------------------------------------------------------------------------
 
 u32 GBA_MemoryRead32(u32 address)
 {
+    if (gba_debug_watchpoints_armed)
+        GBA_DebugWatchpointCheck(address, 4, GBA_WATCH_READ);
+
     register u32 data;
 
     switch (address >> 24)
@@ -347,6 +418,9 @@ u32 GBA_MemoryRead32(u32 address)
 
 void GBA_MemoryWrite32(u32 address, u32 data)
 {
+    if (gba_debug_watchpoints_armed)
+        GBA_DebugWatchpointCheck(address, 4, GBA_WATCH_WRITE);
+
     if (address < 0x02000000)
         return;
     if (address < 0x03000000)
@@ -395,6 +469,9 @@ void GBA_MemoryWrite32(u32 address, u32 data)
 
 u16 GBA_MemoryRead16(u32 address)
 {
+    if (gba_debug_watchpoints_armed)
+        GBA_DebugWatchpointCheck(address, 2, GBA_WATCH_READ);
+
     if (address < 0x00004000)
     {
         if (CPU.R[R_PC] < 0x00004000)
@@ -445,6 +522,9 @@ u16 GBA_MemoryRead16(u32 address)
 
 void GBA_MemoryWrite16(u32 address, u16 data)
 {
+    if (gba_debug_watchpoints_armed)
+        GBA_DebugWatchpointCheck(address, 2, GBA_WATCH_WRITE);
+
     if (address < 0x02000000)
         return;
     if (address < 0x03000000)
@@ -499,6 +579,9 @@ void GBA_MemoryWrite16(u32 address, u16 data)
 
 u8 GBA_MemoryRead8(u32 address)
 {
+    if (gba_debug_watchpoints_armed)
+        GBA_DebugWatchpointCheck(address, 1, GBA_WATCH_READ);
+
     if (address < 0x00004000)
     {
         if (CPU.R[R_PC] < 0x00004000)
@@ -555,6 +638,9 @@ static u16 expand8to16(u8 data)
 
 void GBA_MemoryWrite8(u32 address, u8 data)
 {
+    if (gba_debug_watchpoints_armed)
+        GBA_DebugWatchpointCheck(address, 1, GBA_WATCH_WRITE);
+
     if (address < 0x02000000)
         return;
     if (address < 0x03000000)
@@ -13,7 +13,7 @@ extern _mem_t Mem;
 
 //----------------------------------------------------------------------
 
-void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize);
+void GBA_MemoryInit(u32 *bios_ptr, const u32 *rom_ptr, u32 romsize);
 void GBA_MemoryEnd(void);
 
 //----------------------------------------------------------------------
@@ -34,6 +34,9 @@ void GBA_MemoryWrite16(u32 address, u16 data);
 u8 GBA_MemoryRead8(u32 address);
 void GBA_MemoryWrite8(u32 address, u8 data);
 
+// Host pointer to plain memory (no I/O, BIOS or save memory), NULL otherwise
+u8 *GBA_MemoryGetHostPointer(u32 address, u32 *size, int write);
+
 //----------------------------------------------------------------------
 
 void GBA_RegisterWrite32(u32 address, u32 data);
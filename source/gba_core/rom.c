@@ -153,12 +153,12 @@ int GBA_ShowConsoleRequested(void)
     return ret;
 }
 
-void GBA_HeaderCheck(void *rom)
+void GBA_HeaderCheck(const void *rom)
 {
     // If at the end of the function this is 1, show console window
     showconsole = 0;
 
-    _gba_header_ *header = (_gba_header_ *)rom;
+    const _gba_header_ *header = rom;
 
     ConsoleReset();
 
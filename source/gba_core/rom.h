@@ -7,7 +7,7 @@
 #ifndef GBA_ROM__
 #define GBA_ROM__
 
-void GBA_HeaderCheck(void *rom);
+void GBA_HeaderCheck(const void *rom);
 int GBA_ShowConsoleRequested(void);
 
 #endif // GBA_ROM__
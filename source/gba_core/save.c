@@ -11,12 +11,15 @@
 
 #include "../build_options.h"
 #include "../debug_utils.h"
+#include "../movie.h"
+#include "../save_writer.h"
 
 #include "cpu.h"
 #include "dma.h"
 #include "gba.h"
 #include "memory.h"
 #include "save.h"
+#include "state.h"
 #include "video.h"
 
 static const char *save_type_strings[5] = {
@@ -58,7 +61,7 @@ int GBA_SaveIsEEPROM(void)
     return (SAVE_TYPE == SAV_EEPROM) || (SAVE_TYPE == SAV_AUTODETECT);
 }
 
-void GBA_DetectSaveType(u8 *romptr, size_t size)
+void GBA_DetectSaveType(const u8 *romptr, size_t size)
 {
     for (int j = 0; j < SAV_TYPES; j++)
     {
@@ -164,6 +167,35 @@ void GBA_ResetSaveBuffer(void)
 
 char SAVE_PATH[MAX_PATHLEN];
 
+// Set when the game modifies the save memory. See GBA_SaveAutosaveUpdate().
+static int gba_save_dirty = 0;
+static int gba_save_pending = 0; // There are changes that haven't been saved
+static int gba_save_pending_frames = 0;
+static int gba_save_idle_frames = 0;
+
+void GBA_SaveStateRegister(void)
+{
+    GBA_StateAddBlock(&SAVE_TYPE, sizeof(SAVE_TYPE));
+    GBA_StateAddBlock(SRAM_BUFFER, sizeof(SRAM_BUFFER));
+    GBA_StateAddBlock(FLASH_BUFFER512, sizeof(FLASH_BUFFER512));
+    GBA_StateAddBlock(FLASH_BUFFER1M, sizeof(FLASH_BUFFER1M));
+    GBA_StateAddBlock(&FLASH_1M_PTR, sizeof(FLASH_1M_PTR));
+    GBA_StateAddBlock(&FLASH_CMD, sizeof(FLASH_CMD));
+    GBA_StateAddBlock(&FLASH_CMD_STATE, sizeof(FLASH_CMD_STATE));
+    GBA_StateAddBlock(&eeprom_detect_size, sizeof(eeprom_detect_size));
+    GBA_StateAddBlock(EEPROM_BUFFER, sizeof(EEPROM_BUFFER));
+    GBA_StateAddBlock(&EEPROM_SIZE, sizeof(EEPROM_SIZE));
+    GBA_StateAddBlock(&EEPROM_ADDRESS_BUS, sizeof(EEPROM_ADDRESS_BUS));
+    GBA_StateAddBlock(&EEPROM_ADDRESS, sizeof(EEPROM_ADDRESS));
+    GBA_StateAddBlock(&EEPROM_ADDRESS_MASK, sizeof(EEPROM_ADDRESS_MASK));
+    GBA_StateAddBlock(&EEPROM_CMD, sizeof(EEPROM_CMD));
+    GBA_StateAddBlock(&EEPROM_CMD_LEN, sizeof(EEPROM_CMD_LEN));
+    GBA_StateAddBlock(&EEPROM_DATA_STREAMING, sizeof(EEPROM_DATA_STREAMING));
+    GBA_StateAddBlock(&EEPROM_READ_BUFFER, sizeof(EEPROM_READ_BUFFER));
+    // Writes done in a snapshot that is discarded mustn't be autosaved
+    GBA_StateAddBlock(&gba_save_dirty, sizeof(gba_save_dirty));
+}
+
 void GBA_SaveSetFilename(char *rom_path)
 {
     if (strlen(rom_path) > (MAX_PATHLEN - 1))
@@ -367,7 +399,10 @@ void GBA_SaveWrite8(u32 address, u8 data)
         case SAV_SRAM:
         {
             if ((address >= 0x0E000000) && (address < 0x0E008000))
+            {
                 SRAM_BUFFER[address - 0x0E000000] = data;
+                gba_save_dirty = 1;
+            }
             return;
         }
         case SAV_FLASH:
@@ -401,6 +436,7 @@ void GBA_SaveWrite8(u32 address, u8 data)
                         memset((void *)((uintptr_t)FLASH_BUFFER512
                                         + (address & 0x0000F000)),
                                0xFF, 0xFFF);
+                        gba_save_dirty = 1;
                         FLASH_CMD = 0x30;
                         FLASH_STATE = 1;
                     }
@@ -425,6 +461,7 @@ void GBA_SaveWrite8(u32 address, u8 data)
                             {
                                 memset(FLASH_BUFFER512, 0xFF,
                                        sizeof(FLASH_BUFFER512));
+                                gba_save_dirty = 1;
                                 FLASH_CMD = 0x10;
                                 FLASH_STATE = 1;
                             }
@@ -467,7 +504,10 @@ void GBA_SaveWrite8(u32 address, u8 data)
                 if (FLASH_CMD == 0xA0) // Write byte
                 {
                     if ((address >= 0x0E000000) && (address < 0x0E010000))
+                    {
                         FLASH_BUFFER512[address - 0x0E000000] = data;
+                        gba_save_dirty = 1;
+                    }
                 }
                 FLASH_CMD_STATE = 0;
                 FLASH_CMD = 0;
@@ -505,6 +545,7 @@ void GBA_SaveWrite8(u32 address, u8 data)
                         memset((void *)((uintptr_t)FLASH_1M_PTR
                                         + (address & 0x0000F000)),
                                0xFF, 0xFFF);
+                        gba_save_dirty = 1;
                         FLASH_CMD = 0x30;
                         FLASH_STATE = 1;
                     }
@@ -528,6 +569,7 @@ void GBA_SaveWrite8(u32 address, u8 data)
                             {
                                 memset(FLASH_BUFFER1M, 0xFF,
                                        sizeof(FLASH_BUFFER1M));
+                                gba_save_dirty = 1;
                                 FLASH_CMD = 0x10;
                                 FLASH_STATE = 1;
                             }
@@ -575,7 +617,10 @@ void GBA_SaveWrite8(u32 address, u8 data)
                 if (FLASH_CMD == 0xA0) // Write byte
                 {
                     if ((address >= 0x0E000000) && (address < 0x0E010000))
+                    {
                         FLASH_1M_PTR[address - 0x0E000000] = data;
+                        gba_save_dirty = 1;
+                    }
                 }
                 else if (FLASH_CMD == 0xB0) // Change bank
                 {
@@ -714,6 +759,7 @@ void GBA_SaveWrite16(u32 address, u16 data)
                     {
                         u32 addr = EEPROM_ADDRESS & EEPROM_ADDRESS_MASK;
                         EEPROM_BUFFER[addr] = EEPROM_READ_BUFFER;
+                        gba_save_dirty = 1;
 
                         //Debug_DebugMsgArg("EEPROM: WRITE %X", EEPROM_ADDRESS);
 
@@ -739,76 +785,77 @@ void GBA_SaveWrite16(u32 address, u16 data)
 
 //---------------------------------------------------------------
 
-void GBA_SaveWriteFile(void)
+static const void *GBA_SaveGetData(size_t *size)
 {
     switch (SAVE_TYPE)
     {
         case SAV_SRAM:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(SRAM_BUFFER, sizeof(SRAM_BUFFER), 1, f) != 1)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
+            *size = sizeof(SRAM_BUFFER);
+            return SRAM_BUFFER;
         case SAV_FLASH:
         case SAV_FLASH512:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(FLASH_BUFFER512, sizeof(FLASH_BUFFER512), 1, f) != 1)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
+            *size = sizeof(FLASH_BUFFER512);
+            return FLASH_BUFFER512;
         case SAV_FLASH1M:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(FLASH_BUFFER1M, sizeof(FLASH_BUFFER1M), 1, f) != 1)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
+            *size = sizeof(FLASH_BUFFER1M);
+            return FLASH_BUFFER1M;
         case SAV_EEPROM:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(EEPROM_BUFFER, 1, EEPROM_SIZE, f) != EEPROM_SIZE)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
+            *size = EEPROM_SIZE;
+            return EEPROM_BUFFER;
         case SAV_NONE:
         case SAV_AUTODETECT:
         default:
+            *size = 0;
+            return NULL;
+    }
+}
+
+void GBA_SaveWriteFile(void)
+{
+    size_t size;
+    const void *data = GBA_SaveGetData(&size);
+    if ((data == NULL) || !Movie_SaveWriteAllowed())
+        return;
+
+    // Wait for the write so that the file is complete when this returns
+    SaveWriter_Write(SAVE_PATH, data, size);
+    SaveWriter_Flush();
+
+    gba_save_dirty = 0;
+    gba_save_pending = 0;
+}
+
+void GBA_SaveAutosaveUpdate(void)
+{
+    if (gba_save_dirty)
+    {
+        gba_save_dirty = 0;
+        if (gba_save_pending == 0)
+        {
+            gba_save_pending = 1;
+            gba_save_pending_frames = 0;
+        }
+        gba_save_idle_frames = 0;
+    }
+    else
+    {
+        if (gba_save_pending == 0)
             return;
+        gba_save_idle_frames++;
     }
+
+    gba_save_pending_frames++;
+
+    if ((gba_save_idle_frames < AUTOSAVE_IDLE_FRAMES)
+        && (gba_save_pending_frames < AUTOSAVE_MAX_FRAMES))
+        return;
+
+    size_t size;
+    const void *data = GBA_SaveGetData(&size);
+    if (data && Movie_SaveWriteAllowed())
+        SaveWriter_Write(SAVE_PATH, data, size);
+
+    gba_save_pending = 0;
 }
 
 void GBA_SaveReadFile(void)
@@ -817,7 +864,7 @@ void GBA_SaveReadFile(void)
     {
         case SAV_SRAM:
         {
-            FILE *f = fopen(SAVE_PATH, "rb");
+            FILE *f = Movie_SaveFileOpen(SAVE_PATH);
             if (f == NULL) // Maybe file didn't exist
                 return;
             if (fread(SRAM_BUFFER, sizeof(SRAM_BUFFER), 1, f) != 1)
@@ -830,7 +877,7 @@ void GBA_SaveReadFile(void)
         case SAV_FLASH:
         case SAV_FLASH512:
         {
-            FILE *f = fopen(SAVE_PATH, "rb");
+            FILE *f = Movie_SaveFileOpen(SAVE_PATH);
             if (f == NULL) // Maybe file didn't exist
                 return;
             if (fread(FLASH_BUFFER512, sizeof(FLASH_BUFFER512), 1, f) != 1)
@@ -842,7 +889,7 @@ void GBA_SaveReadFile(void)
         }
         case SAV_FLASH1M:
         {
-            FILE *f = fopen(SAVE_PATH, "rb");
+            FILE *f = Movie_SaveFileOpen(SAVE_PATH);
             if (f == NULL) // Maybe file didn't exist
                 return;
             if (fread(FLASH_BUFFER1M, sizeof(FLASH_BUFFER1M), 1, f) != 1)
@@ -856,7 +903,7 @@ void GBA_SaveReadFile(void)
         }
         case SAV_EEPROM:
         {
-            FILE *f = fopen(SAVE_PATH, "rb");
+            FILE *f = Movie_SaveFileOpen(SAVE_PATH);
             if (f == NULL) // Maybe file didn't exist
                 return;
 
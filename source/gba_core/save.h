@@ -11,7 +11,7 @@
 
 int GBA_SaveIsEEPROM(void);
 
-void GBA_DetectSaveType(u8 *romptr, size_t size);
+void GBA_DetectSaveType(const u8 *romptr, size_t size);
 void GBA_ResetSaveBuffer(void);
 void GBA_SaveSetFilename(char *rom_path);
 
@@ -23,6 +23,11 @@ void GBA_SaveWrite8(u32 address, u8 data);
 void GBA_SaveWrite16(u32 address, u16 data);
 
 void GBA_SaveWriteFile(void);
+// Call once per frame. It writes the save file in the background when the game
+// has modified it and has stopped writing to it for a while.
+void GBA_SaveAutosaveUpdate(void);
 void GBA_SaveReadFile(void);
 
+void GBA_SaveStateRegister(void);
+
 #endif // GBA_SAVE__
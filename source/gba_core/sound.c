@@ -11,12 +11,14 @@
 #include "../build_options.h"
 #include "../config.h"
 #include "../debug_utils.h"
+#include "../general_utils.h"
 #include "../wav_utils.h"
 
 #include "cpu.h"
 #include "dma.h"
 #include "memory.h"
 #include "sound.h"
+#include "state.h"
 
 // Quite a big buffer, but it works fine this way.  The bigger, the less
 // possibilities to underflow, but the more delay between actions and sound
@@ -233,6 +235,7 @@ typedef struct
 
     s16 buffer[GBA_SAMPLE_RATE];
     u32 buffer_write_ptr;
+    u32 buffer_hash_ptr; // Samples before this one have been hashed
 
     // Some temporary variables to avoid doing the same calculations every time
     // a sample is going to be generated:
@@ -251,6 +254,12 @@ static _GBA_SOUND_HARDWARE_ Sound;
 
 static int output_enabled;
 
+void GBA_SoundStateRegister(void)
+{
+    GBA_StateAddBlock(GBA_WavePattern, sizeof(GBA_WavePattern));
+    GBA_StateAddBlock(&Sound, sizeof(Sound));
+}
+
 int GBA_SoundHardwareIsOn(void)
 {
     return Sound.master_enable;
@@ -360,6 +369,7 @@ size_t GBA_SoundGetSamplesFrame(void *buffer, size_t buffer_size)
 
     // Reset pointer
     Sound.buffer_write_ptr = 0;
+    Sound.buffer_hash_ptr = 0;
 
     return copy_size;
 }
@@ -367,6 +377,17 @@ size_t GBA_SoundGetSamplesFrame(void *buffer, size_t buffer_size)
 void GBA_SoundResetBufferPointers(void)
 {
     Sound.buffer_write_ptr = 0;
+    Sound.buffer_hash_ptr = 0;
+}
+
+u64 GBA_SoundHash(void)
+{
+    u32 start = Sound.buffer_hash_ptr;
+    u32 size = (Sound.buffer_write_ptr - start) * sizeof(s16);
+
+    Sound.buffer_hash_ptr = Sound.buffer_write_ptr;
+
+    return hash_data(&Sound.buffer[start], size, HASH_INIT);
 }
 
 void GBA_SoundInit(void)
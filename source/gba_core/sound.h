@@ -22,7 +22,11 @@ u16 GBA_SoundRegRead16(u32 address);
 void GBA_SoundSaveToWAV(void);
 size_t GBA_SoundGetSamplesFrame(void *buffer, size_t buffer_size);
 void GBA_SoundResetBufferPointers(void);
+// Hash of the samples generated since the last call (or since the buffer was
+// emptied). It doesn't remove them from the buffer.
+u64 GBA_SoundHash(void);
 void GBA_SoundEnd(void);
+void GBA_SoundStateRegister(void);
 void GBA_SoundTimerCheck(u32 number);
 
 void GBA_SoundGetConfig(int *vol, int *chn_flags);
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../debug_utils.h"
+
+#include "gba.h"
+#include "cpu.h"
+#include "dma.h"
+#include "interrupts.h"
+#include "memory.h"
+#include "save.h"
+#include "sound.h"
+#include "state.h"
+#include "timers.h"
+#include "video.h"
+
+extern _mem_t Mem;
+
+typedef struct {
+    void *ptr;
+    size_t size;
+} _gba_state_block_;
+
+#define GBA_STATE_MAX_BLOCKS (64)
+
+static _gba_state_block_ gba_state_blocks[GBA_STATE_MAX_BLOCKS];
+static int gba_state_num_blocks = 0;
+static size_t gba_state_size = 0;
+
+static u8 *gba_state_buffer = NULL;
+static int gba_state_saved = 0;
+
+void GBA_StateAddBlock(void *ptr, size_t size)
+{
+    if (gba_state_num_blocks == GBA_STATE_MAX_BLOCKS)
+    {
+        Debug_ErrorMsgArg("%s: Too many blocks", __func__);
+        return;
+    }
+
+    gba_state_blocks[gba_state_num_blocks].ptr = ptr;
+    gba_state_blocks[gba_state_num_blocks].size = size;
+    gba_state_num_blocks++;
+
+    gba_state_size += size;
+}
+
+static int GBA_StateInit(void)
+{
+    if (gba_state_buffer != NULL)
+        return 0;
+
+    GBA_StateAddBlock(&CPU, sizeof(CPU));
+    GBA_StateAddBlock(&Mem, sizeof(Mem));
+
+    GBA_CPUStateRegister();
+    GBA_DMAStateRegister();
+    GBA_InterruptStateRegister();
+    GBA_RunForStateRegister();
+    GBA_SaveStateRegister();
+    GBA_SoundStateRegister();
+    GBA_TimerStateRegister();
+    GBA_VideoStateRegister();
+
+    gba_state_buffer = malloc(gba_state_size);
+    if (gba_state_buffer == NULL)
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory", __func__);
+        gba_state_num_blocks = 0;
+        gba_state_size = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+int GBA_StateSave(void)
+{
+    if (GBA_StateInit() != 0)
+        return 1;
+
+    u8 *dst = gba_state_buffer;
+    for (int i = 0; i < gba_state_num_blocks; i++)
+    {
+        memcpy(dst, gba_state_blocks[i].ptr, gba_state_blocks[i].size);
+        dst += gba_state_blocks[i].size;
+    }
+
+    gba_state_saved = 1;
+
+    return 0;
+}
+
+int GBA_StateLoad(void)
+{
+    if (!gba_state_saved)
+        return 1;
+
+    const u8 *src = gba_state_buffer;
+    for (int i = 0; i < gba_state_num_blocks; i++)
+    {
+        memcpy(gba_state_blocks[i].ptr, src, gba_state_blocks[i].size);
+        src += gba_state_blocks[i].size;
+    }
+
+    return 0;
+}
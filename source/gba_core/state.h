@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GBA_STATE__
+#define GBA_STATE__
+
+#include <stddef.h>
+
+// In-memory snapshot of the emulated system. It contains pointers to buffers of
+// the emulator (like the ROM), so it is only valid while the same ROM is
+// loaded. The screen buffers and the configuration aren't part of it.
+
+// Used by the modules of the core to add their internal state to the snapshot
+void GBA_StateAddBlock(void *ptr, size_t size);
+
+// Returns 0 on success
+int GBA_StateSave(void);
+// Returns 0 on success, or 1 if there isn't any saved snapshot
+int GBA_StateLoad(void);
+
+#endif // GBA_STATE__
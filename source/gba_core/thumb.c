@@ -287,6 +287,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
             return clocks;
         }
 
+#ifdef ENABLE_PROFILER
+        s32 profiler_clocks = clocks;
+#endif
+
         u32 PCseq = ((CPU.OldPC + 2) == CPU.R[R_PC]);
         CPU.OldPC = CPU.R[R_PC];
 
@@ -1619,6 +1623,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                         CPU.R[R_PC] += 2;
                         GBA_Swi(swinummber);
                         clocks -= 50;
+#ifdef ENABLE_PROFILER
+                        GBA_CPUProfilerStep(profiler_clocks - clocks,
+                                            CPU.R[R_PC], 1);
+#endif
                         return clocks;
                         //return GBA_ExecuteARM(clocks);
                     }
@@ -1736,6 +1744,19 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
             }
         }
 
+#ifdef ENABLE_PROFILER
+        GBA_CPUProfilerStep(profiler_clocks - clocks, CPU.R[R_PC] + 2, 1);
+#endif
+
+        if (CPU.R[R_PC] < CPU.OldPC) // Backwards jump
+        {
+            if (GBA_CPUIdleLoopCheck(CPU.OldPC, CPU.R[R_PC] + 2))
+            {
+                if (clocks > 0)
+                    clocks = 0;
+            }
+        }
+
         CPU.R[R_PC] += 2;
         //CPU.R[R_PC] = (CPU.R[R_PC] + 2) & ~1;
     }
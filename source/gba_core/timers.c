@@ -12,6 +12,7 @@
 #include "interrupts.h"
 #include "memory.h"
 #include "sound.h"
+#include "state.h"
 #include "timers.h"
 
 typedef struct
@@ -28,6 +29,11 @@ typedef struct
 
 _timer_t Timer[4];
 
+void GBA_TimerStateRegister(void)
+{
+    GBA_StateAddBlock(Timer, sizeof(Timer));
+}
+
 //----------------------------------------------------------------
 
 static s32 min(s32 a, s32 b)
@@ -10,6 +10,7 @@
 #include "gba.h"
 
 void GBA_TimerInitAll(void);
+void GBA_TimerStateRegister(void);
 
 void GBA_TimerSetStart0(u16 val);
 void GBA_TimerSetStart1(u16 val);
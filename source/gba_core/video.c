@@ -7,9 +7,11 @@
 #include <string.h>
 
 #include "../build_options.h"
+#include "../general_utils.h"
 
 #include "gba.h"
 #include "memory.h"
+#include "state.h"
 #include "video.h"
 
 extern _mem_t Mem;
@@ -36,6 +38,40 @@ static s32 MosSprX, MosSprY, MosBgX, MosBgY;
 static u32 Win0X1, Win0X2, Win0Y1, Win0Y2;
 static u32 Win1X1, Win1X2, Win1Y1, Win1Y2;
 
+static s32 mosBG2lastx, mosBG2lasty, mos2A, mos2C;
+static s32 mosBG3lastx, mosBG3lasty, mos3A, mos3C;
+
+// The screen buffers aren't part of the state. After loading a snapshot they
+// still hold the last frame that has been drawn.
+void GBA_VideoStateRegister(void)
+{
+    GBA_StateAddBlock(&DrawScanlineFn, sizeof(DrawScanlineFn));
+    GBA_StateAddBlock(&BG2lastx, sizeof(BG2lastx));
+    GBA_StateAddBlock(&BG2lasty, sizeof(BG2lasty));
+    GBA_StateAddBlock(&BG3lastx, sizeof(BG3lastx));
+    GBA_StateAddBlock(&BG3lasty, sizeof(BG3lasty));
+    GBA_StateAddBlock(&MosSprX, sizeof(MosSprX));
+    GBA_StateAddBlock(&MosSprY, sizeof(MosSprY));
+    GBA_StateAddBlock(&MosBgX, sizeof(MosBgX));
+    GBA_StateAddBlock(&MosBgY, sizeof(MosBgY));
+    GBA_StateAddBlock(&Win0X1, sizeof(Win0X1));
+    GBA_StateAddBlock(&Win0X2, sizeof(Win0X2));
+    GBA_StateAddBlock(&Win0Y1, sizeof(Win0Y1));
+    GBA_StateAddBlock(&Win0Y2, sizeof(Win0Y2));
+    GBA_StateAddBlock(&Win1X1, sizeof(Win1X1));
+    GBA_StateAddBlock(&Win1X2, sizeof(Win1X2));
+    GBA_StateAddBlock(&Win1Y1, sizeof(Win1Y1));
+    GBA_StateAddBlock(&Win1Y2, sizeof(Win1Y2));
+    GBA_StateAddBlock(&mosBG2lastx, sizeof(mosBG2lastx));
+    GBA_StateAddBlock(&mosBG2lasty, sizeof(mosBG2lasty));
+    GBA_StateAddBlock(&mos2A, sizeof(mos2A));
+    GBA_StateAddBlock(&mos2C, sizeof(mos2C));
+    GBA_StateAddBlock(&mosBG3lastx, sizeof(mosBG3lastx));
+    GBA_StateAddBlock(&mosBG3lasty, sizeof(mosBG3lasty));
+    GBA_StateAddBlock(&mos3A, sizeof(mos3A));
+    GBA_StateAddBlock(&mos3C, sizeof(mos3C));
+}
+
 //-----------------------------------------------------------
 
 static void mem_clear_32(u32 *ptr, u32 size)
@@ -1322,8 +1358,6 @@ static const u32 affine_bg_size[4] = {
     128, 256, 512, 1024
 };
 
-static s32 mosBG2lastx, mosBG2lasty, mos2A, mos2C;
-
 static void gba_bg2drawaffine(s32 y)
 {
     u16 control = REG_BG2CNT;
@@ -1406,8 +1440,6 @@ static void gba_bg2drawaffine(s32 y)
     }
 }
 
-static s32 mosBG3lastx, mosBG3lasty, mos3A, mos3C;
-
 static void gba_bg3drawaffine(s32 y)
 {
     u16 control = REG_BG3CNT;
@@ -3025,3 +3057,27 @@ void GBA_ConvertScreenBufferTo24RGB(void *dst)
         *dest++ = (data & (0x1F << 10)) >> 7;
     }
 }
+
+void GBA_ConvertScreenBufferTo32XRGB(void *dst, int pitch)
+{
+    u16 *src = screen_buffer_array[curr_screen_buffer ^ 1];
+
+    for (int j = 0; j < 160; j++)
+    {
+        u32 *dest = (u32 *)((u8 *)dst + (j * pitch));
+
+        for (int i = 0; i < 240; i++)
+        {
+            u32 data = (u32)*src++;
+            *dest++ = ((data & 0x1F) << 19)
+                      | ((data & (0x1F << 5)) << 6)
+                      | ((data & (0x1F << 10)) >> 7);
+        }
+    }
+}
+
+u64 GBA_ScreenHash(void)
+{
+    return hash_data(screen_buffer_array[curr_screen_buffer ^ 1],
+                     sizeof(screen_buffer_array[0]), HASH_INIT);
+}
@@ -21,6 +21,8 @@ void GBA_UpdateDrawScanlineFn(void);
 
 void GBA_VideoUpdateRegister(u32 address);
 
+void GBA_VideoStateRegister(void);
+
 void GBA_DrawScanline(s32 y);
 void GBA_DrawScanlineWhite(s32 y);
 
@@ -28,5 +30,10 @@ void GBA_DrawScanlineWhite(s32 y);
 void GBA_ConvertScreenBufferTo24RGB(void *dst);
 // 32-bit RGB (with alpha set to 255 in all pixels)
 void GBA_ConvertScreenBufferTo32RGB(void *dst);
+// 32-bit XRGB (0x00RRGGBB). Pitch is the size of a row in bytes.
+void GBA_ConvertScreenBufferTo32XRGB(void *dst, int pitch);
+
+// Hash of the last frame that has been drawn
+u64 GBA_ScreenHash(void);
 
 #endif // GBA_VIDEO__
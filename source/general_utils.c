@@ -31,6 +31,59 @@ void memset_rand(u8 *start, size_t _size)
         *start++ = rand();
 }
 
+//------------------------------------------------------------------------------
+
+// Constants of xxHash64
+#define HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME3 0x165667B19E3779F9ULL
+#define HASH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME5 0x27D4EB2F165667C5ULL
+
+static u64 hash_rotl(u64 value, int shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+// Words are read as little endian so that the hash is the same in all hosts
+static u64 hash_read64(const u8 *src)
+{
+    u64 value = 0;
+    for (int i = 7; i >= 0; i--)
+        value = (value << 8) | src[i];
+    return value;
+}
+
+u64 hash_data(const void *data, size_t size, u64 hash)
+{
+    const u8 *src = data;
+    size_t i = 0;
+
+    hash += (u64)size * HASH_PRIME5;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        u64 lane = hash_rotl(hash_read64(&src[i]) * HASH_PRIME2, 31)
+                   * HASH_PRIME1;
+        hash = hash_rotl(hash ^ lane, 27) * HASH_PRIME1 + HASH_PRIME4;
+    }
+
+    for (; i < size; i++)
+    {
+        hash ^= src[i] * HASH_PRIME5;
+        hash = hash_rotl(hash, 11) * HASH_PRIME1;
+    }
+
+    // Make every bit of the input affect all bits of the result
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
 //----------------------------------------------------------------------------------
 
 u64 asciihex_to_int(const char *text)
@@ -40,6 +40,13 @@ void s_strncat(char *dest, const char *src, size_t _size);
 
 void memset_rand(u8 *start, size_t _size);
 
+// Non-cryptographic hash with the same rounds as xxHash64, but with only one
+// lane (the result isn't the same as xxHash64). It is the same in all hosts.
+// Pass HASH_INIT as "hash" to start a new hash, or the result of a previous
+// call to hash more data.
+#define HASH_INIT 0xCBF29CE484222325ULL
+u64 hash_data(const void *data, size_t size, u64 hash);
+
 // Converts an hexadecimal number in an ASCII string into integer
 u64 asciihex_to_int(const char *text);
 
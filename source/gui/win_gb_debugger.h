@@ -37,6 +37,7 @@ void Win_GBIOViewerClose(void);
 
 int Win_GBTileViewerCreate(void); // Returns 1 if error
 void Win_GBTileViewerUpdate(void);
+void Win_GBTileViewerRender(void);
 void Win_GBTileViewerClose(void);
 
 // win_gb_mapviewer.c
@@ -44,6 +45,7 @@ void Win_GBTileViewerClose(void);
 
 int Win_GBMapViewerCreate(void); // Returns 1 if error
 void Win_GBMapViewerUpdate(void);
+void Win_GBMapViewerRender(void);
 void Win_GBMapViewerClose(void);
 
 // win_gb_sprviewer.c
@@ -169,6 +169,7 @@ void Win_GBMapViewerUpdate(void)
     int b = t + 7;                     // Bottom
     GUI_Draw_Rect(gb_map_buffer, GB_MAP_BUFFER_WIDTH, GB_MAP_BUFFER_HEIGHT,
                   l, r, t, b);
+    GB_Debug_MapModified(gb_mapview_selected_x, gb_mapview_selected_y);
 
     if (gb_mapview_selected_tilebase) // If tile base is 0x8800
     {
@@ -192,7 +193,7 @@ void Win_GBMapViewerUpdate(void)
 
 //----------------------------------------------------------------
 
-static void _win_gb_map_viewer_render(void)
+void Win_GBMapViewerRender(void)
 {
     if (GBMapViewerCreated == 0)
         return;
@@ -245,7 +246,7 @@ static int _win_gb_map_viewer_callback(SDL_Event *e)
     if (redraw)
     {
         Win_GBMapViewerUpdate();
-        _win_gb_map_viewer_render();
+        Win_GBMapViewerRender();
         return 1;
     }
 
@@ -376,7 +377,7 @@ int Win_GBMapViewerCreate(void)
     WH_SetEventCallback(WinIDGBMapViewer, _win_gb_map_viewer_callback);
 
     Win_GBMapViewerUpdate();
-    _win_gb_map_viewer_render();
+    Win_GBMapViewerRender();
 
     return 1;
 }
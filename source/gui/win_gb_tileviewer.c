@@ -167,6 +167,8 @@ void Win_GBTileViewerUpdate(void)
     int r = l + 7;                                   // Right
     int b = t + 7;                                   // Bottom
     GUI_Draw_Rect(buf, GB_TILE_BUFFER_WIDTH, GB_TILE_BUFFER_HEIGHT, l, r, t, b);
+    GB_Debug_TileVRAMModified(gb_tileview_selected_bank,
+                              gb_tileview_selected_index);
 
     if (gb_tile_zoomed_tile_is_pal == 0)
     {
@@ -206,7 +208,7 @@ void Win_GBTileViewerUpdate(void)
 
 //----------------------------------------------------------------
 
-static void _win_gb_tile_viewer_render(void)
+void Win_GBTileViewerRender(void)
 {
     if (GBTileViewerCreated == 0)
         return;
@@ -259,7 +261,7 @@ static int _win_gb_tile_viewer_callback(SDL_Event *e)
     if (redraw)
     {
         Win_GBTileViewerUpdate();
-        _win_gb_tile_viewer_render();
+        Win_GBTileViewerRender();
         return 1;
     }
 
@@ -383,7 +385,7 @@ int Win_GBTileViewerCreate(void)
     WH_SetEventCallback(WinIDGBTileViewer, _win_gb_tile_viewer_callback);
 
     Win_GBTileViewerUpdate();
-    _win_gb_tile_viewer_render();
+    Win_GBTileViewerRender();
 
     return 1;
 }
@@ -37,6 +37,7 @@ void Win_GBAIOViewerClose(void);
 
 int Win_GBATileViewerCreate(void); // Returns 1 on error
 void Win_GBATileViewerUpdate(void);
+void Win_GBATileViewerRender(void);
 void Win_GBATileViewerClose(void);
 
 // win_gba_mapviewer.c
@@ -44,6 +45,7 @@ void Win_GBATileViewerClose(void);
 
 int Win_GBAMapViewerCreate(void); // Returns 1 on error
 void Win_GBAMapViewerUpdate(void);
+void Win_GBAMapViewerRender(void);
 void Win_GBAMapViewerClose(void);
 
 // win_gba_sprviewer.c
@@ -646,7 +646,7 @@ void Win_GBAMapViewerUpdate(void)
 
 //----------------------------------------------------------------
 
-static void _win_gba_map_viewer_render(void)
+void Win_GBAMapViewerRender(void)
 {
     if (GBAMapViewerCreated == 0)
         return;
@@ -699,7 +699,7 @@ static int _win_gba_map_viewer_callback(SDL_Event *e)
     if (redraw)
     {
         Win_GBAMapViewerUpdate();
-        _win_gba_map_viewer_render();
+        Win_GBAMapViewerRender();
         return 1;
     }
 
@@ -838,7 +838,7 @@ int Win_GBAMapViewerCreate(void)
     WH_SetEventCallback(WinIDGBAMapViewer, _win_gba_map_viewer_callback);
 
     Win_GBAMapViewerUpdate();
-    _win_gba_map_viewer_render();
+    Win_GBAMapViewerRender();
 
     return 1;
 }
@@ -180,6 +180,7 @@ void Win_GBATileViewerUpdate(void)
     GUI_Draw_Rect(gba_tile_buffer,
                   GBA_TILE_BUFFER_WIDTH, GBA_TILE_BUFFER_HEIGHT,
                   l, r, t, b);
+    GBA_Debug_PrintTilesModified(gba_tileview_selected_index);
 
     GBA_Debug_TilePrint64x64(gba_tile_zoomed_tile_buffer, 64, 64,
                              gba_tileview_selected_cbb,
@@ -190,7 +191,7 @@ void Win_GBATileViewerUpdate(void)
 
 //----------------------------------------------------------------
 
-static void _win_gba_tile_viewer_render(void)
+void Win_GBATileViewerRender(void)
 {
     if (GBATileViewerCreated == 0)
         return;
@@ -243,7 +244,7 @@ static int _win_gba_tile_viewer_callback(SDL_Event *e)
     if (redraw)
     {
         Win_GBATileViewerUpdate();
-        _win_gba_tile_viewer_render();
+        Win_GBATileViewerRender();
         return 1;
     }
 
@@ -369,7 +370,7 @@ int Win_GBATileViewerCreate(void)
     WH_SetEventCallback(WinIDGBATileViewer, _win_gba_tile_viewer_callback);
 
     Win_GBATileViewerUpdate();
-    _win_gba_tile_viewer_render();
+    Win_GBATileViewerRender();
 
     return 1;
 }
@@ -14,15 +14,20 @@
 #include "win_main_config_input.h"
 #include "win_utils.h"
 
+#include "../archive_utils.h"
 #include "../build_options.h"
 #include "../config.h"
 #include "../debug_utils.h"
 #include "../file_explorer.h"
 #include "../file_utils.h"
 #include "../font_utils.h"
+#include "../frame_hash.h"
+#include "../frame_pacer.h"
 #include "../general_utils.h"
 #include "../input_utils.h"
 #include "../lua_handler.h"
+#include "../movie.h"
+#include "../rom_cache.h"
 #include "../sound_utils.h"
 #include "../window_handler.h"
 
@@ -208,8 +213,35 @@ static int _win_main_get_menu_texture_height(void)
     return 224 * WIN_MAIN_CONFIG_ZOOM;
 }
 
+// The game screen is written straight to the texture of the window, so this
+// buffer is only updated when a copy of the last frame is needed for the menu.
+static void _win_main_update_game_screen_buffer(void)
+{
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_ConvertScreenBufferTo24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
+    else if (WIN_MAIN_RUNNING == RUNNING_GB)
+        GB_Screen_WriteBuffer_24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
+}
+
+static void _win_main_draw_game_screen(void)
+{
+    int pitch;
+    void *pixels = WH_LockTexture(WinIDMain, &pitch);
+    if (pixels == NULL)
+        return;
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_ConvertScreenBufferTo32XRGB(pixels, pitch);
+    else if (WIN_MAIN_RUNNING == RUNNING_GB)
+        GB_Screen_WriteBuffer_32XRGB(pixels, pitch);
+
+    WH_UnlockTexture(WinIDMain);
+}
+
 static void _win_main_get_game_screen_texture_dump(void)
 {
+    _win_main_update_game_screen_buffer();
+
     memset(WIN_MAIN_GAME_MENU_BUFFER, 0, sizeof(WIN_MAIN_GAME_MENU_BUFFER));
 
     if (WIN_MAIN_SCREEN_TYPE == SCREEN_GBA)
@@ -309,8 +341,19 @@ static void _win_main_switch_to_menu_delayed(void)
 
 static int _win_main_get_rom_type(char *name)
 {
+    // Use the name of the ROM inside of compressed files
+    char inner_name[MAX_PATHLEN];
+    if (ArchiveIsSupported(name))
+    {
+        if (ArchiveGetFileName(name, inner_name, sizeof(inner_name)) == 0)
+            return RUNNING_NONE;
+        name = inner_name;
+    }
+
     char extension[4];
     int len = strlen(name);
+    if (len < 3)
+        return RUNNING_NONE;
 
     extension[3] = '\0';
     extension[2] = toupper(name[len - 1]);
@@ -341,7 +384,7 @@ static int _win_main_get_rom_type(char *name)
 }
 
 static void *bios_buffer = NULL;
-static void *rom_buffer = NULL;
+static const void *rom_buffer = NULL;
 static size_t rom_size;
 
 static void _win_main_unload_rom(int save_data)
@@ -352,21 +395,25 @@ static void _win_main_unload_rom(int save_data)
     {
         GBA_EndRom(save_data);
         GBA_DebugClearBreakpointAll();
+        GBA_DebugClearWatchpointAll();
     }
     else if (WIN_MAIN_RUNNING == RUNNING_GB)
     {
         GB_End(save_data);
         GB_DebugClearBreakpointAll();
+        GB_DebugClearWatchpointAll();
     }
     else
     {
         return;
     }
 
+    Movie_Stop();
+    FrameHash_Stop();
+
     if (bios_buffer)
         free(bios_buffer);
-    if (rom_buffer)
-        free(rom_buffer);
+    RomCacheRelease(rom_buffer);
 
     bios_buffer = NULL;
     rom_buffer = NULL;
@@ -376,10 +423,10 @@ static void _win_main_unload_rom(int save_data)
     // Clear screen
     WH_Render(WinIDMain, WIN_MAIN_GAME_SCREEN_BUFFER);
 
-    _win_main_get_game_screen_texture_dump();
-
     WIN_MAIN_RUNNING = RUNNING_NONE;
 
+    _win_main_get_game_screen_texture_dump();
+
     _win_main_switch_to_menu();
 
     WIN_MAIN_MENU_HAS_TO_UPDATE = 1;
@@ -428,7 +475,13 @@ static int _win_main_load_rom_autodetect(char *path)
     }
     else if (type == RUNNING_GB)
     {
-        if (GB_ROMLoad(path))
+        Movie_BeforeLoad(MOVIE_SYSTEM_GB);
+        int loaded = GB_ROMLoad(path);
+        size_t rom_available = 0;
+        const void *rom = loaded ? GB_ROMBufferGet(&rom_available) : NULL;
+        Movie_AfterLoad(rom, rom_available, loaded);
+
+        if (loaded)
         {
             if (GB_IsEnabledSGB())
                 _win_main_set_game_screen(SCREEN_SGB);
@@ -437,6 +490,8 @@ static int _win_main_load_rom_autodetect(char *path)
 
             WIN_MAIN_RUNNING = RUNNING_GB;
 
+            FramePacer_SetRate(GB_CLOCKS_PER_SECOND, GB_CLOCKS_PER_FRAME);
+
             _win_main_switch_to_game_delayed();
 
             return 1;
@@ -460,12 +515,27 @@ static int _win_main_load_rom_autodetect(char *path)
         else
             GBA_BiosLoaded(1);
 
-        FileLoad(path, &rom_buffer, &rom_size);
+        // The GBA core reads the ROM straight from the mapped file, padded to
+        // the size of the ROM address space.
+        rom_buffer = RomCacheAcquire(path, 0x02000000, &rom_size);
+        if (rom_buffer == NULL)
+        {
+            if (bios_buffer)
+                free(bios_buffer);
+            bios_buffer = NULL;
+            return 0;
+        }
+
         GBA_SaveSetFilename(path);
+
+        Movie_BeforeLoad(MOVIE_SYSTEM_GBA);
         GBA_InitRom(bios_buffer, rom_buffer, rom_size);
+        Movie_AfterLoad(rom_buffer, rom_size, 1);
 
         WIN_MAIN_RUNNING = RUNNING_GBA;
 
+        FramePacer_SetRate(GBA_CLOCKS_PER_SECOND, GBA_CLOCKS_PER_FRAME);
+
         _win_main_set_game_screen(SCREEN_GBA);
 
         _win_main_switch_to_game_delayed();
@@ -705,7 +775,7 @@ static void _win_main_screenshot(void)
     if (Win_MainRunningGBA())
         GBA_Screenshot(NULL);
     if (Win_MainRunningGB())
-        GB_Screenshot();
+        GB_Screenshot(NULL);
 }
 
 static void _win_main_menu_exit(void)
@@ -1390,6 +1460,14 @@ int Win_MainCreate(char *rom_path)
     WH_SetEventCallback(WinIDMain, Win_MainEventCallback);
     WH_SetEventMainWindow(WinIDMain);
 
+    // Only the main window waits for VSync, the debugger windows don't need it
+    if ((EmulatorConfig.vsync != WH_VSYNC_OFF)
+        && (WH_SetVSync(WinIDMain, EmulatorConfig.vsync) == 0))
+    {
+        FramePacer_SetVSync(WH_GetRefreshRate(WinIDMain));
+    }
+    FramePacer_SetAudioSync(EmulatorConfig.audio_sync);
+
     FPS_TimerInit();
     atexit(FPS_TimerEnd);
 
@@ -1419,7 +1497,7 @@ void Win_MainRender(void)
     {
         if (WIN_MAIN_RUNNING != RUNNING_NONE)
         {
-            WH_Render(WinIDMain, WIN_MAIN_GAME_SCREEN_BUFFER);
+            WH_RenderTexture(WinIDMain);
         }
     }
     else
@@ -1450,7 +1528,11 @@ static int16_t samples[32 * 1024];
 
 void Win_MainLoopHandle(void)
 {
-    int speedup = Input_Speedup_Enabled();
+    // Movies are played as fast as possible
+    int speedup = Input_Speedup_Enabled() || Movie_IsPlaying();
+
+    // There's no latency to hide if the emulation is going as fast as possible
+    int run_ahead = speedup ? 0 : EmulatorConfig.run_ahead;
 
     if (speedup)
         Win_MainSetFrameskip(10);
@@ -1492,11 +1574,23 @@ void Win_MainLoopHandle(void)
             if (!Script_IsRunning())
             {
                 Input_Update_GBA();
-                GBA_RunForOneFrame();
+                GBA_RunForOneFrameAhead(run_ahead);
+
+                if (GBA_DebugWatchpointHit())
+                    Win_GBADisassemblerSetFocus();
             }
 
             if (_win_main_has_to_frameskip() == 0)
-                GBA_ConvertScreenBufferTo24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
+            {
+                _win_main_draw_game_screen();
+
+                // The viewers only draw the tiles that have changed, so they
+                // can be updated every frame.
+                Win_GBATileViewerUpdate();
+                Win_GBATileViewerRender();
+                Win_GBAMapViewerUpdate();
+                Win_GBAMapViewerRender();
+            }
 
             _win_main_update_frameskip();
 
@@ -1508,17 +1602,6 @@ void Win_MainLoopHandle(void)
             if (!speedup && !Script_IsRunning())
             {
                 size_t size = GBA_SoundGetSamplesFrame(samples, sizeof(samples));
-
-                if (Sound_IsBufferTooBig())
-                {
-                    Sound_ClearBuffer();
-                }
-                else if (Sound_IsBufferOverThreshold())
-                {
-                    if (size > 8) // This should always be true
-                        size -= 8;
-                }
-
                 Sound_SendSamples(samples, size);
             }
         }
@@ -1541,12 +1624,24 @@ void Win_MainLoopHandle(void)
             if (!Script_IsRunning())
             {
                 Input_Update_GB();
-                GB_RunForOneFrame();
+                GB_RunForOneFrameAhead(run_ahead);
                 GB_CameraWebcamDelayDecrease();
+
+                if (GB_DebugWatchpointHit())
+                    Win_GBDisassemblerSetFocus();
             }
 
             if (_win_main_has_to_frameskip() == 0)
-                GB_Screen_WriteBuffer_24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
+            {
+                _win_main_draw_game_screen();
+
+                // The viewers only draw the tiles that have changed, so they
+                // can be updated every frame.
+                Win_GBTileViewerUpdate();
+                Win_GBTileViewerRender();
+                Win_GBMapViewerUpdate();
+                Win_GBMapViewerRender();
+            }
 
             _win_main_update_frameskip();
 
@@ -1558,17 +1653,6 @@ void Win_MainLoopHandle(void)
             if (!speedup && !Script_IsRunning())
             {
                 size_t size = GB_SoundGetSamplesFrame(samples, sizeof(samples));
-
-                if (Sound_IsBufferTooBig())
-                {
-                    Sound_ClearBuffer();
-                }
-                else if (Sound_IsBufferOverThreshold())
-                {
-                    if (size > 8) // This should always be true
-                        size -= 8;
-                }
-
                 Sound_SendSamples(samples, size);
             }
         }
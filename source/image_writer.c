@@ -0,0 +1,541 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "image_writer.h"
+#include "png_utils.h"
+
+// Memory used by images waiting to be written. Getting a buffer waits if it
+// would go over this limit.
+#define IMAGE_WRITER_MAX_MEMORY (32 * 1024 * 1024)
+// Number of unused buffers kept for later images
+#define IMAGE_WRITER_POOL_SIZE (16)
+#define IMAGE_WRITER_MAX_THREADS (4)
+
+// The GBA and the GB have the same frame rate: 16777216 / 280896 Hz
+#define IMAGE_WRITER_FPS_NUM (262144)
+#define IMAGE_WRITER_FPS_DEN (4389)
+
+typedef enum {
+    IMAGE_JOB_PNG,
+    IMAGE_JOB_VIDEO_FRAME
+} _image_job_type_;
+
+// The image data goes right after this header
+typedef struct _image_writer_job_ {
+    struct _image_writer_job_ *next;
+    size_t capacity;
+
+    _image_job_type_ type;
+    char path[MAX_PATHLEN];
+    int width;
+    int height;
+    int is_rgba;
+} _image_writer_job_;
+
+static SDL_Thread *image_writer_thread[IMAGE_WRITER_MAX_THREADS];
+static int image_writer_num_threads = 0;
+static SDL_mutex *image_writer_mutex = NULL;
+static SDL_cond *image_writer_work_cond = NULL; // Jobs queued or exit requested
+static SDL_cond *image_writer_done_cond = NULL; // A job has been finished
+
+static _image_writer_job_ *image_writer_queue = NULL;
+static _image_writer_job_ *image_writer_pool = NULL;
+static int image_writer_pool_count = 0;
+static size_t image_writer_memory = 0; // Memory of buffers out of the pool
+static int image_writer_busy = 0; // Number of jobs being processed
+static int image_writer_quit = 0;
+
+// Errors can't be reported from the threads, they are reported by the main
+// thread the next time it uses this module.
+static int image_writer_error = 0;
+static char image_writer_error_path[MAX_PATHLEN];
+
+// Video frames must be written in order, so only one thread can write them at
+// a time. The file is only opened and closed when there are no jobs.
+static FILE *video_file = NULL;
+static char video_path[MAX_PATHLEN];
+static int video_y4m = 0;
+static int video_width = 0;
+static int video_height = 0;
+static int video_busy = 0;
+static int video_size_warned = 0;
+static u8 *video_planes = NULL; // Used to convert frames to YUV
+
+//----------------------------------------------------------------------------
+
+static _image_writer_job_ *ImageWriter_JobFromBuffer(void *buffer)
+{
+    return ((_image_writer_job_ *)buffer) - 1;
+}
+
+static void *ImageWriter_JobBuffer(_image_writer_job_ *job)
+{
+    return job + 1;
+}
+
+// The mutex must be locked
+static void ImageWriter_JobRelease(_image_writer_job_ *job)
+{
+    image_writer_memory -= job->capacity;
+
+    if (image_writer_pool_count < IMAGE_WRITER_POOL_SIZE)
+    {
+        job->next = image_writer_pool;
+        image_writer_pool = job;
+        image_writer_pool_count++;
+    }
+    else
+    {
+        free(job);
+    }
+}
+
+// The mutex must be locked if the threads are running
+static void ImageWriter_SetError(const char *path)
+{
+    image_writer_error = 1;
+    s_strncpy(image_writer_error_path, path, sizeof(image_writer_error_path));
+}
+
+static void ImageWriter_ReportErrors(void)
+{
+    char path[MAX_PATHLEN];
+
+    if (image_writer_mutex)
+        SDL_LockMutex(image_writer_mutex);
+    int error = image_writer_error;
+    if (error)
+    {
+        image_writer_error = 0;
+        s_strncpy(path, image_writer_error_path, sizeof(path));
+    }
+    if (image_writer_mutex)
+        SDL_UnlockMutex(image_writer_mutex);
+
+    if (error)
+        Debug_ErrorMsgArg("Couldn't save image to file:\n%s", path);
+}
+
+//----------------------------------------------------------------------------
+
+// Returns 0 on success
+static int ImageWriter_VideoWriteY4M(const u8 *src, int width, int height)
+{
+    size_t plane_size = (size_t)width * height;
+
+    if (video_planes == NULL)
+    {
+        video_planes = malloc(plane_size * 3);
+        if (video_planes == NULL)
+            return 1;
+
+        fprintf(video_file, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C444\n",
+                width, height, IMAGE_WRITER_FPS_NUM, IMAGE_WRITER_FPS_DEN);
+    }
+
+    u8 *y_plane = video_planes;
+    u8 *u_plane = y_plane + plane_size;
+    u8 *v_plane = u_plane + plane_size;
+
+    // ITU-R BT.601, limited range
+    for (size_t i = 0; i < plane_size; i++)
+    {
+        int r = *src++;
+        int g = *src++;
+        int b = *src++;
+
+        y_plane[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        u_plane[i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+        v_plane[i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+
+    fprintf(video_file, "FRAME\n");
+    if (fwrite(video_planes, plane_size * 3, 1, video_file) != 1)
+        return 1;
+
+    return 0;
+}
+
+// Returns 0 on success. It doesn't need the mutex to be locked.
+static int ImageWriter_JobRun(_image_writer_job_ *job)
+{
+    const u8 *src = ImageWriter_JobBuffer(job);
+
+    if (job->type == IMAGE_JOB_PNG)
+    {
+        return Save_PNG(job->path, (unsigned char *)src, job->width,
+                        job->height, job->is_rgba);
+    }
+
+    if (video_y4m)
+        return ImageWriter_VideoWriteY4M(src, job->width, job->height);
+
+    size_t size = (size_t)job->width * job->height * 3;
+    if (fwrite(src, size, 1, video_file) != 1)
+        return 1;
+
+    return 0;
+}
+
+// Returns the first job that can be started, or NULL. The mutex must be locked.
+static _image_writer_job_ *ImageWriter_JobTake(void)
+{
+    _image_writer_job_ **next = &image_writer_queue;
+
+    while (*next)
+    {
+        _image_writer_job_ *job = *next;
+
+        if ((job->type != IMAGE_JOB_VIDEO_FRAME) || (video_busy == 0))
+        {
+            *next = job->next;
+            return job;
+        }
+
+        next = &job->next;
+    }
+
+    return NULL;
+}
+
+static int ImageWriter_Thread(unused__ void *arg)
+{
+    SDL_LockMutex(image_writer_mutex);
+
+    while (1)
+    {
+        _image_writer_job_ *job = ImageWriter_JobTake();
+
+        if (job == NULL)
+        {
+            if (image_writer_quit && (image_writer_queue == NULL))
+                break;
+
+            SDL_CondWait(image_writer_work_cond, image_writer_mutex);
+            continue;
+        }
+
+        int is_video = (job->type == IMAGE_JOB_VIDEO_FRAME);
+        if (is_video)
+            video_busy = 1;
+        image_writer_busy++;
+
+        SDL_UnlockMutex(image_writer_mutex);
+
+        int error = ImageWriter_JobRun(job);
+
+        SDL_LockMutex(image_writer_mutex);
+
+        if (error)
+            ImageWriter_SetError(job->path);
+
+        if (is_video)
+        {
+            video_busy = 0;
+            // Other threads may be waiting for this one to finish
+            SDL_CondBroadcast(image_writer_work_cond);
+        }
+
+        image_writer_busy--;
+        ImageWriter_JobRelease(job);
+
+        SDL_CondBroadcast(image_writer_done_cond);
+    }
+
+    SDL_UnlockMutex(image_writer_mutex);
+
+    return 0;
+}
+
+//----------------------------------------------------------------------------
+
+void ImageWriter_Init(void)
+{
+    image_writer_mutex = SDL_CreateMutex();
+    image_writer_work_cond = SDL_CreateCond();
+    image_writer_done_cond = SDL_CreateCond();
+
+    if ((image_writer_mutex == NULL) || (image_writer_work_cond == NULL)
+        || (image_writer_done_cond == NULL))
+    {
+        Debug_LogMsgArg("%s(): %s", __func__, SDL_GetError());
+        ImageWriter_End();
+        return;
+    }
+
+    // Leave one CPU for the emulation
+    int threads = SDL_GetCPUCount() - 1;
+    if (threads < 1)
+        threads = 1;
+    if (threads > IMAGE_WRITER_MAX_THREADS)
+        threads = IMAGE_WRITER_MAX_THREADS;
+
+    image_writer_quit = 0;
+
+    for (int i = 0; i < threads; i++)
+    {
+        SDL_Thread *thread = SDL_CreateThread(ImageWriter_Thread,
+                                              "Image writer", NULL);
+        if (thread == NULL)
+        {
+            Debug_LogMsgArg("%s(): %s", __func__, SDL_GetError());
+            break;
+        }
+
+        image_writer_thread[image_writer_num_threads++] = thread;
+    }
+
+    // Not fatal, images will be written from the main thread
+    if (image_writer_num_threads == 0)
+        ImageWriter_End();
+}
+
+void ImageWriter_End(void)
+{
+    ImageWriter_VideoStop();
+
+    if (image_writer_num_threads > 0)
+    {
+        SDL_LockMutex(image_writer_mutex);
+        image_writer_quit = 1;
+        SDL_CondBroadcast(image_writer_work_cond);
+        SDL_UnlockMutex(image_writer_mutex);
+
+        for (int i = 0; i < image_writer_num_threads; i++)
+            SDL_WaitThread(image_writer_thread[i], NULL);
+
+        image_writer_num_threads = 0;
+    }
+
+    ImageWriter_ReportErrors();
+
+    if (image_writer_done_cond)
+        SDL_DestroyCond(image_writer_done_cond);
+    if (image_writer_work_cond)
+        SDL_DestroyCond(image_writer_work_cond);
+    if (image_writer_mutex)
+        SDL_DestroyMutex(image_writer_mutex);
+
+    image_writer_done_cond = NULL;
+    image_writer_work_cond = NULL;
+    image_writer_mutex = NULL;
+
+    while (image_writer_pool)
+    {
+        _image_writer_job_ *job = image_writer_pool;
+        image_writer_pool = job->next;
+        free(job);
+    }
+    image_writer_pool_count = 0;
+}
+
+void *ImageWriter_BufferGet(size_t size)
+{
+    ImageWriter_ReportErrors();
+
+    int threaded = (image_writer_num_threads > 0);
+
+    if (threaded)
+    {
+        SDL_LockMutex(image_writer_mutex);
+
+        // Wait if there are too many images waiting, but never wait if there
+        // are no images at all, or big images would wait forever.
+        while ((image_writer_memory > 0)
+               && (image_writer_memory + size > IMAGE_WRITER_MAX_MEMORY))
+        {
+            SDL_CondWait(image_writer_done_cond, image_writer_mutex);
+        }
+    }
+
+    _image_writer_job_ *job = NULL;
+
+    _image_writer_job_ **next = &image_writer_pool;
+    while (*next)
+    {
+        if ((*next)->capacity >= size)
+        {
+            job = *next;
+            *next = job->next;
+            image_writer_pool_count--;
+            break;
+        }
+        next = &(*next)->next;
+    }
+
+    if (job == NULL)
+    {
+        job = malloc(sizeof(_image_writer_job_) + size);
+        if (job != NULL)
+            job->capacity = size;
+    }
+
+    if (job != NULL)
+        image_writer_memory += job->capacity;
+
+    if (threaded)
+        SDL_UnlockMutex(image_writer_mutex);
+
+    if (job == NULL)
+    {
+        Debug_ErrorMsgArg("%s(): Not enough memory.", __func__);
+        return NULL;
+    }
+
+    return ImageWriter_JobBuffer(job);
+}
+
+static void ImageWriter_JobQueue(_image_writer_job_ *job)
+{
+    job->next = NULL;
+
+    if (image_writer_num_threads == 0)
+    {
+        if (ImageWriter_JobRun(job) != 0)
+            ImageWriter_SetError(job->path);
+        ImageWriter_JobRelease(job);
+        ImageWriter_ReportErrors();
+        return;
+    }
+
+    SDL_LockMutex(image_writer_mutex);
+
+    _image_writer_job_ **next = &image_writer_queue;
+    while (*next)
+        next = &(*next)->next;
+    *next = job;
+
+    SDL_CondSignal(image_writer_work_cond);
+    SDL_UnlockMutex(image_writer_mutex);
+}
+
+void ImageWriter_SavePNG(const char *path, void *buffer,
+                         int width, int height, int is_rgba)
+{
+    _image_writer_job_ *job = ImageWriter_JobFromBuffer(buffer);
+
+    job->type = IMAGE_JOB_PNG;
+    s_strncpy(job->path, path, sizeof(job->path));
+    job->width = width;
+    job->height = height;
+    job->is_rgba = is_rgba;
+
+    ImageWriter_JobQueue(job);
+}
+
+void ImageWriter_Flush(void)
+{
+    if (image_writer_num_threads > 0)
+    {
+        SDL_LockMutex(image_writer_mutex);
+        while ((image_writer_queue != NULL) || (image_writer_busy > 0))
+            SDL_CondWait(image_writer_done_cond, image_writer_mutex);
+        SDL_UnlockMutex(image_writer_mutex);
+    }
+
+    ImageWriter_ReportErrors();
+}
+
+//----------------------------------------------------------------------------
+
+int ImageWriter_VideoStart(const char *path)
+{
+    ImageWriter_VideoStop();
+
+    video_file = fopen(path, "wb");
+    if (video_file == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't open video file:\n%s", path);
+        return 1;
+    }
+
+    s_strncpy(video_path, path, sizeof(video_path));
+
+    video_y4m = 0;
+    size_t len = strlen(path);
+    if (len > 4)
+    {
+        const char *ext = &path[len - 4];
+        if ((ext[0] == '.') && (tolower(ext[1]) == 'y') && (ext[2] == '4')
+            && (tolower(ext[3]) == 'm'))
+        {
+            video_y4m = 1;
+        }
+    }
+
+    video_width = 0;
+    video_height = 0;
+    video_size_warned = 0;
+
+    return 0;
+}
+
+void ImageWriter_VideoStop(void)
+{
+    if (video_file == NULL)
+        return;
+
+    // Wait until all frames have been written
+    ImageWriter_Flush();
+
+    fclose(video_file);
+    video_file = NULL;
+
+    free(video_planes);
+    video_planes = NULL;
+}
+
+int ImageWriter_VideoIsRecording(void)
+{
+    return video_file != NULL;
+}
+
+void ImageWriter_VideoFrame(void *buffer, int width, int height)
+{
+    _image_writer_job_ *job = ImageWriter_JobFromBuffer(buffer);
+
+    if (video_width == 0)
+    {
+        video_width = width;
+        video_height = height;
+    }
+
+    if ((video_file == NULL)
+        || (video_width != width) || (video_height != height))
+    {
+        if ((video_file != NULL) && (video_size_warned == 0))
+        {
+            Debug_LogMsgArg("%s(): Frame size changed, frames skipped",
+                            __func__);
+            video_size_warned = 1;
+        }
+
+        if (image_writer_mutex)
+            SDL_LockMutex(image_writer_mutex);
+        ImageWriter_JobRelease(job);
+        if (image_writer_mutex)
+            SDL_UnlockMutex(image_writer_mutex);
+        return;
+    }
+
+    job->type = IMAGE_JOB_VIDEO_FRAME;
+    s_strncpy(job->path, video_path, sizeof(job->path));
+    job->width = width;
+    job->height = height;
+    job->is_rgba = 0;
+
+    ImageWriter_JobQueue(job);
+}
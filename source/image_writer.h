@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef IMAGE_WRITER__
+#define IMAGE_WRITER__
+
+#include <stddef.h>
+
+// Encodes screenshots and video frames in worker threads so that the emulation
+// doesn't wait for them. Images are copied into buffers taken from a pool. If
+// the images waiting to be encoded use too much memory, getting a new buffer
+// waits until some of them have been written.
+
+void ImageWriter_Init(void);
+// Waits for all pending images and stops the threads
+void ImageWriter_End(void);
+
+// Returns a buffer of at least "size" bytes, or NULL if there isn't enough
+// memory. It must be passed to one of the functions below, which take
+// ownership of it.
+void *ImageWriter_BufferGet(size_t size);
+
+// Saves a 24-bit RGB or 32-bit RGBA image as a PNG file
+void ImageWriter_SavePNG(const char *path, void *buffer,
+                         int width, int height, int is_rgba);
+
+// Video streams are written as raw 24-bit RGB frames, or as YUV4MPEG2 (4:4:4)
+// if the name of the file ends in ".y4m". Returns 0 on success.
+int ImageWriter_VideoStart(const char *path);
+void ImageWriter_VideoStop(void);
+int ImageWriter_VideoIsRecording(void);
+// Adds a 24-bit RGB frame to the video stream. All frames must have the same
+// size as the first one.
+void ImageWriter_VideoFrame(void *buffer, int width, int height);
+
+// Waits until all pending images have been written
+void ImageWriter_Flush(void);
+
+#endif // IMAGE_WRITER__
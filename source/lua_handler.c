@@ -4,6 +4,10 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <SDL2/SDL.h>
 
 #ifdef ENABLE_LUA
@@ -12,13 +16,30 @@
 # include <lauxlib.h>
 #endif
 
+#include "gb_core/camera.h"
+#include "gb_core/debug.h"
+#include "gb_core/gameboy.h"
+#include "gb_core/gb_main.h"
+#include "gb_core/memory.h"
+#include "gb_core/ppu.h"
+#include "gb_core/sound.h"
+#include "gb_core/state.h"
+#include "gb_core/video.h"
+
+#include "gba_core/cpu.h"
+#include "gba_core/disassembler.h"
 #include "gba_core/gba.h"
+#include "gba_core/interrupts.h"
+#include "gba_core/memory.h"
 #include "gba_core/sound.h"
+#include "gba_core/state.h"
+#include "gba_core/video.h"
 
 #include "gui/win_main.h"
 
 #include "debug_utils.h"
 #include "general_utils.h"
+#include "image_writer.h"
 #include "sound_utils.h"
 #include "wav_utils.h"
 #include "window_handler.h"
@@ -30,8 +51,220 @@ static int script_running = 0;
 
 static uint16_t lua_keyinput = 0;
 
+extern _GB_CONTEXT_ GameBoy;
+
+// ----------------------------------------------------------------------------
+
+// Callbacks are stored in the registry of the Lua state. They are called from
+// the emulation loop, which runs in the thread of the script, so they can read
+// and modify the state of the emulated system in the middle of a frame.
+
+static lua_State *script_state = NULL;
+static int script_in_callback = 0;
+static lua_Integer script_frame_count = 0;
+
+static int script_frame_cb = LUA_NOREF;
+static int script_scanline_cb = LUA_NOREF;
+static int script_pc_hooks = LUA_NOREF; // Table: address -> function
+
+// Calls the function at the top of the stack with one integer argument. Errors
+// are logged, but they don't stop the script.
+static void Script_CallbackRun(lua_State *L, const char *name, lua_Integer arg)
+{
+    // Accesses done by the callbacks shouldn't trigger watchpoints
+    int gba_armed = gba_debug_watchpoints_armed;
+    int gb_armed = gb_debug_watchpoints_armed;
+    GBA_DebugWatchpointsArm(0);
+    GB_DebugWatchpointsArm(0);
+
+    int old_in_callback = script_in_callback;
+    script_in_callback = 1;
+
+    lua_pushinteger(L, arg);
+    if (lua_pcall(L, 1, 0, 0) != 0)
+    {
+        Debug_LogMsgArg("Callback %s(%lld) failed: %s", name, (long long)arg,
+                        lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+
+    script_in_callback = old_in_callback;
+
+    GBA_DebugWatchpointsArm(gba_armed);
+    GB_DebugWatchpointsArm(gb_armed);
+}
+
+static void Script_FrameHook(void)
+{
+    lua_State *L = script_state;
+
+    if (script_frame_cb == LUA_NOREF)
+        return;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, script_frame_cb);
+    Script_CallbackRun(L, "frame", script_frame_count);
+}
+
+static void Script_ScanlineHook(u32 ly)
+{
+    lua_State *L = script_state;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, script_scanline_cb);
+    Script_CallbackRun(L, "scanline", ly);
+}
+
+static void Script_PCHook(u32 addr)
+{
+    lua_State *L = script_state;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, script_pc_hooks);
+    lua_pushinteger(L, addr);
+    lua_rawget(L, -2);
+    lua_remove(L, -2); // Remove table
+
+    if (lua_isfunction(L, -1))
+        Script_CallbackRun(L, "pc", addr);
+    else
+        lua_pop(L, 1);
+}
+
+static void Script_HooksInit(lua_State *L)
+{
+    script_state = L;
+    script_frame_count = 0;
+
+    lua_newtable(L);
+    script_pc_hooks = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    GBA_DebugPCHookHandlerSet(Script_PCHook);
+    GB_DebugPCHookHandlerSet(Script_PCHook);
+}
+
+static void Script_HooksEnd(void)
+{
+    GBA_ScanlineHookSet(NULL);
+    GB_PPUScanlineHookSet(NULL);
+
+    GBA_DebugClearPCHookAll();
+    GB_DebugClearPCHookAll();
+    GBA_DebugPCHookHandlerSet(NULL);
+    GB_DebugPCHookHandlerSet(NULL);
+
+    // The references are freed when the Lua state is closed
+    script_frame_cb = LUA_NOREF;
+    script_scanline_cb = LUA_NOREF;
+    script_pc_hooks = LUA_NOREF;
+    script_state = NULL;
+}
+
+// Replaces the function saved in "ref" by the argument at index "arg" of the
+// stack. Returns 0 on success, 1 if the argument isn't a function or nil.
+static int Script_CallbackSet(lua_State *L, int arg, int *ref)
+{
+    if (!lua_isfunction(L, arg) && !lua_isnil(L, arg))
+        return 1;
+
+    luaL_unref(L, LUA_REGISTRYINDEX, *ref);
+    *ref = LUA_NOREF;
+
+    if (lua_isfunction(L, arg))
+    {
+        lua_pushvalue(L, arg);
+        *ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    return 0;
+}
+
 // ----------------------------------------------------------------------------
 
+static void Script_RunOneFrame(void)
+{
+    if (Win_MainRunningGBA())
+    {
+        GBA_SoundResetBufferPointers();
+        GBA_RunForOneFrame();
+        GBA_SoundSaveToWAV();
+    }
+    else if (Win_MainRunningGB())
+    {
+        GB_SoundResetBufferPointers();
+        GB_RunForOneFrame();
+        GB_CameraWebcamDelayDecrease();
+        GB_SoundSaveToWAV();
+    }
+    else
+    {
+        return;
+    }
+
+    script_frame_count++;
+
+    Script_FrameHook();
+}
+
+// Memory is read like the debugger windows do, without side effects when
+// possible. Accesses are little endian in both systems.
+static u32 Script_MemRead(u32 address, int size)
+{
+    if (Win_MainRunningGB())
+    {
+        u32 value = 0;
+        for (int i = 0; i < size; i++)
+            value |= GB_MemRead8((address + i) & 0xFFFF) << (i * 8);
+        return value;
+    }
+
+    if (size == 1)
+        return GBA_MemoryReadFast8(address);
+    else if (size == 2)
+        return GBA_MemoryReadFast16(address);
+    else
+        return GBA_MemoryReadFast32(address);
+}
+
+static void Script_MemWrite(u32 address, u32 value, int size)
+{
+    if (Win_MainRunningGB())
+    {
+        for (int i = 0; i < size; i++)
+            GB_MemWrite8((address + i) & 0xFFFF, (value >> (i * 8)) & 0xFF);
+        return;
+    }
+
+    if (size == 1)
+        GBA_MemoryWrite8(address, value);
+    else if (size == 2)
+        GBA_MemoryWrite16(address, value);
+    else
+        GBA_MemoryWrite32(address, value);
+}
+
+static void Script_MemReadBlock(u32 address, u8 *dest, size_t size)
+{
+    while (size > 0)
+    {
+        if (Win_MainRunningGBA())
+        {
+            // Plain memory can be copied in one go
+            u32 avail;
+            u8 *src = GBA_MemoryGetHostPointer(address, &avail, 0);
+            if (src != NULL)
+            {
+                size_t len = (size < avail) ? size : avail;
+                memcpy(dest, src, len);
+                address += len;
+                dest += len;
+                size -= len;
+                continue;
+            }
+        }
+
+        *dest++ = Script_MemRead(address++, 1);
+        size--;
+    }
+}
+
 static int lua_run_frames_and_pause(lua_State *L)
 {
     // Number of arguments
@@ -48,16 +281,15 @@ static int lua_run_frames_and_pause(lua_State *L)
 
     Debug_LogMsgArg("%s(%lld)", __func__, frames);
 
-    for (int i = 0; i < frames; i++)
+    if (script_in_callback)
     {
-        if (Win_MainRunningGBA())
-        {
-            GBA_SoundResetBufferPointers();
-            GBA_RunForOneFrame();
-            GBA_SoundSaveToWAV();
-        }
+        Debug_LogMsgArg("%s(): Can't be called from a callback", __func__);
+        return 0;
     }
 
+    for (int i = 0; i < frames; i++)
+        Script_RunOneFrame();
+
     // Number of results
     return 0;
 }
@@ -69,14 +301,20 @@ static int lua_screenshot(lua_State *L)
     if (narg == 0)
     {
         Debug_LogMsgArg("%s()", __func__);
-        GBA_Screenshot("screenshot.png");
+        if (Win_MainRunningGB())
+            GB_Screenshot("screenshot.png");
+        else
+            GBA_Screenshot("screenshot.png");
     }
     else if (narg == 1)
     {
         const char *name = lua_tostring(L, -1);
 
         Debug_LogMsgArg("%s(%s)", __func__, name);
-        GBA_Screenshot(name);
+        if (Win_MainRunningGB())
+            GB_Screenshot(name);
+        else
+            GBA_Screenshot(name);
 
         lua_pop(L, 1);
     }
@@ -90,6 +328,20 @@ static int lua_screenshot(lua_State *L)
     return 0;
 }
 
+static void Script_KeysUpdate(void)
+{
+    if (Win_MainRunningGB())
+    {
+        u16 k = lua_keyinput;
+        GB_InputSet(0, k & BIT(0), k & BIT(1), k & BIT(3), k & BIT(2),
+                    k & BIT(4), k & BIT(5), k & BIT(6), k & BIT(7));
+    }
+    else
+    {
+        GBA_HandleInputFlags(lua_keyinput);
+    }
+}
+
 uint16_t get_bit_from_key_name(const char *name)
 {
     struct {
@@ -140,7 +392,7 @@ static int lua_keys_hold(lua_State *L)
 
     lua_keyinput |= keys;
 
-    GBA_HandleInputFlags(lua_keyinput);
+    Script_KeysUpdate();
 
     // Number of results
     return 0;
@@ -168,7 +420,7 @@ static int lua_keys_release(lua_State *L)
 
     lua_keyinput &= ~keys;
 
-    GBA_HandleInputFlags(lua_keyinput);
+    Script_KeysUpdate();
 
     // Number of results
     return 0;
@@ -181,14 +433,16 @@ static int lua_wav_record_start(lua_State *L)
     if (narg == 0)
     {
         Debug_LogMsgArg("%s()", __func__);
-        WAV_FileStart(NULL, GBA_SAMPLERATE);
+        WAV_FileStart(NULL, Win_MainRunningGB() ? GB_SAMPLERATE
+                                                : GBA_SAMPLERATE);
     }
     else if (narg == 1)
     {
         const char *name = lua_tostring(L, -1);
 
         Debug_LogMsgArg("%s(%s)", __func__, name);
-        WAV_FileStart(name, GBA_SAMPLERATE);
+        WAV_FileStart(name, Win_MainRunningGB() ? GB_SAMPLERATE
+                                                : GBA_SAMPLERATE);
 
         lua_pop(L, 1);
     }
@@ -222,6 +476,568 @@ static int lua_wav_record_end(lua_State *L)
     return 0;
 }
 
+static int lua_video_record_start(lua_State *L)
+{
+    // Number of arguments
+    int narg = lua_gettop(L);
+    if (narg == 0)
+    {
+        Debug_LogMsgArg("%s()", __func__);
+        ImageWriter_VideoStart("video.y4m");
+    }
+    else if (narg == 1)
+    {
+        const char *name = lua_tostring(L, -1);
+
+        Debug_LogMsgArg("%s(%s)", __func__, name);
+        ImageWriter_VideoStart(name);
+
+        lua_pop(L, 1);
+    }
+    else
+    {
+        Debug_LogMsgArg("%s(): Invalid number of arguments: %d", __func__,
+                        narg);
+        return 0;
+    }
+
+    // Number of results
+    return 0;
+}
+
+static int lua_video_record_end(lua_State *L)
+{
+    // Number of arguments
+    int narg = lua_gettop(L);
+    if (narg != 0)
+    {
+        Debug_LogMsgArg("%s(): Invalid number of arguments: %d", __func__,
+                        narg);
+        return 0;
+    }
+
+    Debug_LogMsgArg("%s()", __func__);
+
+    ImageWriter_VideoStop();
+
+    // Number of results
+    return 0;
+}
+
+// Returns 0 if the number of arguments is between min and max (included)
+static int Script_ArgsCheck(lua_State *L, const char *func, int min, int max)
+{
+    int narg = lua_gettop(L);
+    if ((narg < min) || (narg > max))
+    {
+        Debug_LogMsgArg("%s(): Invalid number of arguments: %d", func, narg);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int lua_read_size(lua_State *L, const char *func, int size)
+{
+    if (Script_ArgsCheck(L, func, 1, 1))
+        return 0;
+
+    u32 address = lua_tointeger(L, 1);
+    lua_pushinteger(L, Script_MemRead(address, size));
+
+    // Number of results
+    return 1;
+}
+
+static int lua_read8(lua_State *L)
+{
+    return lua_read_size(L, __func__, 1);
+}
+
+static int lua_read16(lua_State *L)
+{
+    return lua_read_size(L, __func__, 2);
+}
+
+static int lua_read32(lua_State *L)
+{
+    return lua_read_size(L, __func__, 4);
+}
+
+static int lua_write_size(lua_State *L, const char *func, int size)
+{
+    if (Script_ArgsCheck(L, func, 2, 2))
+        return 0;
+
+    u32 address = lua_tointeger(L, 1);
+    u32 value = lua_tointeger(L, 2);
+    Script_MemWrite(address, value, size);
+
+    // Number of results
+    return 0;
+}
+
+static int lua_write8(lua_State *L)
+{
+    return lua_write_size(L, __func__, 1);
+}
+
+static int lua_write16(lua_State *L)
+{
+    return lua_write_size(L, __func__, 2);
+}
+
+static int lua_write32(lua_State *L)
+{
+    return lua_write_size(L, __func__, 4);
+}
+
+// read_block(address, size) returns a string with the contents of the memory
+static int lua_read_block(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 2, 2))
+        return 0;
+
+    u32 address = lua_tointeger(L, 1);
+    lua_Integer size = lua_tointeger(L, 2);
+    if (size < 0)
+    {
+        Debug_LogMsgArg("%s(): Invalid size: %lld", __func__, (long long)size);
+        return 0;
+    }
+
+    luaL_Buffer b;
+    char *dest = luaL_buffinitsize(L, &b, size);
+    Script_MemReadBlock(address, (u8 *)dest, size);
+    luaL_pushresultsize(&b, size);
+
+    // Number of results
+    return 1;
+}
+
+// write_block(address, string) writes the bytes of the string to memory
+static int lua_write_block(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 2, 2))
+        return 0;
+
+    u32 address = lua_tointeger(L, 1);
+    size_t size;
+    const char *src = lua_tolstring(L, 2, &size);
+    if (src == NULL)
+    {
+        Debug_LogMsgArg("%s(): Data isn't a string", __func__);
+        return 0;
+    }
+
+    for (size_t i = 0; i < size; i++)
+        Script_MemWrite(address + i, (u8)src[i], 1);
+
+    // Number of results
+    return 0;
+}
+
+// read_many({ addresses }, [size]) returns a table with the value of each
+// address. The size of the accesses is 1 byte unless it's specified.
+static int lua_read_many(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 1, 2))
+        return 0;
+
+    if (!lua_istable(L, 1))
+    {
+        Debug_LogMsgArg("%s(): Addresses must be a table", __func__);
+        return 0;
+    }
+
+    int size = 1;
+    if (lua_gettop(L) == 2)
+        size = lua_tointeger(L, 2);
+
+    if ((size != 1) && (size != 2) && (size != 4))
+    {
+        Debug_LogMsgArg("%s(): Invalid size: %d", __func__, size);
+        return 0;
+    }
+
+    int num = lua_rawlen(L, 1);
+    lua_createtable(L, num, 0);
+
+    for (int i = 1; i <= num; i++)
+    {
+        lua_rawgeti(L, 1, i);
+        u32 address = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+
+        lua_pushinteger(L, Script_MemRead(address, size));
+        lua_rawseti(L, -2, i);
+    }
+
+    // Number of results
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+// GBA registers: r0-r15, sp, lr, pc, cpsr and spsr. Returns the index in the
+// array of registers, 16 for CPSR, 17 for SPSR or -1 if the name is unknown.
+static int Script_GBARegIndex(const char *name)
+{
+    if (strcmp(name, "sp") == 0)
+        return R_SP;
+    if (strcmp(name, "lr") == 0)
+        return R_LR;
+    if (strcmp(name, "pc") == 0)
+        return R_PC;
+    if (strcmp(name, "cpsr") == 0)
+        return 16;
+    if (strcmp(name, "spsr") == 0)
+        return 17;
+
+    if (name[0] == 'r')
+    {
+        char *end;
+        long index = strtol(&name[1], &end, 10);
+        if ((end != &name[1]) && (*end == '\0') && (index >= 0)
+            && (index < 16))
+            return index;
+    }
+
+    return -1;
+}
+
+static u32 Script_GBARegGet(int index)
+{
+    _cpu_t *cpu = GBA_CPUGet();
+
+    if (index < 16)
+        return cpu->R[index];
+    else if (index == 16)
+        return cpu->CPSR;
+    else
+        return cpu->SPSR;
+}
+
+// Same as when a register is modified from the debugger
+static void Script_GBARegSet(int index, u32 value)
+{
+    _cpu_t *cpu = GBA_CPUGet();
+
+    if (index < 16)
+    {
+        cpu->R[index] = value;
+    }
+    else if (index == 16)
+    {
+        cpu->CPSR = value;
+
+        if (cpu->CPSR & F_T)
+            cpu->EXECUTION_MODE = EXEC_THUMB;
+        else
+            cpu->EXECUTION_MODE = EXEC_ARM;
+
+        GBA_CPUChangeMode(value & 0x1F);
+    }
+    else
+    {
+        cpu->SPSR = value;
+    }
+}
+
+typedef struct {
+    const char *name;
+    u32 *r16; // Only one of the two pointers is used
+    u8 *r8;
+    u32 mask; // The lower bits of F are always 0
+} _script_gb_reg_;
+
+// GB registers. The 16-bit registers go first.
+static const _script_gb_reg_ script_gb_regs[] = {
+    { "af", &GameBoy.CPU.R16.AF, NULL, 0xFFF0 },
+    { "bc", &GameBoy.CPU.R16.BC, NULL, 0xFFFF },
+    { "de", &GameBoy.CPU.R16.DE, NULL, 0xFFFF },
+    { "hl", &GameBoy.CPU.R16.HL, NULL, 0xFFFF },
+    { "sp", &GameBoy.CPU.R16.SP, NULL, 0xFFFF },
+    { "pc", &GameBoy.CPU.R16.PC, NULL, 0xFFFF },
+    { "a", NULL, &GameBoy.CPU.R8.A, 0xFF },
+    { "f", NULL, &GameBoy.CPU.R8.F, 0xF0 },
+    { "b", NULL, &GameBoy.CPU.R8.B, 0xFF },
+    { "c", NULL, &GameBoy.CPU.R8.C, 0xFF },
+    { "d", NULL, &GameBoy.CPU.R8.D, 0xFF },
+    { "e", NULL, &GameBoy.CPU.R8.E, 0xFF },
+    { "h", NULL, &GameBoy.CPU.R8.H, 0xFF },
+    { "l", NULL, &GameBoy.CPU.R8.L, 0xFF },
+};
+
+#define SCRIPT_GB_REGS_16   (6)
+#define SCRIPT_GB_REGS_NUM  (sizeof(script_gb_regs) / sizeof(script_gb_regs[0]))
+
+static const _script_gb_reg_ *Script_GBRegFind(const char *name)
+{
+    for (size_t i = 0; i < SCRIPT_GB_REGS_NUM; i++)
+    {
+        if (strcmp(name, script_gb_regs[i].name) == 0)
+            return &script_gb_regs[i];
+    }
+
+    return NULL;
+}
+
+static int lua_get_reg(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 1, 1))
+        return 0;
+
+    const char *name = lua_tostring(L, 1);
+    if (name == NULL)
+        return 0;
+
+    if (Win_MainRunningGB())
+    {
+        const _script_gb_reg_ *reg = Script_GBRegFind(name);
+        if (reg == NULL)
+            goto unknown;
+
+        lua_pushinteger(L, reg->r16 ? *reg->r16 : *reg->r8);
+    }
+    else
+    {
+        int index = Script_GBARegIndex(name);
+        if (index < 0)
+            goto unknown;
+
+        lua_pushinteger(L, Script_GBARegGet(index));
+    }
+
+    // Number of results
+    return 1;
+
+unknown:
+    Debug_LogMsgArg("%s(): Unknown register: %s", __func__, name);
+    return 0;
+}
+
+static int lua_set_reg(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 2, 2))
+        return 0;
+
+    const char *name = lua_tostring(L, 1);
+    if (name == NULL)
+        return 0;
+
+    u32 value = lua_tointeger(L, 2);
+
+    if (Win_MainRunningGB())
+    {
+        const _script_gb_reg_ *reg = Script_GBRegFind(name);
+        if (reg == NULL)
+            goto unknown;
+
+        if (reg->r16)
+            *reg->r16 = value & reg->mask;
+        else
+            *reg->r8 = value & reg->mask;
+    }
+    else
+    {
+        int index = Script_GBARegIndex(name);
+        if (index < 0)
+            goto unknown;
+
+        Script_GBARegSet(index, value);
+    }
+
+    // Number of results
+    return 0;
+
+unknown:
+    Debug_LogMsgArg("%s(): Unknown register: %s", __func__, name);
+    return 0;
+}
+
+// Returns a table with all the registers of the CPU
+static int lua_get_regs(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 0, 0))
+        return 0;
+
+    lua_newtable(L);
+
+    if (Win_MainRunningGB())
+    {
+        for (int i = 0; i < SCRIPT_GB_REGS_16; i++)
+        {
+            lua_pushinteger(L, *script_gb_regs[i].r16);
+            lua_setfield(L, -2, script_gb_regs[i].name);
+        }
+    }
+    else
+    {
+        char name[4];
+        for (int i = 0; i < 16; i++)
+        {
+            snprintf(name, sizeof(name), "r%d", i);
+            lua_pushinteger(L, Script_GBARegGet(i));
+            lua_setfield(L, -2, name);
+        }
+
+        lua_pushinteger(L, Script_GBARegGet(16));
+        lua_setfield(L, -2, "cpsr");
+        lua_pushinteger(L, Script_GBARegGet(17));
+        lua_setfield(L, -2, "spsr");
+    }
+
+    // Number of results
+    return 1;
+}
+
+// Returns the hash of the last frame as a string, like in the frame hash logs
+static int lua_frame_hash(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 0, 0))
+        return 0;
+
+    u64 hash = Win_MainRunningGB() ? GB_ScreenHash() : GBA_ScreenHash();
+
+    char str[17];
+    snprintf(str, sizeof(str), "%08X%08X", (u32)(hash >> 32), (u32)hash);
+    lua_pushstring(L, str);
+
+    // Number of results
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+// The snapshot is kept in memory, and it's only valid while the same ROM is
+// loaded. The functions return true on success.
+static int lua_save_state(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 0, 0))
+        return 0;
+
+    if (script_in_callback)
+    {
+        Debug_LogMsgArg("%s(): Can't be called from a callback", __func__);
+        return 0;
+    }
+
+    int ret = Win_MainRunningGB() ? GB_StateSave() : GBA_StateSave();
+    lua_pushboolean(L, ret == 0);
+
+    // Number of results
+    return 1;
+}
+
+static int lua_load_state(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 0, 0))
+        return 0;
+
+    if (script_in_callback)
+    {
+        Debug_LogMsgArg("%s(): Can't be called from a callback", __func__);
+        return 0;
+    }
+
+    int ret = Win_MainRunningGB() ? GB_StateLoad() : GBA_StateLoad();
+    lua_pushboolean(L, ret == 0);
+
+    // Number of results
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+
+// on_frame(function) calls the function after every frame with the number of
+// frames run since the start of the script. nil removes the callback.
+static int lua_on_frame(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 1, 1))
+        return 0;
+
+    if (Script_CallbackSet(L, 1, &script_frame_cb) != 0)
+        Debug_LogMsgArg("%s(): Argument isn't a function", __func__);
+
+    // Number of results
+    return 0;
+}
+
+// on_scanline(function) calls the function with the number of the scanline
+// after drawing each visible scanline. nil removes the callback.
+static int lua_on_scanline(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 1, 1))
+        return 0;
+
+    if (Script_CallbackSet(L, 1, &script_scanline_cb) != 0)
+    {
+        Debug_LogMsgArg("%s(): Argument isn't a function", __func__);
+        return 0;
+    }
+
+    if (script_scanline_cb == LUA_NOREF)
+    {
+        GBA_ScanlineHookSet(NULL);
+        GB_PPUScanlineHookSet(NULL);
+    }
+    else
+    {
+        GBA_ScanlineHookSet(Script_ScanlineHook);
+        GB_PPUScanlineHookSet(Script_ScanlineHook);
+    }
+
+    // Number of results
+    return 0;
+}
+
+// on_pc(address, function) calls the function with the address as argument
+// right before the CPU executes the instruction at that address. nil removes
+// the callback.
+static int lua_on_pc(lua_State *L)
+{
+    if (Script_ArgsCheck(L, __func__, 2, 2))
+        return 0;
+
+    if (!lua_isfunction(L, 2) && !lua_isnil(L, 2))
+    {
+        Debug_LogMsgArg("%s(): Argument isn't a function", __func__);
+        return 0;
+    }
+
+    // Hooks are checked with the same granularity as breakpoints
+    u32 address = lua_tointeger(L, 1);
+    if (Win_MainRunningGB())
+        address &= 0xFFFF;
+    else
+        address &= ~1;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, script_pc_hooks);
+    lua_pushinteger(L, address);
+    lua_pushvalue(L, 2);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+
+    if (lua_isfunction(L, 2))
+    {
+        if (Win_MainRunningGB())
+            GB_DebugAddPCHook(address);
+        else
+            GBA_DebugAddPCHook(address);
+    }
+    else
+    {
+        if (Win_MainRunningGB())
+            GB_DebugClearPCHook(address);
+        else
+            GBA_DebugClearPCHook(address);
+    }
+
+    // Number of results
+    return 0;
+}
+
 static int lua_exit(lua_State *L)
 {
     // Number of arguments
@@ -267,17 +1083,38 @@ static int Script_Runner(unused__ void *ptr)
     lua_register(L, "keys_release", lua_keys_release);
     lua_register(L, "wav_record_start", lua_wav_record_start);
     lua_register(L, "wav_record_end", lua_wav_record_end);
+    lua_register(L, "video_record_start", lua_video_record_start);
+    lua_register(L, "video_record_end", lua_video_record_end);
+    lua_register(L, "read8", lua_read8);
+    lua_register(L, "read16", lua_read16);
+    lua_register(L, "read32", lua_read32);
+    lua_register(L, "write8", lua_write8);
+    lua_register(L, "write16", lua_write16);
+    lua_register(L, "write32", lua_write32);
+    lua_register(L, "read_block", lua_read_block);
+    lua_register(L, "write_block", lua_write_block);
+    lua_register(L, "read_many", lua_read_many);
+    lua_register(L, "get_reg", lua_get_reg);
+    lua_register(L, "set_reg", lua_set_reg);
+    lua_register(L, "get_regs", lua_get_regs);
+    lua_register(L, "frame_hash", lua_frame_hash);
+    lua_register(L, "save_state", lua_save_state);
+    lua_register(L, "load_state", lua_load_state);
+    lua_register(L, "on_frame", lua_on_frame);
+    lua_register(L, "on_scanline", lua_on_scanline);
+    lua_register(L, "on_pc", lua_on_pc);
     lua_register(L, "exit", lua_exit);
 
     while (!Win_MainRunningGBA() && !Win_MainRunningGB())
         SDL_Delay(0);
 
-    // GB not supported for now
-    if (Win_MainRunningGB())
-        return 0;
+    Script_HooksInit(L);
 
     // Run script with 0 arguments and expect one return value
     int result = lua_pcall(L, 0, 1, 0);
+
+    Script_HooksEnd();
+
     if (result) {
         fprintf(stderr, "Failed to run script: %s", lua_tostring(L, -1));
         goto exit;
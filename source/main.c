@@ -12,8 +12,13 @@
 #include "debug_utils.h"
 #include "file_utils.h"
 #include "font_utils.h"
+#include "frame_hash.h"
+#include "frame_pacer.h"
+#include "image_writer.h"
 #include "input_utils.h"
 #include "lua_handler.h"
+#include "movie.h"
+#include "save_writer.h"
 #include "sound_utils.h"
 #include "window_handler.h"
 
@@ -55,16 +60,19 @@ static int Init(void)
     Config_Load();
     atexit(Config_Save);
 
-    // Enable VSync
-#if 0
-    if (!SDL_SetHint( SDL_HINT_RENDER_VSYNC, "1"))
-    {
-        Debug_LogMsgArg("Warning: VSync not enabled!");
-    }
-#endif
-
     Sound_Init();
 
+    // VSync is enabled when the main window is created
+    FramePacer_Init();
+
+    // Save files are written from a background thread
+    SaveWriter_Init();
+    atexit(SaveWriter_End);
+
+    // Screenshots and videos are encoded in background threads
+    ImageWriter_Init();
+    atexit(ImageWriter_End);
+
     if (DirCheckExistence(DirGetScreenshotFolderPath()) == 0)
         DirCreate(DirGetScreenshotFolderPath());
 
@@ -74,8 +82,6 @@ static int Init(void)
     return 0;
 }
 
-#define FLOAT_MS_PER_FRAME ((double)1000.0 / (double)60.0)
-
 int main(int argc, char *argv[])
 {
     // Try to get the path where the binary is running from. Try with SDL's
@@ -102,28 +108,64 @@ int main(int argc, char *argv[])
     if (Init() != 0)
         return 1;
 
-    // Check if the user provided a script
+    // Check if the user provided a script or a movie
 
-    if (argc > 2)
+    while (argc > 2)
     {
         if (strcmp(argv[1], "--lua") == 0)
         {
             Script_RunLua(argv[2]);
+        }
+        else if (strcmp(argv[1], "--movie-record") == 0)
+        {
+            Movie_RecordSet(argv[2]);
+        }
+        else if (strcmp(argv[1], "--movie-play") == 0)
+        {
+            if (Movie_PlaySet(argv[2]) != 0)
+                return 1;
+        }
+        else if (strcmp(argv[1], "--video-record") == 0)
+        {
+            if (ImageWriter_VideoStart(argv[2]) != 0)
+                return 1;
+        }
+        else if (strcmp(argv[1], "--hash-log") == 0)
+        {
+            if (FrameHash_LogSet(argv[2]) != 0)
+                return 1;
+        }
+        else if (strcmp(argv[1], "--hash-check") == 0)
+        {
+            if (FrameHash_CheckSet(argv[2]) != 0)
+                return 1;
+        }
+        else if (strcmp(argv[1], "--hash-interval") == 0)
+        {
+            FrameHash_IntervalSet(atoi(argv[2]));
+        }
+        else
+        {
+            break;
+        }
 
-            // Remove argv[1] and argv[2]
+        // Remove argv[1] and argv[2]
 
-            for (int i = 1; i < argc - 2; i++)
-                argv[i] = argv[i + 2];
+        for (int i = 1; i < argc - 2; i++)
+            argv[i] = argv[i + 2];
 
-            argc = argc - 2;
-        }
+        argc = argc - 2;
     }
 
+    // Save the movie if the emulator is closed while recording
+    atexit(Movie_Stop);
+    atexit(FrameHash_Stop);
+
     // Load main window with the ROM provided as argument
 
     Win_MainCreate((argc > 1) ? argv[1] : NULL);
 
-    double waitforticks = 0;
+    int ret = 0;
 
     while (!WH_AreAllWindowsClosed())
     {
@@ -132,28 +174,29 @@ int main(int argc, char *argv[])
 
         Win_MainLoopHandle();
 
+        // Exit when a movie has been played or all the frames of the reference
+        // hash log have been checked. The exit code says if there were errors.
+        int movie_result = Movie_PlaybackResult();
+        if ((movie_result >= 0) || FrameHash_CheckFinished())
+        {
+            ret = (movie_result > 0) || (FrameHash_CheckErrors() > 0);
+            break;
+        }
+
         // Render main window every frame
         Win_MainRender();
 
         // Synchronise video
-        if (Input_Speedup_Enabled())
+        if (Input_Speedup_Enabled() || Movie_IsPlaying())
         {
             SDL_Delay(0);
+            FramePacer_Reset();
         }
         else
         {
-            while (waitforticks >= SDL_GetTicks())
-                SDL_Delay(1);
-
-            int ticksnow = SDL_GetTicks();
-
-            // If the emulator missed a frame or more, adjust next frame
-            if (waitforticks < (ticksnow - FLOAT_MS_PER_FRAME))
-                waitforticks = ticksnow + FLOAT_MS_PER_FRAME;
-            else
-                waitforticks += FLOAT_MS_PER_FRAME;
+            FramePacer_Wait();
         }
     }
 
-    return 0;
+    return ret;
 }
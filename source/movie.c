@@ -0,0 +1,676 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "build_options.h"
+#include "config.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "movie.h"
+
+#include "gba_core/bios.h"
+
+// File format (all values are little endian):
+//
+//     char magic[8]       "GBMOVIE2"
+//     u32 system          MOVIE_SYSTEM_xxx
+//     u32 num_inputs      Number of u16 values of input per frame
+//     u32 flags           MOVIE_FLAG_xxx
+//     u32 hardware_type   EmulatorConfig.hardware_type
+//     u32 boot_rom        EmulatorConfig.load_from_boot_rom
+//     u32 seed            Seed of rand()
+//     u64 time            Current time for the RTC
+//     u64 rom_hash        Hash of the first MOVIE_ROM_HASH_SIZE bytes
+//     u32 frames          Number of frames
+//     u32 save_size
+//     u32 num_runs
+//     u32 num_checkpoints
+//     u8 save[save_size]
+//     { u32 count; u16 input[num_inputs]; } runs[num_runs]
+//     { u32 frame; u64 hash; } checkpoints[num_checkpoints]
+//
+// The input is stored as runs of frames with the same input.
+
+#define MOVIE_MAGIC "GBMOVIE2"
+#define MOVIE_HEADER_SIZE (8 + 4 * 6 + 8 * 2 + 4 * 4)
+
+#define MOVIE_FLAG_BIOS BIT(0) // GBA BIOS loaded
+#define MOVIE_FLAG_SAVE BIT(1) // There was a save file
+
+#define MOVIE_MAX_INPUTS 6
+#define MOVIE_ROM_HASH_SIZE (32 * 1024)
+
+typedef struct {
+    u32 count;
+    u16 input[MOVIE_MAX_INPUTS];
+} _movie_run_;
+
+typedef struct {
+    u32 frame;
+    u64 hash;
+} _movie_checkpoint_;
+
+typedef enum {
+    MOVIE_MODE_NONE,
+    MOVIE_MODE_RECORD,
+    MOVIE_MODE_PLAY
+} _movie_mode_;
+
+typedef enum {
+    MOVIE_STATE_IDLE,    // No movie, or waiting for the ROM to be loaded
+    MOVIE_STATE_LOADING, // Loading the ROM
+    MOVIE_STATE_ACTIVE,  // Recording or playing
+    MOVIE_STATE_DONE     // All frames have been played
+} _movie_state_;
+
+static _movie_mode_ movie_mode = MOVIE_MODE_NONE;
+static _movie_state_ movie_state = MOVIE_STATE_IDLE;
+static char movie_path[MAX_PATHLEN];
+
+static u32 movie_system;
+static u32 movie_num_inputs;
+static u32 movie_flags;
+static u32 movie_hardware_type;
+static u32 movie_boot_rom;
+static u32 movie_seed;
+static u64 movie_time;
+static u64 movie_rom_hash;
+static u32 movie_frames;
+
+static u8 *movie_save = NULL;
+static u32 movie_save_size;
+static int movie_save_captured;
+
+static _movie_run_ *movie_runs = NULL;
+static u32 movie_num_runs;
+static u32 movie_runs_capacity;
+
+static _movie_checkpoint_ *movie_checkpoints = NULL;
+static u32 movie_num_checkpoints;
+static u32 movie_checkpoints_capacity;
+
+// Position during playback and recording
+static u32 movie_frame;
+static u32 movie_run_index;
+static u32 movie_run_pos;
+static u32 movie_checkpoint_index;
+static u32 movie_mismatches;
+
+// Configuration replaced while the ROM is loaded
+static int movie_old_hardware_type;
+static int movie_old_boot_rom;
+
+//----------------------------------------------------------------------------
+
+static void Movie_Free(void)
+{
+    free(movie_save);
+    free(movie_runs);
+    free(movie_checkpoints);
+
+    movie_save = NULL;
+    movie_save_size = 0;
+    movie_save_captured = 0;
+    movie_runs = NULL;
+    movie_num_runs = 0;
+    movie_runs_capacity = 0;
+    movie_checkpoints = NULL;
+    movie_num_checkpoints = 0;
+    movie_checkpoints_capacity = 0;
+}
+
+static void Movie_Reset(void)
+{
+    Movie_Free();
+
+    movie_mode = MOVIE_MODE_NONE;
+    movie_state = MOVIE_STATE_IDLE;
+}
+
+//----------------------------------------------------------------------------
+
+static void put_u32(u8 **ptr, u32 value)
+{
+    u8 *p = *ptr;
+    for (int i = 0; i < 4; i++)
+        p[i] = (value >> (i * 8)) & 0xFF;
+    *ptr = p + 4;
+}
+
+static void put_u64(u8 **ptr, u64 value)
+{
+    put_u32(ptr, (u32)value);
+    put_u32(ptr, (u32)(value >> 32));
+}
+
+static u32 get_u32(const u8 **ptr)
+{
+    const u8 *p = *ptr;
+    u32 value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= (u32)p[i] << (i * 8);
+    *ptr = p + 4;
+    return value;
+}
+
+static u64 get_u64(const u8 **ptr)
+{
+    u64 value = get_u32(ptr);
+    return value | ((u64)get_u32(ptr) << 32);
+}
+
+static size_t Movie_RunSize(void)
+{
+    return 4 + movie_num_inputs * 2;
+}
+
+static void Movie_Save(void)
+{
+    size_t size = MOVIE_HEADER_SIZE + movie_save_size
+                  + movie_num_runs * Movie_RunSize()
+                  + movie_num_checkpoints * 12;
+
+    u8 *data = malloc(size);
+    if (data == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't save movie: Not enough memory.");
+        return;
+    }
+
+    u8 *ptr = data;
+
+    memcpy(ptr, MOVIE_MAGIC, 8);
+    ptr += 8;
+    put_u32(&ptr, movie_system);
+    put_u32(&ptr, movie_num_inputs);
+    put_u32(&ptr, movie_flags);
+    put_u32(&ptr, movie_hardware_type);
+    put_u32(&ptr, movie_boot_rom);
+    put_u32(&ptr, movie_seed);
+    put_u64(&ptr, movie_time);
+    put_u64(&ptr, movie_rom_hash);
+    put_u32(&ptr, movie_frames);
+    put_u32(&ptr, movie_save_size);
+    put_u32(&ptr, movie_num_runs);
+    put_u32(&ptr, movie_num_checkpoints);
+
+    if (movie_save_size > 0)
+    {
+        memcpy(ptr, movie_save, movie_save_size);
+        ptr += movie_save_size;
+    }
+
+    for (u32 i = 0; i < movie_num_runs; i++)
+    {
+        put_u32(&ptr, movie_runs[i].count);
+        for (u32 j = 0; j < movie_num_inputs; j++)
+        {
+            *ptr++ = movie_runs[i].input[j] & 0xFF;
+            *ptr++ = movie_runs[i].input[j] >> 8;
+        }
+    }
+
+    for (u32 i = 0; i < movie_num_checkpoints; i++)
+    {
+        put_u32(&ptr, movie_checkpoints[i].frame);
+        put_u64(&ptr, movie_checkpoints[i].hash);
+    }
+
+    if (FileWriteAtomic(movie_path, data, size) == 0)
+        Debug_ErrorMsgArg("Couldn't save movie:\n%s", movie_path);
+    else
+        Debug_LogMsgArg("Movie saved: %u frames", movie_frames);
+
+    free(data);
+}
+
+static int Movie_Parse(const u8 *data, size_t size)
+{
+    if ((size < MOVIE_HEADER_SIZE) || (memcmp(data, MOVIE_MAGIC, 8) != 0))
+        return 1;
+
+    const u8 *ptr = data + 8;
+
+    movie_system = get_u32(&ptr);
+    movie_num_inputs = get_u32(&ptr);
+    movie_flags = get_u32(&ptr);
+    movie_hardware_type = get_u32(&ptr);
+    movie_boot_rom = get_u32(&ptr);
+    movie_seed = get_u32(&ptr);
+    movie_time = get_u64(&ptr);
+    movie_rom_hash = get_u64(&ptr);
+    movie_frames = get_u32(&ptr);
+    movie_save_size = get_u32(&ptr);
+    movie_num_runs = get_u32(&ptr);
+    movie_num_checkpoints = get_u32(&ptr);
+
+    if ((movie_num_inputs == 0) || (movie_num_inputs > MOVIE_MAX_INPUTS))
+        return 1;
+
+    size_t remaining = size - MOVIE_HEADER_SIZE;
+    size_t runs_size = (size_t)movie_num_runs * Movie_RunSize();
+    size_t checkpoints_size = (size_t)movie_num_checkpoints * 12;
+
+    if ((movie_save_size > remaining)
+        || (runs_size > remaining - movie_save_size)
+        || (checkpoints_size != remaining - movie_save_size - runs_size))
+        return 1;
+
+    if (movie_save_size > 0)
+    {
+        movie_save = malloc(movie_save_size);
+        if (movie_save == NULL)
+            return 1;
+        memcpy(movie_save, ptr, movie_save_size);
+        ptr += movie_save_size;
+    }
+    movie_save_captured = 1;
+
+    if (movie_num_runs > 0)
+    {
+        movie_runs = calloc(movie_num_runs, sizeof(_movie_run_));
+        if (movie_runs == NULL)
+            return 1;
+    }
+
+    u64 total_frames = 0;
+
+    for (u32 i = 0; i < movie_num_runs; i++)
+    {
+        movie_runs[i].count = get_u32(&ptr);
+        for (u32 j = 0; j < movie_num_inputs; j++)
+        {
+            movie_runs[i].input[j] = ptr[0] | (ptr[1] << 8);
+            ptr += 2;
+        }
+        if (movie_runs[i].count == 0)
+            return 1;
+        total_frames += movie_runs[i].count;
+    }
+
+    if (total_frames != movie_frames)
+        return 1;
+
+    if (movie_num_checkpoints > 0)
+    {
+        movie_checkpoints = calloc(movie_num_checkpoints,
+                                   sizeof(_movie_checkpoint_));
+        if (movie_checkpoints == NULL)
+            return 1;
+    }
+
+    for (u32 i = 0; i < movie_num_checkpoints; i++)
+    {
+        movie_checkpoints[i].frame = get_u32(&ptr);
+        movie_checkpoints[i].hash = get_u64(&ptr);
+
+        // They must be sorted
+        if ((i > 0)
+            && (movie_checkpoints[i].frame <= movie_checkpoints[i - 1].frame))
+            return 1;
+    }
+
+    return 0;
+}
+
+//----------------------------------------------------------------------------
+
+int Movie_RecordSet(const char *path)
+{
+    Movie_Reset();
+
+    s_strncpy(movie_path, path, sizeof(movie_path));
+    movie_mode = MOVIE_MODE_RECORD;
+
+    return 0;
+}
+
+int Movie_PlaySet(const char *path)
+{
+    Movie_Reset();
+
+    void *data;
+    size_t size;
+    FileLoad(path, &data, &size);
+    if (data == NULL)
+        return 1;
+
+    int ret = Movie_Parse(data, size);
+    free(data);
+
+    if (ret != 0)
+    {
+        Debug_ErrorMsgArg("Invalid movie file:\n%s", path);
+        Movie_Free();
+        return 1;
+    }
+
+    s_strncpy(movie_path, path, sizeof(movie_path));
+    movie_mode = MOVIE_MODE_PLAY;
+
+    return 0;
+}
+
+int Movie_IsPlaying(void)
+{
+    return (movie_mode == MOVIE_MODE_PLAY)
+           && (movie_state == MOVIE_STATE_ACTIVE);
+}
+
+int Movie_PlaybackResult(void)
+{
+    if ((movie_mode != MOVIE_MODE_PLAY) || (movie_state != MOVIE_STATE_DONE))
+        return -1;
+
+    return (movie_mismatches > 0) ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------
+
+void Movie_BeforeLoad(int system)
+{
+    if ((movie_mode == MOVIE_MODE_NONE) || (movie_state != MOVIE_STATE_IDLE))
+        return;
+
+    if (movie_mode == MOVIE_MODE_RECORD)
+    {
+        movie_system = system;
+        movie_num_inputs = 0;
+        movie_flags = 0;
+        movie_hardware_type = EmulatorConfig.hardware_type;
+        movie_boot_rom = EmulatorConfig.load_from_boot_rom;
+        movie_time = (u64)time(NULL);
+        movie_seed = (u32)movie_time;
+        movie_frames = 0;
+    }
+    else if (movie_system != (u32)system)
+    {
+        Debug_ErrorMsgArg("The movie was recorded with a different system.");
+        Movie_Reset();
+        return;
+    }
+
+    movie_old_hardware_type = EmulatorConfig.hardware_type;
+    movie_old_boot_rom = EmulatorConfig.load_from_boot_rom;
+    EmulatorConfig.hardware_type = (int)movie_hardware_type;
+    EmulatorConfig.load_from_boot_rom = (int)movie_boot_rom;
+
+    srand(movie_seed);
+
+    movie_frame = 0;
+    movie_run_index = 0;
+    movie_run_pos = 0;
+    movie_checkpoint_index = 0;
+    movie_mismatches = 0;
+
+    movie_state = MOVIE_STATE_LOADING;
+}
+
+void Movie_AfterLoad(const void *rom, size_t rom_size, int loaded)
+{
+    if (movie_state != MOVIE_STATE_LOADING)
+        return;
+
+    EmulatorConfig.hardware_type = movie_old_hardware_type;
+    EmulatorConfig.load_from_boot_rom = movie_old_boot_rom;
+
+    if (!loaded)
+    {
+        Movie_Reset();
+        return;
+    }
+
+    u64 rom_hash = 0;
+    if (rom)
+    {
+        if (rom_size > MOVIE_ROM_HASH_SIZE)
+            rom_size = MOVIE_ROM_HASH_SIZE;
+        rom_hash = hash_data(rom, rom_size, HASH_INIT);
+    }
+
+    u32 flags = 0;
+    if ((movie_system == MOVIE_SYSTEM_GBA) && GBA_BiosIsLoaded())
+        flags |= MOVIE_FLAG_BIOS;
+
+    if (movie_mode == MOVIE_MODE_RECORD)
+    {
+        movie_rom_hash = rom_hash;
+        movie_flags = (movie_flags & MOVIE_FLAG_SAVE) | flags;
+        Debug_LogMsgArg("Recording movie: %s", movie_path);
+    }
+    else
+    {
+        // The movie is played anyway, the checkpoints will show if the
+        // emulation behaves differently.
+        if (rom_hash != movie_rom_hash)
+            Debug_LogMsgArg("Movie: The ROM doesn't match the movie");
+        if ((movie_flags & MOVIE_FLAG_BIOS) != flags)
+            Debug_LogMsgArg("Movie: The GBA BIOS doesn't match the movie");
+        Debug_LogMsgArg("Playing movie: %s (%u frames)", movie_path,
+                     movie_frames);
+    }
+
+    movie_state = MOVIE_STATE_ACTIVE;
+}
+
+void Movie_Stop(void)
+{
+    if (movie_state == MOVIE_STATE_IDLE)
+        return;
+
+    if ((movie_mode == MOVIE_MODE_RECORD) && (movie_state == MOVIE_STATE_ACTIVE))
+        Movie_Save();
+
+    Movie_Reset();
+}
+
+//----------------------------------------------------------------------------
+
+FILE *Movie_SaveFileOpen(const char *path)
+{
+    if (movie_state == MOVIE_STATE_IDLE)
+        return fopen(path, "rb");
+
+    // Only the first save file that is opened is stored in the movie. That is
+    // the one of the ROM, the cores open it again when they need to reload it.
+    if (movie_save_captured == 0)
+    {
+        void *data;
+        size_t size;
+        FileLoad_NoError(path, &data, &size);
+        if (data)
+        {
+            movie_save = data;
+            movie_save_size = size;
+            movie_flags |= MOVIE_FLAG_SAVE;
+        }
+        movie_save_captured = 1;
+    }
+
+    if ((movie_flags & MOVIE_FLAG_SAVE) == 0)
+        return NULL;
+
+    FILE *f = tmpfile();
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("Movie: Couldn't create temporary file.");
+        return NULL;
+    }
+
+    if (fwrite(movie_save, movie_save_size, 1, f) != 1)
+        Debug_ErrorMsgArg("Movie: Couldn't write temporary file.");
+
+    rewind(f);
+
+    return f;
+}
+
+int Movie_SaveWriteAllowed(void)
+{
+    return (movie_mode != MOVIE_MODE_PLAY) || (movie_state == MOVIE_STATE_IDLE);
+}
+
+u64 Movie_GetTime(void)
+{
+    if (movie_state == MOVIE_STATE_IDLE)
+        return (u64)time(NULL);
+
+    return movie_time;
+}
+
+//----------------------------------------------------------------------------
+
+static int Movie_RecordFrame(const u16 *input)
+{
+    _movie_run_ *last = NULL;
+    if (movie_num_runs > 0)
+        last = &movie_runs[movie_num_runs - 1];
+
+    if ((last != NULL) && (last->count < UINT32_MAX)
+        && (memcmp(last->input, input, movie_num_inputs * sizeof(u16)) == 0))
+    {
+        last->count++;
+    }
+    else
+    {
+        if (movie_num_runs == movie_runs_capacity)
+        {
+            u32 capacity = movie_runs_capacity ? movie_runs_capacity * 2 : 256;
+            void *runs = realloc(movie_runs, capacity * sizeof(_movie_run_));
+            if (runs == NULL)
+                return 1;
+            movie_runs = runs;
+            movie_runs_capacity = capacity;
+        }
+
+        last = &movie_runs[movie_num_runs++];
+        memset(last, 0, sizeof(_movie_run_));
+        memcpy(last->input, input, movie_num_inputs * sizeof(u16));
+        last->count = 1;
+    }
+
+    movie_frames++;
+
+    return 0;
+}
+
+int Movie_FrameStart(u16 *input, int num_inputs)
+{
+    if (movie_state != MOVIE_STATE_ACTIVE)
+        return 0;
+
+    u32 frame = movie_frame;
+
+    if (movie_mode == MOVIE_MODE_RECORD)
+    {
+        if (movie_num_inputs == 0)
+            movie_num_inputs = num_inputs;
+
+        if (Movie_RecordFrame(input) != 0)
+        {
+            Debug_ErrorMsgArg("Movie: Not enough memory. Recording stopped.");
+            Movie_Save();
+            Movie_Reset();
+            return 0;
+        }
+
+        movie_frame++;
+
+        // Draw the frame before the checkpoint too, see FRAME_HASH_DRAW in
+        // frame_hash.h
+        if (((frame + 1) % MOVIE_CHECKPOINT_FRAMES) == 0)
+            return MOVIE_FRAME_DRAW | MOVIE_FRAME_CHECKPOINT;
+        if (((frame + 2) % MOVIE_CHECKPOINT_FRAMES) == 0)
+            return MOVIE_FRAME_DRAW;
+        return 0;
+    }
+
+    // Playback
+
+    if ((frame == movie_frames) || (movie_num_inputs != (u32)num_inputs))
+    {
+        if (frame != movie_frames)
+        {
+            Debug_LogMsgArg("Movie: Wrong number of inputs");
+            movie_mismatches++;
+        }
+
+        Debug_LogMsgArg("Movie finished: %u frames, %u/%u checkpoints failed",
+                     frame, movie_mismatches, movie_num_checkpoints);
+        movie_state = MOVIE_STATE_DONE;
+        return 0;
+    }
+
+    _movie_run_ *run = &movie_runs[movie_run_index];
+    memcpy(input, run->input, num_inputs * sizeof(u16));
+
+    movie_run_pos++;
+    if (movie_run_pos == run->count)
+    {
+        movie_run_index++;
+        movie_run_pos = 0;
+    }
+
+    movie_frame++;
+
+    if (movie_checkpoint_index < movie_num_checkpoints)
+    {
+        u32 checkpoint_frame = movie_checkpoints[movie_checkpoint_index].frame;
+
+        if (checkpoint_frame == frame)
+            return MOVIE_FRAME_DRAW | MOVIE_FRAME_CHECKPOINT;
+        if (checkpoint_frame == frame + 1)
+            return MOVIE_FRAME_DRAW;
+    }
+
+    return 0;
+}
+
+void Movie_FrameCheckpoint(u64 screen_hash)
+{
+    if (movie_state != MOVIE_STATE_ACTIVE)
+        return;
+
+    u32 frame = movie_frame - 1;
+
+    if (movie_mode == MOVIE_MODE_RECORD)
+    {
+        if (movie_num_checkpoints == movie_checkpoints_capacity)
+        {
+            u32 capacity = movie_checkpoints_capacity ?
+                           movie_checkpoints_capacity * 2 : 64;
+            void *checkpoints = realloc(movie_checkpoints,
+                                        capacity * sizeof(_movie_checkpoint_));
+            if (checkpoints == NULL)
+                return; // Not critical, the movie can still be played
+            movie_checkpoints = checkpoints;
+            movie_checkpoints_capacity = capacity;
+        }
+
+        movie_checkpoints[movie_num_checkpoints].frame = frame;
+        movie_checkpoints[movie_num_checkpoints].hash = screen_hash;
+        movie_num_checkpoints++;
+        return;
+    }
+
+    if (movie_checkpoint_index >= movie_num_checkpoints)
+        return;
+
+    const _movie_checkpoint_ *c = &movie_checkpoints[movie_checkpoint_index];
+    movie_checkpoint_index++;
+
+    if (c->hash != screen_hash)
+    {
+        Debug_LogMsgArg("Movie: Frame %u: Screen doesn't match", frame);
+        movie_mismatches++;
+    }
+}
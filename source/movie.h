@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef MOVIE__
+#define MOVIE__
+
+#include <stdio.h>
+
+#include "general_utils.h"
+
+// Input movies. A movie has everything needed to power on the console in the
+// same state (seed of rand(), time used by the RTC of GB cartridges, contents
+// of the save file and hardware configuration) and the input of every frame.
+// While recording, a hash of the screen is stored every few frames. During
+// playback they are compared with the screen to check that the emulation
+// hasn't changed.
+
+#define MOVIE_SYSTEM_GBA 0
+#define MOVIE_SYSTEM_GB  1
+
+// Only the next ROM that is loaded is recorded or played. Returns 0 on success.
+int Movie_RecordSet(const char *path);
+int Movie_PlaySet(const char *path);
+
+// Returns 1 while a movie is being played
+int Movie_IsPlaying(void);
+// Returns -1 if the playback hasn't finished yet, 0 if it has finished and all
+// checkpoints matched and 1 if there were errors.
+int Movie_PlaybackResult(void);
+
+// Called by the frontend around the load of the ROM
+void Movie_BeforeLoad(int system);
+void Movie_AfterLoad(const void *rom, size_t rom_size, int loaded);
+// Called when the ROM is unloaded. When recording, the movie is saved.
+void Movie_Stop(void);
+
+// Opens a save file for reading. While there is a movie, the contents that the
+// file had when the recording started are used instead.
+FILE *Movie_SaveFileOpen(const char *path);
+// Returns 0 if the save file must not be modified (while playing a movie)
+int Movie_SaveWriteAllowed(void);
+// Returns the time that the RTC of the cartridge has to use as current time
+u64 Movie_GetTime(void);
+
+#define MOVIE_FRAME_DRAW        BIT(0) // Don't skip drawing this frame
+#define MOVIE_FRAME_CHECKPOINT  BIT(1) // Call Movie_FrameCheckpoint() at the end
+
+// Called by the cores at the start of each frame with the state of the input.
+// When recording, it is saved in the movie. When playing, it is replaced by
+// the input of the movie.
+int Movie_FrameStart(u16 *input, int num_inputs);
+void Movie_FrameCheckpoint(u64 screen_hash);
+
+#endif // MOVIE__
@@ -0,0 +1,571 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "profiler.h"
+
+#define PROFILER_REPORT_FILENAME    "profile.txt"
+#define PROFILER_FOLDED_FILENAME    "profile.folded"
+
+#define PROFILER_MAX_REGIONS        (16)
+#define PROFILER_MAX_STACK_DEPTH    (256)
+#define PROFILER_REPORT_HOT_SPOTS   (200)
+// Number of frames checked when looking for the one that a return belongs to.
+// This handles functions that don't return to their caller.
+#define PROFILER_RETURN_SEARCH      (8)
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+    u32 key;
+    u64 instructions;
+    u64 cycles;
+    char disassembly[64];
+} _profiler_pc_;
+
+// Every node represents a function in a specific call stack. Node 0 is the
+// root, which accumulates all code executed outside of any known function.
+typedef struct {
+    u32 parent;
+    u32 function_key;
+    u64 calls;
+    u64 self_instructions;
+    u64 self_cycles;
+    u64 total_cycles; // Only valid while writing the report
+} _profiler_node_;
+
+typedef struct {
+    u32 node;
+    u32 return_address;
+} _profiler_frame_;
+
+static int profiler_running;
+static const _profiler_cpu_info_ *profiler_info;
+
+// Open addressing hash table of executed instructions
+static _profiler_pc_ *profiler_pc;
+static u32 profiler_pc_size; // Power of 2
+static u32 profiler_pc_used;
+
+static _profiler_node_ *profiler_node;
+static u32 profiler_node_size;
+static u32 profiler_node_used;
+
+// Open addressing hash table of (parent, function) -> child node index + 1
+static u32 *profiler_child;
+static u32 profiler_child_size; // Power of 2
+
+static _profiler_frame_ profiler_stack[PROFILER_MAX_STACK_DEPTH];
+static int profiler_stack_depth;
+static u32 profiler_current_node;
+
+static u64 profiler_region_instructions[PROFILER_MAX_REGIONS];
+static u64 profiler_region_cycles[PROFILER_MAX_REGIONS];
+
+static u64 profiler_total_instructions;
+static u64 profiler_total_cycles;
+
+//------------------------------------------------------------------------------
+
+static u32 Profiler_Hash(u32 value)
+{
+    value ^= value >> 16;
+    value *= 0x7FEB352D;
+    value ^= value >> 15;
+    value *= 0x846CA68B;
+    value ^= value >> 16;
+    return value;
+}
+
+static void Profiler_FreeAll(void)
+{
+    free(profiler_pc);
+    free(profiler_node);
+    free(profiler_child);
+
+    profiler_pc = NULL;
+    profiler_node = NULL;
+    profiler_child = NULL;
+    profiler_pc_size = 0;
+    profiler_node_size = 0;
+    profiler_child_size = 0;
+
+    profiler_running = 0;
+}
+
+static int Profiler_PCTableGrow(void)
+{
+    u32 new_size = profiler_pc_size ? profiler_pc_size * 2 : 16 * 1024;
+    _profiler_pc_ *table = calloc(new_size, sizeof(_profiler_pc_));
+    if (table == NULL)
+        return 0;
+
+    for (u32 i = 0; i < profiler_pc_size; i++)
+    {
+        _profiler_pc_ *entry = &profiler_pc[i];
+        if (entry->instructions == 0)
+            continue;
+
+        u32 index = Profiler_Hash(entry->key) & (new_size - 1);
+        while (table[index].instructions != 0)
+            index = (index + 1) & (new_size - 1);
+        table[index] = *entry;
+    }
+
+    free(profiler_pc);
+    profiler_pc = table;
+    profiler_pc_size = new_size;
+    return 1;
+}
+
+static int Profiler_ChildTableGrow(void)
+{
+    u32 new_size = profiler_child_size ? profiler_child_size * 2 : 4 * 1024;
+    u32 *table = calloc(new_size, sizeof(u32));
+    if (table == NULL)
+        return 0;
+
+    for (u32 i = 0; i < profiler_child_size; i++)
+    {
+        u32 node = profiler_child[i];
+        if (node == 0)
+            continue;
+
+        _profiler_node_ *n = &profiler_node[node - 1];
+        u32 index = Profiler_Hash(n->function_key ^ (n->parent * 0x9E3779B1))
+                    & (new_size - 1);
+        while (table[index] != 0)
+            index = (index + 1) & (new_size - 1);
+        table[index] = node;
+    }
+
+    free(profiler_child);
+    profiler_child = table;
+    profiler_child_size = new_size;
+    return 1;
+}
+
+// Returns the index of the node, or the parent if there is no memory left
+static u32 Profiler_GetChildNode(u32 parent, u32 function_key)
+{
+    if ((profiler_node_used + 1) * 2 > profiler_child_size)
+    {
+        if (Profiler_ChildTableGrow() == 0)
+            return parent;
+    }
+
+    u32 index = Profiler_Hash(function_key ^ (parent * 0x9E3779B1))
+                & (profiler_child_size - 1);
+    while (profiler_child[index] != 0)
+    {
+        _profiler_node_ *n = &profiler_node[profiler_child[index] - 1];
+        if ((n->parent == parent) && (n->function_key == function_key))
+            return profiler_child[index] - 1;
+        index = (index + 1) & (profiler_child_size - 1);
+    }
+
+    if (profiler_node_used == profiler_node_size)
+    {
+        u32 new_size = profiler_node_size * 2;
+        _profiler_node_ *nodes = realloc(profiler_node,
+                                         new_size * sizeof(_profiler_node_));
+        if (nodes == NULL)
+            return parent;
+        profiler_node = nodes;
+        profiler_node_size = new_size;
+    }
+
+    u32 node = profiler_node_used++;
+    memset(&profiler_node[node], 0, sizeof(_profiler_node_));
+    profiler_node[node].parent = parent;
+    profiler_node[node].function_key = function_key;
+
+    profiler_child[index] = node + 1;
+
+    return node;
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler_Start(const _profiler_cpu_info_ *info)
+{
+    if (profiler_running)
+        Profiler_End();
+
+    profiler_info = info;
+
+    profiler_pc_used = 0;
+    profiler_node_used = 0;
+    profiler_stack_depth = 0;
+    profiler_current_node = 0;
+    profiler_total_instructions = 0;
+    profiler_total_cycles = 0;
+    memset(profiler_region_instructions, 0,
+           sizeof(profiler_region_instructions));
+    memset(profiler_region_cycles, 0, sizeof(profiler_region_cycles));
+
+    profiler_node_size = 1024;
+    profiler_node = malloc(profiler_node_size * sizeof(_profiler_node_));
+
+    if ((profiler_node == NULL) || (Profiler_PCTableGrow() == 0)
+        || (Profiler_ChildTableGrow() == 0))
+    {
+        Debug_ErrorMsgArg("Profiler: Not enough memory.");
+        Profiler_FreeAll();
+        return;
+    }
+
+    // Root node
+    memset(&profiler_node[0], 0, sizeof(_profiler_node_));
+    profiler_node_used = 1;
+
+    profiler_running = 1;
+}
+
+void Profiler_Instruction(u32 key, u32 address, u32 cycles, int region)
+{
+    if (profiler_running == 0)
+        return;
+
+    // Check if this is the return address of any function in the stack
+    if (profiler_stack_depth > 0)
+    {
+        int limit = profiler_stack_depth - PROFILER_RETURN_SEARCH;
+        if (limit < 0)
+            limit = 0;
+
+        for (int i = profiler_stack_depth - 1; i >= limit; i--)
+        {
+            if (profiler_stack[i].return_address == address)
+            {
+                profiler_stack_depth = i;
+                if (i == 0)
+                    profiler_current_node = 0;
+                else
+                    profiler_current_node = profiler_stack[i - 1].node;
+                break;
+            }
+        }
+    }
+
+    if ((profiler_pc_used + 1) * 2 > profiler_pc_size)
+    {
+        if (Profiler_PCTableGrow() == 0)
+        {
+            Debug_ErrorMsgArg("Profiler: Not enough memory.");
+            Profiler_FreeAll();
+            return;
+        }
+    }
+
+    u32 index = Profiler_Hash(key) & (profiler_pc_size - 1);
+    while (1)
+    {
+        _profiler_pc_ *entry = &profiler_pc[index];
+
+        if (entry->instructions == 0)
+        {
+            entry->key = key;
+            profiler_info->disassemble(key, entry->disassembly,
+                                       sizeof(entry->disassembly));
+            profiler_pc_used++;
+            break;
+        }
+
+        if (entry->key == key)
+            break;
+
+        index = (index + 1) & (profiler_pc_size - 1);
+    }
+
+    _profiler_pc_ *entry = &profiler_pc[index];
+    entry->instructions++;
+    entry->cycles += cycles;
+
+    _profiler_node_ *node = &profiler_node[profiler_current_node];
+    node->self_instructions++;
+    node->self_cycles += cycles;
+
+    if ((region >= 0) && (region < PROFILER_MAX_REGIONS))
+    {
+        profiler_region_instructions[region]++;
+        profiler_region_cycles[region] += cycles;
+    }
+
+    profiler_total_instructions++;
+    profiler_total_cycles += cycles;
+}
+
+void Profiler_Call(u32 function_key, u32 return_address)
+{
+    if (profiler_running == 0)
+        return;
+
+    if (profiler_stack_depth == PROFILER_MAX_STACK_DEPTH)
+    {
+        // Attribute the code to the deepest function that fits in the stack
+        return;
+    }
+
+    u32 node = Profiler_GetChildNode(profiler_current_node, function_key);
+    profiler_node[node].calls++;
+
+    profiler_stack[profiler_stack_depth].node = node;
+    profiler_stack[profiler_stack_depth].return_address = return_address;
+    profiler_stack_depth++;
+
+    profiler_current_node = node;
+}
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+    u32 function_key;
+    u64 calls;
+    u64 self_cycles;
+    u64 total_cycles;
+} _profiler_function_;
+
+static int Profiler_ComparePC(const void *a, const void *b)
+{
+    const _profiler_pc_ *pa = a;
+    const _profiler_pc_ *pb = b;
+    if (pa->cycles != pb->cycles)
+        return (pa->cycles < pb->cycles) ? 1 : -1;
+    return (pa->key > pb->key) - (pa->key < pb->key);
+}
+
+static int Profiler_CompareFunction(const void *a, const void *b)
+{
+    const _profiler_function_ *fa = a;
+    const _profiler_function_ *fb = b;
+    if (fa->self_cycles != fb->self_cycles)
+        return (fa->self_cycles < fb->self_cycles) ? 1 : -1;
+    return (fa->function_key > fb->function_key)
+           - (fa->function_key < fb->function_key);
+}
+
+static double Profiler_Percent(u64 value)
+{
+    if (profiler_total_cycles == 0)
+        return 0.0;
+    return (100.0 * (double)value) / (double)profiler_total_cycles;
+}
+
+// Returns 1 if any ancestor of the node is the same function as the node
+static int Profiler_NodeIsRecursive(u32 node)
+{
+    u32 key = profiler_node[node].function_key;
+    u32 parent = profiler_node[node].parent;
+    while (parent != 0)
+    {
+        if (profiler_node[parent].function_key == key)
+            return 1;
+        parent = profiler_node[parent].parent;
+    }
+    return 0;
+}
+
+static void Profiler_WriteReport(FILE *f)
+{
+    char text[64];
+
+    fprintf(f, "%s profile\n\n", profiler_info->name);
+    fprintf(f, "Instructions: %llu\n",
+            (unsigned long long)profiler_total_instructions);
+    fprintf(f, "Cycles:       %llu\n\n",
+            (unsigned long long)profiler_total_cycles);
+
+    // Memory regions
+
+    fprintf(f, "Memory regions\n"
+               "--------------\n\n");
+    fprintf(f, "%-16s %14s %14s %7s\n",
+            "Region", "Instructions", "Cycles", "%");
+    for (int i = 0; i < profiler_info->num_regions; i++)
+    {
+        if (profiler_region_instructions[i] == 0)
+            continue;
+        fprintf(f, "%-16s %14llu %14llu %6.2f%%\n",
+                profiler_info->region_names[i],
+                (unsigned long long)profiler_region_instructions[i],
+                (unsigned long long)profiler_region_cycles[i],
+                Profiler_Percent(profiler_region_cycles[i]));
+    }
+    fprintf(f, "\n");
+
+    // Functions. Nodes are always created after their parents, so the total
+    // cycles can be accumulated by iterating the array backwards.
+
+    for (u32 i = 0; i < profiler_node_used; i++)
+        profiler_node[i].total_cycles = profiler_node[i].self_cycles;
+    for (u32 i = profiler_node_used - 1; i > 0; i--)
+    {
+        _profiler_node_ *n = &profiler_node[i];
+        profiler_node[n->parent].total_cycles += n->total_cycles;
+    }
+
+    _profiler_function_ *functions =
+            calloc(profiler_node_used, sizeof(_profiler_function_));
+    u32 num_functions = 0;
+
+    if (functions != NULL)
+    {
+        // Merge all nodes of the same function. This is quadratic, but it's
+        // only done once.
+        for (u32 i = 1; i < profiler_node_used; i++)
+        {
+            _profiler_node_ *n = &profiler_node[i];
+
+            u32 j;
+            for (j = 0; j < num_functions; j++)
+            {
+                if (functions[j].function_key == n->function_key)
+                    break;
+            }
+            if (j == num_functions)
+            {
+                functions[j].function_key = n->function_key;
+                num_functions++;
+            }
+
+            functions[j].calls += n->calls;
+            functions[j].self_cycles += n->self_cycles;
+            // Don't count recursive calls twice
+            if (Profiler_NodeIsRecursive(i) == 0)
+                functions[j].total_cycles += n->total_cycles;
+        }
+
+        qsort(functions, num_functions, sizeof(_profiler_function_),
+              Profiler_CompareFunction);
+
+        fprintf(f, "Functions\n"
+                   "---------\n\n");
+        fprintf(f, "%-12s %12s %14s %7s %14s %7s\n",
+                "Function", "Calls", "Self cycles", "%",
+                "Total cycles", "%");
+        fprintf(f, "%-12s %12s %14llu %6.2f%% %14s %7s\n", "(none)", "-",
+                (unsigned long long)profiler_node[0].self_cycles,
+                Profiler_Percent(profiler_node[0].self_cycles), "-", "-");
+        for (u32 i = 0; i < num_functions; i++)
+        {
+            profiler_info->format_key(functions[i].function_key,
+                                      text, sizeof(text));
+            fprintf(f, "%-12s %12llu %14llu %6.2f%% %14llu %6.2f%%\n", text,
+                    (unsigned long long)functions[i].calls,
+                    (unsigned long long)functions[i].self_cycles,
+                    Profiler_Percent(functions[i].self_cycles),
+                    (unsigned long long)functions[i].total_cycles,
+                    Profiler_Percent(functions[i].total_cycles));
+        }
+        fprintf(f, "\n");
+
+        free(functions);
+    }
+
+    // Hot spots. The hash table isn't needed anymore, so it can be sorted.
+
+    u32 used = 0;
+    for (u32 i = 0; i < profiler_pc_size; i++)
+    {
+        if (profiler_pc[i].instructions != 0)
+            profiler_pc[used++] = profiler_pc[i];
+    }
+    qsort(profiler_pc, used, sizeof(_profiler_pc_), Profiler_ComparePC);
+
+    fprintf(f, "Hot spots\n"
+               "---------\n\n");
+    fprintf(f, "%-12s %14s %14s %7s  %s\n",
+            "Address", "Count", "Cycles", "%", "Disassembly");
+    for (u32 i = 0; (i < used) && (i < PROFILER_REPORT_HOT_SPOTS); i++)
+    {
+        profiler_info->format_key(profiler_pc[i].key, text, sizeof(text));
+        fprintf(f, "%-12s %14llu %14llu %6.2f%%  %s\n", text,
+                (unsigned long long)profiler_pc[i].instructions,
+                (unsigned long long)profiler_pc[i].cycles,
+                Profiler_Percent(profiler_pc[i].cycles),
+                profiler_pc[i].disassembly);
+    }
+}
+
+// One line per call stack: "root;function;function cycles"
+static void Profiler_WriteFolded(FILE *f)
+{
+    u32 path[PROFILER_MAX_STACK_DEPTH + 1];
+    char text[64];
+
+    for (u32 i = 0; i < profiler_node_used; i++)
+    {
+        if (profiler_node[i].self_cycles == 0)
+            continue;
+
+        int depth = 0;
+        u32 node = i;
+        while ((node != 0) && (depth < PROFILER_MAX_STACK_DEPTH))
+        {
+            path[depth++] = node;
+            node = profiler_node[node].parent;
+        }
+
+        fprintf(f, "%s", profiler_info->name);
+        while (depth > 0)
+        {
+            depth--;
+            profiler_info->format_key(profiler_node[path[depth]].function_key,
+                                      text, sizeof(text));
+            fprintf(f, ";%s", text);
+        }
+        fprintf(f, " %llu\n", (unsigned long long)profiler_node[i].self_cycles);
+    }
+}
+
+void Profiler_End(void)
+{
+    if (profiler_running == 0)
+        return;
+
+    char path[MAX_PATHLEN];
+    const char *dir = DirGetRunningPath() ? DirGetRunningPath() : "";
+
+    // The folded stacks file has to be written first, the report reorders the
+    // table of instructions.
+
+    snprintf(path, sizeof(path), "%s" PROFILER_FOLDED_FILENAME,
+             dir);
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("Profiler: Couldn't open %s", path);
+    }
+    else
+    {
+        Profiler_WriteFolded(f);
+        fclose(f);
+    }
+
+    snprintf(path, sizeof(path), "%s" PROFILER_REPORT_FILENAME,
+             dir);
+    f = fopen(path, "w");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("Profiler: Couldn't open %s", path);
+    }
+    else
+    {
+        Profiler_WriteReport(f);
+        fclose(f);
+        ConsolePrint("Profile written to %s\n", path);
+    }
+
+    Profiler_FreeAll();
+}
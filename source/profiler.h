@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef PROFILER__
+#define PROFILER__
+
+// Guest code profiler. It is only built if ENABLE_PROFILER is defined, and
+// the CPU cores only call it in that case, so it has no cost otherwise.
+
+#ifdef ENABLE_PROFILER
+
+#include "general_utils.h"
+
+// Keys identify an instruction (or a function) in the report. They are the
+// address of the instruction, with extra information (like the ROM bank) in
+// the bits that aren't used by the address.
+
+typedef struct {
+    const char *name;
+
+    // Called the first time an instruction is executed
+    void (*disassemble)(u32 key, char *dest, int dest_size);
+    void (*format_key)(u32 key, char *dest, int dest_size);
+
+    const char *const *region_names;
+    int num_regions;
+} _profiler_cpu_info_;
+
+void Profiler_Start(const _profiler_cpu_info_ *info);
+// Writes the report and the folded stacks file and frees all memory
+void Profiler_End(void);
+
+// Call this after executing an instruction. "address" is used to detect
+// returns from the functions in the call stack.
+void Profiler_Instruction(u32 key, u32 address, u32 cycles, int region);
+// Call this after an instruction that has called a function
+void Profiler_Call(u32 function_key, u32 return_address);
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER__
@@ -0,0 +1,349 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "archive_utils.h"
+#include "build_options.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "rom_cache.h"
+
+typedef struct _rom_cache_entry_ {
+    struct _rom_cache_entry_ *next;
+
+    char path[MAX_PATHLEN];
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    off_t file_size;
+    size_t size;
+    size_t padded_size;
+
+    void *buffer;
+    size_t map_size;
+    int refcount;
+    u32 release_order; // Used to free the oldest unused entries first
+
+    // Only used for files inside archives. The stream is kept open until the
+    // whole file has been decompressed.
+    _archive_stream_ *stream;
+    size_t available;
+} _rom_cache_entry_;
+
+// Entries without users are kept for a while so that loading the same ROM
+// again (for example, in batch runs) doesn't need to read the file again.
+#define ROM_CACHE_MAX_UNUSED 2
+
+static _rom_cache_entry_ *rom_cache_list = NULL;
+static u32 rom_cache_release_count = 0;
+
+// Returns 1 if the entry was loaded from the file, even if it was opened from a
+// different path.
+static int RomCacheSameFile(const _rom_cache_entry_ *e, const char *path,
+                            const struct stat *st)
+{
+    if ((e->file_size != st->st_size) || (e->mtime != st->st_mtime))
+        return 0;
+
+#if defined(_WIN32)
+    // stat() doesn't return the file index on Windows
+    return strcmp(e->path, path) == 0;
+#else
+    (void)path;
+    return (e->dev == st->st_dev) && (e->ino == st->st_ino);
+#endif
+}
+
+static _rom_cache_entry_ *RomCacheFindFile(const char *path,
+                                           size_t padded_size,
+                                           const struct stat *st)
+{
+    for (_rom_cache_entry_ *e = rom_cache_list; e != NULL; e = e->next)
+    {
+        if ((e->padded_size == padded_size) && RomCacheSameFile(e, path, st))
+            return e;
+    }
+
+    return NULL;
+}
+
+// Looks for a different file with the same contents. Only the entries with the
+// same size are compared, so most loads don't need to read the whole file.
+static _rom_cache_entry_ *RomCacheFindContents(const void *buffer, size_t size,
+                                               size_t padded_size)
+{
+    for (_rom_cache_entry_ *e = rom_cache_list; e != NULL; e = e->next)
+    {
+        if ((e->stream != NULL) || (e->size != size)
+            || (e->padded_size != padded_size))
+            continue;
+
+        if (memcmp(e->buffer, buffer, size) == 0)
+            return e;
+    }
+
+    return NULL;
+}
+
+static _rom_cache_entry_ *RomCacheNewEntry(const char *path,
+                                           const struct stat *st)
+{
+    _rom_cache_entry_ *e = calloc(1, sizeof(_rom_cache_entry_));
+    if (e == NULL)
+    {
+        Debug_ErrorMsgArg("Not enought memory to load %s!", path);
+        return NULL;
+    }
+
+    s_strncpy(e->path, path, sizeof(e->path));
+    e->dev = st->st_dev;
+    e->ino = st->st_ino;
+    e->mtime = st->st_mtime;
+    e->file_size = st->st_size;
+    e->refcount = 1;
+
+    return e;
+}
+
+static void RomCacheAddEntry(_rom_cache_entry_ *e)
+{
+    e->next = rom_cache_list;
+    rom_cache_list = e;
+}
+
+static _rom_cache_entry_ *RomCacheLoadArchive(const char *path,
+                                              const struct stat *st,
+                                              size_t padded_size)
+{
+    size_t size;
+    _archive_stream_ *stream = ArchiveOpen(path, &size);
+    if (stream == NULL)
+        return NULL;
+
+    size_t buffer_size = (size > padded_size) ? size : padded_size;
+    void *buffer = calloc(1, buffer_size);
+    if (buffer == NULL)
+    {
+        Debug_ErrorMsgArg("Not enought memory to load %s!", path);
+        ArchiveClose(stream);
+        return NULL;
+    }
+
+    _rom_cache_entry_ *e = RomCacheNewEntry(path, st);
+    if (e == NULL)
+    {
+        free(buffer);
+        ArchiveClose(stream);
+        return NULL;
+    }
+
+    e->size = size;
+    e->padded_size = padded_size;
+    e->buffer = buffer;
+    e->map_size = buffer_size;
+    e->stream = stream;
+    e->available = 0;
+
+    return e;
+}
+
+static size_t RomCacheEntryFill(_rom_cache_entry_ *e, size_t size)
+{
+    if (size > e->size)
+        size = e->size;
+
+    if ((e->stream == NULL) || (e->available >= size))
+        return e->available;
+
+    // Decompress up to the requested size. The archive code reads the
+    // compressed file in small chunks, so this doesn't need to load the whole
+    // file in memory.
+    u8 *dest = (u8 *)e->buffer + e->available;
+    size_t done = ArchiveRead(e->stream, dest, size - e->available);
+    e->available += done;
+
+    if (e->available != size)
+    {
+        // The rest of the buffer stays filled with zeroes. Don't try to read
+        // from the file again, or the error would be reported many times.
+        Debug_ErrorMsgArg("%s: Couldn't decompress the whole file.", e->path);
+        e->available = e->size;
+    }
+
+    if (e->available == e->size)
+    {
+        ArchiveClose(e->stream);
+        e->stream = NULL;
+    }
+
+    return e->available;
+}
+
+const void *RomCacheAcquirePartial(const char *path, size_t padded_size,
+                                   size_t preload_size, size_t *size_,
+                                   size_t *available_)
+{
+    *size_ = 0;
+    *available_ = 0;
+
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        Debug_ErrorMsgArg("%s couldn't be opened!", path);
+        return NULL;
+    }
+
+    int is_archive = ArchiveIsSupported(path);
+
+    _rom_cache_entry_ *e = RomCacheFindFile(path, padded_size, &st);
+    if (e)
+    {
+        e->refcount++;
+    }
+    else if (is_archive)
+    {
+        e = RomCacheLoadArchive(path, &st, padded_size);
+        if (e == NULL)
+            return NULL;
+
+        RomCacheAddEntry(e);
+    }
+    else
+    {
+        size_t size, map_size;
+        void *buffer = FileMapReadOnly(path, padded_size, &size, &map_size);
+        if (buffer == NULL)
+            return NULL;
+
+        // A copy of the same file may have been loaded already
+        e = RomCacheFindContents(buffer, size, padded_size);
+        if (e)
+        {
+            FileUnmap(buffer, map_size);
+            e->refcount++;
+        }
+        else
+        {
+            e = RomCacheNewEntry(path, &st);
+            if (e == NULL)
+            {
+                FileUnmap(buffer, map_size);
+                return NULL;
+            }
+
+            e->size = size;
+            e->padded_size = padded_size;
+            e->buffer = buffer;
+            e->map_size = map_size;
+            e->available = size;
+
+            RomCacheAddEntry(e);
+        }
+    }
+
+    *size_ = e->size;
+    *available_ = RomCacheEntryFill(e, preload_size);
+    return e->buffer;
+}
+
+const void *RomCacheAcquire(const char *path, size_t padded_size,
+                            size_t *size_)
+{
+    size_t available;
+    return RomCacheAcquirePartial(path, padded_size, SIZE_MAX, size_,
+                                  &available);
+}
+
+static _rom_cache_entry_ *RomCacheFindBuffer(const void *buffer)
+{
+    for (_rom_cache_entry_ *e = rom_cache_list; e != NULL; e = e->next)
+    {
+        if (e->buffer == buffer)
+            return e;
+    }
+
+    return NULL;
+}
+
+size_t RomCacheFill(const void *buffer, size_t size)
+{
+    _rom_cache_entry_ *e = RomCacheFindBuffer(buffer);
+    if (e == NULL)
+        return 0;
+
+    return RomCacheEntryFill(e, size);
+}
+
+static void RomCacheEntryFree(_rom_cache_entry_ *e)
+{
+    if (ArchiveIsSupported(e->path))
+    {
+        ArchiveClose(e->stream);
+        free(e->buffer);
+    }
+    else
+    {
+        FileUnmap(e->buffer, e->map_size);
+    }
+    free(e);
+}
+
+// Frees the oldest entries without users until there are few enough of them
+static void RomCacheTrim(void)
+{
+    while (1)
+    {
+        int unused = 0;
+        _rom_cache_entry_ **oldest = NULL;
+
+        for (_rom_cache_entry_ **prev = &rom_cache_list; *prev != NULL;
+             prev = &(*prev)->next)
+        {
+            _rom_cache_entry_ *e = *prev;
+            if (e->refcount > 0)
+                continue;
+
+            unused++;
+            if ((oldest == NULL)
+                || (e->release_order < (*oldest)->release_order))
+                oldest = prev;
+        }
+
+        if (unused <= ROM_CACHE_MAX_UNUSED)
+            return;
+
+        _rom_cache_entry_ *e = *oldest;
+        *oldest = e->next;
+        RomCacheEntryFree(e);
+    }
+}
+
+void RomCacheRelease(const void *buffer)
+{
+    if (buffer == NULL)
+        return;
+
+    _rom_cache_entry_ *e = RomCacheFindBuffer(buffer);
+    if ((e == NULL) || (e->refcount == 0))
+    {
+        Debug_DebugMsgArg("%s: Buffer not found: %p", __func__, buffer);
+        return;
+    }
+
+    e->refcount--;
+    if (e->refcount == 0)
+    {
+        e->release_order = rom_cache_release_count++;
+        RomCacheTrim();
+    }
+}
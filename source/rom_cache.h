@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef ROM_CACHE__
+#define ROM_CACHE__
+
+#include <stddef.h>
+
+// ROMs are mapped as read-only memory and shared between all the users that
+// load the same file. Files are identified by their device and inode (or by
+// their path on Windows), checking that the size and modification time haven't
+// changed. If the file isn't in the cache, it is compared with the files of
+// the same size, so copies of a file are shared too.
+//
+// padded_size is the minimum size of the returned buffer. The bytes after the
+// end of the file read as zero. The size of the file is returned in size_.
+// Returns NULL on error.
+//
+// Files inside archives (see archive_utils.h) are decompressed into a buffer
+// instead of being mapped. They aren't deduplicated by contents.
+const void *RomCacheAcquire(const char *path, size_t padded_size,
+                            size_t *size_);
+// Like RomCacheAcquire(), but files inside archives are only decompressed up
+// to preload_size bytes. The number of bytes that can be used is returned in
+// available_, and the rest of the file has to be requested with RomCacheFill().
+const void *RomCacheAcquirePartial(const char *path, size_t padded_size,
+                                   size_t preload_size, size_t *size_,
+                                   size_t *available_);
+// Makes sure that the first "size" bytes of the buffer can be used. Returns the
+// number of bytes that can be used.
+size_t RomCacheFill(const void *buffer, size_t size);
+// Releases a buffer returned by RomCacheAcquire(). When it has no more users it
+// stays in the cache until other buffers are released after it, so that the
+// same ROM can be loaded again quickly. NULL is ignored.
+void RomCacheRelease(const void *buffer);
+
+#endif // ROM_CACHE__
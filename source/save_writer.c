@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "save_writer.h"
+
+typedef struct _save_writer_job_ {
+    struct _save_writer_job_ *next;
+    char path[MAX_PATHLEN];
+    void *data;
+    size_t size;
+} _save_writer_job_;
+
+static SDL_Thread *save_writer_thread = NULL;
+static SDL_mutex *save_writer_mutex = NULL;
+static SDL_cond *save_writer_work_cond = NULL; // Jobs queued or exit requested
+static SDL_cond *save_writer_idle_cond = NULL; // All jobs done
+
+static _save_writer_job_ *save_writer_queue = NULL;
+static int save_writer_busy = 0;
+static int save_writer_quit = 0;
+
+// Errors can't be reported from the thread, they are reported by the next call
+// to SaveWriter_Write() or SaveWriter_Flush() in the main thread.
+static int save_writer_error = 0;
+static char save_writer_error_path[MAX_PATHLEN];
+
+static void SaveWriter_ReportErrors(void)
+{
+    char path[MAX_PATHLEN];
+
+    SDL_LockMutex(save_writer_mutex);
+    int error = save_writer_error;
+    if (error)
+    {
+        save_writer_error = 0;
+        s_strncpy(path, save_writer_error_path, sizeof(path));
+    }
+    SDL_UnlockMutex(save_writer_mutex);
+
+    if (error)
+        Debug_ErrorMsgArg("Couldn't save data to file:\n%s", path);
+}
+
+static int SaveWriter_Thread(unused__ void *arg)
+{
+    SDL_LockMutex(save_writer_mutex);
+
+    while (1)
+    {
+        while ((save_writer_queue == NULL) && (save_writer_quit == 0))
+            SDL_CondWait(save_writer_work_cond, save_writer_mutex);
+
+        _save_writer_job_ *job = save_writer_queue;
+        if (job == NULL)
+            break; // Exit requested and there are no jobs left
+
+        save_writer_queue = job->next;
+        save_writer_busy = 1;
+
+        SDL_UnlockMutex(save_writer_mutex);
+
+        int ok = FileWriteAtomic(job->path, job->data, job->size);
+
+        SDL_LockMutex(save_writer_mutex);
+
+        if (ok == 0)
+        {
+            save_writer_error = 1;
+            s_strncpy(save_writer_error_path, job->path,
+                      sizeof(save_writer_error_path));
+        }
+
+        free(job->data);
+        free(job);
+
+        save_writer_busy = 0;
+        if (save_writer_queue == NULL)
+            SDL_CondBroadcast(save_writer_idle_cond);
+    }
+
+    SDL_UnlockMutex(save_writer_mutex);
+
+    return 0;
+}
+
+void SaveWriter_Init(void)
+{
+    save_writer_mutex = SDL_CreateMutex();
+    save_writer_work_cond = SDL_CreateCond();
+    save_writer_idle_cond = SDL_CreateCond();
+
+    if ((save_writer_mutex == NULL) || (save_writer_work_cond == NULL)
+        || (save_writer_idle_cond == NULL))
+    {
+        Debug_LogMsgArg("%s(): %s", __func__, SDL_GetError());
+        SaveWriter_End();
+        return;
+    }
+
+    save_writer_quit = 0;
+    save_writer_thread = SDL_CreateThread(SaveWriter_Thread, "Save writer",
+                                          NULL);
+    if (save_writer_thread == NULL)
+    {
+        // Not fatal, files will be written from the main thread
+        Debug_LogMsgArg("%s(): %s", __func__, SDL_GetError());
+        SaveWriter_End();
+    }
+}
+
+void SaveWriter_End(void)
+{
+    if (save_writer_thread)
+    {
+        SDL_LockMutex(save_writer_mutex);
+        save_writer_quit = 1;
+        SDL_CondSignal(save_writer_work_cond);
+        SDL_UnlockMutex(save_writer_mutex);
+
+        SDL_WaitThread(save_writer_thread, NULL);
+        save_writer_thread = NULL;
+    }
+
+    if (save_writer_idle_cond)
+        SDL_DestroyCond(save_writer_idle_cond);
+    if (save_writer_work_cond)
+        SDL_DestroyCond(save_writer_work_cond);
+    if (save_writer_mutex)
+        SDL_DestroyMutex(save_writer_mutex);
+
+    save_writer_idle_cond = NULL;
+    save_writer_work_cond = NULL;
+    save_writer_mutex = NULL;
+}
+
+void SaveWriter_Write(const char *path, const void *data, size_t size)
+{
+    if (save_writer_thread == NULL)
+    {
+        if (FileWriteAtomic(path, data, size) == 0)
+            Debug_ErrorMsgArg("Couldn't save data to file:\n%s", path);
+        return;
+    }
+
+    SaveWriter_ReportErrors();
+
+    void *copy = malloc(size);
+    if (copy == NULL)
+    {
+        Debug_ErrorMsgArg("%s(): Not enough memory.", __func__);
+        return;
+    }
+    memcpy(copy, data, size);
+
+    SDL_LockMutex(save_writer_mutex);
+
+    // If the previous write of this file hasn't started yet, replace its data.
+    // This coalesces bursts of writes into one.
+    _save_writer_job_ **next = &save_writer_queue;
+    while (*next)
+    {
+        _save_writer_job_ *job = *next;
+        if (strcmp(job->path, path) == 0)
+        {
+            free(job->data);
+            job->data = copy;
+            job->size = size;
+            SDL_UnlockMutex(save_writer_mutex);
+            return;
+        }
+        next = &job->next;
+    }
+
+    _save_writer_job_ *job = malloc(sizeof(_save_writer_job_));
+    if (job == NULL)
+    {
+        SDL_UnlockMutex(save_writer_mutex);
+        free(copy);
+        Debug_ErrorMsgArg("%s(): Not enough memory.", __func__);
+        return;
+    }
+
+    s_strncpy(job->path, path, sizeof(job->path));
+    job->data = copy;
+    job->size = size;
+    job->next = NULL;
+    *next = job;
+
+    SDL_CondSignal(save_writer_work_cond);
+    SDL_UnlockMutex(save_writer_mutex);
+}
+
+void SaveWriter_Flush(void)
+{
+    if (save_writer_thread == NULL)
+        return;
+
+    SDL_LockMutex(save_writer_mutex);
+    while (save_writer_queue || save_writer_busy)
+        SDL_CondWait(save_writer_idle_cond, save_writer_mutex);
+    SDL_UnlockMutex(save_writer_mutex);
+
+    SaveWriter_ReportErrors();
+}
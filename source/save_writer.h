@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef SAVE_WRITER__
+#define SAVE_WRITER__
+
+#include <stddef.h>
+
+// Writes save files from a background thread so that the emulation never
+// waits for the disk. Files are written with FileWriteAtomic().
+
+void SaveWriter_Init(void);
+// Waits for all pending writes and stops the thread
+void SaveWriter_End(void);
+
+// Queues a write of a copy of the data. If there is already a write to the
+// same file waiting in the queue, it is replaced by this one. If the thread
+// isn't running, the file is written right away.
+void SaveWriter_Write(const char *path, const void *data, size_t size);
+// Waits until all pending writes have been done
+void SaveWriter_Flush(void);
+
+#endif // SAVE_WRITER__
@@ -4,6 +4,7 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <SDL2/SDL.h>
@@ -14,75 +15,124 @@
 #include "input_utils.h"
 #include "sound_utils.h"
 
-#define SDL_BUFFER_SAMPLES  (1 * 1024)
+// Samples requested by SDL in each call to the callback (~11.6 ms)
+#define SDL_BUFFER_SAMPLES  (512)
 
-// Number of samples to have as max in the SDL sound buffer.
-#define SDL_BUFFER_SAMPLES_THRESHOLD   (SDL_BUFFER_SAMPLES * 6)
+// The samples of the emulator are resampled to the output sample rate and
+// saved to a ring buffer. The main thread is the only one that writes to it,
+// and the audio callback is the only one that reads from it, so it doesn't need
+// any lock. Sizes are in stereo frames (two samples).
+#define SOUND_RING_SIZE     (16 * 1024) // Must be a power of 2
+#define SOUND_RING_MASK     (SOUND_RING_SIZE - 1)
+
+// Fill level that the rate controller tries to keep. The callback always has a
+// full buffer available, plus the samples of one frame of jitter.
+#define SOUND_TARGET_FILL   (SDL_BUFFER_SAMPLES * 2)
+
+// If there are more frames than this in the buffer (for example, after the
+// emulation has been paused), the callback drops the extra ones.
+#define SOUND_MAX_FILL      (SOUND_TARGET_FILL * 4)
+
+// Maximum change of the resampling ratio. A change of 1% is hard to hear, and
+// it's enough to compensate the difference between the refresh rate of the
+// emulated systems (~59.73 Hz) and the one of the emulator (60 Hz).
+#define SOUND_RATE_MAX_DELTA    (0.01)
 
 static int sound_enabled = 0;
 
-static SDL_AudioSpec obtained_spec;
-static SDL_AudioStream *stream;
+static int16_t sound_ring[SOUND_RING_SIZE * 2];
+static SDL_atomic_t sound_ring_read;  // Only modified by the callback
+static SDL_atomic_t sound_ring_write; // Only modified by the main thread
+
+// Resampler state, only used by the main thread
+static u32 resample_step;       // 16.16 fixed point, input frames per output
+static u32 resample_frac;       // 16.16 fixed point, position between frames
+static int16_t resample_prev[2];
+static double fill_average = SOUND_TARGET_FILL;
+static double fill_error = 0.0;
+static int rate_control_enabled = 1;
+
+// Only used by the callback
+static int16_t last_played[2];
+static int sound_primed = 0; // 0 = Waiting until the buffer reaches the target
+
+static u32 Sound_RingFill(void)
+{
+    u32 read = SDL_AtomicGet(&sound_ring_read);
+    u32 write = SDL_AtomicGet(&sound_ring_write);
+    return write - read;
+}
 
 static void Sound_Callback(unused__ void *userdata, Uint8 *buffer, int len)
 {
-    if (sound_enabled == 0)
+    int16_t *out = (int16_t *)buffer;
+    u32 frames = len / (2 * sizeof(int16_t));
+
+    u32 read = SDL_AtomicGet(&sound_ring_read);
+    u32 write = SDL_AtomicGet(&sound_ring_write);
+
+    // Don't play audio during speedup or if it is disabled in the configuration
+    if ((sound_enabled == 0) || EmulatorConfig.snd_mute
+        || Input_Speedup_Enabled())
     {
+        // Output silence and drop everything
         memset(buffer, 0, len);
+        last_played[0] = 0;
+        last_played[1] = 0;
+        sound_primed = 0;
+        SDL_AtomicSet(&sound_ring_read, write);
         return;
     }
 
-    // Don't play audio during speedup or if it is disabled in the configuration
-    if (EmulatorConfig.snd_mute || Input_Speedup_Enabled())
+    u32 available = write - read;
+    if (available > SOUND_MAX_FILL)
     {
-        // Output silence
-        memset(buffer, 0, len);
-        SDL_AudioStreamClear(stream);
+        read = write - SOUND_TARGET_FILL;
+        available = SOUND_TARGET_FILL;
     }
-    else
+
+    // After running out of samples, wait until the buffer has enough of them
+    // again instead of playing small chunks with gaps between them.
+    if (available >= SOUND_TARGET_FILL)
+        sound_primed = 1;
+
+    u32 copy = 0;
+    if (sound_primed)
     {
-        int available = SDL_AudioStreamAvailable(stream);
+        copy = (available < frames) ? available : frames;
+        if (copy < frames)
+            sound_primed = 0;
+    }
 
-        if (available < len)
-        {
-            memset(buffer, 0, len);
-        }
-        else
-        {
-            int obtained = SDL_AudioStreamGet(stream, buffer, len);
-            if (obtained == -1)
-            {
-                Debug_LogMsgArg("Failed to get converted data: %s",
-                                SDL_GetError());
-            }
-            else
-            {
-                if (obtained != len)
-                {
-                    Debug_LogMsgArg("%s: Obtained = %d, Requested = %d",
-                                    __func__, obtained, len);
-                    // Clear the rest of the buffer
-                    memset(&(buffer[obtained]), 0, len - obtained);
-                }
-            }
-        }
+    for (u32 i = 0; i < copy; i++)
+    {
+        u32 index = ((read + i) & SOUND_RING_MASK) * 2;
+        out[i * 2 + 0] = sound_ring[index + 0];
+        out[i * 2 + 1] = sound_ring[index + 1];
+    }
 
-        //Debug_LogMsgArg("Available: %d/%d",
-        //                SDL_AudioStreamAvailable(stream),
-        //                obtained_spec.samples);
+    if (copy > 0)
+    {
+        last_played[0] = out[(copy - 1) * 2 + 0];
+        last_played[1] = out[(copy - 1) * 2 + 1];
     }
-}
 
-void Sound_ClearBuffer(void)
-{
-    SDL_AudioStreamClear(stream);
+    // If there aren't enough samples, hold the last one. Jumping to silence
+    // would cause a pop.
+    for (u32 i = copy; i < frames; i++)
+    {
+        out[i * 2 + 0] = last_played[0];
+        out[i * 2 + 1] = last_played[1];
+    }
+
+    SDL_AtomicSet(&sound_ring_read, read + copy);
 }
 
 static void Sound_End(void)
 {
-     SDL_FreeAudioStream(stream);
+    SDL_CloseAudio();
 
-     sound_enabled = 0;
+    sound_enabled = 0;
 }
 
 void Sound_Init(void)
@@ -98,21 +148,18 @@ void Sound_Init(void)
     desired_spec.callback = Sound_Callback;
     desired_spec.userdata = NULL;
 
-    if (SDL_OpenAudio(&desired_spec, &obtained_spec) < 0)
+    // If the device doesn't support this format SDL converts the output of the
+    // callback, so it is always int16_t, stereo, SDL_SAMPLERATE Hz.
+    if (SDL_OpenAudio(&desired_spec, NULL) < 0)
     {
         Debug_ErrorMsgArg("Couldn't open audio: %s\n", SDL_GetError());
         return;
     }
 
-    // Input format is int16_t, dual, 32 * 1024 Hz
-    // Output format is whatever SDL_OpenAudio() returned
-    stream = SDL_NewAudioStream(AUDIO_S16, 2, GBA_SAMPLERATE,
-                                obtained_spec.format, obtained_spec.channels,
-                                obtained_spec.freq);
-    if (stream == NULL) {
-        Debug_ErrorMsgArg("Failed to create audio stream: %s", SDL_GetError());
-        return;
-    }
+    SDL_AtomicSet(&sound_ring_read, 0);
+    SDL_AtomicSet(&sound_ring_write, 0);
+
+    resample_step = ((u64)GBA_SAMPLERATE << 16) / SDL_SAMPLERATE;
 
     // Cleanup everything on exit of the program
     atexit(Sound_End);
@@ -122,27 +169,86 @@ void Sound_Init(void)
     sound_enabled = 1;
 }
 
-int Sound_IsBufferOverThreshold(void)
+// Dynamic rate control: The resampling ratio is adjusted proportionally to the
+// difference between the current fill level of the buffer and the target, so
+// that the buffer never underflows or grows without audible pitch changes.
+static void Sound_RateUpdate(void)
 {
-    if (SDL_AudioStreamAvailable(stream) > SDL_BUFFER_SAMPLES_THRESHOLD)
-        return 1;
+    fill_average += ((double)Sound_RingFill() - fill_average) / 8.0;
+
+    double error = (fill_average - SOUND_TARGET_FILL) / SOUND_TARGET_FILL;
+    if (error > 1.0)
+        error = 1.0;
+    else if (error < -1.0)
+        error = -1.0;
 
-    return 0;
+    fill_error = error;
+
+    // If the buffer is too full, read the input faster to generate fewer
+    // output frames.
+    double ratio = (double)GBA_SAMPLERATE / (double)SDL_SAMPLERATE;
+    if (rate_control_enabled)
+        ratio *= 1.0 + (SOUND_RATE_MAX_DELTA * error);
+
+    resample_step = (u32)(ratio * 65536.0);
 }
 
-int Sound_IsBufferTooBig(void)
+void Sound_SendSamples(int16_t *buffer, int len)
 {
-    if (SDL_AudioStreamAvailable(stream) > SDL_BUFFER_SAMPLES_THRESHOLD * 2)
-        return 1;
+    if (sound_enabled == 0)
+        return;
+
+    Sound_RateUpdate();
+
+    u32 write = SDL_AtomicGet(&sound_ring_write);
+    u32 free_frames = SOUND_RING_SIZE - Sound_RingFill();
 
-    return 0;
+    int frames = len / (2 * sizeof(int16_t));
+
+    // Linear interpolation between the previous input frame and the current
+    // one. The position is kept between calls so that there are no gaps.
+    for (int i = 0; i < frames; i++)
+    {
+        int16_t cur_l = buffer[i * 2 + 0];
+        int16_t cur_r = buffer[i * 2 + 1];
+
+        while (resample_frac < 0x10000)
+        {
+            // Drop samples if the callback isn't reading them
+            if (free_frames > 0)
+            {
+                s64 frac = resample_frac;
+                s32 l = resample_prev[0]
+                        + (((cur_l - resample_prev[0]) * frac) >> 16);
+                s32 r = resample_prev[1]
+                        + (((cur_r - resample_prev[1]) * frac) >> 16);
+
+                u32 index = (write & SOUND_RING_MASK) * 2;
+                sound_ring[index + 0] = l;
+                sound_ring[index + 1] = r;
+                write++;
+                free_frames--;
+            }
+
+            resample_frac += resample_step;
+        }
+
+        resample_frac -= 0x10000;
+        resample_prev[0] = cur_l;
+        resample_prev[1] = cur_r;
+    }
+
+    SDL_AtomicSet(&sound_ring_write, write);
 }
 
-void Sound_SendSamples(int16_t *buffer, int len)
+double Sound_GetFillError(void)
+{
+    return fill_error;
+}
+
+void Sound_RateControlEnable(int enable)
 {
-    int rc = SDL_AudioStreamPut(stream, buffer, len);
-    if (rc == -1)
-        Debug_LogMsgArg("Failed to send samples to stream: %s", SDL_GetError());
+    rate_control_enabled = enable;
 }
 
 void Sound_Enable(void)
@@ -16,11 +16,17 @@ void Sound_Init(void);
 void Sound_Enable(void);
 void Sound_Disable(void);
 
-void Sound_ClearBuffer(void);
-int Sound_IsBufferOverThreshold(void);
-int Sound_IsBufferTooBig(void);
+// Buffer with stereo 16-bit samples at GBA_SAMPLERATE. "len" is in bytes. The
+// playback speed is adjusted slightly to keep a low and constant latency.
 void Sound_SendSamples(int16_t *buffer, int len);
 
+// Difference between the fill level of the buffer and the target, between -1.0
+// (empty) and 1.0 (twice the target or more).
+double Sound_GetFillError(void);
+// If disabled, the playback speed isn't adjusted. Used when the speed of the
+// emulation follows the audio instead.
+void Sound_RateControlEnable(int enable);
+
 void Sound_SetVolume(int vol);
 
 void Sound_SetEnabled(int enable);
@@ -10,6 +10,7 @@ extern "C"
 
 #include "config.h"
 #include "debug_utils.h"
+#include "general_utils.h"
 #include "webcam_utils.h"
 
 #include "gb_core/camera.h"
@@ -31,7 +32,7 @@ extern "C" int Webcam_GetFrame(void)
     for (int j = 0; j < GBCAM_SENSOR_H; j++)
     {
         for (int i = 0; i < GBCAM_SENSOR_W; i++)
-            gb_camera_webcam_output[i][j] = rand() & 0xFF;
+            gb_camera_webcam_output[j][i] = rand() & 0xFF;
     }
 
     return 0;
@@ -44,18 +45,153 @@ extern "C" void Webcam_End(void)
 
 #else
 
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
 #include "opencv2/opencv.hpp"
 
+// Frames are captured by a thread so that the emulation never has to wait for
+// the device. The thread scales them down to the size of the sensor and
+// publishes them in a triple buffer: the thread owns one of the buffers, the
+// main thread owns another one, and the third one holds the latest frame.
+#define WEBCAM_FRAME_NEW    (1 << 2) // Set in webcam_ready until it's read
+#define WEBCAM_FRAME_MASK   (3)
+
+// Used if the source is a file and it doesn't have a valid frame rate
+#define WEBCAM_FILE_DEFAULT_FPS (30)
+
+static int webcam_frames[3][GBCAM_SENSOR_H][GBCAM_SENSOR_W];
+static int webcam_back = 0;  // Only used by the capture thread
+static int webcam_front = 1; // Only used by the main thread
+static SDL_atomic_t webcam_ready; // Index of the latest frame | new flag
+
+static SDL_Thread *webcam_thread = NULL;
+static SDL_atomic_t webcam_quit;
+
+// Errors can't be reported from the thread, they are reported by the next call
+// to Webcam_GetFrame(). The value is the number of channels of the frame, or -1
+// if it couldn't get a frame.
+static SDL_atomic_t webcam_error;
+
 static cv::VideoCapture cap;
 
 static int camera_enabled = 0;
 static int camera_zoomfactor = 1;
+static int camera_is_file = 0;
+static Uint32 camera_frame_ms; // Time between frames of a file source
 
-// Returns 1 on success
-extern "C" int Webcam_Init(void)
+// Returns the number of channels of the frame if it isn't valid, 0 on success
+static int Webcam_ConvertFrame(const cv::Mat &frame,
+                               int out[GBCAM_SENSOR_H][GBCAM_SENSOR_W])
 {
-    if (camera_enabled)
+    cv::Mat convertedframe;
+    frame.convertTo(convertedframe, CV_8U);
+    unsigned char *p = convertedframe.data;
+
+    cv::Size size = convertedframe.size();
+    int w = size.width;
+    //int h = size.height;
+
+    int channels = convertedframe.channels();
+    if (channels != 3)
+        return channels;
+
+    // How much to jump from one element of a row to the next one
+    size_t step = convertedframe.elemSize();
+
+    for (int j = 0; j < GBCAM_SENSOR_H; j++)
+    {
+        for (int i = 0; i < GBCAM_SENSOR_W; i++)
+        {
+            size_t index = ((j * camera_zoomfactor) * w * step)
+                           + ((i * camera_zoomfactor) * 3);
+
+            int r = p[index + 0];
+            int g = p[index + 1];
+            int b = p[index + 2];
+
+            out[j][i] = (2 * r + 5 * g + 1 * b) >> 3;
+        }
+    }
+
+    return 0;
+}
+
+static int Webcam_Thread(unused__ void *arg)
+{
+    cv::Mat frame;
+    Uint32 deadline = SDL_GetTicks();
+
+    while (SDL_AtomicGet(&webcam_quit) == 0)
+    {
+        // Reading from a device blocks until the next frame is ready, but a
+        // file has to be played at its own frame rate.
+        if (camera_is_file)
+        {
+            Uint32 now = SDL_GetTicks();
+            if ((Sint32)(deadline - now) > 0)
+            {
+                SDL_Delay(deadline - now);
+                deadline += camera_frame_ms;
+            }
+            else
+            {
+                deadline = now + camera_frame_ms;
+            }
+        }
+
+        cap >> frame;
+
+        // Loop files
+        if (frame.empty() && camera_is_file)
+        {
+            cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+            cap >> frame;
+        }
+
+        if (frame.empty())
+        {
+            SDL_AtomicSet(&webcam_error, -1);
+            break;
+        }
+
+        int ret = Webcam_ConvertFrame(frame, webcam_frames[webcam_back]);
+        if (ret != 0)
+        {
+            SDL_AtomicSet(&webcam_error, ret);
+            break;
+        }
+
+        int old = SDL_AtomicSet(&webcam_ready, webcam_back | WEBCAM_FRAME_NEW);
+        webcam_back = old & WEBCAM_FRAME_MASK;
+    }
+
+    return 0;
+}
+
+static int Webcam_Open(void)
+{
+    if (EmulatorConfig.webcam_source[0] != '\0')
+    {
+        // Video files and image sequences like "frame_%03d.png"
+        if (!cap.open(EmulatorConfig.webcam_source))
+        {
+            Debug_ErrorMsgArg("OpenCV error:\n"
+                              "Couldn't open file %s",
+                              EmulatorConfig.webcam_source);
+            return 0;
+        }
+
+        camera_is_file = 1;
+
+        double fps = cap.get(cv::CAP_PROP_FPS);
+        if ((fps < 1.0) || (fps > 1000.0))
+            fps = WEBCAM_FILE_DEFAULT_FPS;
+        camera_frame_ms = (Uint32)(1000.0 / fps);
+
         return 1;
+    }
 
     // Try to open the default camera
     if (!cap.open(EmulatorConfig.webcam_select))
@@ -66,7 +202,7 @@ extern "C" int Webcam_Init(void)
         return 0;
     }
 
-    camera_enabled = 1;
+    camera_is_file = 0;
 
     // TODO : Select resolution from configuration file?
 
@@ -97,6 +233,20 @@ extern "C" int Webcam_Init(void)
             break;
     }
 
+    return 1;
+}
+
+// Returns 1 on success
+extern "C" int Webcam_Init(void)
+{
+    if (camera_enabled)
+        return 1;
+
+    if (!Webcam_Open())
+        return 0;
+
+    camera_enabled = 1;
+
     cv::Mat frame;
     cap >> frame;
     if (frame.empty())
@@ -107,8 +257,8 @@ extern "C" int Webcam_Init(void)
     }
 
     cv::Size size = frame.size();
-    w = size.width;
-    h = size.height;
+    int w = size.width;
+    int h = size.height;
 
     Debug_LogMsgArg("Camera resolution is: %dx%d", w, h);
     if ((w < GBCAM_SENSOR_W) || (h < GBCAM_SENSOR_H))
@@ -123,9 +273,35 @@ extern "C" int Webcam_Init(void)
 
     camera_zoomfactor = (xfactor > yfactor) ? yfactor : xfactor; // Min
 
+    // Publish the first frame so that there is always one available
+    int channels = Webcam_ConvertFrame(frame, webcam_frames[2]);
+    if (channels != 0)
+    {
+        Webcam_End();
+        Debug_ErrorMsgArg("Invalid camera output.\n"
+                          "Channels = %d",
+                          channels);
+        return -1;
+    }
+
+    webcam_back = 0;
+    webcam_front = 1;
+    SDL_AtomicSet(&webcam_ready, 2 | WEBCAM_FRAME_NEW);
+    SDL_AtomicSet(&webcam_error, 0);
+    SDL_AtomicSet(&webcam_quit, 0);
+
+    webcam_thread = SDL_CreateThread(Webcam_Thread, "Webcam capture", NULL);
+    if (webcam_thread == NULL)
+    {
+        Webcam_End();
+        Debug_ErrorMsgArg("%s(): %s", __func__, SDL_GetError());
+        return 0;
+    }
+
     return 1;
 }
 
+// This never waits for the capture thread, it uses the latest frame available
 extern "C" int Webcam_GetFrame(void)
 {
     if (camera_enabled == 0)
@@ -134,56 +310,38 @@ extern "C" int Webcam_GetFrame(void)
         for (int j = 0; j < GBCAM_SENSOR_H; j++)
         {
             for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                gb_camera_webcam_output[i][j] = rand() & 0xFF;
+                gb_camera_webcam_output[j][i] = rand() & 0xFF;
         }
+
+        return 0;
     }
-    else
+
+    int error = SDL_AtomicGet(&webcam_error);
+    if (error != 0)
     {
-        // Get image
-        cv::Mat frame, convertedframe;
-        cap >> frame;
-        if (frame.empty())
+        Webcam_End();
+        if (error < 0)
         {
-            Webcam_End();
             Debug_ErrorMsgArg("OpenCV error: Couldn't get frame");
-            return -1;
         }
-
-        frame.convertTo(convertedframe, CV_8U);
-        unsigned char *p = convertedframe.data;
-
-        cv::Size size = convertedframe.size();
-        int w = size.width;
-        //int h = size.height;
-
-        int channels = convertedframe.channels();
-        if (channels != 3)
+        else
         {
             Debug_ErrorMsgArg("Invalid camera output.\n"
                               "Channels = %d",
-                              channels);
-            return -1;
+                              error);
         }
+        return -1;
+    }
 
-        // How much to jump from one element of a row to the next one
-        size_t step = convertedframe.elemSize();
-
-        for (int j = 0; j < GBCAM_SENSOR_H; j++)
-        {
-            for (int i = 0; i < GBCAM_SENSOR_W; i++)
-            {
-                size_t index = ((j * camera_zoomfactor) * w * step)
-                               + ((i * camera_zoomfactor) * 3);
-
-                int r = p[index + 0];
-                int g = p[index + 1];
-                int b = p[index + 2];
-
-                gb_camera_webcam_output[i][j] = (2 * r + 5 * g + 1 * b) >> 3;
-            }
-        }
+    if (SDL_AtomicGet(&webcam_ready) & WEBCAM_FRAME_NEW)
+    {
+        int old = SDL_AtomicSet(&webcam_ready, webcam_front);
+        webcam_front = old & WEBCAM_FRAME_MASK;
     }
 
+    memcpy(gb_camera_webcam_output, webcam_frames[webcam_front],
+           sizeof(gb_camera_webcam_output));
+
     return 0;
 }
 
@@ -192,6 +350,13 @@ extern "C" void Webcam_End(void)
     if (camera_enabled == 0)
         return;
 
+    if (webcam_thread)
+    {
+        SDL_AtomicSet(&webcam_quit, 1);
+        SDL_WaitThread(webcam_thread, NULL);
+        webcam_thread = NULL;
+    }
+
     cap.release();
 
     camera_enabled = 0;
@@ -26,6 +26,9 @@ typedef struct
     SDL_Renderer *mRenderer;
     SDL_GLContext GLContext;
     SDL_Texture *mTexture;
+    SDL_Texture *mStreamTexture; // Native format, written with WH_LockTexture()
+    int mStreamWidth;
+    int mStreamHeight;
     int mWindowID;
 
     WH_CallbackFn mEventCallback;
@@ -121,6 +124,7 @@ int WH_Create(int width, int height, int texw, int texh, int scale)
     // Initialize non-existant window
     w->mWindow = NULL;
     w->mRenderer = NULL;
+    w->mStreamTexture = NULL;
     w->mEventCallback = NULL;
     w->mMouseFocus = 0;
     w->mKeyboardFocus = 0;
@@ -248,11 +252,14 @@ static void _wh_free_from_handle(WindowHandle *w)
     if (w->mWindow != NULL)
     {
         SDL_DestroyTexture(w->mTexture);
+        if (w->mStreamTexture)
+            SDL_DestroyTexture(w->mStreamTexture);
         SDL_GL_DeleteContext(w->GLContext);
         SDL_DestroyWindow(w->mWindow);
     }
 
     w->mWindow = NULL;
+    w->mStreamTexture = NULL;
     w->mWindowID = -1;
 
     w->mMouseFocus = 0;
@@ -441,18 +448,8 @@ void WH_SetCaption(int index, const char *caption)
     SDL_SetWindowTitle(w->mWindow, caption);
 }
 
-void WH_Render(int index, const unsigned char *buffer)
+static void _wh_render_texture(WindowHandle *w, SDL_Texture *texture)
 {
-    WindowHandle *w = _wh_get_from_index(index);
-
-    if (w == NULL)
-        return;
-    if (w->mWindow == NULL)
-        return;
-
-    SDL_UpdateTexture(w->mTexture, NULL, (const void *)buffer,
-                      w->mTexWidth * 3);
-
 #ifdef OPENGL_BLIT
     glEnable(GL_TEXTURE_2D);
     glDisable(GL_DEPTH_TEST);
@@ -469,7 +466,7 @@ void WH_Render(int index, const unsigned char *buffer)
 
     glClear(GL_COLOR_BUFFER_BIT); // Clear screen
 
-    SDL_GL_BindTexture(w->mTexture, NULL, NULL); // Returns 0 if OK
+    SDL_GL_BindTexture(texture, NULL, NULL); // Returns 0 if OK
 
     if (w->mTexScale)
     {
@@ -501,7 +498,7 @@ void WH_Render(int index, const unsigned char *buffer)
 
     if (w->mTexScale == 0)
     {
-        SDL_RenderCopy(w->mRenderer, w->mTexture, NULL, NULL);
+        SDL_RenderCopy(w->mRenderer, texture, NULL, NULL);
     }
     else
     {
@@ -529,7 +526,7 @@ void WH_Render(int index, const unsigned char *buffer)
         dst.w = x_size;
         dst.h = y_size;
 
-        SDL_RenderCopy(w->mRenderer, w->mTexture, &src, &dst);
+        SDL_RenderCopy(w->mRenderer, texture, &src, &dst);
     }
 
 #endif // OPENGL_BLIT
@@ -537,6 +534,99 @@ void WH_Render(int index, const unsigned char *buffer)
     SDL_RenderPresent(w->mRenderer);
 }
 
+void WH_Render(int index, const unsigned char *buffer)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if (w == NULL)
+        return;
+    if (w->mWindow == NULL)
+        return;
+
+    SDL_UpdateTexture(w->mTexture, NULL, (const void *)buffer,
+                      w->mTexWidth * 3);
+
+    _wh_render_texture(w, w->mTexture);
+}
+
+void *WH_LockTexture(int index, int *pitch)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if (w == NULL)
+        return NULL;
+    if (w->mWindow == NULL)
+        return NULL;
+
+    if (w->mStreamTexture)
+    {
+        if ((w->mStreamWidth != w->mTexWidth)
+            || (w->mStreamHeight != w->mTexHeight))
+        {
+            SDL_DestroyTexture(w->mStreamTexture);
+            w->mStreamTexture = NULL;
+        }
+    }
+
+    if (w->mStreamTexture == NULL)
+    {
+        w->mStreamTexture = SDL_CreateTexture(w->mRenderer,
+                                              SDL_PIXELFORMAT_RGB888,
+                                              SDL_TEXTUREACCESS_STREAMING,
+                                              w->mTexWidth, w->mTexHeight);
+        if (w->mStreamTexture == NULL)
+        {
+            Debug_LogMsgArg("Couldn't create texture! SDL Error: %s\n",
+                            SDL_GetError());
+            return NULL;
+        }
+
+        w->mStreamWidth = w->mTexWidth;
+        w->mStreamHeight = w->mTexHeight;
+    }
+
+    void *pixels;
+    if (SDL_LockTexture(w->mStreamTexture, NULL, &pixels, pitch) != 0)
+    {
+        Debug_LogMsgArg("Couldn't lock texture! SDL Error: %s\n",
+                        SDL_GetError());
+        return NULL;
+    }
+
+    return pixels;
+}
+
+void WH_UnlockTexture(int index)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if (w == NULL)
+        return;
+    if (w->mStreamTexture == NULL)
+        return;
+
+    SDL_UnlockTexture(w->mStreamTexture);
+}
+
+void WH_RenderTexture(int index)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if (w == NULL)
+        return;
+    if (w->mWindow == NULL)
+        return;
+
+    // Nothing has been written to it yet, or the size has changed since then
+    if (w->mStreamTexture == NULL)
+        return;
+    if ((w->mStreamWidth != w->mTexWidth)
+        || (w->mStreamHeight != w->mTexHeight))
+        return;
+
+    _wh_render_texture(w, w->mStreamTexture);
+}
+
 int WH_AreAllWindowsClosed(void)
 {
     for (int i = 0; i < MAX_WINDOWS; i++)
@@ -656,3 +746,61 @@ int WH_IsShown(int index)
 
     return w->mShown;
 }
+
+int WH_SetVSync(int index, int mode)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if (w == NULL)
+        return 1;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    // Make sure that the context of this renderer is the current one
+    SDL_RenderFlush(w->mRenderer);
+
+    if (SDL_RenderSetVSync(w->mRenderer, mode != WH_VSYNC_OFF) != 0)
+    {
+        Debug_LogMsgArg("Couldn't set VSync: %s", SDL_GetError());
+        return 1;
+    }
+
+    if (mode == WH_VSYNC_ADAPTIVE)
+    {
+        // Late swap tearing is only available in the OpenGL renderer, and
+        // only if the driver supports it. Keep regular VSync if not.
+        SDL_RendererInfo info;
+        if ((SDL_GetRendererInfo(w->mRenderer, &info) != 0)
+            || (strcmp(info.name, "opengl") != 0)
+            || (SDL_GL_SetSwapInterval(-1) != 0))
+        {
+            Debug_LogMsgArg("Adaptive VSync not supported, using VSync");
+        }
+    }
+
+    return 0;
+#else
+    if (mode == WH_VSYNC_OFF)
+        return 0;
+
+    Debug_LogMsgArg("VSync requires SDL 2.0.18 or later");
+    return 1;
+#endif
+}
+
+int WH_GetRefreshRate(int index)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if (w == NULL)
+        return 0;
+
+    int display = SDL_GetWindowDisplayIndex(w->mWindow);
+    if (display < 0)
+        return 0;
+
+    SDL_DisplayMode mode;
+    if (SDL_GetCurrentDisplayMode(display, &mode) != 0)
+        return 0;
+
+    return mode.refresh_rate;
+}
@@ -28,8 +28,17 @@ void WH_HandleEvents(void);
 
 void WH_SetCaption(int index, const char *caption);
 
+// The buffer is in 24 bit RGB format
 void WH_Render(int index, const unsigned char *buffer);
 
+// Streaming access to a texture in the native format of the renderer (32 bit
+// XRGB, 0x00RRGGBB), so that frames can be written straight to it instead of
+// being copied from a buffer. Pitch is the size of a row in bytes. It returns
+// NULL on error. WH_RenderTexture() renders the last frame written to it.
+void *WH_LockTexture(int index, int *pitch);
+void WH_UnlockTexture(int index);
+void WH_RenderTexture(int index);
+
 void WH_Close(int index);
 void WH_CloseAllBut(int index);
 void WH_CloseAllButMain(void);
@@ -47,4 +56,13 @@ int WH_HasKeyboardFocus(int index);
 
 int WH_IsShown(int index);
 
+#define WH_VSYNC_OFF        (0)
+#define WH_VSYNC_ON         (1)
+#define WH_VSYNC_ADAPTIVE   (2) // Don't wait if the frame is late
+
+// Returns 0 on success
+int WH_SetVSync(int index, int mode);
+// Refresh rate of the display that has the window, 0 if unknown
+int WH_GetRefreshRate(int index);
+
 #endif // WINDOW_HANDLER__
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+// Replacements of the parts of the emulator that need the GUI, which aren't
+// linked in the tests.
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "debug_utils.h"
+
+#include "gba_core/bios.h"
+
+#include "test.h"
+
+int test_errors = 0;
+
+int Test_Result(void)
+{
+    if (test_errors > 0)
+    {
+        printf("%d checks failed\n", test_errors);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
+
+t_config EmulatorConfig;
+
+void Debug_LogMsgArg(const char *msg, ...)
+{
+    va_list args;
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+    printf("\n");
+}
+
+void Debug_DebugMsgArg(const char *msg, ...)
+{
+    va_list args;
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+    printf("\n");
+}
+
+void Debug_ErrorMsgArg(const char *msg, ...)
+{
+    va_list args;
+    va_start(args, msg);
+    printf("Error: ");
+    vprintf(msg, args);
+    va_end(args);
+    printf("\n");
+}
+
+int GBA_BiosIsLoaded(void)
+{
+    return 0;
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef TEST__
+#define TEST__
+
+#include <stdio.h>
+
+// Number of checks that have failed. The test fails if it isn't 0 at the end.
+extern int test_errors;
+
+#define TEST_CHECK(cond)                                                       \
+    do {                                                                       \
+        if (!(cond))                                                           \
+        {                                                                      \
+            printf("%s:%d: Check failed: %s\n", __FILE__, __LINE__, #cond);    \
+            test_errors++;                                                     \
+        }                                                                      \
+    } while (0)
+
+// Returns the exit code of the test
+int Test_Result(void);
+
+#endif // TEST__
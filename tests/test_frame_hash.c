@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "frame_hash.h"
+#include "general_utils.h"
+
+#include "test.h"
+
+#define TEST_LOG_PATH "test_frame_hash.log"
+
+static u32 test_frame;
+static u32 test_wrong_frame = UINT32_MAX; // Frame with a different screen
+
+static u64 test_screen_hash(void)
+{
+    if (test_frame == test_wrong_frame)
+        return 0;
+
+    return hash_data(&test_frame, sizeof(test_frame), HASH_INIT);
+}
+
+static u64 test_sound_hash(void)
+{
+    return (u64)test_frame * 0x100000001ULL;
+}
+
+// Emulates the frames like the cores do. Returns 0 if the frames were drawn
+// when they had to be drawn.
+static int test_run(int interval, int frames)
+{
+    int ret = 0;
+
+    for (test_frame = 0; test_frame < (u32)frames; test_frame++)
+    {
+        int flags = FrameHash_FrameStart();
+
+        int draw = (((test_frame + 1) % interval) == 0)
+                   || (((test_frame + 2) % interval) == 0);
+        if (((flags & FRAME_HASH_DRAW) != 0) != draw)
+            ret = 1;
+        if ((flags & FRAME_HASH_END) == 0)
+            ret = 1;
+
+        FrameHash_FrameEnd(test_screen_hash, test_sound_hash);
+    }
+
+    return ret;
+}
+
+static int test_log_lines(void)
+{
+    FILE *f = fopen(TEST_LOG_PATH, "r");
+    if (f == NULL)
+        return -1;
+
+    int lines = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), f))
+    {
+        if (line[0] != '#')
+            lines++;
+    }
+
+    fclose(f);
+    return lines;
+}
+
+int main(void)
+{
+    // Nothing is hashed until a log is set
+
+    TEST_CHECK(FrameHash_FrameStart() == 0);
+
+    // Save a log
+
+    FrameHash_IntervalSet(4);
+    TEST_CHECK(FrameHash_LogSet(TEST_LOG_PATH) == 0);
+    TEST_CHECK(test_run(4, 20) == 0);
+    FrameHash_Stop();
+
+    TEST_CHECK(test_log_lines() == 5);
+
+    // Check the same frames
+
+    TEST_CHECK(FrameHash_CheckSet(TEST_LOG_PATH) == 0);
+    TEST_CHECK(test_run(4, 20) == 0);
+    TEST_CHECK(FrameHash_CheckFinished() == 0);
+    TEST_CHECK(FrameHash_CheckErrors() == 0);
+    FrameHash_Stop();
+
+    // Run past the end of the log
+
+    TEST_CHECK(FrameHash_CheckSet(TEST_LOG_PATH) == 0);
+    test_run(4, 24);
+    TEST_CHECK(FrameHash_CheckFinished() == 1);
+    TEST_CHECK(FrameHash_CheckErrors() == 0);
+    FrameHash_Stop();
+
+    // Only the screens that are hashed are checked
+
+    TEST_CHECK(FrameHash_CheckSet(TEST_LOG_PATH) == 0);
+    test_wrong_frame = 6;
+    test_run(4, 20);
+    TEST_CHECK(FrameHash_CheckErrors() == 0);
+    FrameHash_Stop();
+
+    TEST_CHECK(FrameHash_CheckSet(TEST_LOG_PATH) == 0);
+    test_wrong_frame = 7;
+    test_run(4, 20);
+    TEST_CHECK(FrameHash_CheckErrors() == 1);
+    FrameHash_Stop();
+
+    test_wrong_frame = UINT32_MAX;
+
+    // The sound of all the frames since the last line is checked
+
+    TEST_CHECK(FrameHash_CheckSet(TEST_LOG_PATH) == 0);
+    for (test_frame = 0; test_frame < 20; test_frame++)
+    {
+        FrameHash_FrameStart();
+        if (test_frame == 9)
+            FrameHash_FrameEnd(test_screen_hash, test_screen_hash);
+        else
+            FrameHash_FrameEnd(test_screen_hash, test_sound_hash);
+    }
+    TEST_CHECK(FrameHash_CheckErrors() == 1);
+    FrameHash_Stop();
+
+    // A log saved with a different interval stops the check
+
+    FrameHash_IntervalSet(5);
+    TEST_CHECK(FrameHash_CheckSet(TEST_LOG_PATH) == 0);
+    TEST_CHECK(test_run(5, 20) == 0);
+    TEST_CHECK(FrameHash_CheckFinished() == 1);
+    TEST_CHECK(FrameHash_CheckErrors() == 1);
+    FrameHash_Stop();
+
+    // Logs saved with the old hash can't be checked
+
+    FILE *f = fopen(TEST_LOG_PATH, "w");
+    if (f)
+    {
+        fputs("# Frame, screen hash, sound hash\n"
+              "3 0123456789ABCDEF 0123456789ABCDEF\n", f);
+        fclose(f);
+    }
+    TEST_CHECK(FrameHash_CheckSet(TEST_LOG_PATH) != 0);
+    TEST_CHECK(FrameHash_FrameStart() == 0);
+
+    remove(TEST_LOG_PATH);
+
+    return Test_Result();
+}
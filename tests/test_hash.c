@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include "general_utils.h"
+
+#include "test.h"
+
+static int test_popcount(u64 value)
+{
+    int count = 0;
+    while (value)
+    {
+        value &= value - 1;
+        count++;
+    }
+    return count;
+}
+
+static void test_vectors(void)
+{
+    // If the hash changes, the frame hash logs and the movies saved with the
+    // old one stop working, so their formats have to change too.
+
+    static u8 rom[32 * 1024];
+    for (size_t i = 0; i < sizeof(rom); i++)
+        rom[i] = (u8)((i * 7) ^ (i >> 8));
+
+    TEST_CHECK(hash_data("", 0, HASH_INIT) == 0x4FA8D3E0A94EAA96ULL);
+    TEST_CHECK(hash_data("a", 1, HASH_INIT) == 0xEDC777A061B87D7BULL);
+    TEST_CHECK(hash_data("GiiBiiAdvance", 13, HASH_INIT)
+               == 0x7736BF12FA5EF282ULL);
+    TEST_CHECK(hash_data(rom, sizeof(rom), HASH_INIT)
+               == 0x30239467B2BDCA51ULL);
+
+    // Bit 63 flipped in two different words
+    rom[7] ^= 0x80;
+    rom[8007] ^= 0x80;
+    TEST_CHECK(hash_data(rom, sizeof(rom), HASH_INIT)
+               == 0xBBF3E7FE05E5ED37ULL);
+}
+
+static void test_single_bit_changes(void)
+{
+    u8 data[64];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (u8)(i * 13);
+
+    u64 ref = hash_data(data, sizeof(data), HASH_INIT);
+
+    // Every bit of the input has to change a lot of bits of the hash, not only
+    // the ones above it.
+    for (size_t bit = 0; bit < sizeof(data) * 8; bit++)
+    {
+        data[bit / 8] ^= 1 << (bit % 8);
+        u64 hash = hash_data(data, sizeof(data), HASH_INIT);
+        data[bit / 8] ^= 1 << (bit % 8);
+
+        int changed = test_popcount(hash ^ ref);
+        if ((changed < 12) || (changed > 52))
+        {
+            printf("Bit %zu changes %d bits of the hash\n", bit, changed);
+            test_errors++;
+        }
+    }
+}
+
+static void test_paired_bit_changes(void)
+{
+    u8 data[256] = { 0 };
+
+    u64 ref = hash_data(data, sizeof(data), HASH_INIT);
+
+    // Changes in the most significant bits of two words can't cancel out
+    for (size_t a = 0; a < sizeof(data) / 8; a++)
+    {
+        for (size_t b = a + 1; b < sizeof(data) / 8; b++)
+        {
+            data[a * 8 + 7] ^= 0x80;
+            data[b * 8 + 7] ^= 0x80;
+            u64 hash = hash_data(data, sizeof(data), HASH_INIT);
+            data[a * 8 + 7] ^= 0x80;
+            data[b * 8 + 7] ^= 0x80;
+
+            if (hash == ref)
+            {
+                printf("Words %zu and %zu cancel out\n", a, b);
+                test_errors++;
+            }
+        }
+    }
+}
+
+static void test_screen_changes(void)
+{
+    // Like a line of the screen of the GBA, 4 pixels per word
+    u16 line[240];
+    for (size_t i = 0; i < 240; i++)
+        line[i] = (u16)(i * 0x0421);
+
+    u64 ref = hash_data(line, sizeof(line), HASH_INIT);
+
+    // Most significant bit of blue in the 4th pixel of a word
+    line[3] ^= 0x4000;
+    u64 hash = hash_data(line, sizeof(line), HASH_INIT);
+    line[3] ^= 0x4000;
+
+    TEST_CHECK(test_popcount(hash ^ ref) >= 12);
+}
+
+int main(void)
+{
+    test_vectors();
+    test_single_bit_changes();
+    test_paired_bit_changes();
+    test_screen_changes();
+
+    return Test_Result();
+}
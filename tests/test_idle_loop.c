@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <string.h>
+
+#include "gb_core/gameboy.h"
+#include "gb_core/idle_loop.h"
+#include "gb_core/memory.h"
+
+#include "test.h"
+
+_GB_CONTEXT_ GameBoy;
+
+static u8 test_memory[0x10000];
+
+u32 GB_MemRead8(u32 address)
+{
+    return test_memory[address & 0xFFFF];
+}
+
+// Writes the code of a loop at the address and checks it. The last instruction
+// of the code must be the JR that jumps back to the address.
+static int test_loop_is_safe(u32 address, const u8 *code, size_t size)
+{
+    memcpy(&test_memory[address], code, size);
+    return GB_IdleLoopBodyIsSafe(address + size - 2, address);
+}
+
+#define LOOP_IS_SAFE(address, ...)                                             \
+    test_loop_is_safe(address, (const u8[]){ __VA_ARGS__ },                    \
+                      sizeof((const u8[]){ __VA_ARGS__ }))
+
+static void test_read_is_safe(void)
+{
+    TEST_CHECK(GB_IdleLoopReadIsSafe(0x0000)); // ROM
+    TEST_CHECK(GB_IdleLoopReadIsSafe(0x7FFF));
+    TEST_CHECK(GB_IdleLoopReadIsSafe(0x8000)); // VRAM
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(0xA000)); // Cartridge RAM
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(0xBFFF));
+    TEST_CHECK(GB_IdleLoopReadIsSafe(0xC000)); // WRAM
+    TEST_CHECK(GB_IdleLoopReadIsSafe(0xDFFF));
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(0xE000)); // Echo RAM
+    TEST_CHECK(GB_IdleLoopReadIsSafe(0xFE00)); // OAM
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(0xFEA0)); // Not usable
+    TEST_CHECK(GB_IdleLoopReadIsSafe(0xFF80)); // HRAM
+    TEST_CHECK(GB_IdleLoopReadIsSafe(IE_REG));
+
+    // Registers that only change at events or PPU mode changes
+    TEST_CHECK(GB_IdleLoopReadIsSafe(IF_REG));
+    TEST_CHECK(GB_IdleLoopReadIsSafe(STAT_REG));
+    TEST_CHECK(GB_IdleLoopReadIsSafe(LY_REG));
+
+    // Registers that change on their own
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(P1_REG));
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(SB_REG));
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(DIV_REG));
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(TIMA_REG));
+    TEST_CHECK(!GB_IdleLoopReadIsSafe(NR52_REG));
+}
+
+static void test_body_is_safe(void)
+{
+    _GB_CPU_ *cpu = &GameBoy.CPU;
+
+    // LDH A,[LY] ; CP A,0x90 ; JR NZ,loop
+    TEST_CHECK(LOOP_IS_SAFE(0x0150, 0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA));
+
+    // LDH A,[P1] ; CP A,0x90 ; JR NZ,loop
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0xF0, 0x00, 0xFE, 0x90, 0x20, 0xFA));
+
+    // LD A,[0xC000] ; AND A,A ; JR Z,loop
+    TEST_CHECK(LOOP_IS_SAFE(0x0150, 0xFA, 0x00, 0xC0, 0xA7, 0x28, 0xFA));
+
+    // LD A,[0xC000] ; AND A,A ; JP Z,loop
+    memcpy(&test_memory[0x0200],
+           (const u8[]){ 0xFA, 0x00, 0xC0, 0xA7, 0xCA, 0x00, 0x02 }, 7);
+    TEST_CHECK(GB_IdleLoopBodyIsSafe(0x0204, 0x0200));
+
+    // LD A,[0xA000] ; AND A,A ; JR Z,loop
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0xFA, 0x00, 0xA0, 0xA7, 0x28, 0xFA));
+
+    // LD A,[HL] ; AND A,A ; JR Z,loop
+    cpu->R8.H = 0xC1;
+    cpu->R8.L = 0x00;
+    TEST_CHECK(LOOP_IS_SAFE(0x0150, 0x7E, 0xA7, 0x28, 0xFC));
+    cpu->R8.H = 0xA0;
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0x7E, 0xA7, 0x28, 0xFC));
+
+    // LD HL,0xC100 ; LD A,[HL] ; AND A,A ; JR Z,loop
+    TEST_CHECK(LOOP_IS_SAFE(0x0150, 0x21, 0x00, 0xC1, 0x7E, 0xA7, 0x28, 0xF9));
+
+    // INC HL ; LD A,[HL] ; AND A,A ; JR Z,loop (HL isn't known)
+    cpu->R8.H = 0xC1;
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0x23, 0x7E, 0xA7, 0x28, 0xFB));
+
+    // LD C,0x41 ; LD A,[0xFF00+C] ; AND A,3 ; JR NZ,loop
+    TEST_CHECK(LOOP_IS_SAFE(0x0150, 0x0E, 0x41, 0xF2, 0xE6, 0x03, 0x20, 0xF9));
+
+    // BIT 0,[HL] ; JR Z,loop
+    cpu->R8.H = 0xFF;
+    cpu->R8.L = 0x85;
+    TEST_CHECK(LOOP_IS_SAFE(0x0150, 0xCB, 0x46, 0x28, 0xFC));
+
+    // Loops that write to memory or have side effects
+
+    // LD [HL],A ; JR loop
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0x77, 0x18, 0xFD));
+    // LDH [0x80],A ; JR loop
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0xE0, 0x80, 0x18, 0xFC));
+    // SET 0,[HL] ; JR loop
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0xCB, 0xC6, 0x18, 0xFC));
+    // HALT ; JR loop
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0x76, 0x18, 0xFD));
+    // CALL 0x0000 ; JR loop
+    TEST_CHECK(!LOOP_IS_SAFE(0x0150, 0xCD, 0x00, 0x00, 0x18, 0xFB));
+
+    // The last instruction of the body ends after the start of the branch
+    TEST_CHECK(GB_IdleLoopBodyIsSafe(0x0151, 0x0150) == 0);
+
+    // The branch has to be JR or JP
+    memcpy(&test_memory[0x0150], (const u8[]){ 0xF0, 0x44, 0xC0 }, 3);
+    TEST_CHECK(GB_IdleLoopBodyIsSafe(0x0152, 0x0150) == 0); // RET NZ
+
+    // Code that can be modified by the cartridge isn't analyzed
+    memcpy(&test_memory[0xA000], (const u8[]){ 0xF0, 0x44, 0x20, 0xFC }, 4);
+    TEST_CHECK(GB_IdleLoopBodyIsSafe(0xA002, 0xA000) == 0);
+}
+
+int main(void)
+{
+    test_read_is_safe();
+    test_body_is_safe();
+
+    return Test_Result();
+}
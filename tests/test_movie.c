@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "build_options.h"
+#include "config.h"
+#include "general_utils.h"
+#include "movie.h"
+
+#include "test.h"
+
+#define TEST_MOVIE_PATH "test_movie.gbm"
+#define TEST_SAVE_PATH  "test_movie.sav"
+
+#define TEST_FRAMES (MOVIE_CHECKPOINT_FRAMES * 3 + 10)
+#define TEST_INPUTS 2
+
+static const u8 test_rom[] = { 0x00, 0xC3, 0x50, 0x01, 0xCE, 0xED };
+
+static u16 test_input(u32 frame, int i)
+{
+    return (u16)((frame / 7) * (i + 1));
+}
+
+static u64 test_screen_hash(u32 frame)
+{
+    return hash_data(&frame, sizeof(frame), HASH_INIT);
+}
+
+static void test_save_write(const char *data)
+{
+    FILE *f = fopen(TEST_SAVE_PATH, "wb");
+    if (f == NULL)
+        return;
+    fputs(data, f);
+    fclose(f);
+}
+
+// Returns the first byte of the save file that the core would load
+static int test_save_read(void)
+{
+    FILE *f = Movie_SaveFileOpen(TEST_SAVE_PATH);
+    if (f == NULL)
+        return -1;
+    int c = fgetc(f);
+    fclose(f);
+    return c;
+}
+
+static int test_record(int *first_rand, u64 *time)
+{
+    int ret = 0;
+
+    test_save_write("A");
+
+    if (Movie_RecordSet(TEST_MOVIE_PATH) != 0)
+        return 1;
+
+    EmulatorConfig.hardware_type = 3;
+    Movie_BeforeLoad(MOVIE_SYSTEM_GB);
+    *first_rand = rand();
+    *time = Movie_GetTime();
+    if (test_save_read() != 'A')
+        ret = 1;
+    Movie_AfterLoad(test_rom, sizeof(test_rom), 1);
+
+    for (u32 frame = 0; frame < TEST_FRAMES; frame++)
+    {
+        u16 input[TEST_INPUTS];
+        for (int i = 0; i < TEST_INPUTS; i++)
+            input[i] = test_input(frame, i);
+
+        int flags = Movie_FrameStart(input, TEST_INPUTS);
+
+        int checkpoint = ((frame + 1) % MOVIE_CHECKPOINT_FRAMES) == 0;
+        int draw = checkpoint
+                   || (((frame + 2) % MOVIE_CHECKPOINT_FRAMES) == 0);
+        if (((flags & MOVIE_FRAME_CHECKPOINT) != 0) != checkpoint)
+            ret = 1;
+        if (((flags & MOVIE_FRAME_DRAW) != 0) != draw)
+            ret = 1;
+
+        if (flags & MOVIE_FRAME_CHECKPOINT)
+            Movie_FrameCheckpoint(test_screen_hash(frame));
+    }
+
+    Movie_Stop();
+
+    return ret;
+}
+
+// Returns the result of the playback, or -2 if the input of the movie wasn't
+// the one that was recorded.
+static int test_play(u32 wrong_frame)
+{
+    if (Movie_PlaySet(TEST_MOVIE_PATH) != 0)
+        return -2;
+
+    Movie_BeforeLoad(MOVIE_SYSTEM_GB);
+    Movie_AfterLoad(test_rom, sizeof(test_rom), 1);
+
+    int ret = 0;
+
+    for (u32 frame = 0; frame < TEST_FRAMES; frame++)
+    {
+        u16 input[TEST_INPUTS] = { 0 };
+
+        int flags = Movie_FrameStart(input, TEST_INPUTS);
+
+        for (int i = 0; i < TEST_INPUTS; i++)
+        {
+            if (input[i] != test_input(frame, i))
+                ret = -2;
+        }
+
+        if (flags & MOVIE_FRAME_CHECKPOINT)
+        {
+            u64 hash = test_screen_hash(frame);
+            if (frame == wrong_frame)
+                hash++;
+            Movie_FrameCheckpoint(hash);
+        }
+    }
+
+    if (Movie_PlaybackResult() != -1)
+        ret = -2;
+
+    // The movie ends at the start of the frame after the last one
+    u16 input[TEST_INPUTS] = { 0 };
+    Movie_FrameStart(input, TEST_INPUTS);
+
+    if (ret == 0)
+        ret = Movie_PlaybackResult();
+
+    Movie_Stop();
+
+    return ret;
+}
+
+int main(void)
+{
+    int first_rand;
+    u64 time;
+
+    EmulatorConfig.hardware_type = 0;
+
+    TEST_CHECK(test_record(&first_rand, &time) == 0);
+
+    // The configuration is only replaced while the ROM is loaded
+    TEST_CHECK(EmulatorConfig.hardware_type == 3);
+
+    // The save file is modified after the movie is recorded, but the movie
+    // has to use the one that existed when the recording started.
+
+    test_save_write("B");
+    EmulatorConfig.hardware_type = 0;
+
+    TEST_CHECK(Movie_PlaySet(TEST_MOVIE_PATH) == 0);
+    Movie_BeforeLoad(MOVIE_SYSTEM_GB);
+    TEST_CHECK(EmulatorConfig.hardware_type == 3);
+    TEST_CHECK(rand() == first_rand);
+    TEST_CHECK(Movie_GetTime() == time);
+    TEST_CHECK(test_save_read() == 'A');
+    Movie_AfterLoad(test_rom, sizeof(test_rom), 1);
+    TEST_CHECK(EmulatorConfig.hardware_type == 0);
+    TEST_CHECK(Movie_IsPlaying() == 1);
+    TEST_CHECK(Movie_SaveWriteAllowed() == 0);
+    Movie_Stop();
+
+    TEST_CHECK(Movie_IsPlaying() == 0);
+    TEST_CHECK(Movie_SaveWriteAllowed() == 1);
+    TEST_CHECK(test_save_read() == 'B');
+
+    // Playback
+
+    TEST_CHECK(test_play(UINT32_MAX) == 0);
+    TEST_CHECK(test_play(MOVIE_CHECKPOINT_FRAMES * 2 - 1) == 1);
+
+    // A movie of a different system isn't played
+
+    TEST_CHECK(Movie_PlaySet(TEST_MOVIE_PATH) == 0);
+    Movie_BeforeLoad(MOVIE_SYSTEM_GBA);
+    Movie_AfterLoad(test_rom, sizeof(test_rom), 1);
+    TEST_CHECK(Movie_IsPlaying() == 0);
+    Movie_Stop();
+
+    // Invalid movie files are rejected
+
+    test_save_write("GBMOVIE2 is not a movie");
+    TEST_CHECK(Movie_PlaySet(TEST_SAVE_PATH) != 0);
+
+    remove(TEST_MOVIE_PATH);
+    remove(TEST_SAVE_PATH);
+
+    return Test_Result();
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019-2020, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <string.h>
+
+#include "general_utils.h"
+#include "rom_cache.h"
+
+#include "test.h"
+
+#define TEST_ROM_SIZE (32 * 1024)
+
+static u8 test_rom[TEST_ROM_SIZE];
+
+static void test_file_write(const char *path, const u8 *data, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return;
+    fwrite(data, size, 1, f);
+    fclose(f);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(test_rom); i++)
+        test_rom[i] = (u8)((i * 7) ^ (i >> 8));
+
+    test_file_write("test_rom_a.gb", test_rom, sizeof(test_rom));
+    test_file_write("test_rom_copy.gb", test_rom, sizeof(test_rom));
+
+    // Two bytes with bit 7 flipped. They are the most significant byte of two
+    // different 64-bit words.
+    test_rom[7] ^= 0x80;
+    test_rom[8007] ^= 0x80;
+    test_file_write("test_rom_b.gb", test_rom, sizeof(test_rom));
+
+    size_t size_a, size_b, size_copy;
+    const u8 *a = RomCacheAcquire("test_rom_a.gb", 0, &size_a);
+    const u8 *b = RomCacheAcquire("test_rom_b.gb", 0, &size_b);
+    const u8 *copy = RomCacheAcquire("test_rom_copy.gb", 0, &size_copy);
+
+    TEST_CHECK((a != NULL) && (b != NULL) && (copy != NULL));
+    TEST_CHECK((size_a == TEST_ROM_SIZE) && (size_b == TEST_ROM_SIZE));
+
+    // Files with different contents are never shared
+    TEST_CHECK(a != b);
+    TEST_CHECK(memcmp(b, test_rom, TEST_ROM_SIZE) == 0);
+
+    // Copies of the same file are shared
+    TEST_CHECK(a == copy);
+
+    // The same file is shared
+    size_t size_again;
+    const u8 *again = RomCacheAcquire("test_rom_b.gb", 0, &size_again);
+    TEST_CHECK(again == b);
+
+    // Padded buffers aren't shared with buffers that aren't padded
+    size_t size_padded;
+    const u8 *padded = RomCacheAcquire("test_rom_a.gb", 2 * TEST_ROM_SIZE,
+                                       &size_padded);
+    TEST_CHECK((padded != NULL) && (padded != a));
+    TEST_CHECK(size_padded == TEST_ROM_SIZE);
+    TEST_CHECK((padded != NULL) && (padded[TEST_ROM_SIZE] == 0)
+               && (padded[2 * TEST_ROM_SIZE - 1] == 0));
+
+    RomCacheRelease(padded);
+    RomCacheRelease(again);
+    RomCacheRelease(copy);
+    RomCacheRelease(b);
+    RomCacheRelease(a);
+
+    // The last files that have been released are kept in the cache
+    const u8 *a_reloaded = RomCacheAcquire("test_rom_a.gb", 0, &size_a);
+    TEST_CHECK(a_reloaded == a);
+    RomCacheRelease(a_reloaded);
+
+    remove("test_rom_a.gb");
+    remove("test_rom_b.gb");
+    remove("test_rom_copy.gb");
+
+    return Test_Result();
+}